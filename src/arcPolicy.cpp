@@ -0,0 +1,174 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "arcPolicy.h"
+
+namespace badgerdb {
+
+ArcPolicy::ArcPolicy(const std::uint32_t bufs)
+	: accesses(bufs), capacity(bufs), p(0), prev(bufs), next(bufs), owner(bufs, NULL),
+	  t1(prev, next, owner), t2(prev, next, owner), b1(bufs), b2(bufs), keys(bufs)
+{
+  for (std::uint32_t i = bufs; i > 0; i--)
+    freeFrames.push_back(i - 1);
+}
+
+void ArcPolicy::loaded(const FrameId frame, const File* file, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  PageKey key = {file, pageNo};
+  keys[frame] = key;
+
+  // A page coming back from either ghost list has been seen twice
+  if (b1.remove(key) || b2.remove(key)) {
+    t2.pushFront(frame);
+  }
+  else {
+    t1.pushFront(frame);
+    // Keep the directory within its bounds: |T1| + |B1| <= c and the total <= 2c
+    if (t1.size() + b1.size() > capacity)
+      b1.dropOldest();
+  }
+  if (t1.size() + t2.size() + b1.size() + b2.size() > 2 * capacity)
+    b2.dropOldest();
+}
+
+void ArcPolicy::accessed(const FrameId frame)
+{
+  accesses.record(frame);
+}
+
+void ArcPolicy::applyAccesses()
+{
+  accesses.replay([this](const FrameId frame, const std::uint32_t hits) {
+    if (frame >= capacity)
+      return;
+    if (t1.contains(frame)) {
+      t1.erase(frame);
+      t2.pushFront(frame);
+    }
+    else if (t2.contains(frame)) {
+      t2.moveToFront(frame);
+    }
+  });
+}
+
+void ArcPolicy::freed(const FrameId frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  if (t1.contains(frame))
+    t1.erase(frame);
+  else if (t2.contains(frame))
+    t2.erase(frame);
+  else
+    return;
+  freeFrames.push_back(frame);
+}
+
+// A frame already in T1 keeps its place; one the previous page had promoted to T2 goes
+// back to T1.  Neither page enters a ghost list, so the scan does not move p
+void ArcPolicy::recycled(const FrameId frame, const File* file, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  PageKey key = {file, pageNo};
+  keys[frame] = key;
+  if (t2.contains(frame)) {
+    t2.erase(frame);
+    t1.pushFront(frame);
+  }
+}
+
+bool ArcPolicy::victim(FrameReclaimer& reclaimer, const File* file, const PageId pageNo, FrameId& frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  PageKey key = {file, pageNo};
+
+  // Adapt the target size of T1 on a ghost hit
+  const bool inB2 = b2.contains(key);
+  if (b1.contains(key)) {
+    const std::size_t delta = std::max<std::size_t>(b1.size() ? b2.size() / b1.size() : 1, 1);
+    p = std::min(capacity, p + delta);
+  }
+  else if (inB2) {
+    const std::size_t delta = std::max<std::size_t>(b2.size() ? b1.size() / b2.size() : 1, 1);
+    p = p > delta ? p - delta : 0;
+  }
+
+  if (!freeFrames.empty() && reclaimer.reclaim(freeFrames.back())) {
+    frame = freeFrames.back();
+    freeFrames.pop_back();
+    return true;
+  }
+
+  // REPLACE: evict from T1 if it exceeds its target, otherwise from T2, falling back to
+  // the other list if every page of the preferred one is pinned
+  const bool fromT1 = t1.size() > 0 && (t1.size() > p || (inB2 && t1.size() == p));
+  if (fromT1 && t1.reclaimOldest(reclaimer, frame)) {
+    b1.add(keys[frame]);
+    return true;
+  }
+  if (t2.reclaimOldest(reclaimer, frame)) {
+    b2.add(keys[frame]);
+    return true;
+  }
+  if (t1.reclaimOldest(reclaimer, frame)) {
+    b1.add(keys[frame]);
+    return true;
+  }
+  return false;
+}
+
+void ArcPolicy::upcoming(const std::size_t count, std::vector<FrameId>& frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  const std::size_t first = frames.size();
+  if (t1.size() > p)
+    t1.oldest(std::min(count, t1.size() - p), frames);
+  t2.oldest(count - (frames.size() - first), frames);
+  // With T2 empty the victims come from T1 whatever its target
+  if (frames.size() == first)
+    t1.oldest(count, frames);
+}
+
+// Pages of dropped frames that were in T2 go to B2, so that the page the buffer manager
+// moves to another frame goes back to T2 when it is loaded there; pages of T1 go back
+// to T1 anyway.  The ghost lists are then trimmed to the bounds of the new c
+void ArcPolicy::resize(const std::uint32_t frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  for (FrameId f = frames; f < capacity; f++) {
+    if (t1.contains(f)) {
+      t1.erase(f);
+    }
+    else if (t2.contains(f)) {
+      t2.erase(f);
+      b2.add(keys[f]);
+    }
+  }
+  freeFrames.erase(std::remove_if(freeFrames.begin(), freeFrames.end(),
+      [frames](const FrameId f) { return f >= frames; }), freeFrames.end());
+  for (FrameId f = frames; f > capacity; f--)
+    freeFrames.push_back(f - 1);
+  capacity = frames;
+
+  p = std::min(p, capacity);
+  b1.resize(capacity);
+  b2.resize(capacity);
+  while (b1.size() > 0 && t1.size() + b1.size() > capacity)
+    b1.dropOldest();
+  while (b2.size() > 0 && t1.size() + t2.size() + b1.size() + b2.size() > 2 * capacity)
+    b2.dropOldest();
+}
+
+}
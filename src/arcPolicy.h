@@ -0,0 +1,101 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "bufPolicy.h"
+
+namespace badgerdb {
+
+/**
+* @brief Adaptive Replacement Cache (Megiddo and Modha)
+*
+* Resident pages are split between T1 (seen once recently) and T2 (seen at least twice),
+* both LRU ordered.  The ghost lists B1 and B2 remember the pages recently evicted from T1
+* and T2.  A miss that hits B1 means T1 was too small, so the target size p of T1 grows; a
+* miss that hits B2 shrinks it.  The victim comes from T1 while T1 is larger than p and
+* from T2 otherwise, so the split between recency and frequency follows the workload.
+*/
+class ArcPolicy : public BufPolicy
+{
+ private:
+	/**
+	 * Hits not yet applied; record() needs no latch
+	 */
+  AccessLog accesses;
+
+	/**
+	 * Protects all the members below
+	 */
+  std::mutex latch;
+
+	/**
+	 * Number of frames (c in the paper); the arrays below may hold more
+	 */
+  std::size_t capacity;
+
+	/**
+	 * Target size of T1
+	 */
+  std::size_t p;
+
+	/**
+	 * Link arrays shared by t1 and t2
+	 */
+  std::vector<FrameId> prev;
+  std::vector<FrameId> next;
+  std::vector<const FrameList*> owner;
+
+	/**
+	 * Resident pages seen once, and seen at least twice, recently
+	 */
+  FrameList t1;
+  FrameList t2;
+
+	/**
+	 * Pages recently evicted from t1 and from t2
+	 */
+  GhostList b1;
+  GhostList b2;
+
+	/**
+	 * Page held by each resident frame
+	 */
+  std::vector<PageKey> keys;
+
+	/**
+	 * Frames holding no page
+	 */
+  std::vector<FrameId> freeFrames;
+
+	/**
+	 * Applies the hits noted in accesses since the last call; called under the latch
+	 */
+  void applyAccesses();
+
+ public:
+	/**
+   * Constructor of ArcPolicy class
+	 *
+	 * @param bufs   	Number of frames in the buffer pool
+	 */
+  explicit ArcPolicy(const std::uint32_t bufs);
+
+  virtual void loaded(const FrameId frame, const File* file, const PageId pageNo);
+  virtual void accessed(const FrameId frame);
+  virtual void freed(const FrameId frame);
+  virtual void recycled(const FrameId frame, const File* file, const PageId pageNo);
+  virtual bool victim(FrameReclaimer& reclaimer, const File* file, const PageId pageNo, FrameId& frame);
+  virtual void upcoming(const std::size_t count, std::vector<FrameId>& frames);
+  virtual void resize(const std::uint32_t frames);
+  virtual const char* name() const { return "arc"; }
+};
+
+}
@@ -0,0 +1,77 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Page allocation and deletion on a growing file, which stay at a constant cost
+// per page with the allocation map.
+//
+// usage: alloc_map [pages] [reportEvery]
+//
+// alloc:  File::allocatePage until the file holds pages pages; the rate is
+//         reported for every reportEvery pages, so a cost growing with the file
+//         would show as a falling rate.
+// delete: File::deletePage of every tenth page, then allocatePage reusing them.
+// reopen: closing the file (writing the map back) and opening it again.
+// scan:   FileIterator over every used page, without reading the pages.
+
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "file_iterator.h"
+
+using namespace badgerdb;
+
+int main(int argc, char** argv) {
+  const long pages = bench::argOr(argc, argv, 1, 1000000);
+  const long reportEvery = bench::argOr(argc, argv, 2, pages / 10);
+
+  const std::string filename = "bench_alloc_map.db";
+  std::printf("%ld pages (%.1f GB)\n", pages,
+              pages * (Page::SIZE / (1024.0 * 1024.0 * 1024.0)));
+  bench::removeIfExists(filename);
+  {
+    File file = File::create(filename);
+    Page page;
+    bench::Timer timer;
+    for (long i = 1; i <= pages; ++i) {
+      file.allocatePage(page);
+      if (i % reportEvery == 0) {
+        std::printf("alloc   pages %8ld-%-8ld %10.0f pages/s\n",
+                    i - reportEvery + 1, i, reportEvery / timer.seconds());
+        timer.reset();
+      }
+    }
+
+    const long deletes = pages / 10;
+    timer.reset();
+    for (long i = 0; i < deletes; ++i) {
+      file.deletePage(i * 10 + 1);
+    }
+    std::printf("delete  %8ld pages        %10.0f pages/s\n", deletes,
+                deletes / timer.seconds());
+    timer.reset();
+    for (long i = 0; i < deletes; ++i) {
+      file.allocatePage(page);
+    }
+    std::printf("reuse   %8ld pages        %10.0f pages/s\n", deletes,
+                deletes / timer.seconds());
+  }
+
+  {
+    bench::Timer timer;
+    File file = File::open(filename);
+    std::printf("reopen                          %10.3f s\n", timer.seconds());
+    timer.reset();
+    long used = 0;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      ++used;
+    }
+    std::printf("scan    %8ld pages        %10.0f pages/s\n", used,
+                used / timer.seconds());
+  }
+  File::remove(filename);
+  return 0;
+}
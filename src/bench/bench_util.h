@@ -0,0 +1,169 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "page.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+namespace bench {
+
+/**
+ * @brief Wall clock stopwatch used by the benchmarks.
+ */
+class Timer {
+ public:
+  Timer() : start_(std::chrono::steady_clock::now()) {}
+
+  /**
+   * Restarts the stopwatch.
+   */
+  void reset() { start_ = std::chrono::steady_clock::now(); }
+
+  /**
+   * Returns the time elapsed since construction or the last reset().
+   *
+   * @return  Elapsed time in seconds.
+   */
+  double seconds() const {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_).count();
+  }
+
+  /**
+   * Returns the time elapsed since construction or the last reset().
+   *
+   * @return  Elapsed time in nanoseconds.
+   */
+  std::uint64_t nanos() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start_).count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @brief Small, fast pseudo random generator (xorshift64*).  Each benchmark
+ *        thread owns one, so there is no shared state as with random().
+ */
+class Rng {
+ public:
+  explicit Rng(std::uint64_t seed) : state_(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+  std::uint64_t next() {
+    state_ ^= state_ >> 12;
+    state_ ^= state_ << 25;
+    state_ ^= state_ >> 27;
+    return state_ * 0x2545F4914F6CDD1DULL;
+  }
+
+  /**
+   * Returns a value uniformly distributed over [0, bound).
+   */
+  std::uint32_t below(std::uint32_t bound) {
+    return static_cast<std::uint32_t>(next() % bound);
+  }
+
+ private:
+  std::uint64_t state_;
+};
+
+/**
+ * @brief Zipfian distribution over [0, n): value k is drawn with probability
+ *        proportional to 1 / (k + 1)^theta, so 0 is the most popular value.
+ *        Sampling is a binary search over the precomputed CDF.
+ */
+class Zipf {
+ public:
+  Zipf(std::uint32_t n, double theta) : cdf_(n) {
+    double sum = 0;
+    for (std::uint32_t k = 0; k < n; ++k) {
+      sum += 1.0 / std::pow(k + 1.0, theta);
+      cdf_[k] = sum;
+    }
+    for (std::uint32_t k = 0; k < n; ++k) {
+      cdf_[k] /= sum;
+    }
+  }
+
+  std::uint32_t next(Rng& rng) const {
+    const double u = (rng.next() >> 11) * (1.0 / 9007199254740992.0);
+    std::vector<double>::const_iterator it =
+        std::lower_bound(cdf_.begin(), cdf_.end(), u);
+    return it == cdf_.end() ? cdf_.size() - 1 : it - cdf_.begin();
+  }
+
+ private:
+  std::vector<double> cdf_;
+};
+
+/**
+ * Returns argv[index] as a number, or fallback if the argument is missing.
+ */
+inline long argOr(int argc, char** argv, int index, long fallback) {
+  return argc > index ? std::strtol(argv[index], NULL, 10) : fallback;
+}
+
+/**
+ * Deletes the named file if it exists.
+ */
+inline void removeIfExists(const std::string& filename) {
+  try {
+    File::remove(filename);
+  } catch (FileNotFoundException&) {
+  }
+}
+
+/**
+ * Writes the named file back and drops it from the page cache, so the next reads
+ * of it go to the device.
+ */
+inline void dropCache(const std::string& filename) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+/**
+ * Creates a fresh file holding numPages pages, each with one small record.
+ * Page numbers run from 1 to numPages.
+ */
+inline File makeFile(const std::string& filename, PageId numPages,
+                     const FileOptions& options = FileOptions()) {
+  removeIfExists(filename);
+  File file = File::create(filename, options);
+  char record[64];
+  for (PageId i = 0; i < numPages; ++i) {
+    Page page = file.allocatePage();
+    std::snprintf(record, sizeof(record), "bench page %u", page.page_number());
+    page.insertRecord(record);
+    file.writePage(page);
+  }
+  return file;
+}
+
+}
+}
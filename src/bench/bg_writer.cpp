@@ -0,0 +1,97 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// readPage miss latency under a write-heavy load, with and without the background writer.
+//
+// usage: bg_writer [filePages] [frames] [ops] [thinkUs]
+//
+// One thread reads Zipf(0.9) distributed pages and dirties 70% of them.  Every 16
+// accesses it sleeps for thinkUs microseconds, standing in for waiting on clients; that
+// is the time the writer gets to clean frames ahead of the clock.  With thinkUs 0 the
+// writer only gets the cycles the scheduler takes from the foreground thread.
+// Reports miss latency percentiles, the dirty victims misses had to write themselves
+// and the writer's counters.
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+void run(const char* name, const BufMgrOptions& options, File& file, std::uint32_t frames,
+         const std::vector<PageId>& trace, std::uint64_t thinkUs) {
+  BufMgr bufMgr(frames, options);
+  bench::Rng rng(3);
+  Page* page;
+
+  bench::Timer timer;
+  for (std::size_t i = 0; i < trace.size(); ++i) {
+    bufMgr.readPage(&file, trace[i], page);
+    bufMgr.unPinPage(&file, trace[i], rng.below(10) < 7);
+    if (thinkUs > 0 && i % 16 == 15) {
+      std::this_thread::sleep_for(std::chrono::microseconds(thinkUs));
+    }
+  }
+  const double secs = timer.seconds();
+
+  const BufStats stats = bufMgr.getBufStats();
+  const BufWriterStats& writer = bufMgr.getWriterStats();
+  std::printf("%-14s %8.0f ops/s  misses %6llu  miss p50 %6.1f us  p99 %6.1f us  p99.9 %6.1f us"
+              "  victim writes %6llu  writer wrote %6llu (clean %llu, %llu passes)\n",
+              name, trace.size() / secs, (unsigned long long)stats.missLatency.total,
+              stats.missLatency.percentile(0.5) / 1000.0,
+              stats.missLatency.percentile(0.99) / 1000.0,
+              stats.missLatency.percentile(0.999) / 1000.0,
+              (unsigned long long)stats.victimwrites,
+              (unsigned long long)writer.pagesWritten.load(),
+              (unsigned long long)writer.alreadyClean.load(),
+              (unsigned long long)writer.passes.load());
+  bufMgr.flushFile(&file);
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId filePages = bench::argOr(argc, argv, 1, 2000);
+  const std::uint32_t frames = bench::argOr(argc, argv, 2, 200);
+  const long ops = bench::argOr(argc, argv, 3, 100000);
+  const std::uint64_t thinkUs = bench::argOr(argc, argv, 4, 100);
+
+  bench::Rng rng(11);
+  bench::Zipf zipf(filePages, 0.9);
+  std::vector<PageId> trace(ops);
+  for (long i = 0; i < ops; ++i) {
+    trace[i] = zipf.next(rng) + 1;
+  }
+
+  const std::string filename = "bench_writer.db";
+  std::printf("file %u pages, pool %u frames, %ld ops, %llu us idle per 16 ops\n", filePages,
+              frames, ops, (unsigned long long)thinkUs);
+  {
+    File file = bench::makeFile(filename, filePages);
+
+    BufMgrOptions off;
+    run("no writer", off, file, frames, trace, thinkUs);
+
+    BufMgrOptions on;
+    on.backgroundWriter = true;
+    run("writer", on, file, frames, trace, thinkUs);
+
+    BufMgrOptions limited;
+    limited.backgroundWriter = true;
+    limited.writerPagesPerSec = 20000;
+    run("writer 20k/s", limited, file, frames, trace, thinkUs);
+  }
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,175 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Foreground throughput while the log is checkpointed, and how much log
+// recovery then reads.
+//
+// usage: checkpoint [seconds] [opsPerSec] [filePages] [checkpointMB]
+//
+// Worker threads change 8 bytes of random pages of a file the buffer pool
+// holds whole, logging each change with LogManager::logUpdate, at opsPerSec
+// changes per second between them.  Whenever checkpointMB have been logged
+// since the last checkpoint:
+// none:  nothing happens; recovery reads the whole log.
+// sharp: the workers are stopped between changes while BufMgr::flushFile
+//        writes every dirty page and the log start is moved to its end.
+// fuzzy: the checkpointer thread (BufMgrOptions::checkpointLogBytes) runs
+//        BufMgr::checkpoint while the workers go on.
+// Throughput is sampled every 100 ms; "worst" is the slowest sample, which
+// stays near opsPerSec as long as nothing holds the workers up.
+// "recover" reopens the log and times LogManager::recover.
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+#include "log_manager.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_checkpoint.db";
+const std::string kLogname = "bench_checkpoint.log";
+const int kThreads = 4;
+
+enum Mode { NONE, SHARP, FUZZY };
+
+struct Result {
+  double rate;
+  double worst;
+  double logMb;
+  double recoverMs;
+  std::uint64_t checkpoints;
+};
+
+Result run(Mode mode, double seconds, long opsPerSec, PageId filePages,
+           long checkpointMb) {
+  unlink(kLogname.c_str());
+  Result result;
+  {
+    File file = File::open(kFilename);
+    // A log buffer large enough that its own flushes do not stall the workers
+    LogOptions logOptions;
+    logOptions.buffer_bytes = 64 << 20;
+    LogManager log(kLogname, logOptions);
+    BufMgrOptions options;
+    options.log = &log;
+    if (mode == FUZZY) {
+      options.checkpointLogBytes = checkpointMb << 20;
+    }
+    BufMgr bufMgr(filePages + 1, options);
+
+    // Workers hold quiesce around every change; a sharp checkpoint takes it
+    std::mutex quiesce[kThreads];
+    std::atomic<long> ops(0);
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> workers;
+    bench::Timer timer;
+    for (int t = 0; t < kThreads; ++t) {
+      workers.push_back(std::thread([&, t]() {
+        bench::Rng rng(t + 1);
+        const double rate = double(opsPerSec) / kThreads;
+        for (std::uint64_t c = 0; !stop; ++c) {
+          // A worker that fell behind catches up at full speed
+          while (c >= rate * timer.seconds() && !stop) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+          }
+          const PageId pageNo =
+              rng.below(filePages / kThreads) * kThreads + t + 1;
+          std::lock_guard<std::mutex> guard(quiesce[t]);
+          Page* page;
+          bufMgr.readPage(&file, pageNo, page);
+          std::memcpy(reinterpret_cast<char*>(page) + Page::SIZE - 8, &c, 8);
+          log.logUpdate(file, *page, Page::SIZE - 8, 8);
+          bufMgr.unPinPage(&file, pageNo, true);
+          ++ops;
+        }
+      }));
+    }
+
+    std::vector<double> samples;
+    std::uint64_t sharpCheckpoints = 0;
+    Lsn lastCheckpoint = log.startLsn();
+    bench::Timer sample;
+    long lastOps = 0;
+    while (timer.seconds() < seconds) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      if (mode == SHARP &&
+          log.endLsn() - lastCheckpoint >= Lsn(checkpointMb) << 20) {
+        for (int t = 0; t < kThreads; ++t) {
+          quiesce[t].lock();
+        }
+        lastCheckpoint = log.endLsn();
+        bufMgr.flushFile(&file);
+        log.checkpoint(lastCheckpoint);
+        ++sharpCheckpoints;
+        for (int t = 0; t < kThreads; ++t) {
+          quiesce[t].unlock();
+        }
+      }
+      if (sample.seconds() >= 0.1) {
+        const long now = ops.load();
+        samples.push_back((now - lastOps) / sample.seconds());
+        lastOps = now;
+        sample.reset();
+      }
+    }
+    stop = true;
+    for (int t = 0; t < kThreads; ++t) {
+      workers[t].join();
+    }
+    result.rate = ops.load() / timer.seconds();
+    result.worst = *std::min_element(samples.begin(), samples.end());
+    result.logMb = (log.endLsn() - log.startLsn()) / double(1 << 20);
+    result.checkpoints = mode == FUZZY
+                             ? bufMgr.getCheckpointStats().checkpoints.load()
+                             : sharpCheckpoints;
+    bufMgr.flushFile(&file);
+  }
+
+  LogManager log(kLogname);
+  bench::Timer timer;
+  log.recover();
+  result.recoverMs = timer.seconds() * 1e3;
+  return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const double seconds = bench::argOr(argc, argv, 1, 6);
+  const long opsPerSec = bench::argOr(argc, argv, 2, 50000);
+  const PageId filePages = bench::argOr(argc, argv, 3, 16384);
+  const long checkpointMb = bench::argOr(argc, argv, 4, 4);
+
+  std::printf("%d threads, %.0f s at %ld ops/s, file %u pages, checkpoint "
+              "every %ld MB of log\n", kThreads, seconds, opsPerSec, filePages,
+              checkpointMb);
+  {
+    File file = bench::makeFile(kFilename, filePages);
+  }
+  std::printf("%-6s %6s %10s %10s %10s %10s\n", "mode", "ckpts", "ops/s",
+              "worst", "log MB", "recover ms");
+  const char* names[3] = {"none", "sharp", "fuzzy"};
+  for (int mode = NONE; mode <= FUZZY; ++mode) {
+    const Result result = run(Mode(mode), seconds, opsPerSec, filePages,
+                              checkpointMb);
+    std::printf("%-6s %6lu %10.0f %10.0f %10.1f %10.1f\n", names[mode],
+                (unsigned long)result.checkpoints, result.rate, result.worst,
+                result.logMb, result.recoverMs);
+  }
+  File::remove(kFilename);
+  unlink(kLogname.c_str());
+  return 0;
+}
@@ -0,0 +1,90 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Cost of page checksums: CRC-32C of a page, and File::writePage and
+// File::readPage with and without FileOptions::checksums.
+//
+// usage: checksum [filePages] [ops]
+//
+// crc:   File::pageChecksum of one page, with the SSE4.2 instruction when the
+//        CPU has it and with the table driven fallback.
+// write: File::writePage of random pages of a file of filePages pages; the
+//        page cache holds the file, so the pwrite is a copy.
+// read:  File::readPage of random pages, warm, which checks the checksum the
+//        pages carry when written with one.
+
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "crc32c.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_checksum.db";
+
+// Returns the nanoseconds per write and per read of random pages of a file
+// created with or without checksums.
+void pageOps(bool checksums, PageId filePages, long ops, double& writeNs,
+             double& readNs) {
+  FileOptions options;
+  options.checksums = checksums;
+  File file = bench::makeFile(kFilename, filePages, options);
+  bench::Rng rng(7);
+  Page page = file.readPage(1);
+
+  bench::Timer timer;
+  for (long i = 0; i < ops; ++i) {
+    const PageId pageNo = rng.below(filePages) + 1;
+    file.readPage(pageNo, page);
+    file.writePage(page);
+  }
+  const double both = timer.seconds();
+  timer.reset();
+  for (long i = 0; i < ops; ++i) {
+    file.readPage(rng.below(filePages) + 1, page);
+  }
+  readNs = timer.seconds() * 1e9 / ops;
+  writeNs = both * 1e9 / ops - readNs;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId filePages = bench::argOr(argc, argv, 1, 2048);
+  const long ops = bench::argOr(argc, argv, 2, 200000);
+
+  std::printf("file %u pages, %ld ops, crc32 instruction %s\n", filePages, ops,
+              crc32cHardware() ? "used" : "not available");
+  Page page;
+  page.insertRecord("checksum bench");
+  volatile std::uint32_t sink = 0;
+  bench::Timer timer;
+  for (long i = 0; i < ops; ++i) {
+    sink += File::pageChecksum(page);
+  }
+  std::printf("crc   crc32c    %8.0f ns/page\n", timer.seconds() * 1e9 / ops);
+  timer.reset();
+  const long softOps = ops / 10;
+  for (long i = 0; i < softOps; ++i) {
+    sink += crc32cSoftware(i, &page, Page::SIZE);
+  }
+  std::printf("crc   software  %8.0f ns/page\n",
+              timer.seconds() * 1e9 / softOps);
+
+  double writeOff, readOff, writeOn, readOn;
+  pageOps(false, filePages, ops, writeOff, readOff);
+  pageOps(true, filePages, ops, writeOn, readOn);
+  std::printf("%-15s %8s %8s %8s\n", "ns/op", "off", "on", "cost");
+  std::printf("%-15s %8.0f %8.0f %8.0f\n", "write", writeOff, writeOn,
+              writeOn - writeOff);
+  std::printf("%-15s %8.0f %8.0f %8.0f\n", "read", readOff, readOn,
+              readOn - readOff);
+  File::remove(kFilename);
+  return 0;
+}
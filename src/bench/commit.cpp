@@ -0,0 +1,140 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Commit throughput when every commit forces its pages to the file, and when
+// it only forces a write-ahead log (LogManager) and leaves the pages in the
+// buffer pool.
+//
+// usage: commit [commitsPerThread] [filePages]
+//
+// Each transaction changes the last 8 bytes of pagesPerTxn random pages, out
+// of a share of the file no other thread touches, then commits.
+// force: writes the pages with File::writePage in one File::SyncBatch, so a
+//        commit costs the page writes and an fdatasync of the file.
+// wal:   logs each change with LogManager::logUpdate through a BufMgr holding
+//        the whole file, then LogManager::commit; concurrent commits share
+//        the log's fdatasync, reported as syncs per commit.
+
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+#include "log_manager.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_commit.db";
+const std::string kLogname = "bench_commit.log";
+
+// Changes the last 8 bytes of the page, which hold the end of its record.
+void touch(Page& page, std::uint64_t value) {
+  std::memcpy(reinterpret_cast<char*>(&page) + Page::SIZE - 8, &value, 8);
+}
+
+// Runs threads threads of commits transactions each and returns the commits
+// per second.
+template <typename Txn>
+double run(int threads, long commits, PageId filePages, int pagesPerTxn,
+           const Txn& txn) {
+  std::vector<std::thread> workers;
+  bench::Timer timer;
+  for (int t = 0; t < threads; ++t) {
+    workers.push_back(std::thread([=, &txn]() {
+      bench::Rng rng(t + 1);
+      std::vector<PageId> pages(pagesPerTxn);
+      for (long c = 0; c < commits; ++c) {
+        for (int p = 0; p < pagesPerTxn; ++p) {
+          // Pages t + 1, t + 1 + threads, ... belong to thread t
+          pages[p] = rng.below(filePages / threads) * threads + t + 1;
+        }
+        txn(pages, c);
+      }
+    }));
+  }
+  for (std::size_t t = 0; t < workers.size(); ++t) {
+    workers[t].join();
+  }
+  return threads * commits / timer.seconds();
+}
+
+double forceRate(int threads, long commits, PageId filePages,
+                 int pagesPerTxn) {
+  FileOptions options;
+  options.durability = SYNC_PER_BATCH;
+  File file = File::open(kFilename, options);
+  return run(threads, commits, filePages, pagesPerTxn,
+             [&file](const std::vector<PageId>& pages, long c) {
+    File::SyncBatch batch;
+    for (std::size_t p = 0; p < pages.size(); ++p) {
+      Page page = file.readPage(pages[p]);
+      touch(page, c);
+      file.writePage(page);
+    }
+    batch.commit();
+  });
+}
+
+double walRate(int threads, long commits, PageId filePages, int pagesPerTxn,
+               double& syncsPerCommit) {
+  unlink(kLogname.c_str());
+  File file = File::open(kFilename);
+  LogManager log(kLogname);
+  BufMgrOptions options;
+  options.log = &log;
+  BufMgr bufMgr(filePages + 1, options);
+  const std::uint64_t syncs = log.syncs();
+  const double rate = run(threads, commits, filePages, pagesPerTxn,
+                          [&](const std::vector<PageId>& pages, long c) {
+    for (std::size_t p = 0; p < pages.size(); ++p) {
+      Page* page;
+      bufMgr.readPage(&file, pages[p], page);
+      touch(*page, c);
+      log.logUpdate(file, *page, Page::SIZE - 8, 8);
+      bufMgr.unPinPage(&file, pages[p], true);
+    }
+    log.commit();
+  });
+  syncsPerCommit = (log.syncs() - syncs) / double(threads * commits);
+  return rate;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const long commits = bench::argOr(argc, argv, 1, 500);
+  const PageId filePages = bench::argOr(argc, argv, 2, 4096);
+
+  std::printf("%ld commits per thread, file %u pages (commits/s)\n", commits,
+              filePages);
+  {
+    File file = bench::makeFile(kFilename, filePages);
+  }
+  std::printf("%-8s %-6s %10s %10s %12s\n", "threads", "pages", "force", "wal",
+              "syncs/commit");
+  const int threadCounts[3] = {1, 4, 8};
+  const int pageCounts[2] = {1, 8};
+  for (int pc = 0; pc < 2; ++pc) {
+    for (int tc = 0; tc < 3; ++tc) {
+      const int threads = threadCounts[tc];
+      const int pages = pageCounts[pc];
+      const double force = forceRate(threads, commits, filePages, pages);
+      double syncsPerCommit;
+      const double wal = walRate(threads, commits, filePages, pages,
+                                 syncsPerCommit);
+      std::printf("%-8d %-6d %10.0f %10.0f %12.2f\n", threads, pages, force,
+                  wal, syncsPerCommit);
+    }
+  }
+  File::remove(kFilename);
+  unlink(kLogname.c_str());
+  return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Memory a buffered and an O_DIRECT file cost next to a buffer pool, and
+// throughput when both are given the same total memory.
+//
+// usage: direct_io [filePages] [frames] [ops]
+//
+// Every run makes Zipfian (theta 0.9) page reads over the file through a
+// BufMgr, starting with the file dropped from the page cache; the first ops
+// reads warm the pool and the next ops are timed.  Memory is the pool plus the
+// pages of the file resident in the page cache afterwards (counted with
+// mincore), i.e. what caching this file costs in total.
+//
+// buffered:        frames frames, file opened without O_DIRECT
+// direct:          frames frames, O_DIRECT
+// direct, same RAM: O_DIRECT with as many frames as the buffered run used
+//                  memory in total
+
+#include <sys/mman.h>
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+// Returns the number of pages of the named file that are in the page cache.
+std::size_t cachedPages(const std::string& filename) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  const off_t size = lseek(fd, 0, SEEK_END);
+  void* map = size > 0 ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (map == MAP_FAILED) {
+    return 0;
+  }
+  const long osPage = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> resident((size + osPage - 1) / osPage);
+  std::size_t count = 0;
+  if (mincore(map, size, &resident[0]) == 0) {
+    for (std::size_t i = 0; i < resident.size(); ++i) {
+      count += resident[i] & 1;
+    }
+  }
+  munmap(map, size);
+  return count * osPage / Page::SIZE;
+}
+
+// Runs the workload and returns the total memory used, in pages.
+std::size_t run(const char* label, const std::string& filename, PageId filePages,
+                std::uint32_t frames, bool direct, long ops) {
+  bench::dropCache(filename);
+  FileOptions fileOptions;
+  fileOptions.direct_io = direct;
+  File file = File::open(filename, fileOptions);
+  const bench::Zipf zipf(filePages, 0.9);
+  bench::Rng rng(11);
+
+  BufMgr bufMgr(frames);
+  Page* page;
+  for (long i = 0; i < ops; ++i) {
+    const PageId pageNo = zipf.next(rng) + 1;
+    bufMgr.readPage(&file, pageNo, page);
+    bufMgr.unPinPage(&file, pageNo, false);
+  }
+  bufMgr.clearBufStats();
+  bench::Timer timer;
+  for (long i = 0; i < ops; ++i) {
+    const PageId pageNo = zipf.next(rng) + 1;
+    bufMgr.readPage(&file, pageNo, page);
+    bufMgr.unPinPage(&file, pageNo, false);
+  }
+  const double secs = timer.seconds();
+  const BufStats stats = bufMgr.getBufStats();
+
+  const std::size_t cached = cachedPages(filename);
+  const double mb = Page::SIZE / (1024.0 * 1024.0);
+  std::printf("%-17s %s  pool %7.1f MB + page cache %7.1f MB = %7.1f MB"
+              "  hit ratio %6.2f%%  %9.0f reads/s\n",
+              label, file.directIo() ? "O_DIRECT" : "buffered", frames * mb,
+              cached * mb, (frames + cached) * mb,
+              100.0 * (1.0 - stats.diskreads / double(ops)), ops / secs);
+  return frames + cached;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId filePages = bench::argOr(argc, argv, 1, 16384);
+  const std::uint32_t frames = bench::argOr(argc, argv, 2, 2048);
+  const long ops = bench::argOr(argc, argv, 3, 200000);
+
+  const std::string filename = "bench_direct_io.db";
+  std::printf("file %u pages (%.0f MB), %ld reads\n", filePages,
+              filePages * (Page::SIZE / (1024.0 * 1024.0)), ops);
+  {
+    File file = bench::makeFile(filename, filePages);
+  }
+  const std::size_t bufferedMemory = run("buffered", filename, filePages, frames, false, ops);
+  run("direct", filename, filePages, frames, true, ops);
+  run("direct, same RAM", filename, filePages, bufferedMemory, true, ops);
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Throughput of page allocation and write-back under each FileDurability.
+//
+// usage: durability [allocsPerThread] [frames] [groupCommitUs]
+//
+// alloc:     1 and 4 threads each call File::allocatePage allocsPerThread times
+//            on a fresh file; every call is one batch.
+// flushFile: frames pages are dirtied in a BufMgr and written back by one
+//            flushFile(), one batch for all of them.
+// evict:     2 * frames pages are dirtied through a BufMgr of frames frames, so
+//            every miss writes back its victim in a batch of its own.
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_durability.db";
+
+FileOptions optionsFor(FileDurability durability, unsigned groupCommitUs) {
+  FileOptions options;
+  options.durability = durability;
+  options.group_commit_us = groupCommitUs;
+  return options;
+}
+
+// Returns the pages allocated per second by threads threads.
+double allocRate(const FileOptions& options, int threads, long allocs) {
+  bench::removeIfExists(kFilename);
+  File file = File::create(kFilename, options);
+  std::vector<std::thread> workers;
+  bench::Timer timer;
+  for (int t = 0; t < threads; ++t) {
+    workers.push_back(std::thread([&file, allocs]() {
+      Page page;
+      for (long i = 0; i < allocs; ++i) {
+        file.allocatePage(page);
+      }
+    }));
+  }
+  for (std::size_t t = 0; t < workers.size(); ++t) {
+    workers[t].join();
+  }
+  return threads * allocs / timer.seconds();
+}
+
+// Dirties pages pages through a pool of frames frames, then flushes the file,
+// and returns the pages written per second.
+double writeBackRate(const FileOptions& options, std::uint32_t frames,
+                     PageId pages) {
+  {
+    File file = bench::makeFile(kFilename, pages);
+  }
+  File file = File::open(kFilename, options);
+  BufMgrOptions bufOptions;
+  bufOptions.streamIo = true;
+  BufMgr bufMgr(frames, bufOptions);
+  Page* page;
+  bench::Timer timer;
+  for (PageId pageNo = 1; pageNo <= pages; ++pageNo) {
+    bufMgr.readPage(&file, pageNo, page);
+    bufMgr.unPinPage(&file, pageNo, true);
+  }
+  bufMgr.flushFile(&file);
+  return pages / timer.seconds();
+}
+
+}
+
+int main(int argc, char** argv) {
+  const long allocs = bench::argOr(argc, argv, 1, 200);
+  const std::uint32_t frames = bench::argOr(argc, argv, 2, 256);
+  const unsigned groupCommitUs = bench::argOr(argc, argv, 3, 0);
+
+  const FileDurability modes[3] = {NO_SYNC, SYNC_PER_BATCH, GROUP_COMMIT};
+  const char* names[3] = {"none", "per batch", "group commit"};
+  std::printf("%ld allocations per thread, %u frames, %u us commit window "
+              "(pages/s)\n", allocs, frames, groupCommitUs);
+  std::printf("%-13s %10s %10s %10s %10s\n", "durability", "alloc x1",
+              "alloc x4", "flushFile", "evict");
+  for (int m = 0; m < 3; ++m) {
+    const FileOptions options = optionsFor(modes[m], groupCommitUs);
+    const double alloc1 = allocRate(options, 1, allocs);
+    const double alloc4 = allocRate(options, 4, allocs);
+    const double flush = writeBackRate(options, frames, frames);
+    const double evict = writeBackRate(options, frames, 2 * frames);
+    std::printf("%-13s %10.0f %10.0f %10.0f %10.0f\n", names[m], alloc1,
+                alloc4, flush, evict);
+  }
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Random page reads from one file by 1, 2 and 4 threads, through File (pread on a
+// descriptor shared by every File object of the file) and through a shared fstream.
+//
+// usage: file_io [filePages] [readsPerThread]
+//
+// pread:   File::readPage(pageNo, Page&); the threads never wait for each other.
+// fstream: what File used to do: one std::fstream per file shared by all its File
+//          objects, so every read holds a latch around seekg() and the two read()
+//          calls for the page header and the page data.
+// The file is cached, so the numbers show the cost of the calls and of the latch
+// rather than of the device.
+
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+// Reads pages the way File did before it used positional I/O.
+class StreamReader {
+ public:
+  explicit StreamReader(const std::string& filename)
+      : stream_(filename.c_str(), std::ios::in | std::ios::binary) {}
+
+  void readPage(PageId page_number, Page& page) {
+    std::lock_guard<std::mutex> guard(latch_);
+    char* bytes = reinterpret_cast<char*>(&page);
+    stream_.seekg(sizeof(FileHeader) + (page_number - 1) * Page::SIZE, std::ios::beg);
+    stream_.read(bytes, sizeof(PageHeader));
+    stream_.read(bytes + sizeof(PageHeader), Page::DATA_SIZE);
+  }
+
+ private:
+  std::fstream stream_;
+  std::mutex latch_;
+};
+
+// Runs threads threads that each read reads random pages through read(rng, page) and
+// returns the total number of reads per second.
+template <typename ReadFn>
+double readRate(int threads, long reads, ReadFn read) {
+  std::vector<std::thread> workers;
+  bench::Timer timer;
+  for (int t = 0; t < threads; ++t) {
+    workers.push_back(std::thread([t, reads, &read]() {
+      bench::Rng rng(t + 1);
+      Page page;
+      for (long i = 0; i < reads; ++i) {
+        read(rng, page);
+      }
+    }));
+  }
+  for (std::size_t t = 0; t < workers.size(); ++t) {
+    workers[t].join();
+  }
+  return threads * reads / timer.seconds();
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId filePages = bench::argOr(argc, argv, 1, 4096);
+  const long reads = bench::argOr(argc, argv, 2, 200000);
+
+  const std::string filename = "bench_file_io.db";
+  std::printf("file %u pages, %ld random reads per thread\n", filePages, reads);
+  {
+    File file = bench::makeFile(filename, filePages);
+    StreamReader stream(filename);
+    const int threadCounts[3] = {1, 2, 4};
+    for (int i = 0; i < 3; ++i) {
+      const int threads = threadCounts[i];
+      const double pread = readRate(threads, reads, [&](bench::Rng& rng, Page& page) {
+        file.readPage(rng.below(filePages) + 1, page);
+      });
+      const double fstream = readRate(threads, reads, [&](bench::Rng& rng, Page& page) {
+        stream.readPage(rng.below(filePages) + 1, page);
+      });
+      std::printf("%d thread%s  pread %10.0f reads/s  fstream %10.0f reads/s  (%.2fx)\n",
+                  threads, threads > 1 ? "s" : " ", pread, fstream, pread / fstream);
+    }
+  }
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Write-back throughput of BufMgr::flushFile with and without coalescing runs
+// of adjacent pages, next to the sequential write bandwidth of the device.
+//
+// usage: flush_write [pages] [holeEvery]
+//
+// Every page of a file of pages pages is dirtied in random order, then
+// flushFile writes them all back and syncs once (SYNC_PER_BATCH).  With
+// holeEvery > 0 every holeEvery-th page is left clean, so runs are shorter.
+// run 1:   one write per page, in page order.
+// run 128: runs of up to 128 adjacent pages per vectored write.
+// Both through File (stream) and through the IoEngine.
+// seq:     the same bytes written with 1 MB pwrites and one fdatasync.
+
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_flush_write.db";
+
+// Dirties the file through a pool holding all of it, flushes it and returns
+// the MB written per second.
+double flushRate(PageId pages, long holeEvery, bool streamIo,
+                 std::uint32_t maxWriteRun) {
+  FileOptions fileOptions;
+  fileOptions.durability = SYNC_PER_BATCH;
+  File file = File::open(kFilename, fileOptions);
+  BufMgrOptions options;
+  options.streamIo = streamIo;
+  options.maxWriteRun = maxWriteRun;
+  BufMgr bufMgr(pages, options);
+
+  std::vector<PageId> order;
+  for (PageId pageNo = 1; pageNo <= pages; ++pageNo) {
+    if (holeEvery <= 0 || pageNo % holeEvery != 0) {
+      order.push_back(pageNo);
+    }
+  }
+  bench::Rng rng(11);
+  for (std::size_t i = order.size() - 1; i > 0; --i) {
+    std::swap(order[i], order[rng.below(i + 1)]);
+  }
+  Page* page;
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    bufMgr.readPage(&file, order[i], page);
+    bufMgr.unPinPage(&file, order[i], true);
+  }
+
+  bench::Timer timer;
+  bufMgr.flushFile(&file);
+  return order.size() * (Page::SIZE / (1024.0 * 1024.0)) / timer.seconds();
+}
+
+// Rewrites pages pages with 1 MB writes and returns the MB written per second.
+double sequentialRate(PageId pages) {
+  const std::size_t chunk = 1024 * 1024;
+  std::vector<char> buffer(chunk, 'x');
+  const int fd = open(kFilename.c_str(), O_WRONLY);
+  bench::Timer timer;
+  const off_t end = static_cast<off_t>(pages + 1) * Page::SIZE;
+  for (off_t offset = Page::SIZE; offset < end; offset += chunk) {
+    const std::size_t length =
+        end - offset < static_cast<off_t>(chunk) ? end - offset : chunk;
+    if (pwrite(fd, &buffer[0], length, offset) < 0) {
+      std::perror("pwrite");
+      break;
+    }
+  }
+  fdatasync(fd);
+  const double rate = pages * (Page::SIZE / (1024.0 * 1024.0)) / timer.seconds();
+  close(fd);
+  return rate;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId pages = bench::argOr(argc, argv, 1, 16384);
+  const long holeEvery = bench::argOr(argc, argv, 2, 0);
+
+  std::printf("%u pages (%.0f MB), hole every %ld pages (MB/s)\n", pages,
+              pages * (Page::SIZE / (1024.0 * 1024.0)), holeEvery);
+  {
+    File file = bench::makeFile(kFilename, pages);
+  }
+  std::printf("%-8s %10s %10s\n", "", "stream", "engine");
+  const std::uint32_t runs[2] = {1, File::MAX_WRITE_RUN};
+  for (int r = 0; r < 2; ++r) {
+    const double stream = flushRate(pages, holeEvery, true, runs[r]);
+    const double engine = flushRate(pages, holeEvery, false, runs[r]);
+    std::printf("run %-4u %10.0f %10.0f\n", runs[r], stream, engine);
+  }
+  std::printf("%-8s %10.0f\n", "seq", sequentialRate(pages));
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Hit-only throughput of BufMgr::readPage/unPinPage from 1 to N threads.
+//
+// usage: hit_scaling [max_threads] [ops_per_thread] [pages]
+//
+// All pages fit in the pool and are read in before timing starts, so every
+// access is a hit.  With hits latching only one hash shard and one frame,
+// throughput should grow close to linearly with the thread count up to the
+// number of cores.
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+int main(int argc, char** argv) {
+  const long maxThreads = bench::argOr(argc, argv, 1, std::thread::hardware_concurrency());
+  const long ops = bench::argOr(argc, argv, 2, 2000000);
+  const PageId pages = bench::argOr(argc, argv, 3, 4096);
+
+  const std::string filename = "bench_hit_scaling.db";
+  {
+    File file = bench::makeFile(filename, pages);
+    BufMgr bufMgr(pages + pages / 4);
+
+    Page* page;
+    for (PageId p = 1; p <= pages; ++p) {
+      bufMgr.readPage(&file, p, page);
+      bufMgr.unPinPage(&file, p, false);
+    }
+
+    std::cout << "threads  Mops/s  speedup\n";
+    double base = 0;
+    for (long threads = 1; threads <= maxThreads; threads *= 2) {
+      std::vector<std::thread> workers;
+      bench::Timer timer;
+      for (long t = 0; t < threads; ++t) {
+        workers.push_back(std::thread([&, t]() {
+          bench::Rng rng(t + 1);
+          Page* threadPage;
+          for (long i = 0; i < ops; ++i) {
+            PageId p = rng.below(pages) + 1;
+            bufMgr.readPage(&file, p, threadPage);
+            bufMgr.unPinPage(&file, p, false);
+          }
+        }));
+      }
+      for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+      }
+      const double mops = threads * ops / timer.seconds() / 1e6;
+      if (threads == 1) {
+        base = mops;
+      }
+      std::printf("%7ld  %6.2f  %7.2f\n", threads, mops, mops / base);
+    }
+  }
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,117 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Read and write system calls made per buffer miss, per File::readPage and per
+// page allocation and deletion, counted from /proc/self/io.
+//
+// usage: io_count [filePages] [ops]
+//
+// miss:     BufMgr::readPage of a page not in the pool (stream I/O, so every
+//           read is a pread of this thread), then unPinPage.
+// readPage: File::readPage(pageNo, Page&).
+// alloc:    File::allocatePage on a file of filePages pages.
+// delete:   File::deletePage of each page allocated.
+
+#include <fstream>
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+// Read and write calls made by the process so far.
+struct SyscallCount {
+  std::uint64_t reads;
+  std::uint64_t writes;
+
+  static SyscallCount now() {
+    SyscallCount count = {0, 0};
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    std::uint64_t value;
+    while (io >> key >> value) {
+      if (key == "syscr:") {
+        count.reads = value;
+      } else if (key == "syscw:") {
+        count.writes = value;
+      }
+    }
+    return count;
+  }
+};
+
+// Calls made by SyscallCount::now() itself, which reads /proc/self/io.
+SyscallCount probeCost() {
+  const SyscallCount first = SyscallCount::now();
+  const SyscallCount second = SyscallCount::now();
+  SyscallCount cost = {second.reads - first.reads,
+                       second.writes - first.writes};
+  return cost;
+}
+
+void report(const char* label, const SyscallCount& before, long ops) {
+  static const SyscallCount probe = probeCost();
+  const SyscallCount after = SyscallCount::now();
+  std::printf("%-9s %6.2f reads %6.2f writes per op\n", label,
+              (after.reads - before.reads - probe.reads) / double(ops),
+              (after.writes - before.writes - probe.writes) / double(ops));
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId filePages = bench::argOr(argc, argv, 1, 2048);
+  const long ops = bench::argOr(argc, argv, 2, 1000);
+
+  const std::string filename = "bench_io_count.db";
+  std::printf("file %u pages, %ld ops each\n", filePages, ops);
+  {
+    File file = bench::makeFile(filename, filePages);
+    bench::Rng rng(3);
+
+    {
+      BufMgrOptions options;
+      options.streamIo = true;
+      BufMgr bufMgr(16, options);
+      Page* page;
+      // Strided page numbers never hit the 16 frames
+      SyscallCount before = SyscallCount::now();
+      for (long i = 0; i < ops; ++i) {
+        const PageId pageNo = (i * 97) % filePages + 1;
+        bufMgr.readPage(&file, pageNo, page);
+        bufMgr.unPinPage(&file, pageNo, false);
+      }
+      report("miss", before, ops);
+    }
+
+    Page page;
+    SyscallCount before = SyscallCount::now();
+    for (long i = 0; i < ops; ++i) {
+      file.readPage(rng.below(filePages) + 1, page);
+    }
+    report("readPage", before, ops);
+
+    std::vector<PageId> allocated;
+    before = SyscallCount::now();
+    for (long i = 0; i < ops; ++i) {
+      file.allocatePage(page);
+      allocated.push_back(page.page_number());
+    }
+    report("alloc", before, ops);
+
+    before = SyscallCount::now();
+    for (long i = 0; i < ops; ++i) {
+      file.deletePage(allocated[i]);
+    }
+    report("delete", before, ops);
+  }
+  File::remove(filename);
+  return 0;
+}
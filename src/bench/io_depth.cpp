@@ -0,0 +1,133 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Random page IOPS of the IoEngines at several queue depths, against File's
+// blocking calls.
+//
+// usage: io_depth [filePages] [ops]
+//
+// blocking: File::readPage / File::writePage (pread / pwrite), one page at a time.
+// io_uring, thread pool: depth requests kept in flight; as soon as the oldest
+//           completes, another is submitted in its place.
+// Each run is done twice: with the file dropped from the page cache first
+// (cold), and with it cached.
+
+#include <iostream>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "file.h"
+#include "io_engine.h"
+
+using namespace badgerdb;
+
+namespace {
+
+double streamIops(File& file, const std::vector<PageId>& pages, bool write) {
+  bench::Timer timer;
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    Page page = file.readPage(pages[i]);
+    if (write) {
+      file.writePage(page);
+    }
+  }
+  return pages.size() / timer.seconds();
+}
+
+// Writes first read each page with the same engine, so both runs see the same
+// number of reads and the write run adds the writes on top.
+double engineIops(IoEngine& engine, File& file, const std::vector<PageId>& pages,
+                  unsigned depth, bool write) {
+  std::vector<Page> buffers(depth);
+  std::vector<IoRequest> requests(depth);
+  std::vector<std::size_t> slotOp(depth);
+
+  bench::Timer timer;
+  std::size_t next = 0;
+  for (unsigned slot = 0; slot < depth && next < pages.size(); ++slot, ++next) {
+    file.prepareRead(pages[next], buffers[slot], requests[slot]);
+    slotOp[slot] = next;
+    IoRequest* request = &requests[slot];
+    engine.submit(&request, 1);
+  }
+  std::size_t done = 0;
+  std::vector<bool> writing(depth, false);
+  for (unsigned slot = 0; done < pages.size(); slot = (slot + 1) % depth) {
+    if (slotOp[slot] == pages.size()) {
+      continue;
+    }
+    engine.wait(requests[slot]);
+    if (write && !writing[slot]) {
+      file.finishRead(pages[slotOp[slot]], buffers[slot], requests[slot]);
+      file.prepareWrite(buffers[slot], requests[slot]);
+      writing[slot] = true;
+    } else {
+      ++done;
+      writing[slot] = false;
+      if (next == pages.size()) {
+        slotOp[slot] = pages.size();
+        continue;
+      }
+      file.prepareRead(pages[next], buffers[slot], requests[slot]);
+      slotOp[slot] = next++;
+    }
+    IoRequest* request = &requests[slot];
+    engine.submit(&request, 1);
+  }
+  return pages.size() / timer.seconds();
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId filePages = bench::argOr(argc, argv, 1, 2000);
+  const long ops = bench::argOr(argc, argv, 2, 20000);
+  const unsigned depths[4] = {1, 4, 16, 64};
+
+  bench::Rng rng(5);
+  std::vector<PageId> pages(ops);
+  for (long i = 0; i < ops; ++i) {
+    pages[i] = rng.below(filePages) + 1;
+  }
+
+  const std::string filename = "bench_io.db";
+  std::printf("file %u pages, %ld random page ops\n", filePages, ops);
+  {
+    File file = bench::makeFile(filename, filePages);
+
+    for (int cold = 1; cold >= 0; --cold) {
+      for (int write = 0; write <= 1; ++write) {
+        const char* what = write ? "read+write" : "read";
+        const char* cache = cold ? "cold" : "cached";
+        if (cold) {
+          bench::dropCache(filename);
+        }
+        std::printf("%-6s %-10s blocking         %9.0f IOPS\n", cache, what,
+                    streamIops(file, pages, write));
+
+        const IoEngineType types[2] = {URING_ENGINE, THREAD_POOL_ENGINE};
+        for (int t = 0; t < 2; ++t) {
+          for (int d = 0; d < 4; ++d) {
+            IoEngine* engine = IoEngine::create(types[t], depths[d]);
+            if (engine == NULL) {
+              continue;
+            }
+            if (cold) {
+              bench::dropCache(filename);
+            }
+            const double iops = engineIops(*engine, file, pages, depths[d], write);
+            std::printf("%-6s %-10s %-11s qd %2u %9.0f IOPS\n", cache, what,
+                        engine->name(), depths[d], iops);
+            delete engine;
+          }
+        }
+      }
+    }
+  }
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Cost of detecting a buffer miss with and without exceptions.
+//
+// usage: miss_latency [ops] [pages]
+//
+// detect: absent keys looked up with the throwing BufTable::lookup (the old
+//         readPage miss path, which caught HashNotFoundException) and with
+//         BufTable::find, for both table types.
+// scan:   readPage/unPinPage over a cold file, so every access is a miss; the
+//         per-page time is what a cold scan pays in total.
+
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+#include "bufHashTbl.h"
+#include "bufProbeTbl.h"
+#include "exceptions/hash_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+void detect(const char* name, BufTable& table, const File* file, long ops) {
+  for (PageId p = 1; p <= 1024; ++p) {
+    table.insert(file, p, p);
+  }
+
+  FrameId frameNo = 0;
+  long misses = 0;
+  bench::Timer timer;
+  for (long i = 0; i < ops; ++i) {
+    try {
+      table.lookup(file, 100000 + i, frameNo);
+    } catch (HashNotFoundException&) {
+      ++misses;
+    }
+  }
+  const double throwNs = timer.nanos() / double(ops);
+
+  timer.reset();
+  for (long i = 0; i < ops; ++i) {
+    if (!table.find(file, 100000 + i, frameNo)) {
+      ++misses;
+    }
+  }
+  const double findNs = timer.nanos() / double(ops);
+
+  std::printf("%-8s  miss via exception %8.1f ns  miss via find %6.1f ns  (%ld)\n",
+              name, throwNs, findNs, misses);
+}
+
+}
+
+int main(int argc, char** argv) {
+  const long ops = bench::argOr(argc, argv, 1, 200000);
+  const PageId pages = bench::argOr(argc, argv, 2, 2000);
+
+  const std::string filename = "bench_miss_latency.db";
+  {
+    File file = bench::makeFile(filename, pages);
+
+    {
+      BufHashTbl chained(1229);
+      detect("chained", chained, &file, ops);
+    }
+    {
+      BufProbeTbl probing(1024, BufHashTbl::DEFAULT_SHARDS);
+      detect("probing", probing, &file, ops);
+    }
+
+    BufMgr bufMgr(pages / 4);
+    Page* page;
+    bench::Timer timer;
+    for (PageId p = 1; p <= pages; ++p) {
+      bufMgr.readPage(&file, p, page);
+      bufMgr.unPinPage(&file, p, false);
+    }
+    std::printf("cold scan readPage   %8.1f ns/page\n", timer.nanos() / double(pages));
+  }
+  File::remove(filename);
+  return 0;
+}
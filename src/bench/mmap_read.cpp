@@ -0,0 +1,90 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Page reads through a File read with pread and through a File opened with
+// FileOptions::mmap_reads, on scans and on random lookups.
+//
+// usage: mmap_read [filePages] [lookups] [scans]
+//
+// scan:    walks the used page list with FileIterator, reading every page.
+//          Each step reads the page, then its header to follow the link.
+// lookups: File::readPage(pageNo, Page&) of uniformly random pages.
+// Both run once from a cold page cache and then warm.
+
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "file_iterator.h"
+
+using namespace badgerdb;
+
+namespace {
+
+// Scans the file scans times and returns the pages read per second.
+double scanRate(File& file, long scans) {
+  bench::Timer timer;
+  long pages = 0;
+  for (long s = 0; s < scans; ++s) {
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      const Page page = *iter;
+      pages += page.page_number() != Page::INVALID_NUMBER;
+    }
+  }
+  return pages / timer.seconds();
+}
+
+// Reads lookups random pages and returns the pages read per second.
+double lookupRate(File& file, PageId filePages, long lookups) {
+  bench::Rng rng(5);
+  Page page;
+  bench::Timer timer;
+  for (long i = 0; i < lookups; ++i) {
+    file.readPage(rng.below(filePages) + 1, page);
+  }
+  return lookups / timer.seconds();
+}
+
+void run(const std::string& filename, PageId filePages, long lookups,
+         long scans, bool mapped) {
+  FileOptions options;
+  options.mmap_reads = mapped;
+  const char* label = mapped ? "mmap " : "pread";
+
+  bench::dropCache(filename);
+  {
+    File file = File::open(filename, options);
+    std::printf("%s  cold scan   %10.0f pages/s\n", label, scanRate(file, 1));
+    std::printf("%s  warm scan   %10.0f pages/s\n", label, scanRate(file, scans));
+  }
+  bench::dropCache(filename);
+  {
+    File file = File::open(filename, options);
+    std::printf("%s  cold lookup %10.0f pages/s\n", label,
+                lookupRate(file, filePages, filePages));
+    std::printf("%s  warm lookup %10.0f pages/s\n", label,
+                lookupRate(file, filePages, lookups));
+  }
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId filePages = bench::argOr(argc, argv, 1, 4096);
+  const long lookups = bench::argOr(argc, argv, 2, 500000);
+  const long scans = bench::argOr(argc, argv, 3, 20);
+
+  const std::string filename = "bench_mmap_read.db";
+  std::printf("file %u pages, %ld warm scans, %ld warm lookups\n", filePages,
+              scans, lookups);
+  {
+    File file = bench::makeFile(filename, filePages);
+  }
+  run(filename, filePages, lookups, scans, false);
+  run(filename, filePages, lookups, scans, true);
+  File::remove(filename);
+  return 0;
+}
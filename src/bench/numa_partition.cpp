@@ -0,0 +1,136 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Hit throughput with the buffer pool in one piece and split into one
+// BufPartition per NUMA node, with every thread pinned to a node.
+//
+// usage: numa_partition [threads] [ops_per_thread] [pages]
+//
+// Thread t runs on the (t mod nodes)-th node (numaRunOnNode).  All pages fit
+// in the pool and are read in before timing, so every access is a hit; each
+// hit reads a word of every cache line of the page.  A hit is local when the
+// thread runs on the node its page's partition is placed on.
+// single: BufMgrOptions::partitions = 1, built by a thread on the first node,
+//         so first touch puts the pool there; threads read random pages.
+// random: one partition per node; threads read random pages.
+// routed: one partition per node; threads read only pages whose home
+//         partition (BufMgr::homePartition) is on their own node, as a
+//         server sending each request to a thread near its data would.
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+#include "numa.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_numa_partition.db";
+
+enum Mode { SINGLE, RANDOM, ROUTED };
+
+void run(Mode mode, long threads, long ops, PageId pages) {
+  const std::vector<int>& nodes = numaNodes();
+  BufMgrOptions options;
+  options.partitions = mode == SINGLE ? 1 : 0;
+  numaRunOnNode(nodes[0]);
+  File file = File::open(kFilename);
+  BufMgr bufMgr(pages + pages / 4, options);
+
+  // Pages by the node of their home partition
+  std::vector<std::vector<PageId> > byNode(nodes.size());
+  Page* page;
+  for (PageId p = 1; p <= pages; ++p) {
+    bufMgr.readPage(&file, p, page);
+    bufMgr.unPinPage(&file, p, false);
+    const int node = bufMgr.partitionNode(bufMgr.homePartition(&file, p));
+    for (std::size_t n = 0; n < nodes.size(); ++n) {
+      if (nodes[n] == node) {
+        byNode[n].push_back(p);
+      }
+    }
+  }
+
+  std::vector<long> local(threads, 0);
+  std::vector<std::thread> workers;
+  volatile std::uint64_t sink = 0;
+  bench::Timer timer;
+  for (long t = 0; t < threads; ++t) {
+    workers.push_back(std::thread([&, t]() {
+      const std::size_t n = t % nodes.size();
+      numaRunOnNode(nodes[n]);
+      const std::vector<PageId>& mine = byNode[n];
+      bench::Rng rng(t + 1);
+      Page* threadPage;
+      std::uint64_t sum = 0;
+      long hereHits = 0;
+      for (long i = 0; i < ops; ++i) {
+        const PageId p = mode == ROUTED && !mine.empty()
+                             ? mine[rng.below(mine.size())]
+                             : rng.below(pages) + 1;
+        bufMgr.readPage(&file, p, threadPage);
+        const std::uint64_t* words =
+            reinterpret_cast<const std::uint64_t*>(threadPage);
+        for (std::size_t w = 0; w < Page::SIZE / 8; w += 8) {
+          sum += words[w];
+        }
+        bufMgr.unPinPage(&file, p, false);
+        if (bufMgr.partitionNode(bufMgr.homePartition(&file, p)) ==
+            numaCurrentNode()) {
+          ++hereHits;
+        }
+      }
+      local[t] = hereHits;
+      sink += sum;
+    }));
+  }
+  long localHits = 0;
+  for (long t = 0; t < threads; ++t) {
+    workers[t].join();
+    localHits += local[t];
+  }
+  const double seconds = timer.seconds();
+  // A single partition is placed by first touch, not bound
+  bool bound = true;
+  for (std::uint32_t p = 0; p < bufMgr.partitionCount(); ++p) {
+    bound = bound &&
+            (bufMgr.partitionCount() == 1 || bufMgr.partitionBound(p));
+  }
+  const char* names[3] = {"single", "random", "routed"};
+  std::printf("%-7s %10u %8.2f %8.1f %8.1f %6s\n", names[mode],
+              bufMgr.partitionCount(), threads * ops / seconds / 1e6,
+              100.0 * localHits / (threads * ops),
+              100.0 * (threads * ops - localHits) / (threads * ops),
+              bound ? "yes" : "no");
+  bufMgr.flushFile(&file);
+}
+
+}
+
+int main(int argc, char** argv) {
+  const long threads =
+      bench::argOr(argc, argv, 1, std::thread::hardware_concurrency());
+  const long ops = bench::argOr(argc, argv, 2, 1000000);
+  const PageId pages = bench::argOr(argc, argv, 3, 65536);
+
+  std::printf("%zu nodes, %ld threads, %ld hits per thread, %u pages\n",
+              numaNodes().size(), threads, ops, pages);
+  {
+    File file = bench::makeFile(kFilename, pages);
+  }
+  std::printf("%-7s %10s %8s %8s %8s %6s\n", "mode", "partitions", "Mhits/s",
+              "local%", "remote%", "bound");
+  run(SINGLE, threads, ops, pages);
+  run(RANDOM, threads, ops, pages);
+  run(ROUTED, threads, ops, pages);
+  File::remove(kFilename);
+  return 0;
+}
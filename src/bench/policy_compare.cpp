@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Hit ratio and throughput of the replacement policies.
+//
+// usage: policy_compare [filePages] [frames] [ops]
+//
+// uniform: every page of the file equally likely.
+// zipfian: page popularity follows Zipf(0.99); popular pages are spread over the file.
+// scan:    the zipfian point lookups, interrupted every 5000 lookups by a sequential
+//          scan of half the file, as a report query running next to index lookups.
+//
+// The hit ratio counts every access that did not read the page from disk.
+
+#include <iostream>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+enum Workload { UNIFORM, ZIPFIAN, SCAN_MIXED };
+
+const char* workloadName(Workload w) {
+  return w == UNIFORM ? "uniform" : (w == ZIPFIAN ? "zipfian" : "scan");
+}
+
+// Builds the page sequence up front so generating it is not part of the timing.
+std::vector<PageId> makeTrace(Workload w, PageId filePages, long ops) {
+  bench::Rng rng(42);
+  bench::Zipf zipf(filePages, 0.99);
+  std::vector<PageId> placement(filePages);
+  for (PageId p = 0; p < filePages; ++p) {
+    placement[p] = p + 1;
+  }
+  for (PageId p = filePages - 1; p > 0; --p) {
+    std::swap(placement[p], placement[rng.below(p + 1)]);
+  }
+
+  std::vector<PageId> trace;
+  trace.reserve(ops);
+  PageId scanPos = 0;
+  while ((long)trace.size() < ops) {
+    if (w == UNIFORM) {
+      trace.push_back(rng.below(filePages) + 1);
+      continue;
+    }
+    trace.push_back(placement[zipf.next(rng)]);
+    if (w == SCAN_MIXED && trace.size() % 5000 == 0) {
+      for (PageId s = 0; s < filePages / 2 && (long)trace.size() < ops; ++s) {
+        trace.push_back(scanPos % filePages + 1);
+        ++scanPos;
+      }
+    }
+  }
+  return trace;
+}
+
+void run(BufPolicyType type, const char* name, File& file, std::uint32_t frames,
+         const std::vector<PageId>& trace, Workload w) {
+  BufMgrOptions options;
+  options.policyType = type;
+  BufMgr bufMgr(frames, options);
+  Page* page;
+
+  // Warm the pool with one pass over the trace's first frames accesses
+  for (std::uint32_t i = 0; i < frames && i < trace.size(); ++i) {
+    bufMgr.readPage(&file, trace[i], page);
+    bufMgr.unPinPage(&file, trace[i], false);
+  }
+  bufMgr.clearBufStats();
+
+  bench::Timer timer;
+  for (std::size_t i = 0; i < trace.size(); ++i) {
+    bufMgr.readPage(&file, trace[i], page);
+    bufMgr.unPinPage(&file, trace[i], false);
+  }
+  const double secs = timer.seconds();
+
+  const double hitRatio = 1.0 - bufMgr.getBufStats().diskreads / double(trace.size());
+  std::printf("%-8s %-6s  hit ratio %6.2f%%  %10.0f ops/s\n", workloadName(w), name,
+              hitRatio * 100, trace.size() / secs);
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId filePages = bench::argOr(argc, argv, 1, 2000);
+  const std::uint32_t frames = bench::argOr(argc, argv, 2, 200);
+  const long ops = bench::argOr(argc, argv, 3, 200000);
+
+  const std::string filename = "bench_policy.db";
+  std::printf("file %u pages, pool %u frames, %ld ops\n", filePages, frames, ops);
+  {
+    File file = bench::makeFile(filename, filePages);
+    const Workload workloads[3] = {UNIFORM, ZIPFIAN, SCAN_MIXED};
+    for (int w = 0; w < 3; ++w) {
+      std::vector<PageId> trace = makeTrace(workloads[w], filePages, ops);
+      run(CLOCK_POLICY, "clock", file, frames, trace, workloads[w]);
+      run(LRU_K_POLICY, "lru-2", file, frames, trace, workloads[w]);
+      run(TWO_Q_POLICY, "2q", file, frames, trace, workloads[w]);
+      run(ARC_POLICY, "arc", file, frames, trace, workloads[w]);
+    }
+  }
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Sequential scan through readPage, with and without prefetch.
+//
+// usage: prefetch_scan [filePages] [frames] [workNs]
+//
+// Every scan starts with the file dropped from the page cache and spends workNs
+// per page on the page's contents.  The prefetching scans ask for the next
+// window of pages whenever they enter a window, so one window is always in
+// flight while the current one is processed.
+
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+void work(std::uint64_t nanos) {
+  bench::Timer timer;
+  while (timer.nanos() < nanos) {
+  }
+}
+
+void scan(const char* name, const BufMgrOptions& options, File& file, const std::string& filename,
+          PageId filePages, std::uint32_t frames, PageId window, std::uint64_t workNs) {
+  BufMgr bufMgr(frames, options);
+  Page* page;
+  bench::dropCache(filename);
+
+  bench::Timer timer;
+  if (window > 0) {
+    bufMgr.prefetch(&file, 1, window);
+  }
+  for (PageId p = 1; p <= filePages; ++p) {
+    if (window > 0 && (p - 1) % window == 0 && p + window <= filePages) {
+      bufMgr.prefetch(&file, p + window, std::min(window, filePages - (p + window) + 1));
+    }
+    bufMgr.readPage(&file, p, page);
+    work(workNs);
+    bufMgr.unPinPage(&file, p, false);
+  }
+  const double secs = timer.seconds();
+
+  const BufStats stats = bufMgr.getBufStats();
+  std::printf("%-10s window %3u  %8.2f ms  %9.0f pages/s  prefetched %llu of %llu reads\n", name,
+              window, secs * 1000, filePages / secs, (unsigned long long)stats.prefetched,
+              (unsigned long long)stats.diskreads);
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId filePages = bench::argOr(argc, argv, 1, 2000);
+  const std::uint32_t frames = bench::argOr(argc, argv, 2, 256);
+  const std::uint64_t workNs = bench::argOr(argc, argv, 3, 2000);
+  const PageId windows[4] = {0, 8, 32, 64};
+
+  const std::string filename = "bench_prefetch.db";
+  std::printf("file %u pages, pool %u frames, %llu ns of work per page\n", filePages, frames,
+              (unsigned long long)workNs);
+  {
+    File file = bench::makeFile(filename, filePages);
+
+    BufMgrOptions engine;
+    BufMgrOptions stream;
+    stream.streamIo = true;
+    for (int w = 0; w < 4; ++w) {
+      scan("io engine", engine, file, filename, filePages, frames, windows[w], workNs);
+    }
+    for (int w = 0; w < 4; ++w) {
+      scan("stream", stream, file, filename, filePages, frames, windows[w], workNs);
+    }
+  }
+  File::remove(filename);
+  return 0;
+}
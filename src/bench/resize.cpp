@@ -0,0 +1,145 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Changing the size of the buffer pool under load: in place with BufMgr::resize
+// against tearing the pool down and building a new one, as a restart would.
+//
+// usage: resize [seconds] [filePages] [periodMs]
+//
+// Worker threads read Zipf (theta 0.8) distributed pages of a file.  Every periodMs
+// the pool switches between an eighth and half of the file:
+// fixed:   no switching, the pool stays at an eighth of the file.
+// restart: the workers are stopped between reads while the pool is flushed,
+//          destroyed and built anew at the other size, with an empty cache.
+// online:  BufMgr::resize while the workers go on.
+// Reported are reads per second, the share that hit, the 99th percentile and the
+// slowest read, and how long a switch took on average.
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_resize.db";
+const int kThreads = 4;
+
+enum Mode { FIXED, RESTART, ONLINE };
+
+void run(Mode mode, double seconds, PageId filePages, long periodMs) {
+  const std::uint32_t small = filePages / 8;
+  const std::uint32_t large = filePages / 2;
+  File file = File::open(kFilename);
+  BufMgrOptions options;
+  options.maxBufs = large;
+  std::unique_ptr<BufMgr> bufMgr(new BufMgr(small, options));
+  const bench::Zipf zipf(filePages, 0.8);
+
+  // Workers hold quiesce around every read; a restart takes them all
+  std::mutex quiesce[kThreads];
+  LatencyHistogram latency[kThreads];
+  std::atomic<long> ops(0);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < kThreads; ++t) {
+    workers.push_back(std::thread([&, t]() {
+      bench::Rng rng(t + 1);
+      Page* page;
+      while (!stop) {
+        const PageId pageNo = zipf.next(rng) + 1;
+        std::lock_guard<std::mutex> guard(quiesce[t]);
+        bench::Timer timer;
+        bufMgr->readPage(&file, pageNo, page);
+        bufMgr->unPinPage(&file, pageNo, false);
+        latency[t].record(timer.nanos());
+        ++ops;
+      }
+    }));
+  }
+
+  // Misses of the pools already torn down
+  long misses = 0;
+  int switches = 0;
+  double switchSeconds = 0;
+  bool isSmall = true;
+  bench::Timer timer;
+  bench::Timer period;
+  while (timer.seconds() < seconds) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (mode == FIXED || period.seconds() * 1000 < periodMs) {
+      continue;
+    }
+    period.reset();
+    isSmall = !isSmall;
+    bench::Timer took;
+    if (mode == RESTART) {
+      for (int t = 0; t < kThreads; ++t) {
+        quiesce[t].lock();
+      }
+      bufMgr->flushFile(&file);
+      misses += bufMgr->getBufStats().diskreads;
+      bufMgr.reset();
+      bufMgr.reset(new BufMgr(isSmall ? small : large, options));
+      for (int t = 0; t < kThreads; ++t) {
+        quiesce[t].unlock();
+      }
+    } else {
+      bufMgr->resize(isSmall ? small : large);
+    }
+    switchSeconds += took.seconds();
+    ++switches;
+  }
+  stop = true;
+  for (int t = 0; t < kThreads; ++t) {
+    workers[t].join();
+  }
+  const double elapsed = timer.seconds();
+  misses += bufMgr->getBufStats().diskreads;
+
+  LatencyHistogram all;
+  std::uint64_t slowest = 0;
+  for (int t = 0; t < kThreads; ++t) {
+    all.add(latency[t]);
+    slowest = std::max(slowest, latency[t].percentile(1.0));
+  }
+  const char* names[3] = {"fixed", "restart", "online"};
+  std::printf("%-8s %10.0f %7.1f %9.1f %9.1f %9d %9.2f\n", names[mode],
+              ops.load() / elapsed, 100.0 * (ops.load() - misses) / ops.load(),
+              all.percentile(0.99) / 1e3, slowest / 1e3, switches,
+              switches > 0 ? switchSeconds * 1e3 / switches : 0.0);
+  bufMgr->flushFile(&file);
+}
+
+}
+
+int main(int argc, char** argv) {
+  const double seconds = bench::argOr(argc, argv, 1, 4);
+  const PageId filePages = bench::argOr(argc, argv, 2, 16384);
+  const long periodMs = bench::argOr(argc, argv, 3, 250);
+
+  std::printf("%d threads, %.0f s, file %u pages, pool %u <-> %u frames every "
+              "%ld ms\n", kThreads, seconds, filePages, filePages / 8,
+              filePages / 2, periodMs);
+  {
+    File file = bench::makeFile(kFilename, filePages);
+  }
+  std::printf("%-8s %10s %7s %9s %9s %9s %9s\n", "mode", "reads/s", "hit%",
+              "p99 us", "max us", "switches", "switch ms");
+  for (int mode = FIXED; mode <= ONLINE; ++mode) {
+    run(Mode(mode), seconds, filePages, periodMs);
+  }
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,127 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Hit ratio of a hot working set while a large sequential scan runs next to it, with
+// the scan reading through the replacement policy and through a BufAccessStrategy ring.
+//
+// usage: scan_ring [hotPages] [scanPages] [frames] [ringSize]
+//
+// One thread makes uniform lookups over a hot file that fits in the pool.  The hit
+// ratio of those lookups is measured before the scan and while a second thread scans a
+// cold file several times the size of the pool; both threads yield after every page so
+// that they interleave even on one CPU.  Every scan page is read exactly once, so the
+// hot misses during the scan are the disk reads minus the scan's pages.  After the
+// scan, one pass over the hot set in order shows how much of it is still resident.
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const long kLookups = 100000;
+
+// Makes lookups over the hot file until count are done or, with count 0, until stop is
+// set.  Returns the number of lookups made.
+long lookups(BufMgr& bufMgr, File& hot, PageId hotPages, bench::Rng& rng, long count,
+             const std::atomic<bool>* stop) {
+  Page* page;
+  long done = 0;
+  while (count > 0 ? done < count : !stop->load()) {
+    const PageId pageNo = rng.below(hotPages) + 1;
+    bufMgr.readPage(&hot, pageNo, page);
+    bufMgr.unPinPage(&hot, pageNo, false);
+    ++done;
+    if (stop) {
+      std::this_thread::yield();
+    }
+  }
+  return done;
+}
+
+void run(BufPolicyType type, const char* name, File& hot, PageId hotPages, File& scan,
+         PageId scanPages, std::uint32_t frames, std::uint32_t ringSize) {
+  BufMgrOptions options;
+  options.policyType = type;
+  BufMgr bufMgr(frames, options);
+  bench::Rng rng(7);
+
+  // Warm the pool, then measure the hot set alone
+  lookups(bufMgr, hot, hotPages, rng, kLookups, NULL);
+  bufMgr.clearBufStats();
+  lookups(bufMgr, hot, hotPages, rng, kLookups, NULL);
+  const double before = 1.0 - bufMgr.getBufStats().diskreads / double(kLookups);
+
+  bufMgr.clearBufStats();
+  std::atomic<bool> stop(false);
+  std::thread scanner([&]() {
+    BufAccessStrategy ring(ringSize);
+    Page* page;
+    for (PageId pageNo = 1; pageNo <= scanPages; ++pageNo) {
+      bufMgr.readPage(&scan, pageNo, page, ringSize > 0 ? &ring : NULL);
+      bufMgr.unPinPage(&scan, pageNo, false);
+      std::this_thread::yield();
+    }
+    stop = true;
+  });
+  bench::Timer timer;
+  const long during = lookups(bufMgr, hot, hotPages, rng, 0, &stop);
+  scanner.join();
+  const double scanSecs = timer.seconds();
+  const double duringRatio =
+      1.0 - (double(bufMgr.getBufStats().diskreads) - scanPages) / during;
+
+  bufMgr.clearBufStats();
+  Page* page;
+  for (PageId pageNo = 1; pageNo <= hotPages; ++pageNo) {
+    bufMgr.readPage(&hot, pageNo, page);
+    bufMgr.unPinPage(&hot, pageNo, false);
+  }
+  const double after = 1.0 - bufMgr.getBufStats().diskreads / double(hotPages);
+
+  char label[32];
+  if (ringSize > 0) {
+    std::snprintf(label, sizeof(label), "ring %u", ringSize);
+  } else {
+    std::snprintf(label, sizeof(label), "no ring");
+  }
+  std::printf("%-6s %-8s  hot hit ratio before %6.2f%%  during %6.2f%%"
+              "  hot set resident after %6.2f%%  scan %7.1f ms\n",
+              name, label, before * 100, duringRatio * 100, after * 100, scanSecs * 1000);
+}
+
+}
+
+int main(int argc, char** argv) {
+  const PageId hotPages = bench::argOr(argc, argv, 1, 150);
+  const PageId scanPages = bench::argOr(argc, argv, 2, 2000);
+  const std::uint32_t frames = bench::argOr(argc, argv, 3, 200);
+  const std::uint32_t ringSize = bench::argOr(argc, argv, 4, 16);
+
+  const std::string hotName = "bench_ring_hot.db";
+  const std::string scanName = "bench_ring_scan.db";
+  std::printf("hot set %u pages, scan %u pages, pool %u frames, ring %u frames\n",
+              hotPages, scanPages, frames, ringSize);
+  {
+    File hot = bench::makeFile(hotName, hotPages);
+    File scan = bench::makeFile(scanName, scanPages);
+    const BufPolicyType types[4] = {CLOCK_POLICY, LRU_K_POLICY, TWO_Q_POLICY, ARC_POLICY};
+    const char* names[4] = {"clock", "lru-2", "2q", "arc"};
+    for (int t = 0; t < 4; ++t) {
+      run(types[t], names[t], hot, hotPages, scan, scanPages, frames, 0);
+      run(types[t], names[t], hot, hotPages, scan, scanPages, frames, ringSize);
+    }
+  }
+  File::remove(hotName);
+  File::remove(scanName);
+  return 0;
+}
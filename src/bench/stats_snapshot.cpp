@@ -0,0 +1,107 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Cost of a buffer hit with and without BufMgr::getBufStats() snapshots being
+// taken meanwhile, and the cost of a snapshot.
+//
+// usage: stats_snapshot [bursts] [pages] [snapshotMs]
+//
+// All pages fit in the pool and are read in before timing, so every access is
+// a hit.  Hits run in bursts of 50000; the fastest burst is reported, which
+// keeps a noisy machine out of the figure.  With fewer cores than threads the
+// snapshot thread's own time shows up in the bursts it runs during.
+// quiet:    nothing else runs.
+// snapshot: another thread takes a snapshot every snapshotMs milliseconds.
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_stats_snapshot.db";
+const int kBurst = 50000;
+
+void run(bool snapshots, long bursts, PageId pages, long snapshotMs) {
+  File file = File::open(kFilename);
+  BufMgr bufMgr(pages + pages / 4);
+  Page* page;
+  for (PageId p = 1; p <= pages; ++p) {
+    bufMgr.readPage(&file, p, page);
+    bufMgr.unPinPage(&file, p, false);
+  }
+
+  std::atomic<bool> stop(false);
+  LatencyHistogram snapshotTime;
+  std::thread reader;
+  if (snapshots) {
+    reader = std::thread([&]() {
+      while (!stop) {
+        bench::Timer timer;
+        bufMgr.getBufStats();
+        snapshotTime.record(timer.nanos());
+        std::this_thread::sleep_for(std::chrono::milliseconds(snapshotMs));
+      }
+    });
+  }
+
+  // Hits run on a thread of their own in both modes, so that the process is
+  // multithreaded and its latches take the atomic path either way
+  double best = 1e9;
+  std::thread worker([&]() {
+    bench::Rng rng(1);
+    Page* workerPage;
+    for (long b = 0; b < bursts; ++b) {
+      bench::Timer timer;
+      for (int i = 0; i < kBurst; ++i) {
+        const PageId p = rng.below(pages) + 1;
+        bufMgr.readPage(&file, p, workerPage);
+        bufMgr.unPinPage(&file, p, false);
+      }
+      best = std::min(best, timer.nanos() / double(kBurst));
+    }
+  });
+  worker.join();
+  stop = true;
+  if (reader.joinable()) {
+    reader.join();
+  }
+
+  const BufStats stats = bufMgr.getBufStats();
+  std::printf("%-9s %8.2f %12llu %10llu %11.1f %11.1f\n",
+              snapshots ? "snapshot" : "quiet", best,
+              (unsigned long long)stats.hits,
+              (unsigned long long)snapshotTime.total,
+              snapshotTime.percentile(0.5) / 1e3,
+              snapshotTime.percentile(0.99) / 1e3);
+  bufMgr.flushFile(&file);
+}
+
+}
+
+int main(int argc, char** argv) {
+  const long bursts = bench::argOr(argc, argv, 1, 400);
+  const PageId pages = bench::argOr(argc, argv, 2, 4096);
+  const long snapshotMs = bench::argOr(argc, argv, 3, 10);
+
+  std::printf("%ld bursts of %d hits, %u pages, a snapshot every %ld ms\n",
+              bursts, kBurst, pages, snapshotMs);
+  {
+    File file = bench::makeFile(kFilename, pages);
+  }
+  std::printf("%-9s %8s %12s %10s %11s %11s\n", "mode", "ns/hit", "hits",
+              "snapshots", "snap p50 us", "snap p99 us");
+  run(false, bursts, pages, snapshotMs);
+  run(true, bursts, pages, snapshotMs);
+  File::remove(kFilename);
+  return 0;
+}
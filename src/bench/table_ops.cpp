@@ -0,0 +1,138 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Chained BufHashTbl against open addressing BufProbeTbl.
+//
+// usage: table_ops [frames] [ops]
+//
+// lookup: hits on a table holding one entry per frame.
+// churn:  remove a random mapping and insert one for a random new page, as an
+//         eviction under a random miss-heavy workload does.
+// readPage: BufMgr with each table on a file four times the size of the pool,
+//           uniformly random pages, so most accesses miss.
+
+#include <iostream>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+#include "bufHashTbl.h"
+#include "bufProbeTbl.h"
+
+using namespace badgerdb;
+
+namespace {
+
+struct Key {
+  const File* file;
+  PageId pageNo;
+};
+
+void runTable(const char* name, BufTable& table, const std::vector<File*>& files,
+              std::uint32_t frames, long ops) {
+  bench::Rng rng(7);
+  std::vector<Key> live(frames);
+  PageId nextPage = 1;
+  for (std::uint32_t f = 0; f < frames; ++f) {
+    live[f].file = files[f % files.size()];
+    live[f].pageNo = nextPage++;
+    table.insert(live[f].file, live[f].pageNo, f);
+  }
+  // Page numbers above nextPage are handed out at random, so fresh pages are not
+  // adjacent to each other in the key space.
+  std::vector<PageId> fresh(frames);
+  for (std::uint32_t f = 0; f < frames; ++f) {
+    fresh[f] = nextPage + f;
+  }
+  for (std::uint32_t f = frames - 1; f > 0; --f) {
+    std::swap(fresh[f], fresh[rng.below(f + 1)]);
+  }
+
+  FrameId frameNo;
+  std::uint64_t sink = 0;
+  bench::Timer timer;
+  for (long i = 0; i < ops; ++i) {
+    const Key& k = live[rng.below(frames)];
+    table.lookup(k.file, k.pageNo, frameNo);
+    sink += frameNo;
+  }
+  const double lookupNs = timer.nanos() / double(ops);
+
+  timer.reset();
+  for (long i = 0; i < ops; ++i) {
+    const std::uint32_t f = rng.below(frames);
+    const std::uint32_t slot = i % frames;
+    table.remove(live[f].file, live[f].pageNo);
+    std::swap(live[f].pageNo, fresh[slot]);
+    table.insert(live[f].file, live[f].pageNo, f);
+  }
+  const double churnNs = timer.nanos() / double(ops);
+
+  std::printf("%-8s  lookup %7.1f ns/op  churn %7.1f ns/op  (%llu)\n", name,
+              lookupNs, churnNs, (unsigned long long)(sink & 1));
+}
+
+void runBufMgr(const char* name, BufTableType type, File& file,
+               std::uint32_t frames, long ops) {
+  BufMgrOptions options;
+  options.tableType = type;
+  BufMgr bufMgr(frames, options);
+  const PageId pages = frames * 4;
+
+  bench::Rng rng(11);
+  Page* page;
+  bench::Timer timer;
+  for (long i = 0; i < ops; ++i) {
+    const PageId p = rng.below(pages) + 1;
+    bufMgr.readPage(&file, p, page);
+    bufMgr.unPinPage(&file, p, false);
+  }
+  std::printf("%-8s  readPage %7.0f ops/s\n", name, ops / timer.seconds());
+}
+
+}
+
+int main(int argc, char** argv) {
+  const std::uint32_t frames = bench::argOr(argc, argv, 1, 65536);
+  const long ops = bench::argOr(argc, argv, 2, 2000000);
+
+  const std::string names[4] = {"bench_table.1", "bench_table.2", "bench_table.3",
+                                "bench_table.4"};
+  {
+    std::vector<File> owned;
+    for (int i = 0; i < 4; ++i) {
+      bench::removeIfExists(names[i]);
+      owned.push_back(File::create(names[i]));
+    }
+    std::vector<File*> files;
+    for (size_t i = 0; i < owned.size(); ++i) {
+      files.push_back(&owned[i]);
+    }
+
+    {
+      BufHashTbl chained(((int)(frames * 1.2)) + 1);
+      runTable("chained", chained, files, frames, ops);
+    }
+    {
+      BufProbeTbl probing(frames, BufHashTbl::DEFAULT_SHARDS);
+      runTable("probing", probing, files, frames, ops);
+    }
+  }
+  for (int i = 0; i < 4; ++i) {
+    File::remove(names[i]);
+  }
+
+  const std::uint32_t poolFrames = 512;
+  const std::string dataName = "bench_table.db";
+  {
+    File file = bench::makeFile(dataName, poolFrames * 4);
+    runBufMgr("chained", CHAINED_TABLE, file, poolFrames, ops / 10);
+    runBufMgr("probing", PROBING_TABLE, file, poolFrames, ops / 10);
+  }
+  File::remove(dataName);
+  return 0;
+}
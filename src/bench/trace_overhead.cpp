@@ -0,0 +1,105 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Cost of a buffer hit with the event trace off and on, and a sample trace.
+//
+// usage: trace_overhead [bursts] [pages] [tracefile]
+//
+// All pages fit in the pool and are read in before timing, so every access is
+// a hit.  Hits run in bursts of 50000 on a thread of their own; the fastest
+// burst is reported, which keeps a noisy machine out of the figure.
+// off: BufMgrOptions::traceEvents is 0, each event costs a test of the pointer.
+// on:  every hit and unpin is recorded in a ring of 65536 events.
+// If tracefile is given, Zipf (theta 0.8) reads of twice as many pages through a
+// pool of a quarter of them are traced and saved there, for trace_dump.
+
+#include <iostream>
+#include <thread>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "bench_trace_overhead.db";
+const int kBurst = 50000;
+
+void run(bool traced, long bursts, PageId pages) {
+  File file = File::open(kFilename);
+  BufMgrOptions options;
+  options.traceEvents = traced ? 65536 : 0;
+  BufMgr bufMgr(pages + pages / 4, options);
+  Page* page;
+  for (PageId p = 1; p <= pages; ++p) {
+    bufMgr.readPage(&file, p, page);
+    bufMgr.unPinPage(&file, p, false);
+  }
+
+  double best = 1e9;
+  std::thread worker([&]() {
+    bench::Rng rng(1);
+    Page* workerPage;
+    for (long b = 0; b < bursts; ++b) {
+      bench::Timer timer;
+      for (int i = 0; i < kBurst; ++i) {
+        const PageId p = rng.below(pages) + 1;
+        bufMgr.readPage(&file, p, workerPage);
+        bufMgr.unPinPage(&file, p, false);
+      }
+      best = std::min(best, timer.nanos() / double(kBurst));
+    }
+  });
+  worker.join();
+
+  std::printf("%-5s %8.2f\n", traced ? "on" : "off", best);
+  bufMgr.flushFile(&file);
+}
+
+void sample(PageId pages, const std::string& path) {
+  File file = File::open(kFilename);
+  BufMgrOptions options;
+  options.traceEvents = 1 << 20;
+  BufMgr bufMgr(pages / 2, options);
+  const bench::Zipf zipf(pages * 2, 0.8);
+  std::thread worker([&]() {
+    bench::Rng rng(1);
+    Page* page;
+    for (int i = 0; i < 200000; ++i) {
+      const PageId p = zipf.next(rng) + 1;
+      bufMgr.readPage(&file, p, page);
+      bufMgr.unPinPage(&file, p, false);
+    }
+  });
+  worker.join();
+  bufMgr.trace()->save(path);
+  std::printf("trace of 200000 Zipf reads saved to %s\n", path.c_str());
+  bufMgr.flushFile(&file);
+}
+
+}
+
+int main(int argc, char** argv) {
+  const long bursts = bench::argOr(argc, argv, 1, 400);
+  const PageId pages = bench::argOr(argc, argv, 2, 4096);
+
+  std::printf("%ld bursts of %d hits, %u pages\n", bursts, kBurst, pages);
+  {
+    File file = bench::makeFile(kFilename, pages * 2);
+  }
+  std::printf("%-5s %8s\n", "trace", "ns/hit");
+  run(false, bursts, pages);
+  run(true, bursts, pages);
+  run(false, bursts, pages);
+  run(true, bursts, pages);
+  if (argc > 3) {
+    sample(pages, argv[3]);
+  }
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,80 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#include "bufArena.h"
+
+namespace badgerdb {
+
+static_assert(std::is_trivially_destructible<Page>::value,
+              "Frames are unmapped without running destructors.");
+
+BufArena::BufArena(const std::uint32_t frames, const bool hugePages)
+	: base(MAP_FAILED), length(static_cast<std::size_t>(frames > 0 ? frames : 1) * Page::SIZE),
+	  backingName("4k")
+{
+  if (hugePages) {
+    const std::size_t hugeLength = (length + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    base = mmap(NULL, hugeLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base != MAP_FAILED) {
+      length = hugeLength;
+      backingName = "hugetlb";
+    }
+    else {
+      // Map a huge page more than needed and trim both ends to a 2 MB boundary, so
+      // that every 2 MB of the arena can become one transparent huge page
+      void* raw = mmap(NULL, hugeLength + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (raw == MAP_FAILED)
+        throw std::bad_alloc();
+      const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw);
+      const std::uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+      if (aligned > start)
+        munmap(raw, aligned - start);
+      const std::uintptr_t end = start + hugeLength + HUGE_PAGE_SIZE;
+      if (end > aligned + hugeLength)
+        munmap(reinterpret_cast<void*>(aligned + hugeLength), end - (aligned + hugeLength));
+      base = reinterpret_cast<void*>(aligned);
+      length = hugeLength;
+      backingName = madvise(base, length, MADV_HUGEPAGE) == 0 ? "thp" : "4k";
+    }
+  }
+  else {
+    // Frames are only backed once committed, so a large reserve costs no swap space
+    base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED)
+      throw std::bad_alloc();
+  }
+
+}
+
+BufArena::~BufArena()
+{
+  munmap(base, length);
+}
+
+void BufArena::commit(const std::uint32_t first, const std::uint32_t count)
+{
+  Page* frame = pages();
+  for (std::uint32_t i = first; i < first + count; i++)
+    new (&frame[i]) Page();
+}
+
+// Frames are a multiple of the system page size, so whole pages are dropped.  With
+// explicit huge pages the kernel only drops whole 2 MB pages and may refuse; the memory
+// then simply stays
+void BufArena::release(const std::uint32_t first, const std::uint32_t count)
+{
+  if (count > 0)
+    madvise(&pages()[first], static_cast<std::size_t>(count) * Page::SIZE, MADV_DONTNEED);
+}
+
+}
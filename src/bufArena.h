@@ -0,0 +1,96 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+* @brief One contiguous, page-aligned mapping holding every frame of the buffer pool
+*
+* Frame i is the Page at byte offset i * Page::SIZE, so frames are aligned to the
+* system page size (as O_DIRECT needs) and the pool costs a single mapping instead of
+* a heap block per frame.  With huge pages the arena first asks for explicit 2 MB
+* pages (MAP_HUGETLB), which need a reserved hugetlbfs pool; failing that it maps
+* 2 MB-aligned memory and advises the kernel to back it with transparent huge pages.
+*
+* The arena may be mapped for more frames than the buffer pool uses, so that the pool
+* can grow in place.  Only committed frames are touched; released frames give their
+* memory back to the system but keep their addresses.
+*/
+class BufArena
+{
+ private:
+	/**
+	 * Start of the mapping
+	 */
+  void* base;
+
+	/**
+	 * Length of the mapping in bytes
+	 */
+  std::size_t length;
+
+	/**
+	 * How the mapping is backed, for reports
+	 */
+  const char* backingName;
+
+ public:
+	/**
+	 * Size of a huge page
+	 */
+  static const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	/**
+   * Constructor of BufArena class, maps the arena.  No frame is committed yet
+	 *
+	 * @param frames   	Number of frames
+	 * @param hugePages True to back the arena with 2 MB pages when the system allows
+	 * @throws std::bad_alloc If the memory cannot be mapped
+	 */
+  BufArena(const std::uint32_t frames, const bool hugePages);
+
+	/**
+   * Destructor of BufArena class, unmaps the arena
+	 */
+  ~BufArena();
+
+	/**
+	 * Constructs an empty Page in each of count frames from first on, which puts memory
+	 * behind them.
+	 */
+  void commit(const std::uint32_t first, const std::uint32_t count);
+
+	/**
+	 * Gives the memory behind count frames from first on back to the system.  The frames
+	 * must be committed again before they are used.
+	 */
+  void release(const std::uint32_t first, const std::uint32_t count);
+
+	/**
+	 * Returns the first frame; the others follow it contiguously.
+	 */
+  Page* pages() const { return static_cast<Page*>(base); }
+
+	/**
+	 * Returns the length of the mapping in bytes.
+	 */
+  std::size_t size() const { return length; }
+
+	/**
+	 * Returns how the arena is backed: "hugetlb", "thp" or "4k".
+	 */
+  const char* backing() const { return backingName; }
+};
+
+}
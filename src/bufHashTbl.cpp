@@ -10,44 +10,108 @@
 #include "buffer.h"
 #include "bufHashTbl.h"
 #include "exceptions/hash_already_present_exception.h"
-#include "exceptions/hash_not_found_exception.h"
 #include "exceptions/hash_table_exception.h"
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+unsigned BufHashTbl::hash(const File* file, const PageId pageNo)
 {
-  int tmp, value;
+  int tmp;
+  unsigned value;
   tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
+  value = tmp + pageNo;
   return value;
 }
 
-BufHashTbl::BufHashTbl(int htSize)
+hashShard& BufHashTbl::locate(const File* file, const PageId pageNo, unsigned& key)
+{
+  unsigned value = hash(file, pageNo);
+  key = value / numShards;
+  return shards[value % numShards];
+}
+
+void BufHashTbl::allocate(hashShard& shard, const int size)
+{
+  shard.ht = new hashBucket* [size];
+  for(int i=0; i < size; i++)
+    shard.ht[i] = NULL;
+  shard.size = size;
+}
+
+BufHashTbl::BufHashTbl(int htSize, int shardCnt)
 	: HTSIZE(htSize)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  numShards = shardCnt < 1 ? 1 : (shardCnt > htSize ? htSize : shardCnt);
+
+  // allocate every shard's array of pointers to hashBuckets
+  shards = new hashShard[numShards];
+  for(int s = 0; s < numShards; s++)
+    allocate(shards[s], (HTSIZE + numShards - 1) / numShards);
 }
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
+  for(int s = 0; s < numShards; s++) {
+    hashBucket** ht = shards[s].ht;
+    for(int i = 0; i < shards[s].size; i++) {
+      hashBucket* tmpBuf = ht[i];
+      while (ht[i]) {
+        tmpBuf = ht[i];
+        ht[i] = ht[i]->next;
+        delete tmpBuf;
+      }
     }
+    delete [] ht;
   }
-  delete [] ht;
+  delete [] shards;
+}
+
+// The shard count stays, so every entry stays in its shard and only moves between
+// buckets; each shard is latched while its nodes are relinked
+void BufHashTbl::resize(const std::uint32_t entries)
+{
+  HTSIZE = (int)(entries * 1.2) + 1;
+  const int size = (HTSIZE + numShards - 1) / numShards;
+
+  for(int s = 0; s < numShards; s++) {
+    hashShard& shard = shards[s];
+    std::lock_guard<std::mutex> guard(shard.latch);
+    if (shard.size == size)
+      continue;
+
+    hashBucket** oldHt = shard.ht;
+    const int oldSize = shard.size;
+    allocate(shard, size);
+    for(int i = 0; i < oldSize; i++) {
+      while (oldHt[i]) {
+        hashBucket* tmpBuc = oldHt[i];
+        oldHt[i] = tmpBuc->next;
+        const int index = (hash(tmpBuc->file, tmpBuc->pageNo) / numShards) % size;
+        tmpBuc->next = shard.ht[index];
+        shard.ht[index] = tmpBuc;
+      }
+    }
+    delete [] oldHt;
+  }
+}
+
+std::uint32_t BufHashTbl::slots()
+{
+  std::uint32_t total = 0;
+  for(int s = 0; s < numShards; s++) {
+    std::lock_guard<std::mutex> guard(shards[s].latch);
+    total += shards[s].size;
+  }
+  return total;
 }
 
 void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
 {
-  int index = hash(file, pageNo);
+  unsigned key;
+  hashShard& shard = locate(file, pageNo, key);
+  std::lock_guard<std::mutex> guard(shard.latch);
+  hashBucket** ht = shard.ht;
+  int index = key % shard.size;
 
   hashBucket* tmpBuc = ht[index];
   while (tmpBuc) {
@@ -67,25 +131,33 @@ void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId fra
   ht[index] = tmpBuc;
 }
 
-void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+bool BufHashTbl::find(const File* file, const PageId pageNo, FrameId &frameNo) 
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
+  unsigned key;
+  hashShard& shard = locate(file, pageNo, key);
+  std::lock_guard<std::mutex> guard(shard.latch);
+
+  hashBucket* tmpBuc = shard.ht[key % shard.size];
   while (tmpBuc) {
     if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
     {
       frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
+      return true;
     }
     tmpBuc = tmpBuc->next;
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  return false;
 }
 
-void BufHashTbl::remove(const File* file, const PageId pageNo) {
+bool BufHashTbl::erase(const File* file, const PageId pageNo) {
+
+  unsigned key;
+  hashShard& shard = locate(file, pageNo, key);
+  std::lock_guard<std::mutex> guard(shard.latch);
+  hashBucket** ht = shard.ht;
+  int index = key % shard.size;
 
-  int index = hash(file, pageNo);
   hashBucket* tmpBuc = ht[index];
   hashBucket* prevBuc = NULL;
 
@@ -99,7 +171,7 @@ void BufHashTbl::remove(const File* file, const PageId pageNo) {
 				ht[index] = tmpBuc->next;
 
       delete tmpBuc;
-      return;
+      return true;
     }
 		else
 		{
@@ -108,7 +180,7 @@ void BufHashTbl::remove(const File* file, const PageId pageNo) {
     }
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  return false;
 }
 
 }
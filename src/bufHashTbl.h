@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <mutex>
+
 #include "file.h"
+#include "bufTable.h"
 
 namespace badgerdb {
 
@@ -37,42 +40,106 @@ struct hashBucket {
 };
 
 
+/**
+* @brief One independently latched slice of the buffer pool hash table
+*/
+struct hashShard {
+	/**
+	 * Latch protecting the buckets of this shard
+	 */
+	std::mutex latch;
+
+	/**
+	 * Bucket array of this shard
+	 */
+	hashBucket**  ht;
+
+	/**
+	 * Number of buckets in ht; each shard is resized on its own
+	 */
+	int size;
+
+	/**
+	 * Pads the shard out to its own cache line so that latching one shard does not
+	 * bounce the line holding its neighbour
+	 */
+	char pad[64 - (sizeof(std::mutex) + sizeof(hashBucket**) + sizeof(int)) % 64];
+};
+
+
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
-* @warning This class is not threadsafe.
+* The table is split into a number of shards, each with its own latch and its own
+* bucket array.  A (file, pageNo) pair always hashes to the same shard, so operations
+* on pages that live in different shards never contend.  Every public method latches
+* exactly one shard for its duration, which makes the table safe to use from many
+* threads at once.
 */
-class BufHashTbl
+class BufHashTbl : public BufTable
 {
  private:
 	/**
 	 *	Size of Hash Table
 	 */
   int HTSIZE;
+
+	/**
+	 * Number of shards the buckets are split into
+	 */
+  int numShards;
+
 	/**
-	 * Actual Hash table object
+	 * Actual Hash table object, as an array of numShards shards
 	 */
-  hashBucket**  ht;
+  hashShard*  shards;
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * returns hash value computed using file and pageNo
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  unsigned hash(const File* file, const PageId pageNo);
+
+	/**
+	 * Locates the shard for (file, pageNo).  The bucket within the shard depends on the
+	 * shard's size, so it is only picked once the shard is latched, as key % size.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param key  		Set to the part of the hash left to pick the bucket with
+	 * @return  			Shard holding the bucket
+	 */
+  hashShard& locate(const File* file, const PageId pageNo, unsigned& key);
+
+	/**
+	 * Allocates an empty bucket array for a shard
+	 *
+	 * @param shard   Shard to initialize
+	 * @param size  	Number of buckets
+	 */
+  static void allocate(hashShard& shard, const int size);
 
  public:
 	/**
+	 * Default number of shards
+	 */
+  static const int DEFAULT_SHARDS = 64;
+
+	/**
    * Constructor of BufHashTbl class
+	 *
+	 * @param htSize  	Total number of buckets across all shards
+	 * @param shardCnt  Number of independently latched shards
 	 */
-	BufHashTbl(const int htSize);  // constructor
+	BufHashTbl(const int htSize, const int shardCnt = DEFAULT_SHARDS);  // constructor
 
 	/**
    * Destructor of BufHashTbl class
 	 */
-  ~BufHashTbl(); // destructor
+  virtual ~BufHashTbl(); // destructor
 	
 	/**
    * Insert entry into hash table mapping (file, pageNo) to frameNo.
@@ -83,27 +150,40 @@ class BufHashTbl
    * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
    * @throws  HashTableException (optional) if could not create a new bucket as running of memory
 	 */
-  void insert(const File* file, const PageId pageNo, const FrameId frameNo);
+  virtual void insert(const File* file, const PageId pageNo, const FrameId frameNo);
 
 	/**
    * Check if (file, pageNo) is currently in the buffer pool (ie. in
-   * the hash table).
+   * the hash table).  Does not throw if the entry is missing.
 	 *
 	 * @param file  	File object
 	 * @param pageNo	Page number in the file
-	 * @param frameNo Frame number reference
-   * @throws HashNotFoundException if the page entry is not found in the hash table 
+	 * @param frameNo Frame number reference, only assigned if the entry is found
+	 * @return  			True if the entry was found, false otherwise
 	 */
-  void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
+  virtual bool find(const File* file, const PageId pageNo, FrameId &frameNo);
 
 	/**
-   * Delete entry (file,pageNo) from hash table.
+   * Delete entry (file,pageNo) from hash table if it is present.
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
-   * @throws HashNotFoundException if the page entry is not found in the hash table 
+	 * @return  			True if the entry was found and deleted, false otherwise
+	 */
+  virtual bool erase(const File* file, const PageId pageNo);
+
+	/**
+   * Resizes the table to about 1.2 buckets per entry.  The bucket nodes are moved to
+	 * the new arrays, not copied, one shard at a time.
+	 *
+	 * @param entries Maximum number of entries expected at any one time from now on
+	 */
+  virtual void resize(const std::uint32_t entries);
+
+	/**
+   * Returns the number of buckets over all the shards.
 	 */
-  void remove(const File* file, const PageId pageNo);  
+  virtual std::uint32_t slots();
 };
 
 }
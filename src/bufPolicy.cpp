@@ -0,0 +1,112 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bufPolicy.h"
+
+namespace badgerdb {
+
+AccessLog::AccessLog(const std::uint32_t bufs)
+	: hits(bufs), slots(bufs), tail(0), head(0)
+{
+  for (std::uint32_t i = 0; i < bufs; i++)
+    slots[i].store(NONE, std::memory_order_relaxed);
+}
+
+// Only the hit that finds the count at 0 takes a slot; the ring holds each frame once
+void AccessLog::record(const FrameId frame)
+{
+  if (hits[frame].fetch_add(1, std::memory_order_relaxed) != 0)
+    return;
+  const std::uint64_t position = tail.fetch_add(1, std::memory_order_relaxed);
+  slots[position % slots.size()].store(frame, std::memory_order_release);
+}
+
+void FrameList::pushFront(const FrameId frame)
+{
+  prev[frame] = NONE;
+  next[frame] = head;
+  if (head != NONE)
+    prev[head] = frame;
+  else
+    tail = frame;
+  head = frame;
+  owner[frame] = this;
+  count++;
+}
+
+void FrameList::erase(const FrameId frame)
+{
+  if (prev[frame] != NONE)
+    next[prev[frame]] = next[frame];
+  else
+    head = next[frame];
+
+  if (next[frame] != NONE)
+    prev[next[frame]] = prev[frame];
+  else
+    tail = prev[frame];
+
+  owner[frame] = NULL;
+  count--;
+}
+
+bool FrameList::reclaimOldest(FrameReclaimer& reclaimer, FrameId& frame)
+{
+  for (FrameId f = tail; f != NONE; f = prev[f]) {
+    if (reclaimer.reclaim(f)) {
+      erase(f);
+      frame = f;
+      return true;
+    }
+  }
+  return false;
+}
+
+void FrameList::oldest(const std::size_t count, std::vector<FrameId>& frames) const
+{
+  std::size_t listed = 0;
+  for (FrameId f = tail; f != NONE && listed < count; f = prev[f], listed++)
+    frames.push_back(f);
+}
+
+void GhostList::add(const PageKey& key)
+{
+  if (capacity == 0)
+    return;
+  remove(key);
+  if (order.size() >= capacity)
+    dropOldest();
+  order.push_front(key);
+  index[key] = order.begin();
+}
+
+bool GhostList::remove(const PageKey& key)
+{
+  std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash>::iterator it = index.find(key);
+  if (it == index.end())
+    return false;
+  order.erase(it->second);
+  index.erase(it);
+  return true;
+}
+
+void GhostList::dropOldest()
+{
+  if (order.empty())
+    return;
+  index.erase(order.back());
+  order.pop_back();
+}
+
+void GhostList::resize(const std::size_t capacityIn)
+{
+  capacity = capacityIn;
+  while (order.size() > capacity)
+    dropOldest();
+}
+
+}
@@ -0,0 +1,361 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "file.h"
+#include "bufTable.h"
+
+namespace badgerdb {
+
+/**
+* @brief Callback through which a replacement policy takes frames from the buffer manager
+*/
+class FrameReclaimer
+{
+ public:
+	/**
+   * Destructor of FrameReclaimer class
+	 */
+  virtual ~FrameReclaimer() {}
+
+	/**
+	 * Tries to take a frame for a new page.  Succeeds if the frame is free, or if it holds
+	 * a page that is not pinned; that page is then unmapped from the buffer pool (the
+	 * caller of BufPolicy::victim() writes it back if it is dirty).
+	 *
+	 * @param frame   Frame to take
+	 * @return  			True if the frame now belongs to the caller, false if it is pinned
+	 */
+  virtual bool reclaim(const FrameId frame) = 0;
+};
+
+
+/**
+* @brief Interface of the page replacement policies used by BufMgr
+*
+* The buffer manager reports every page that enters the pool (loaded), every hit
+* (accessed) and every page that leaves the pool without being chosen as a victim
+* (freed), and asks the policy for a victim frame when it needs one.  loaded(), freed()
+* and victim() are serialized by the buffer manager; accessed() may be called from many
+* threads at once and concurrently with the others.  It is on the path of every hit, so
+* it should not take a latch shared by all the frames: policies with ordered state note
+* hits in an AccessLog and apply them under their latch in the other methods.
+*/
+class BufPolicy
+{
+ public:
+	/**
+   * Destructor of BufPolicy class
+	 */
+  virtual ~BufPolicy() {}
+
+	/**
+	 * Records that a page was placed in a frame after a miss or an allocPage.
+	 *
+	 * @param frame   Frame now holding the page
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  virtual void loaded(const FrameId frame, const File* file, const PageId pageNo) = 0;
+
+	/**
+	 * Records a buffer hit on the page in a frame.
+	 *
+	 * @param frame   Frame holding the page
+	 */
+  virtual void accessed(const FrameId frame) = 0;
+
+	/**
+	 * Records that the page in a frame left the buffer pool without being chosen as a
+	 * victim (disposePage, flushFile).  The frame is free afterwards.
+	 *
+	 * @param frame   Frame that became free
+	 */
+  virtual void freed(const FrameId frame) = 0;
+
+	/**
+	 * Records that a frame was reused by a BufAccessStrategy, outside victim(), and now
+	 * holds another page.  The policy treats the new page as one it has not seen before
+	 * and must not promote it for having been loaded, so the frame stays an early victim.
+	 *
+	 * @param frame   Frame now holding the page
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  virtual void recycled(const FrameId frame, const File* file, const PageId pageNo) = 0;
+
+	/**
+	 * Picks a frame for the page (file, pageNo), which is about to be loaded, and takes
+	 * it through the reclaimer.  Free frames are used first.
+	 *
+	 * @param reclaimer Used to take the chosen frame
+	 * @param file   		File of the page that needs a frame
+	 * @param pageNo  	Page number of the page that needs a frame
+	 * @param frame   	Frame taken, returned via this reference
+	 * @return  				False if every frame is pinned
+	 */
+  virtual bool victim(FrameReclaimer& reclaimer, const File* file, const PageId pageNo, FrameId& frame) = 0;
+
+	/**
+	 * Lists frames the policy expects to pick as victims soonest, soonest first, so that
+	 * their pages can be written back before they are evicted.  Only a hint: it may be
+	 * called concurrently with every other method and the frames may hold anything by the
+	 * time the caller looks at them.
+	 *
+	 * @param count   Maximum number of frames to list
+	 * @param frames  Frames are appended to this vector
+	 */
+  virtual void upcoming(const std::size_t count, std::vector<FrameId>& frames) = 0;
+
+	/**
+	 * Changes the number of frames the policy manages to frames 0 to frames - 1, as the
+	 * buffer pool grows or shrinks.  Frames added are free.  Frames dropped are forgotten
+	 * wherever they are, and victim() never picks them again; the buffer manager empties
+	 * them first.  Serialized with loaded(), freed() and victim();
+	 * accessed() may still be called for a dropped frame and is then ignored.
+	 *
+	 * @param frames  Number of frames, at most the number the policy was constructed with
+	 */
+  virtual void resize(const std::uint32_t frames) = 0;
+
+	/**
+	 * Returns the name of the policy, for reports.
+	 */
+  virtual const char* name() const = 0;
+};
+
+
+/**
+* @brief Identity of a page, used by policies that remember pages after eviction
+*/
+struct PageKey {
+	/**
+	 * File object
+	 */
+	const File* file;
+
+	/**
+	 * Page number in the file
+	 */
+	PageId pageNo;
+
+	bool operator==(const PageKey& rhs) const {
+		return file == rhs.file && pageNo == rhs.pageNo;
+	}
+};
+
+/**
+* @brief Hash functor for PageKey
+*/
+struct PageKeyHash {
+	std::size_t operator()(const PageKey& key) const {
+		return BufTable::mix(key.file, key.pageNo);
+	}
+};
+
+
+/**
+* @brief Doubly linked list of frames, threaded through arrays indexed by frame number
+*
+* Each frame is on at most one FrameList of a policy at a time.  All operations are O(1)
+* and none allocates.  The head is the most recently inserted frame, the tail the oldest.
+*/
+class FrameList
+{
+ private:
+	/**
+	 * Marks the absence of a neighbour
+	 */
+  static const FrameId NONE = ~FrameId(0);
+
+	/**
+	 * Previous (newer) and next (older) frame of each frame; shared by the lists of a policy
+	 */
+  std::vector<FrameId>& prev;
+  std::vector<FrameId>& next;
+
+	/**
+	 * List each frame is on; shared by the lists of a policy
+	 */
+  std::vector<const FrameList*>& owner;
+
+  FrameId head;
+  FrameId tail;
+  std::size_t count;
+
+ public:
+	/**
+	 * Constructs an empty list over link arrays shared with the other lists of a policy
+	 */
+  FrameList(std::vector<FrameId>& prevIn, std::vector<FrameId>& nextIn, std::vector<const FrameList*>& ownerIn)
+		: prev(prevIn), next(nextIn), owner(ownerIn), head(NONE), tail(NONE), count(0) {}
+
+	/**
+	 * Inserts a frame that is on no list at the head.
+	 */
+  void pushFront(const FrameId frame);
+
+	/**
+	 * Removes a frame from this list.
+	 */
+  void erase(const FrameId frame);
+
+	/**
+	 * Moves a frame of this list to the head.
+	 */
+  void moveToFront(const FrameId frame) { erase(frame); pushFront(frame); }
+
+	/**
+	 * Returns true if the frame is on this list.
+	 */
+  bool contains(const FrameId frame) const { return owner[frame] == this; }
+
+	/**
+	 * Returns the number of frames on the list.
+	 */
+  std::size_t size() const { return count; }
+
+	/**
+	 * Walks the list from the tail (oldest) towards the head and takes the first frame
+	 * the reclaimer accepts.  The frame is removed from the list.
+	 *
+	 * @param reclaimer Used to take frames
+	 * @param frame   	Frame taken, returned via this reference
+	 * @return  				False if the reclaimer accepted no frame of the list
+	 */
+  bool reclaimOldest(FrameReclaimer& reclaimer, FrameId& frame);
+
+	/**
+	 * Appends up to count frames to a vector, oldest first.
+	 */
+  void oldest(const std::size_t count, std::vector<FrameId>& frames) const;
+};
+
+
+/**
+* @brief Hits noted without a latch, for a policy to apply later under its own
+*
+* record() is lock-free: the first hit on a frame since the last replay() appends the
+* frame to a ring, and later hits only count.  Each frame is in the ring at most once,
+* so a ring as long as there are frames never overflows.  replay() hands the frames to
+* the policy in the order of their first hits, each with its number of hits.
+*/
+class AccessLog
+{
+ private:
+	/**
+	 * Marks a slot not yet written
+	 */
+  static const FrameId NONE = ~FrameId(0);
+
+	/**
+	 * Hits on each frame since it was last replayed; nonzero while the frame is in the ring
+	 */
+  std::vector<std::atomic<std::uint32_t> > hits;
+
+	/**
+	 * Frames in the order of their first hits
+	 */
+  std::vector<std::atomic<FrameId> > slots;
+
+	/**
+	 * Next slot to write, taken by record(); next slot to replay, owned by replay()
+	 */
+  std::atomic<std::uint64_t> tail;
+  std::uint64_t head;
+
+ public:
+	/**
+	 * Constructs an empty log for frames 0 to bufs - 1
+	 */
+  explicit AccessLog(const std::uint32_t bufs);
+
+	/**
+	 * Notes a hit on a frame.  May be called from many threads at once.
+	 */
+  void record(const FrameId frame);
+
+	/**
+	 * Empties the log into apply(frame, hits), oldest first.  Calls must be serialized,
+	 * by the latch of the policy.  A hit whose record() is still under way may be left
+	 * for the next call.
+	 */
+  template <typename Apply>
+  void replay(Apply apply)
+	{
+		while (head != tail.load(std::memory_order_acquire)) {
+			std::atomic<FrameId>& slot = slots[head % slots.size()];
+			const FrameId frame = slot.exchange(NONE, std::memory_order_acquire);
+			if (frame == NONE)
+				break;
+			head++;
+			apply(frame, hits[frame].exchange(0, std::memory_order_relaxed));
+		}
+	}
+};
+
+
+/**
+* @brief Bounded list of pages that recently left the buffer pool (ghost entries)
+*
+* Remembers page identities only, never page contents.  Once full, adding a page forgets
+* the oldest one.
+*/
+class GhostList
+{
+ private:
+  std::size_t capacity;
+  std::list<PageKey> order;
+  std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash> index;
+
+ public:
+	/**
+	 * Constructs an empty ghost list that remembers at most capacityIn pages
+	 */
+  explicit GhostList(const std::size_t capacityIn) : capacity(capacityIn) {}
+
+	/**
+	 * Adds a page as the newest entry, forgetting the oldest entry if the list is full.
+	 */
+  void add(const PageKey& key);
+
+	/**
+	 * Removes a page; returns true if it was on the list.
+	 */
+  bool remove(const PageKey& key);
+
+	/**
+	 * Forgets the oldest entry.
+	 */
+  void dropOldest();
+
+	/**
+	 * Changes the number of pages the list remembers, forgetting the oldest entries
+	 * beyond it.
+	 */
+  void resize(const std::size_t capacityIn);
+
+	/**
+	 * Returns true if the page is on the list.
+	 */
+  bool contains(const PageKey& key) const { return index.count(key) != 0; }
+
+	/**
+	 * Returns the number of pages on the list.
+	 */
+  std::size_t size() const { return order.size(); }
+};
+
+}
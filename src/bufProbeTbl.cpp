@@ -0,0 +1,209 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include "bufProbeTbl.h"
+#include "exceptions/hash_already_present_exception.h"
+
+namespace badgerdb {
+
+// Largest value a metadata byte can hold; an entry this far from home forces a grow
+static const std::uint8_t MAX_META = 255;
+
+BufProbeTbl::BufProbeTbl(const std::uint32_t entries, const int shardCnt)
+{
+  // Round the shard count down to a power of two, with no more shards than entries
+  numShards = 1;
+  shardBits = 0;
+  while (numShards * 2 <= (std::uint32_t)shardCnt && numShards * 2 <= entries) {
+    numShards *= 2;
+    shardBits++;
+  }
+
+  const std::uint32_t capacity = shardCapacity(entries);
+  shards = new probeShard[numShards];
+  for (std::uint32_t s = 0; s < numShards; s++)
+    allocate(shards[s], capacity);
+}
+
+std::uint32_t BufProbeTbl::shardCapacity(const std::uint32_t entries) const
+{
+  // Size every shard so that its share of the entries fills it at most 3/4
+  std::uint32_t capacity = 16;
+  while (capacity * 3 < 4 * (entries / numShards + 1))
+    capacity *= 2;
+  return capacity;
+}
+
+BufProbeTbl::~BufProbeTbl()
+{
+  for (std::uint32_t s = 0; s < numShards; s++) {
+    delete [] shards[s].slots;
+    delete [] shards[s].meta;
+  }
+  delete [] shards;
+}
+
+void BufProbeTbl::allocate(probeShard& shard, const std::uint32_t capacity)
+{
+  shard.slots = new probeSlot[capacity];
+  shard.meta = new std::uint8_t[capacity];
+  std::memset(shard.meta, 0, capacity);
+  shard.mask = capacity - 1;
+  shard.count = 0;
+}
+
+std::int64_t BufProbeTbl::probe(const probeShard& shard, const std::uint64_t h, const File* file, const PageId pageNo)
+{
+  std::uint32_t i = h & shard.mask;
+  for (std::uint32_t dist = 1; dist <= MAX_META; dist++) {
+    const std::uint8_t m = shard.meta[i];
+    // An empty slot, or an entry closer to its home than we are to ours, ends the probe
+    if (m < dist)
+      return -1;
+    if (m == dist && shard.slots[i].file == file && shard.slots[i].pageNo == pageNo)
+      return i;
+    i = (i + 1) & shard.mask;
+  }
+  return -1;
+}
+
+void BufProbeTbl::place(probeShard& shard, probeSlot entry)
+{
+  if ((shard.count + 1) * 8 > (shard.mask + 1) * 7)
+    grow(shard);
+
+  std::uint32_t i = mix(entry.file, entry.pageNo) & shard.mask;
+  std::uint32_t dist = 1;
+  for (;;) {
+    if (shard.meta[i] == 0) {
+      shard.slots[i] = entry;
+      shard.meta[i] = dist;
+      shard.count++;
+      return;
+    }
+    // Robin Hood: take the slot from an entry that is closer to its home
+    if (shard.meta[i] < dist) {
+      probeSlot displaced = shard.slots[i];
+      std::uint32_t displacedDist = shard.meta[i];
+      shard.slots[i] = entry;
+      shard.meta[i] = dist;
+      entry = displaced;
+      dist = displacedDist;
+    }
+    i = (i + 1) & shard.mask;
+    if (++dist > MAX_META) {
+      grow(shard);
+      place(shard, entry);
+      return;
+    }
+  }
+}
+
+void BufProbeTbl::grow(probeShard& shard)
+{
+  rebuild(shard, (shard.mask + 1) * 2);
+}
+
+void BufProbeTbl::rebuild(probeShard& shard, const std::uint32_t capacity)
+{
+  probeSlot* oldSlots = shard.slots;
+  std::uint8_t* oldMeta = shard.meta;
+  const std::uint32_t oldCapacity = shard.mask + 1;
+
+  allocate(shard, capacity);
+  for (std::uint32_t i = 0; i < oldCapacity; i++) {
+    if (oldMeta[i] != 0)
+      place(shard, oldSlots[i]);
+  }
+
+  delete [] oldSlots;
+  delete [] oldMeta;
+}
+
+void BufProbeTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  const std::uint64_t h = mix(file, pageNo);
+  probeShard& shard = shardFor(h);
+  std::lock_guard<std::mutex> guard(shard.latch);
+
+  const std::int64_t index = probe(shard, h, file, pageNo);
+  if (index >= 0)
+    throw HashAlreadyPresentException(file->filename(), pageNo, shard.slots[index].frameNo);
+
+  probeSlot entry = {file, pageNo, frameNo};
+  place(shard, entry);
+}
+
+bool BufProbeTbl::find(const File* file, const PageId pageNo, FrameId &frameNo)
+{
+  const std::uint64_t h = mix(file, pageNo);
+  probeShard& shard = shardFor(h);
+  std::lock_guard<std::mutex> guard(shard.latch);
+
+  const std::int64_t index = probe(shard, h, file, pageNo);
+  if (index < 0)
+    return false;
+
+  frameNo = shard.slots[index].frameNo; // return frameNo by reference
+  return true;
+}
+
+bool BufProbeTbl::erase(const File* file, const PageId pageNo)
+{
+  const std::uint64_t h = mix(file, pageNo);
+  probeShard& shard = shardFor(h);
+  std::lock_guard<std::mutex> guard(shard.latch);
+
+  const std::int64_t index = probe(shard, h, file, pageNo);
+  if (index < 0)
+    return false;
+
+  // Backward shift deletion: pull the following entries of the cluster one slot closer
+  // to their home until an empty slot or an entry already at home is reached
+  std::uint32_t i = index;
+  for (;;) {
+    const std::uint32_t next = (i + 1) & shard.mask;
+    if (shard.meta[next] <= 1)
+      break;
+    shard.slots[i] = shard.slots[next];
+    shard.meta[i] = shard.meta[next] - 1;
+    i = next;
+  }
+  shard.meta[i] = 0;
+  shard.count--;
+  return true;
+}
+
+// The shard bits of the hash stay, so every entry stays in its shard; each shard is
+// latched while its entries are moved
+void BufProbeTbl::resize(const std::uint32_t entries)
+{
+  const std::uint32_t target = shardCapacity(entries);
+  for (std::uint32_t s = 0; s < numShards; s++) {
+    probeShard& shard = shards[s];
+    std::lock_guard<std::mutex> guard(shard.latch);
+
+    std::uint32_t capacity = target;
+    while ((shard.count + 1) * 8 > capacity * 7)
+      capacity *= 2;
+    if (capacity != shard.mask + 1)
+      rebuild(shard, capacity);
+  }
+}
+
+std::uint32_t BufProbeTbl::slots()
+{
+  std::uint32_t total = 0;
+  for (std::uint32_t s = 0; s < numShards; s++) {
+    std::lock_guard<std::mutex> guard(shards[s].latch);
+    total += shards[s].mask + 1;
+  }
+  return total;
+}
+
+}
@@ -0,0 +1,229 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+#include "file.h"
+#include "bufTable.h"
+
+namespace badgerdb {
+
+/**
+* @brief Slot of the open addressing table
+*/
+struct probeSlot {
+	/**
+	 * pointer a file object
+	 */
+	const File *file;
+
+	/**
+	 * page number within a file
+	 */
+	PageId pageNo;
+
+	/**
+	 * frame number of page in the buffer pool
+	 */
+	FrameId frameNo;
+};
+
+
+/**
+* @brief One independently latched open addressing table
+*
+* meta[i] is 0 if slots[i] is empty, otherwise one more than the distance of the entry in
+* slots[i] from the slot it hashes to.  Probes only touch the one byte wide meta array
+* until they find a candidate whose distance matches, so a miss rarely loads a slot.
+*/
+struct probeShard {
+	/**
+	 * Latch protecting this shard
+	 */
+	std::mutex latch;
+
+	/**
+	 * Slot array, capacity entries long
+	 */
+	probeSlot* slots;
+
+	/**
+	 * Probe distance metadata, one byte per slot
+	 */
+	std::uint8_t* meta;
+
+	/**
+	 * Number of slots minus one; the number of slots is a power of two
+	 */
+	std::uint32_t mask;
+
+	/**
+	 * Number of occupied slots
+	 */
+	std::uint32_t count;
+
+	/**
+	 * Pads the shard out to its own cache line
+	 */
+	char pad[64 - (sizeof(std::mutex) + sizeof(probeSlot*) + sizeof(std::uint8_t*) + 2 * sizeof(std::uint32_t)) % 64];
+};
+
+
+/**
+* @brief Open addressing (Robin Hood) hash table to keep track of pages in the buffer pool
+*
+* Drop-in alternative to BufHashTbl.  Entries live in flat per-shard arrays, so insert and
+* remove never allocate, and a lookup walks a few adjacent slots instead of a linked list.
+* Entries are placed with Robin Hood hashing and removed with backward shift deletion,
+* which keeps probe sequences short even at high load.  Keys are hashed with
+* BufTable::mix(); the top bits select the shard and the low bits the home slot.
+*
+* A shard doubles its capacity if it fills beyond 7/8 or a probe distance no longer fits
+* in a metadata byte.  Shards are sized up front for the expected number of entries, so
+* this only happens when hashing is badly skewed.  resize() sizes them anew, one shard
+* at a time, when the number of entries expected changes.
+*/
+class BufProbeTbl : public BufTable
+{
+ private:
+	/**
+	 * Number of shards, a power of two
+	 */
+  std::uint32_t numShards;
+
+	/**
+	 * Number of bits of the hash used to select the shard
+	 */
+  int shardBits;
+
+	/**
+	 * Array of numShards shards
+	 */
+  probeShard* shards;
+
+	/**
+	 * Locates the shard responsible for a hash value
+	 *
+	 * @param h   Hash value computed by BufTable::mix()
+	 * @return  	Shard responsible for the hash
+	 */
+  probeShard& shardFor(const std::uint64_t h)
+	{
+		return shards[shardBits == 0 ? 0 : h >> (64 - shardBits)];
+	}
+
+	/**
+	 * Finds the slot holding (file, pageNo) in a latched shard
+	 *
+	 * @param shard   Shard to search
+	 * @param h       Hash of (file, pageNo)
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Index of the slot, or -1 if the entry is not present
+	 */
+  static std::int64_t probe(const probeShard& shard, const std::uint64_t h, const File* file, const PageId pageNo);
+
+	/**
+	 * Places an entry known to be absent into a latched shard, growing it if necessary
+	 *
+	 * @param shard   Shard to insert into
+	 * @param entry   Entry to insert
+	 */
+  static void place(probeShard& shard, probeSlot entry);
+
+	/**
+	 * Doubles the capacity of a latched shard and reinserts its entries
+	 *
+	 * @param shard   Shard to grow
+	 */
+  static void grow(probeShard& shard);
+
+	/**
+	 * Moves the entries of a latched shard to new arrays of another capacity
+	 *
+	 * @param shard     Shard to rebuild
+	 * @param capacity  Number of slots, a power of two that holds the entries
+	 */
+  static void rebuild(probeShard& shard, const std::uint32_t capacity);
+
+	/**
+	 * Returns the capacity that a shard's share of entries fills at most 3/4
+	 *
+	 * @param entries   Number of entries expected in the whole table
+	 */
+  std::uint32_t shardCapacity(const std::uint32_t entries) const;
+
+	/**
+	 * Allocates empty slot and metadata arrays for a shard
+	 *
+	 * @param shard     Shard to initialize
+	 * @param capacity  Number of slots, a power of two
+	 */
+  static void allocate(probeShard& shard, const std::uint32_t capacity);
+
+ public:
+	/**
+   * Constructor of BufProbeTbl class
+	 *
+	 * @param entries   Maximum number of entries expected at any one time
+	 * @param shardCnt  Number of independently latched shards; rounded down to a power of two
+	 */
+	BufProbeTbl(const std::uint32_t entries, const int shardCnt);
+
+	/**
+   * Destructor of BufProbeTbl class
+	 */
+  virtual ~BufProbeTbl();
+
+	/**
+   * Insert entry into hash table mapping (file, pageNo) to frameNo.
+	 *
+	 * @param file   	File object
+	 * @param pageNo 	Page number in the file
+	 * @param frameNo Frame number assigned to that page of the file
+   * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
+	 */
+  virtual void insert(const File* file, const PageId pageNo, const FrameId frameNo);
+
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool (ie. in
+   * the hash table).  Does not throw if the entry is missing.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, only assigned if the entry is found
+	 * @return  			True if the entry was found, false otherwise
+	 */
+  virtual bool find(const File* file, const PageId pageNo, FrameId &frameNo);
+
+	/**
+   * Delete entry (file,pageNo) from hash table if it is present.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			True if the entry was found and deleted, false otherwise
+	 */
+  virtual bool erase(const File* file, const PageId pageNo);
+
+	/**
+   * Resizes every shard for its share of the entries, as the constructor does, but never
+	 * below what its current entries need.
+	 *
+	 * @param entries Maximum number of entries expected at any one time from now on
+	 */
+  virtual void resize(const std::uint32_t entries);
+
+	/**
+   * Returns the number of slots over all the shards.
+	 */
+  virtual std::uint32_t slots();
+};
+
+}
@@ -0,0 +1,87 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "file.h"
+#include "bufTable.h"
+
+namespace badgerdb {
+
+class BufMgr;
+
+/**
+* @brief Ring of frames that confines a large scan to a small part of the buffer pool
+*
+* Passed to BufMgr::readPage().  A miss made through the strategy reuses the frame the
+* ring loaded ringSize misses ago, as long as that frame still holds the page the ring
+* put there and nobody has it pinned; only when it cannot does the miss take a victim
+* from the replacement policy.  A scan of any length therefore evicts at most ringSize
+* pages of the rest of the pool.  Hits are unaffected.
+*
+* A strategy belongs to one scan and must not be used by two threads at once.  It holds
+* no pins, so it may be destroyed at any time.
+*/
+class BufAccessStrategy
+{
+	friend class BufMgr;
+
+ private:
+	/**
+	 * Page the ring loaded into a frame
+	 */
+  struct Slot {
+		/**
+		 * Frame the page was loaded into
+		 */
+		FrameId frame;
+
+		/**
+		 * File of the page, NULL while the slot has not been used
+		 */
+		const File* file;
+
+		/**
+		 * Page number in the file
+		 */
+		PageId pageNo;
+	};
+
+	/**
+	 * Slots in the order the ring reuses them
+	 */
+  std::vector<Slot> ring;
+
+	/**
+	 * Slot the next miss reuses
+	 */
+  std::size_t current;
+
+ public:
+	/**
+   * Constructor of BufAccessStrategy class
+	 *
+	 * @param ringSize  Number of frames the scan may hold at once (at least one); it
+	 *                  needs at least as many as pages it keeps pinned at a time
+	 */
+  explicit BufAccessStrategy(const std::uint32_t ringSize)
+		: ring(ringSize > 0 ? ringSize : 1), current(0)
+	{
+		for (std::size_t i = 0; i < ring.size(); i++)
+			ring[i].file = NULL;
+	}
+
+	/**
+	 * Returns the number of frames in the ring.
+	 */
+  std::uint32_t size() const { return ring.size(); }
+};
+
+}
@@ -0,0 +1,125 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "file.h"
+#include "exceptions/hash_not_found_exception.h"
+
+namespace badgerdb {
+
+/**
+* @brief Interface of the tables that map a (File, page) pair to the buffer pool frame holding it
+*
+* Implementations must be safe to call from many threads at once.
+*/
+class BufTable
+{
+ public:
+	/**
+   * Destructor of BufTable class
+	 */
+  virtual ~BufTable() {}
+
+	/**
+   * Insert entry into hash table mapping (file, pageNo) to frameNo.
+	 *
+	 * @param file   	File object
+	 * @param pageNo 	Page number in the file
+	 * @param frameNo Frame number assigned to that page of the file
+   * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
+	 */
+  virtual void insert(const File* file, const PageId pageNo, const FrameId frameNo) = 0;
+
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool (ie. in
+   * the hash table).  Reports a miss through the return value, so it is cheap
+   * on the miss path.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, only assigned if the entry is found
+	 * @return  			True if the entry was found, false otherwise
+	 */
+  virtual bool find(const File* file, const PageId pageNo, FrameId &frameNo) = 0;
+
+	/**
+   * Delete entry (file,pageNo) from hash table if it is present.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			True if the entry was found and deleted, false otherwise
+	 */
+  virtual bool erase(const File* file, const PageId pageNo) = 0;
+
+	/**
+   * Resizes the table for a new number of entries, as the buffer pool grows or shrinks.
+	 * Shards are rebuilt one at a time under their own latches, so lookups, inserts and
+	 * removes go on meanwhile and wait for at most one shard's rebuild.
+	 *
+	 * @param entries Maximum number of entries expected at any one time from now on
+	 */
+  virtual void resize(const std::uint32_t entries) = 0;
+
+	/**
+   * Returns the number of buckets or slots the table has, over all its shards.
+	 */
+  virtual std::uint32_t slots() = 0;
+
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool (ie. in
+   * the hash table).
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference
+   * @throws HashNotFoundException if the page entry is not found in the hash table 
+	 */
+  void lookup(const File* file, const PageId pageNo, FrameId &frameNo)
+	{
+		if (!find(file, pageNo, frameNo))
+			throw HashNotFoundException(file->filename(), pageNo);
+	}
+
+	/**
+   * Delete entry (file,pageNo) from hash table.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+   * @throws HashNotFoundException if the page entry is not found in the hash table 
+	 */
+  void remove(const File* file, const PageId pageNo)
+	{
+		if (!erase(file, pageNo))
+			throw HashNotFoundException(file->filename(), pageNo);
+	}
+
+	/**
+	 * Mixes the file object address and the page number into a well distributed 64 bit
+	 * hash (the finalizer of MurmurHash3).  Consecutive pages of one file end up far
+	 * apart, and all 64 bits of the pointer take part.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Hash value.
+	 */
+  static std::uint64_t mix(const File* file, const PageId pageNo)
+	{
+		std::uint64_t h = reinterpret_cast<std::uintptr_t>(file) ^
+				(static_cast<std::uint64_t>(pageNo) * 0x9E3779B97F4A7C15ULL);
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+};
+
+}
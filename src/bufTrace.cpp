@@ -0,0 +1,449 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <thread>
+#include "bufTrace.h"
+#include "exceptions/io_error_exception.h"
+
+namespace badgerdb {
+
+	namespace {
+
+		// First bytes of a trace file
+		const char TRACE_MAGIC[8] = {'B', 'D', 'T', 'R', 'A', 'C', 'E', '1'};
+
+		// Source of BufTrace::id
+		std::atomic<std::uint64_t> nextTraceId(1);
+
+		// Trace the calling thread recorded in last, and its ring there
+		thread_local std::uint64_t cachedTrace = 0;
+		thread_local BufTraceRing* cachedRing = NULL;
+
+		// Identity of a page in a trace
+		typedef std::pair<std::uint64_t, PageId> TracePage;
+
+		// Fenwick tree over the accesses of a trace, holding a 1 at the latest access of
+		// every page, so that the pages accessed between two accesses are counted in
+		// O(log n)
+		class Fenwick
+		{
+		 public:
+			explicit Fenwick(const std::size_t size) : tree(size + 1, 0) {}
+
+			void add(std::size_t at, const int delta)
+			{
+				for (at++; at < tree.size(); at += at & (~at + 1))
+					tree[at] += delta;
+			}
+
+			// Sum over [0, end)
+			std::int64_t sum(std::size_t end) const
+			{
+				std::int64_t total = 0;
+				for (; end > 0; end -= end & (~end + 1))
+					total += tree[end];
+				return total;
+			}
+
+		 private:
+			std::vector<std::int64_t> tree;
+		};
+
+		bool isAccess(const BufTraceEvent& event)
+		{
+			return event.type == TRACE_HIT || event.type == TRACE_ALLOC ||
+				(event.type == TRACE_MISS && (event.flags & TRACE_PREFETCH) == 0);
+		}
+
+		void writeAll(std::FILE* out, const std::string& path, const void* data, const std::size_t bytes)
+		{
+			if (bytes > 0 && std::fwrite(data, 1, bytes, out) != bytes) {
+				const int error = errno;
+				std::fclose(out);
+				throw IoErrorException(path, Page::INVALID_NUMBER, error);
+			}
+		}
+
+		void readAll(std::FILE* in, const std::string& path, void* data, const std::size_t bytes)
+		{
+			if (bytes > 0 && std::fread(data, 1, bytes, in) != bytes) {
+				const int error = std::ferror(in) ? errno : 0;
+				std::fclose(in);
+				throw IoErrorException(path, Page::INVALID_NUMBER, error);
+			}
+		}
+
+	}
+
+	const FrameId BufTraceEvent::NO_FRAME;
+	const int BufTraceFileReport::REUSE_BUCKETS;
+
+	BufTraceFileReport::BufTraceFileReport()
+		: accesses(0), hits(0), misses(0), cold(0), evictedClean(0), evictedDirty(0), evictedByRing(0),
+		  evictedByResize(0), flushed(0), disposed(0), refetches(0)
+	{
+		std::fill(reuse, reuse + REUSE_BUCKETS, 0);
+	}
+
+	std::uint64_t BufTraceFileReport::lruFrames(const double q) const
+	{
+		std::uint64_t warm = 0;
+		for (int b = 0; b < REUSE_BUCKETS; b++)
+			warm += reuse[b];
+		if (warm == 0)
+			return 0;
+
+		std::uint64_t seen = 0;
+		for (int b = 0; b < REUSE_BUCKETS; b++) {
+			seen += reuse[b];
+			if (seen >= q * warm)
+				return std::uint64_t(1) << b;
+		}
+		return std::uint64_t(1) << (REUSE_BUCKETS - 1);
+	}
+
+	// Reuse distances are LRU stack distances over the accesses of all files: the pages
+	// accessed between two accesses to a page are those whose latest access lies between
+	void BufTraceReport::build(const std::vector<BufTraceEvent>& events,
+		const std::map<std::uint64_t, std::string>& names, const std::size_t top)
+	{
+		std::size_t accesses = 0;
+		for (std::size_t i = 0; i < events.size(); i++) {
+			if (isAccess(events[i]))
+				accesses++;
+		}
+
+		std::map<std::uint64_t, BufTraceFileReport> byFile;
+		std::map<TracePage, std::size_t> latest;
+		std::set<TracePage> evicted;
+		std::map<TracePage, std::uint64_t> refetched;
+		Fenwick marks(accesses);
+		std::size_t index = 0;
+
+		for (std::size_t i = 0; i < events.size(); i++) {
+			const BufTraceEvent& event = events[i];
+			BufTraceFileReport& file = byFile[event.file];
+			const TracePage page(event.file, event.pageNo);
+
+			if (event.type == TRACE_MISS && evicted.erase(page) > 0) {
+				file.refetches++;
+				refetched[page]++;
+			}
+
+			if (isAccess(event)) {
+				file.accesses++;
+				if (event.type == TRACE_HIT)
+					file.hits++;
+				else
+					file.misses++;
+
+				std::map<TracePage, std::size_t>::iterator last = latest.find(page);
+				if (last == latest.end()) {
+					file.cold++;
+					latest[page] = index;
+				}
+				else {
+					const std::uint64_t distance = marks.sum(index) - marks.sum(last->second + 1);
+					const int bucket = 63 - __builtin_clzll(distance + 1);
+					file.reuse[std::min(bucket, BufTraceFileReport::REUSE_BUCKETS - 1)]++;
+					marks.add(last->second, -1);
+					last->second = index;
+				}
+				marks.add(index, 1);
+				index++;
+				continue;
+			}
+
+			switch (event.type) {
+				case TRACE_EVICT:
+					if (event.flags & TRACE_RING)
+						file.evictedByRing++;
+					else if (event.flags & TRACE_RESIZE)
+						file.evictedByResize++;
+					else if (event.flags & TRACE_DIRTY)
+						file.evictedDirty++;
+					else
+						file.evictedClean++;
+					evicted.insert(page);
+					break;
+				case TRACE_FLUSH:
+					file.flushed++;
+					evicted.erase(page);
+					break;
+				case TRACE_DISPOSE: {
+					// The page number may be allocated again, to a page not seen before
+					file.disposed++;
+					evicted.erase(page);
+					std::map<TracePage, std::size_t>::iterator last = latest.find(page);
+					if (last != latest.end()) {
+						marks.add(last->second, -1);
+						latest.erase(last);
+					}
+					break;
+				}
+				default:
+					break;
+			}
+		}
+
+		files.clear();
+		for (std::map<std::uint64_t, BufTraceFileReport>::iterator it = byFile.begin(); it != byFile.end(); ++it) {
+			std::map<std::uint64_t, std::string>::const_iterator name = names.find(it->first);
+			if (name != names.end()) {
+				it->second.filename = name->second;
+			}
+			else {
+				char key[32];
+				std::snprintf(key, sizeof(key), "0x%llx", (unsigned long long)it->first);
+				it->second.filename = key;
+			}
+			files.push_back(it->second);
+		}
+		std::sort(files.begin(), files.end(), [](const BufTraceFileReport& a, const BufTraceFileReport& b) {
+			return a.filename < b.filename;
+		});
+
+		topRefetches.clear();
+		for (std::map<TracePage, std::uint64_t>::iterator it = refetched.begin(); it != refetched.end(); ++it) {
+			BufTraceRefetch refetch;
+			refetch.filename = byFile[it->first.first].filename;
+			refetch.pageNo = it->first.second;
+			refetch.count = it->second;
+			topRefetches.push_back(refetch);
+		}
+		std::stable_sort(topRefetches.begin(), topRefetches.end(), [](const BufTraceRefetch& a, const BufTraceRefetch& b) {
+			return a.count > b.count;
+		});
+		if (topRefetches.size() > top) {
+			topRefetches.resize(top);
+		}
+	}
+
+	void BufTraceReport::print(std::ostream& out) const
+	{
+		char line[256];
+		for (std::size_t f = 0; f < files.size(); f++) {
+			const BufTraceFileReport& file = files[f];
+			out << "file " << file.filename << "\n";
+			std::snprintf(line, sizeof(line), "  accesses %llu: hits %llu (%.1f%%), misses %llu, cold %llu\n",
+				(unsigned long long)file.accesses, (unsigned long long)file.hits,
+				file.accesses > 0 ? 100.0 * file.hits / file.accesses : 0.0,
+				(unsigned long long)file.misses, (unsigned long long)file.cold);
+			out << line;
+
+			if (file.accesses > file.cold) {
+				std::snprintf(line, sizeof(line), "  LRU frames for 50%% / 90%% / 99%% of warm accesses: %llu / %llu / %llu\n",
+					(unsigned long long)file.lruFrames(0.5), (unsigned long long)file.lruFrames(0.9),
+					(unsigned long long)file.lruFrames(0.99));
+				out << line;
+
+				// Share of all the file's accesses an LRU pool of 2^b frames would hit
+				int last = 0;
+				for (int b = 0; b < BufTraceFileReport::REUSE_BUCKETS; b++) {
+					if (file.reuse[b] > 0)
+						last = b;
+				}
+				out << "  LRU hit% by frames:";
+				std::uint64_t seen = 0;
+				for (int b = 0; b <= last; b++) {
+					seen += file.reuse[b];
+					std::snprintf(line, sizeof(line), " %llu:%.1f", (unsigned long long)(std::uint64_t(1) << b),
+						100.0 * seen / file.accesses);
+					out << line;
+				}
+				out << "\n";
+			}
+
+			std::snprintf(line, sizeof(line), "  left the pool: evicted %llu clean, %llu dirty, %llu by rings, "
+				"%llu by resize; flushed %llu; disposed %llu\n",
+				(unsigned long long)file.evictedClean, (unsigned long long)file.evictedDirty,
+				(unsigned long long)file.evictedByRing, (unsigned long long)file.evictedByResize,
+				(unsigned long long)file.flushed, (unsigned long long)file.disposed);
+			out << line;
+			std::snprintf(line, sizeof(line), "  read again after eviction: %llu\n", (unsigned long long)file.refetches);
+			out << line;
+		}
+
+		if (!topRefetches.empty()) {
+			out << "pages read again most after eviction\n";
+			for (std::size_t i = 0; i < topRefetches.size(); i++) {
+				std::snprintf(line, sizeof(line), "  %s page %u: %llu times\n", topRefetches[i].filename.c_str(),
+					topRefetches[i].pageNo, (unsigned long long)topRefetches[i].count);
+				out << line;
+			}
+		}
+	}
+
+	BufTrace::BufTrace(const std::size_t events)
+		: id(nextTraceId++), ringSize([events]() {
+			std::size_t size = 2;
+			while (size < events)
+				size *= 2;
+			return size;
+		}())
+	{
+	}
+
+	// A thread that records in several traces in turn finds its ring again under the
+	// latch, instead of making another
+	BufTraceRing& BufTrace::ring()
+	{
+		if (cachedTrace == id) {
+			return *cachedRing;
+		}
+
+		std::lock_guard<std::mutex> guard(latch);
+		const std::thread::id self = std::this_thread::get_id();
+		BufTraceRing* mine = NULL;
+		for (std::size_t i = 0; i < rings.size() && mine == NULL; i++) {
+			if (rings[i]->owner == self)
+				mine = rings[i].get();
+		}
+		if (mine == NULL) {
+			rings.push_back(std::unique_ptr<BufTraceRing>(new BufTraceRing(ringSize)));
+			mine = rings.back().get();
+			mine->owner = self;
+		}
+		cachedTrace = id;
+		cachedRing = mine;
+		return *mine;
+	}
+
+	// The event is filled in before the release store of the head publishes it
+	void BufTrace::record(const BufTraceEventType type, const File* file, const PageId pageNo, const FrameId frame,
+		const std::uint8_t flags)
+	{
+		BufTraceRing& mine = ring();
+		const std::uint64_t at = mine.head.load(std::memory_order_relaxed);
+		BufTraceEvent& event = mine.events[at & (ringSize - 1)];
+		event.nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+		event.file = reinterpret_cast<std::uintptr_t>(file);
+		event.pageNo = pageNo;
+		event.frame = frame;
+		event.type = type;
+		event.flags = flags;
+		mine.head.store(at + 1, std::memory_order_release);
+	}
+
+	void BufTrace::name(const File* file)
+	{
+		const std::uint64_t key = reinterpret_cast<std::uintptr_t>(file);
+		std::lock_guard<std::mutex> guard(latch);
+		std::string& known = names[key];
+
+		// A File object made where a destroyed one was takes over its key
+		if (known != file->filename()) {
+			known = file->filename();
+		}
+	}
+
+	// Seqlock style: the head read after the copy tells which slots the writer may have
+	// reused meanwhile, including the one it is writing now
+	void BufTrace::snapshot(std::vector<BufTraceEvent>& events, std::map<std::uint64_t, std::string>& namesOut) const
+	{
+		std::vector<BufTraceRing*> all;
+		{
+			std::lock_guard<std::mutex> guard(latch);
+			for (std::size_t i = 0; i < rings.size(); i++) {
+				all.push_back(rings[i].get());
+			}
+			namesOut.insert(names.begin(), names.end());
+		}
+
+		const std::size_t first = events.size();
+		std::vector<BufTraceEvent> copy(ringSize);
+		for (std::size_t r = 0; r < all.size(); r++) {
+			const BufTraceRing& ring = *all[r];
+			const std::uint64_t end = ring.head.load(std::memory_order_acquire);
+			const std::uint64_t begin = end > ringSize ? end - ringSize : 0;
+			for (std::uint64_t i = begin; i < end; i++) {
+				copy[i - begin] = ring.events[i & (ringSize - 1)];
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const std::uint64_t now = ring.head.load(std::memory_order_relaxed);
+			const std::uint64_t intact = now + 1 > ringSize ? now + 1 - ringSize : 0;
+			for (std::uint64_t i = std::max(begin, intact); i < end; i++) {
+				events.push_back(copy[i - begin]);
+			}
+		}
+
+		std::stable_sort(events.begin() + first, events.end(), [](const BufTraceEvent& a, const BufTraceEvent& b) {
+			return a.nanos < b.nanos;
+		});
+	}
+
+	// Layout: magic, number of names, each name as key, length and bytes, number of
+	// events, events as they are in memory
+	void BufTrace::save(const std::string& path) const
+	{
+		std::vector<BufTraceEvent> events;
+		std::map<std::uint64_t, std::string> namesNow;
+		snapshot(events, namesNow);
+
+		std::FILE* out = std::fopen(path.c_str(), "wb");
+		if (out == NULL) {
+			throw IoErrorException(path, Page::INVALID_NUMBER, errno);
+		}
+		writeAll(out, path, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+		const std::uint64_t nameCount = namesNow.size();
+		writeAll(out, path, &nameCount, sizeof(nameCount));
+		for (std::map<std::uint64_t, std::string>::const_iterator it = namesNow.begin(); it != namesNow.end(); ++it) {
+			const std::uint64_t length = it->second.size();
+			writeAll(out, path, &it->first, sizeof(it->first));
+			writeAll(out, path, &length, sizeof(length));
+			writeAll(out, path, it->second.data(), it->second.size());
+		}
+		const std::uint64_t eventCount = events.size();
+		writeAll(out, path, &eventCount, sizeof(eventCount));
+		writeAll(out, path, events.data(), events.size() * sizeof(BufTraceEvent));
+		if (std::fclose(out) != 0) {
+			throw IoErrorException(path, Page::INVALID_NUMBER, errno);
+		}
+	}
+
+	void BufTrace::load(const std::string& path, std::vector<BufTraceEvent>& events,
+		std::map<std::uint64_t, std::string>& namesOut)
+	{
+		std::FILE* in = std::fopen(path.c_str(), "rb");
+		if (in == NULL) {
+			throw IoErrorException(path, Page::INVALID_NUMBER, errno);
+		}
+		char magic[sizeof(TRACE_MAGIC)];
+		readAll(in, path, magic, sizeof(magic));
+		if (std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0) {
+			std::fclose(in);
+			throw IoErrorException(path, Page::INVALID_NUMBER, EINVAL);
+		}
+
+		std::uint64_t nameCount;
+		readAll(in, path, &nameCount, sizeof(nameCount));
+		for (std::uint64_t i = 0; i < nameCount; i++) {
+			std::uint64_t key;
+			std::uint64_t length;
+			readAll(in, path, &key, sizeof(key));
+			readAll(in, path, &length, sizeof(length));
+			std::string name(length, '\0');
+			readAll(in, path, &name[0], length);
+			namesOut[key] = name;
+		}
+
+		std::uint64_t eventCount;
+		readAll(in, path, &eventCount, sizeof(eventCount));
+		const std::size_t first = events.size();
+		events.resize(first + eventCount);
+		readAll(in, path, events.data() + first, eventCount * sizeof(BufTraceEvent));
+		std::fclose(in);
+	}
+
+}
@@ -0,0 +1,356 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file.h"
+
+namespace badgerdb {
+
+/**
+* @brief Kinds of events BufTrace records
+*/
+enum BufTraceEventType {
+	/**
+	 * readPage() found the page in the pool
+	 */
+	TRACE_HIT,
+
+	/**
+	 * readPage() read the page into a frame, or prefetch() started reading it (TRACE_PREFETCH)
+	 */
+	TRACE_MISS,
+
+	/**
+	 * allocPage() placed a new page in a frame
+	 */
+	TRACE_ALLOC,
+
+	/**
+	 * unPinPage() or a PageHandle unpinned the page (TRACE_DIRTY if it was changed)
+	 */
+	TRACE_UNPIN,
+
+	/**
+	 * The page was evicted from its frame for another page, by the replacement policy
+	 * or as TRACE_RING or TRACE_RESIZE say (TRACE_DIRTY if it had to be written back)
+	 */
+	TRACE_EVICT,
+
+	/**
+	 * flushFile() took the page out of the pool (TRACE_DIRTY if it wrote it)
+	 */
+	TRACE_FLUSH,
+
+	/**
+	 * disposePage() deleted the page; the frame is BufTraceEvent::NO_FRAME if the page
+	 * was not in the pool
+	 */
+	TRACE_DISPOSE
+};
+
+/**
+ * Flags of a BufTraceEvent
+ */
+const std::uint8_t TRACE_DIRTY = 1;
+const std::uint8_t TRACE_RING = 2;
+const std::uint8_t TRACE_RESIZE = 4;
+const std::uint8_t TRACE_PREFETCH = 8;
+
+
+/**
+* @brief One event of a buffer pool trace, 32 bytes
+*/
+struct BufTraceEvent
+{
+	/**
+	 * Frame of an event that involves none
+	 */
+	static const FrameId NO_FRAME = ~FrameId(0);
+
+	/**
+	 * steady_clock time of the event, in nanoseconds
+	 */
+  std::uint64_t nanos;
+
+	/**
+	 * Key of the file: the address of its File object, which BufTrace names
+	 */
+  std::uint64_t file;
+
+	/**
+	 * Page number in the file, and the frame holding it
+	 */
+  PageId pageNo;
+  FrameId frame;
+
+	/**
+	 * BufTraceEventType, and TRACE_ flags
+	 */
+  std::uint8_t type;
+  std::uint8_t flags;
+};
+
+
+/**
+* @brief Reuse distances and eviction reasons of one file, made from a trace
+*/
+struct BufTraceFileReport
+{
+	/**
+	 * Number of buckets of reuse
+	 */
+	static const int REUSE_BUCKETS = 33;
+
+	/**
+	 * Name of the file, or its key in hexadecimal if the trace does not name it
+	 */
+  std::string filename;
+
+	/**
+	 * Accesses (hits, misses and allocs, not prefetches), and how many hit and missed
+	 */
+  std::uint64_t accesses;
+  std::uint64_t hits;
+  std::uint64_t misses;
+
+	/**
+	 * Accesses to a page not accessed before in the trace
+	 */
+  std::uint64_t cold;
+
+	/**
+	 * Accesses by reuse distance: the number of other pages, of any file, accessed since
+	 * the page was last accessed.  reuse[b] counts distances d with 2^b <= d + 1 < 2^(b+1),
+	 * so an LRU pool of 2^b frames would hit reuse[0] + ... + reuse[b] of them.
+	 */
+  std::uint64_t reuse[REUSE_BUCKETS];
+
+	/**
+	 * Pages that left the pool: evicted by the replacement policy clean and dirty, by a
+	 * BufAccessStrategy ring, by a shrink, and taken out by flushFile() and disposePage()
+	 */
+  std::uint64_t evictedClean;
+  std::uint64_t evictedDirty;
+  std::uint64_t evictedByRing;
+  std::uint64_t evictedByResize;
+  std::uint64_t flushed;
+  std::uint64_t disposed;
+
+	/**
+	 * Misses of pages evicted earlier in the trace: the pool is thrashing on them
+	 */
+  std::uint64_t refetches;
+
+	/**
+	 * Returns the smallest LRU pool, a power of two frames, that would hit the fraction q
+	 * of the accesses that are not cold; 0 if there are none.
+	 */
+  std::uint64_t lruFrames(const double q) const;
+
+	/**
+	 * Constructor of BufTraceFileReport class
+	 */
+  BufTraceFileReport();
+};
+
+
+/**
+* @brief A page the pool read again after evicting it, made from a trace
+*/
+struct BufTraceRefetch
+{
+	/**
+	 * Name of the file and number of the page
+	 */
+  std::string filename;
+  PageId pageNo;
+
+	/**
+	 * Number of times the page was read again after an eviction
+	 */
+  std::uint64_t count;
+};
+
+
+/**
+* @brief Report made from a trace: every file, and the pages refetched most
+*/
+struct BufTraceReport
+{
+	/**
+	 * Reports of the files, sorted by name
+	 */
+  std::vector<BufTraceFileReport> files;
+
+	/**
+	 * Pages refetched most, most first
+	 */
+  std::vector<BufTraceRefetch> topRefetches;
+
+	/**
+	 * Makes the report of a trace.
+	 *
+	 * @param events  Events in time order
+	 * @param names   Names of the files, by key
+	 * @param top     Number of pages in topRefetches
+	 */
+  void build(const std::vector<BufTraceEvent>& events, const std::map<std::uint64_t, std::string>& names,
+		const std::size_t top);
+
+	/**
+	 * Writes the report as text.
+	 */
+  void print(std::ostream& out) const;
+};
+
+
+/**
+* @brief Ring buffer of the events one thread recorded
+*
+* Only its thread writes it; readers copy it without stopping the writer and drop the
+* events overwritten meanwhile.
+*/
+struct BufTraceRing
+{
+	/**
+	 * Events; slot (i mod events.size()) holds event i
+	 */
+  std::vector<BufTraceEvent> events;
+
+	/**
+	 * Number of events recorded so far
+	 */
+  std::atomic<std::uint64_t> head;
+
+	/**
+	 * Thread writing the ring
+	 */
+  std::thread::id owner;
+
+	/**
+	 * Constructs a ring of a power of two events
+	 */
+  explicit BufTraceRing(const std::size_t size) : events(size), head(0) {}
+};
+
+
+/**
+* @brief Event trace of a buffer manager, one lock-free ring buffer per thread
+*
+* Built by BufMgr when BufMgrOptions::traceEvents is set.  Recording an event writes
+* 32 bytes to the calling thread's ring and publishes them with one release store; the
+* ring is found through a thread local cache, so only a thread's first event takes a
+* latch.  Each ring keeps the latest events of its thread, older ones are overwritten.
+* snapshot() merges the rings while they are written; save() writes a trace file that
+* the trace_dump tool turns into a BufTraceReport.
+*/
+class BufTrace
+{
+ private:
+	/**
+	 * Identifies the trace in the thread local caches; never reused
+	 */
+  const std::uint64_t id;
+
+	/**
+	 * Events each ring holds, a power of two
+	 */
+  const std::size_t ringSize;
+
+	/**
+	 * Latch protecting rings and names
+	 */
+  mutable std::mutex latch;
+
+	/**
+	 * Ring of every thread that recorded an event; kept when the thread exits
+	 */
+  std::vector<std::unique_ptr<BufTraceRing> > rings;
+
+	/**
+	 * Names of the files seen, by key
+	 */
+  std::map<std::uint64_t, std::string> names;
+
+	/**
+	 * Returns the calling thread's ring, made on its first event.
+	 */
+  BufTraceRing& ring();
+
+ public:
+	/**
+	 * Constructor of BufTrace class
+	 *
+	 * @param events  Events each thread's ring holds, rounded up to a power of two
+	 */
+  explicit BufTrace(const std::size_t events);
+
+	/**
+	 * Records an event in the calling thread's ring.
+	 *
+	 * @param type    BufTraceEventType
+	 * @param file    File of the page
+	 * @param pageNo  Page number in the file
+	 * @param frame   Frame holding the page, or BufTraceEvent::NO_FRAME
+	 * @param flags   TRACE_ flags
+	 */
+  void record(const BufTraceEventType type, const File* file, const PageId pageNo, const FrameId frame,
+		const std::uint8_t flags = 0);
+
+	/**
+	 * Remembers the name of a file, so that reports name it; cheap once it is known.
+	 * Called as pages of the file enter the pool.
+	 */
+  void name(const File* file);
+
+	/**
+	 * Copies the events of every ring, merged in time order, and the file names.  The
+	 * threads go on recording meanwhile; events they overwrite during the copy are left
+	 * out, and so is the oldest event of a full ring, whose slot the next event takes.
+	 *
+	 * @param events  Events are appended to this vector
+	 * @param namesOut File names are added to this map
+	 */
+  void snapshot(std::vector<BufTraceEvent>& events, std::map<std::uint64_t, std::string>& namesOut) const;
+
+	/**
+	 * Writes a snapshot to a trace file.
+	 *
+	 * @param path    Name of the trace file, replaced if it exists
+	 * @throws IoErrorException If the file cannot be written
+	 */
+  void save(const std::string& path) const;
+
+	/**
+	 * Reads a trace file written by save().
+	 *
+	 * @param path    Name of the trace file
+	 * @param events  Events are appended to this vector
+	 * @param namesOut File names are added to this map
+	 * @throws IoErrorException If the file cannot be read or is not a trace file
+	 */
+  static void load(const std::string& path, std::vector<BufTraceEvent>& events,
+		std::map<std::uint64_t, std::string>& namesOut);
+
+	/**
+	 * Returns the number of events each ring holds.
+	 */
+  std::size_t capacity() const { return ringSize; }
+};
+
+}
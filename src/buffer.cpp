@@ -5,121 +5,1184 @@
 * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
 */
 
+#include <cstring>
 #include <memory>
 #include <iostream>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <pthread.h>
+#include <sched.h>
 #include "buffer.h"
+#include "bufProbeTbl.h"
+#include "clockPolicy.h"
+#include "lruKPolicy.h"
+#include "twoQPolicy.h"
+#include "arcPolicy.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
-#include "exceptions/hash_not_found_exception.h"
+#include "exceptions/badgerdb_exception.h"
 
 namespace badgerdb {
 
-	BufMgr::BufMgr(std::uint32_t bufs) : numBufs(bufs) {
-		bufDescTable = new BufDesc[bufs];
+	namespace {
 
-		for (FrameId i = 0; i < bufs; i++)
+		// Counts the calling thread's readPage() calls, so that one hit in BufMgr::HIT_SAMPLE
+		// is timed
+		thread_local std::uint32_t hitTicks = 0;
+
+		// Returns the statistics shard of the calling thread; threads take the shards in
+		// turn as they first count
+		std::uint32_t statsSlot()
+		{
+			static std::atomic<std::uint32_t> nextThread(0);
+			static thread_local const std::uint32_t slot = nextThread++ % BufMgr::STATS_SHARDS;
+			return slot;
+		}
+
+		// Builds the hash table and the replacement policy of a partition with frames in use
+		// out of slice set aside
+		void buildPartition(BufTable*& table, BufPolicy*& policy, const std::uint32_t frames,
+			const std::uint32_t slice, const BufMgrOptions& options)
+		{
+			if (options.tableType == CHAINED_TABLE) {
+				int htsize = ((((int)(frames * 1.2)) * 2) / 2) + 1;
+				table = new BufHashTbl(htsize, options.tableShards);  // allocate the buffer hash table
+			}
+			else {
+				table = new BufProbeTbl(frames, options.tableShards);
+			}
+
+			switch (options.policyType) {
+				case LRU_K_POLICY:
+					policy = new LruKPolicy(slice, options.lruK);
+					break;
+				case TWO_Q_POLICY:
+					policy = new TwoQPolicy(slice);
+					break;
+				case ARC_POLICY:
+					policy = new ArcPolicy(slice);
+					break;
+				default:
+					policy = new ClockPolicy(slice);
+					break;
+			}
+			if (frames < slice) {
+				policy->resize(frames);
+			}
+		}
+
+	}
+
+	const std::size_t BufMgr::CHECKPOINT_BATCH;
+	const int BufMgr::CHECKPOINT_PIN_WAIT_MS;
+	const std::uint32_t BufMgr::RESIZE_BATCH;
+	const int BufMgr::RESIZE_PIN_WAIT_MS;
+	const std::uint32_t BufMgr::STATS_SHARDS;
+	const std::uint32_t BufMgr::HIT_SAMPLE;
+
+	void LatencyHistogram::clear()
+	{
+		std::fill(counts, counts + BUCKETS, 0);
+		total = 0;
+	}
+
+	void LatencyHistogram::add(const LatencyHistogram& other)
+	{
+		for (int b = 0; b < BUCKETS; b++) {
+			counts[b] += other.counts[b];
+		}
+		total += other.total;
+	}
+
+	std::uint64_t LatencyHistogram::bucketStart(const int bucket)
+	{
+		if (bucket < (1 << SUB_BITS))
+			return bucket;
+		const int msb = (bucket >> SUB_BITS) + SUB_BITS - 1;
+		return (std::uint64_t(1) << msb) | (std::uint64_t(bucket & ((1 << SUB_BITS) - 1)) << (msb - SUB_BITS));
+	}
+
+	std::uint64_t LatencyHistogram::percentile(const double q) const
+	{
+		if (total == 0)
+			return 0;
+		std::uint64_t rank = (std::uint64_t)(q * total);
+		if (rank >= total)
+			rank = total - 1;
+		std::uint64_t seen = 0;
+		for (int b = 0; b < BUCKETS; b++) {
+			seen += counts[b];
+			if (seen > rank)
+				return bucketStart(b);
+		}
+		return bucketStart(BUCKETS - 1);
+	}
+
+	void BufFileStats::add(const BufFileStats& other)
+	{
+		hits += other.hits;
+		misses += other.misses;
+		prefetched += other.prefetched;
+		evictions += other.evictions;
+		writebacks += other.writebacks;
+		allocs += other.allocs;
+		disposes += other.disposes;
+	}
+
+	void BufStats::add(const BufStats& other)
+	{
+		accesses += other.accesses;
+		hits += other.hits;
+		misses += other.misses;
+		diskreads += other.diskreads;
+		diskwrites += other.diskwrites;
+		prefetched += other.prefetched;
+		victimwrites += other.victimwrites;
+		ringreuses += other.ringreuses;
+		evictions += other.evictions;
+		allocs += other.allocs;
+		disposes += other.disposes;
+		hitLatency.add(other.hitLatency);
+		missLatency.add(other.missLatency);
+		writeLatency.add(other.writeLatency);
+	}
+
+	void BufStats::clear()
+	{
+		accesses = hits = misses = diskreads = diskwrites = prefetched = victimwrites = ringreuses = 0;
+		evictions = allocs = disposes = 0;
+		hitLatency.clear();
+		missLatency.clear();
+		writeLatency.clear();
+		files.clear();
+	}
+
+	BufFileStats& BufStatShard::of(const File* file)
+	{
+		std::unordered_map<const File*, BufFileStats>::iterator it = files.find(file);
+		if (it == files.end()) {
+			it = files.insert(std::make_pair(file, BufFileStats())).first;
+			it->second.filename = file->filename();
+		}
+		return it->second;
+	}
+
+	BufMgr::BufMgr(std::uint32_t bufs, const BufMgrOptions& options) : numBufs(bufs) {
+		// Every partition needs a frame, and an equal slice of the frames set aside
+		const std::vector<int>& nodes = numaNodes();
+		numPartitions = options.partitions > 0 ? options.partitions : nodes.size();
+		numPartitions = std::max<std::uint32_t>(std::min(numPartitions, bufs), 1);
+		maxBufs = std::max(bufs, options.maxBufs);
+		sliceFrames = (maxBufs + numPartitions - 1) / numPartitions;
+		reservedBufs = sliceFrames * numPartitions;
+
+		bufDescTable = new BufDesc[reservedBufs];
+		statShards = new BufStatShard[STATS_SHARDS];
+		tracer = options.traceEvents > 0 ? new BufTrace(options.traceEvents) : NULL;
+
+		for (FrameId i = 0; i < reservedBufs; i++)
 		{
 			bufDescTable[i].frameNo = i;
 			bufDescTable[i].valid = false;
 		}
 
-		bufPool = new Page[bufs];
+		arena = new BufArena(reservedBufs, options.hugePages);
+		bufPool = arena->pages();
+
+		nextNewPartition = 0;
+		partitions = new BufPartition[numPartitions];
+		for (std::uint32_t p = 0; p < numPartitions; p++) {
+			BufPartition& part = partitions[p];
+			part.mgr = this;
+			part.first = p * sliceFrames;
+			part.frames = (std::uint64_t)(p + 1) * bufs / numPartitions - (std::uint64_t)p * bufs / numPartitions;
+			part.keep = part.frames;
+			part.node = nodes[p % nodes.size()];
+
+			// Moves the descriptors touched by their constructors; the frames are placed as
+			// they are committed
+			if (numPartitions > 1) {
+				part.bound = numaBindMemory(&bufPool[part.first], (std::size_t)sliceFrames * Page::SIZE, part.node) &&
+					numaBindMemory(&bufDescTable[part.first], sliceFrames * sizeof(BufDesc), part.node);
+			}
+		}
 
-		int htsize = ((((int)(bufs * 1.2)) * 2) / 2) + 1;
-		hashTable = new BufHashTbl(htsize);  // allocate the buffer hash table
+		// Frames, tables and policies are built by a thread on the partition's node, so
+		// that they are first touched, and placed, there
+		std::vector<std::thread> builders;
+		for (std::uint32_t p = 0; p < numPartitions; p++) {
+			BufPartition& part = partitions[p];
+			if (nodes.size() > 1) {
+				builders.push_back(std::thread([this, &part, &options]() {
+					numaRunOnNode(part.node);
+					arena->commit(part.first, part.frames);
+					buildPartition(part.table, part.policy, part.frames, sliceFrames, options);
+				}));
+			}
+			else {
+				arena->commit(part.first, part.frames);
+				buildPartition(part.table, part.policy, part.frames, sliceFrames, options);
+			}
+		}
+		for (std::size_t i = 0; i < builders.size(); i++) {
+			builders[i].join();
+		}
 
-		clockHand = bufs - 1;
+		evacuating = false;
+		cleanTargetFixed = options.writerCleanTarget > 0;
+		cleanTarget = cleanTargetFixed ? options.writerCleanTarget : std::max<std::uint32_t>(bufs / 8, 1);
+		writerRate = options.writerPagesPerSec;
+		io = options.streamIo ? NULL : IoEngine::create(options.ioEngine, options.ioDepth);
+		log = options.log;
+		checkpointBytes = options.checkpointLogBytes;
+		checkpointRate = options.checkpointPagesPerSec;
+		maxWriteRun = std::min<std::uint32_t>(std::max<std::uint32_t>(options.maxWriteRun, 1), File::MAX_WRITE_RUN);
+
+		frameIo = new IoRequest[reservedBufs];
+		loaderStop = false;
+
+		writerStop = false;
+		if (options.backgroundWriter) {
+			writer = std::thread(&BufMgr::writerLoop, this);
+		}
+		if (log != NULL && checkpointBytes > 0) {
+			checkpointer = std::thread(&BufMgr::checkpointerLoop, this);
+		}
 	}
 
 	// Flushes dirty pages and deallocates the buffer pool, BufDesc table, and hashtable
 	BufMgr::~BufMgr()
 	{
+		// Let the loader complete the prefetches in flight
+		if (loader.joinable()) {
+			{
+				std::lock_guard<std::mutex> guard(loadLatch);
+				loaderStop = true;
+			}
+			loaderWake.notify_one();
+			loader.join();
+		}
+
+		// Stop the writer and the checkpointer first, so nothing else touches the frames
+		{
+			std::lock_guard<std::mutex> guard(writerLatch);
+			writerStop = true;
+		}
+		writerWake.notify_one();
+		checkpointerWake.notify_one();
+		if (writer.joinable()) {
+			writer.join();
+		}
+		if (checkpointer.joinable()) {
+			checkpointer.join();
+		}
+
 		// Flush any dirty pages
-		for (uint32_t i = 0; i < numBufs; i++) {
+		std::vector<FrameId> dirtyFrames;
+		for (uint32_t i = 0; i < reservedBufs; i++) {
 
-			BufDesc currDesc = bufDescTable[i];
+			BufDesc& currDesc = bufDescTable[i];
 			if (currDesc.dirty && currDesc.valid) {
-				currDesc.file->writePage(bufPool[currDesc.frameNo]);
+				dirtyFrames.push_back(currDesc.frameNo);
 			}
 		}
+		writeFrames(dirtyFrames);
 
 		// Deallocate memory structures
 		delete[] bufDescTable;
-		delete[] bufPool;
-		delete hashTable;
+		delete arena;
+		for (std::uint32_t p = 0; p < numPartitions; p++) {
+			delete partitions[p].table;
+			delete partitions[p].policy;
+		}
+		delete[] partitions;
+		delete io;
+		delete[] frameIo;
+		delete[] statShards;
+		delete tracer;
+	}
+
+	// Takes a frame picked by the policy: free frames are taken as they are, unpinned
+	// frames are unmapped, pinned frames are refused.
+	// Unmap the frame before dropping the latch, so that concurrent hits on the old page
+	// miss and queue up behind allocLatch instead of seeing a frame that is being recycled
+	bool BufMgr::reclaim(const FrameId frame, const bool ring)
+	{
+		// Only the shrink emptying them takes the frames it gives back
+		if (!evacuating && !inUse(frame)) {
+			return false;
+		}
+
+		BufDesc& currDesc = bufDescTable[frame];
+		std::lock_guard<std::mutex> guard(currDesc.latch);
+
+		if (!currDesc.valid) {
+			return true;
+		}
+		if (currDesc.pinCnt > 0 || currDesc.writing || currDesc.loading) {
+			return false;
+		}
+
+		countLeaving(currDesc, true);
+		if (tracer != NULL) {
+			tracer->record(TRACE_EVICT, currDesc.file, currDesc.pageNo, frame,
+				(currDesc.dirty ? TRACE_DIRTY : 0) | (ring ? TRACE_RING : 0) | (evacuating ? TRACE_RESIZE : 0));
+		}
+		currDesc.valid = false;
+		homeOf(currDesc.file, currDesc.pageNo).table->remove(currDesc.file, currDesc.pageNo);
+		return true;
+	}
+
+	bool BufPartition::reclaim(const FrameId frame)
+	{
+		return mgr->reclaim(first + frame);
 	}
 
-	// Advances clock to next frame in buffer pool.
-	void BufMgr::advanceClock()
+	bool BufMgr::victimFrom(BufPartition& part, const File* file, const PageId pageNo, FrameId& frame)
 	{
-		clockHand = (clockHand + 1) % numBufs;
+		FrameId local;
+		if (!part.policy->victim(part, file, pageNo, local)) {
+			return false;
+		}
+		frame = part.first + local;
+		return true;
 	}
 
-	// Allocates free frame using clock algorithm
+	// Allocates a frame picked by the replacement policy of the page's home partition,
+	// or of another partition if every frame of the home is pinned.  A new page has no
+	// number yet, so it starts at a partition on the caller's node instead
 	// If necessary, writes dirty page back to disk
 	// Throws buffer_exceeded_exception if all buffer frames are pinned
-	// If buffer frame allocated has valid page in it, remove entry from hash table
-	void BufMgr::allocBuf(FrameId &frame)
+	// Caller must hold allocLatch
+	void BufMgr::allocBuf(FrameId &frame, const File* file, const PageId pageNo)
+	{
+		std::uint32_t start = 0;
+		if (numPartitions > 1) {
+			if (pageNo != Page::INVALID_NUMBER) {
+				start = homePartition(file, pageNo);
+			}
+			else {
+				const int node = numaCurrentNode();
+				const std::uint32_t turn = nextNewPartition++;
+				start = turn % numPartitions;
+				for (std::uint32_t i = 0; i < numPartitions; i++) {
+					if (partitions[(turn + i) % numPartitions].node == node) {
+						start = (turn + i) % numPartitions;
+						break;
+					}
+				}
+			}
+		}
+
+		for (std::uint32_t i = 0; i < numPartitions; i++) {
+			if (victimFrom(partitions[(start + i) % numPartitions], file, pageNo, frame)) {
+				cleanVictim(frame);
+				return;
+			}
+		}
+
+		// If buffer is full, throw exception
+		throw BufferExceededException();
+	}
+
+	void BufMgr::cleanVictim(const FrameId frame)
+	{
+		// The frame is unmapped, so nobody else touches it until it is Set() again
+		BufDesc& currDesc = bufDescTable[frame];
+
+		// If frame is dirty, write page to disk before using
+		if (currDesc.file && currDesc.dirty) {
+
+			writeFrames(std::vector<FrameId>(1, frame));
+			{
+				BufStatShard& shard = statShard();
+				std::lock_guard<std::mutex> statsGuard(shard.latch);
+				shard.stats.diskwrites++;
+				shard.stats.victimwrites++;
+			}
+
+			// The writer is falling behind
+			if (writer.joinable()) {
+				writerWake.notify_one();
+			}
+		}
+
+		// Initialize frame for new data
+		std::lock_guard<std::mutex> guard(currDesc.latch);
+		currDesc.Clear();
+	}
+
+	// The frame is off the policy's lists if victim() chose it, so it goes through
+	// loaded() first; freed() then puts it on the free list
+	void BufMgr::abandonFrame(const FrameId frame, const bool recycled, const File* file, const PageId pageNo)
+	{
+		BufPartition& owner = ownerOf(frame);
+		if (!recycled) {
+			owner.policy->loaded(frame - owner.first, file, pageNo);
+		}
+		owner.policy->freed(frame - owner.first);
+	}
+
+	bool BufMgr::allocFromRing(BufAccessStrategy& strategy, FrameId& frame, const File* file, const PageId pageNo)
 	{
-		uint32_t origLoc = clockHand;
-		BufDesc currDesc;
-		bool found;
-		uint32_t counter = 0;
+		BufAccessStrategy::Slot& slot = strategy.ring[strategy.current];
+		strategy.current = (strategy.current + 1) % strategy.ring.size();
+
+		bool reused = false;
+		if (slot.file != NULL) {
+			// The frame may have been evicted and given to another page since the ring
+			// loaded it, or given back by a shrink.  Only holders of allocLatch change what a
+			// frame holds, so what we see here still holds when reclaim() runs
+			BufDesc& desc = bufDescTable[slot.frame];
+			bool ours;
+			{
+				std::lock_guard<std::mutex> descGuard(desc.latch);
+				ours = desc.valid && desc.file == slot.file && desc.pageNo == slot.pageNo;
+			}
+			ours = ours && inUse(slot.frame);
+			if (ours && reclaim(slot.frame, true)) {
+				frame = slot.frame;
+				cleanVictim(frame);
+				BufStatShard& shard = statShard();
+				std::lock_guard<std::mutex> statsGuard(shard.latch);
+				shard.stats.ringreuses++;
+				reused = true;
+			}
+		}
+
+		if (!reused) {
+			allocBuf(frame, file, pageNo);
+		}
+
+		slot.frame = frame;
+		slot.file = file;
+		slot.pageNo = pageNo;
+		return reused;
+	}
 
-		// Iterate through entries until we find a free frame, or
-		// discover that they're all pinned
-		while (!found && (counter < numBufs)) {
+	// The page moved is unmapped first, as reclaim() does, so hits on it wait at
+	// allocLatch until it is mapped in its new frame.  Its recovery LSN and dirty bit go
+	// with it
+	bool BufMgr::evacuateStep(BufPartition& part, std::vector<FrameId>& pending, std::vector<FrameId>& busy,
+		FrameId& pinned)
+	{
+		while (!pending.empty()) {
+			BufDesc& desc = bufDescTable[pending.back()];
+			std::lock_guard<std::mutex> guard(desc.latch);
+			if (desc.file != NULL)
+				break;
+			pending.pop_back();
+		}
+		if (pending.empty()) {
+			return false;
+		}
+
+		FrameId frame;
+		evacuating = true;
+		const bool found = victimFrom(part, NULL, Page::INVALID_NUMBER, frame);
+		evacuating = false;
+		if (!found) {
+			// Every frame of the partition is pinned; name one given back if possible
+			for (std::size_t i = pending.size(); i-- > 0;) {
+				BufDesc& desc = bufDescTable[pending[i]];
+				std::lock_guard<std::mutex> guard(desc.latch);
+				if (desc.file != NULL && desc.pinCnt > 0) {
+					pinned = pending[i];
+					break;
+				}
+			}
+			return false;
+		}
+		cleanVictim(frame);
+		if (!inUse(frame)) {
+			return true;
+		}
 
-			advanceClock();
+		while (!pending.empty()) {
+			const FrameId from = pending.back();
+			pending.pop_back();
+			BufDesc& desc = bufDescTable[from];
+			File* file;
+			PageId pageNo;
+			bool dirty;
+			Lsn recLsn;
+			std::uint64_t hits;
+			{
+				std::lock_guard<std::mutex> guard(desc.latch);
+				if (desc.file == NULL) {
+					continue;
+				}
+				if (!desc.valid || desc.pinCnt > 0 || desc.writing || desc.loading) {
+					if (desc.pinCnt > 0) {
+						pinned = from;
+					}
+					busy.push_back(from);
+					continue;
+				}
+				desc.valid = false;
+				homeOf(desc.file, desc.pageNo).table->remove(desc.file, desc.pageNo);
+				file = desc.file;
+				pageNo = desc.pageNo;
+				dirty = desc.dirty;
+				recLsn = desc.recLsn;
+				hits = desc.hits;
+			}
 
-			// If we cycle back to start loc, clear count
-			if (clockHand == origLoc) {
-				counter = 0;
+			std::memcpy(static_cast<void*>(&bufPool[frame]), &bufPool[from], Page::SIZE);
+			{
+				std::lock_guard<std::mutex> guard(bufDescTable[frame].latch);
+				bufDescTable[frame].Set(file, pageNo, recLsn);
+				bufDescTable[frame].pinCnt = 0;
+				bufDescTable[frame].dirty = dirty;
+				bufDescTable[frame].hits = hits;
 			}
+			BufPartition& owner = ownerOf(frame);
+			owner.policy->loaded(frame - owner.first, file, pageNo);
+			homeOf(file, pageNo).table->insert(file, pageNo, frame);
 
-			// Get description of current frame
-			currDesc = bufDescTable[clockHand];
+			std::lock_guard<std::mutex> guard(desc.latch);
+			desc.Clear();
+			return true;
+		}
+
+		// Every page left to move is pinned or busy
+		abandonFrame(frame, false, NULL, Page::INVALID_NUMBER);
+		return false;
+	}
 
-			// If valid is not set, use current frame
-			if (!currDesc.valid) {
+	// Growing partitions get their frames before shrinking ones give theirs back.  A
+	// shrink empties its frames a batch of steps at a time, letting misses in between, and
+	// comes back to the pinned and busy ones until they are done or the pins outlast the
+	// wait.  Only then do the policies forget the frames, and the tables and the arena
+	// shrink.
+	void BufMgr::resize(std::uint32_t bufs)
+	{
+		std::lock_guard<std::mutex> resizeGuard(resizeLatch);
+		if (bufs > maxBufs) {
+			throw BufferExceededException();
+		}
+		bufs = std::max(bufs, numPartitions);
 
-				frame = currDesc.frameNo;
-				found = true;
+		std::vector<std::uint32_t> before(numPartitions);
+		std::vector<std::uint32_t> after(numPartitions);
+		for (std::uint32_t p = 0; p < numPartitions; p++) {
+			before[p] = partitions[p].frames;
+			after[p] = (std::uint64_t)(p + 1) * bufs / numPartitions - (std::uint64_t)p * bufs / numPartitions;
+		}
+
+		// The frames added are unused, so they are built without allocLatch
+		for (std::uint32_t p = 0; p < numPartitions; p++) {
+			BufPartition& part = partitions[p];
+			if (after[p] > before[p]) {
+				arena->commit(part.first + before[p], after[p] - before[p]);
+				part.table->resize(after[p]);
 			}
-			// If valid and refbit set, clear refbit and advance clock
-			else if (currDesc.refbit) {
+		}
 
-				bufDescTable[clockHand].refbit = false;
+		std::vector<std::vector<FrameId> > pending(numPartitions);
+		std::vector<std::vector<FrameId> > busy(numPartitions);
+		{
+			std::lock_guard<std::mutex> allocGuard(allocLatch);
+			for (std::uint32_t p = 0; p < numPartitions; p++) {
+				BufPartition& part = partitions[p];
+				if (after[p] > before[p]) {
+					part.policy->resize(after[p]);
+					part.frames = part.keep = after[p];
+				}
+				else if (after[p] < before[p]) {
+					part.keep = after[p];
+					for (FrameId f = part.first + before[p]; f > part.first + after[p]; f--) {
+						pending[p].push_back(f - 1);
+					}
+				}
 			}
-			// If frame is currently pinned increment count 
-			else if (currDesc.pinCnt > 0) {
-				counter++;
+		}
+
+		const std::chrono::steady_clock::time_point deadline =
+			std::chrono::steady_clock::now() + std::chrono::milliseconds(RESIZE_PIN_WAIT_MS);
+		bool stuck = false;
+		FrameId pinned = BufTraceEvent::NO_FRAME;
+		for (;;) {
+			bool done = true;
+			pinned = BufTraceEvent::NO_FRAME;
+			for (std::uint32_t p = 0; p < numPartitions; p++) {
+				while (!pending[p].empty()) {
+					std::lock_guard<std::mutex> allocGuard(allocLatch);
+					std::uint32_t steps = 0;
+					while (steps < RESIZE_BATCH && evacuateStep(partitions[p], pending[p], busy[p], pinned)) {
+						steps++;
+					}
+					if (steps < RESIZE_BATCH) {
+						break;
+					}
+				}
+				done = done && pending[p].empty() && busy[p].empty();
 			}
-			// If frame is valid and not pinned, use it.
-			else {
+			if (done) {
+				break;
+			}
+			if (std::chrono::steady_clock::now() >= deadline) {
+				stuck = true;
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			for (std::uint32_t p = 0; p < numPartitions; p++) {
+				pending[p].insert(pending[p].end(), busy[p].begin(), busy[p].end());
+				busy[p].clear();
+			}
+		}
 
-				// If frame is dirty, write page to disk before using
-				if (currDesc.dirty) {
+		std::lock_guard<std::mutex> allocGuard(allocLatch);
+		if (stuck) {
+			// Give all the frames back to the policy afresh, as free frames; those still
+			// holding a page are reclaimed as such when picked.  Report the last frame
+			// found pinned, or failing that one still busy
+			for (std::uint32_t p = 0; p < numPartitions; p++) {
+				BufPartition& part = partitions[p];
+				if (after[p] < before[p]) {
+					part.policy->resize(after[p]);
+					part.policy->resize(before[p]);
+					part.keep = before[p];
+				}
+				if (pinned == BufTraceEvent::NO_FRAME && (!busy[p].empty() || !pending[p].empty())) {
+					pinned = busy[p].empty() ? pending[p].back() : busy[p].back();
+				}
+			}
+			std::uint32_t total = 0;
+			for (std::uint32_t p = 0; p < numPartitions; p++) {
+				total += partitions[p].frames;
+			}
+			numBufs = total;
+			BufDesc& desc = bufDescTable[pinned];
+			std::lock_guard<std::mutex> guard(desc.latch);
+			throw PagePinnedException(desc.file != NULL ? desc.file->filename() : "", desc.pageNo, desc.frameNo);
+		}
+
+		for (std::uint32_t p = 0; p < numPartitions; p++) {
+			BufPartition& part = partitions[p];
+			if (after[p] < before[p]) {
+				part.policy->resize(after[p]);
+				part.frames = after[p];
+				part.table->resize(after[p]);
+				arena->release(part.first + after[p], before[p] - after[p]);
+			}
+		}
+		numBufs = bufs;
+		if (!cleanTargetFixed) {
+			cleanTarget = std::max<std::uint32_t>(bufs / 8, 1);
+		}
+	}
 
-					bufDescTable[clockHand].file->writePage(bufPool[currDesc.frameNo]);
+	// Runs until the buffer manager is destroyed: every pass asks the policy for the
+	// frames it will evict next and writes back the dirty ones, then sleeps until the
+	// next pass is due or a miss had to write a dirty victim itself
+	void BufMgr::writerLoop()
+	{
+		const std::chrono::milliseconds interval(10);
+		std::vector<FrameId> candidates;
+		std::vector<FrameId> batch;
+
+		// Only use cycles no foreground thread wants: a writer that preempts a miss adds
+		// a whole pass to that miss's latency
+		sched_param param;
+		param.sched_priority = 0;
+		pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+		std::unique_lock<std::mutex> guard(writerLatch);
+
+		while (!writerStop) {
+			guard.unlock();
+
+			// Every partition keeps its share of the upcoming victims clean
+			candidates.clear();
+			const std::uint32_t target = cleanTarget;
+			for (std::uint32_t p = 0; p < numPartitions; p++) {
+				const std::size_t from = candidates.size();
+				partitions[p].policy->upcoming((target + numPartitions - 1) / numPartitions, candidates);
+				for (std::size_t i = from; i < candidates.size(); i++) {
+					candidates[i] += partitions[p].first;
+				}
+			}
+			batch.clear();
+			for (std::size_t i = 0; i < candidates.size(); i++) {
+				if (beginWriteBack(candidates[i])) {
+					batch.push_back(candidates[i]);
 				}
+			}
 
-				// Remove frame from hash table
-				hashTable->remove(currDesc.file, currDesc.pageNo);
+			// All the pages of a pass are in flight at once
+			bool failed = false;
+			try {
+				writeFrames(batch);
+				writerStats.pagesWritten += batch.size();
+			}
+			catch (BadgerDbException& e) {
+				// Leave the pages dirty, so the error surfaces where the foreground writes them
+				failed = true;
+			}
+			endWriteBack(batch, failed);
+			writerStats.passes++;
 
-				// Initialize frame for new data
-				bufDescTable[clockHand].Clear();
+			// Spread the writes out to stay under the rate limit
+			if (writerRate > 0 && !batch.empty()) {
+				std::this_thread::sleep_for(std::chrono::microseconds(batch.size() * 1000000 / writerRate));
+			}
 
-				frame = currDesc.frameNo;
-				found = true;
+			guard.lock();
+			if (!writerStop) {
+				writerWake.wait_for(guard, interval);
 			}
 		}
+	}
 
-		// If buffer is full, throw exception
-		if (!found) {
-			throw BufferExceededException();
+	// Runs until the buffer manager is destroyed: checkpoints whenever checkpointBytes
+	// have been logged since the last checkpoint started.  Unlike the writer it keeps
+	// normal priority, or a busy system would never bound its recovery time; the write
+	// rate limit is what keeps it from crowding out foreground I/O
+	void BufMgr::checkpointerLoop()
+	{
+		const std::chrono::milliseconds interval(10);
+		Lsn lastStart = log->startLsn();
+		std::unique_lock<std::mutex> guard(writerLatch);
+
+		while (!writerStop) {
+			guard.unlock();
+
+			const Lsn end = log->endLsn();
+			if (end - lastStart >= checkpointBytes) {
+				try {
+					checkpoint();
+					lastStart = end;
+				}
+				catch (BadgerDbException& e) {
+					// Try again next time; the pages stay dirty, so the error surfaces where
+					// the foreground writes them
+				}
+			}
+
+			guard.lock();
+			if (!writerStop) {
+				checkpointerWake.wait_for(guard, interval);
+			}
+		}
+	}
+
+	// Only the pages that may hold changes logged before the end of the log as the
+	// checkpoint starts are written: those whose recovery LSN is older, if dirty, being
+	// written or pinned (a pinned page may be changed and unpinned dirty at any time).
+	// Each is written as soon as it is unpinned and not being written by someone else;
+	// nobody waits for the checkpoint.  Once the pages are written, every file written
+	// since the last checkpoint is synced, evictions and the writer's included, and the
+	// log may forget the records before the oldest recovery LSN left.
+	Lsn BufMgr::checkpoint()
+	{
+		std::lock_guard<std::mutex> checkpointGuard(checkpointLatch);
+		const Lsn target = log != NULL ? log->endLsn() : std::numeric_limits<Lsn>::max();
+
+		struct Pending {
+			FrameId frame;
+			File* file;
+			PageId pageNo;
+		};
+		std::vector<Pending> pending;
+		for (std::uint32_t i = 0; i < reservedBufs; i++) {
+			BufDesc& desc = bufDescTable[i];
+			std::lock_guard<std::mutex> guard(desc.latch);
+			if (desc.file != NULL && desc.recLsn < target &&
+					(desc.dirty || desc.writing || (log != NULL && desc.pinCnt > 0))) {
+				Pending entry = {desc.frameNo, desc.file, desc.pageNo};
+				pending.push_back(entry);
+			}
+		}
+
+		const std::chrono::steady_clock::time_point deadline =
+			std::chrono::steady_clock::now() + std::chrono::milliseconds(CHECKPOINT_PIN_WAIT_MS);
+		std::set<const File*> written;
+		std::vector<Pending> busy;
+		std::vector<FrameId> batch;
+		std::size_t next = 0;
+		for (;;) {
+			batch.clear();
+			while (next < pending.size() && batch.size() < CHECKPOINT_BATCH) {
+				const Pending& entry = pending[next++];
+				BufDesc& desc = bufDescTable[entry.frame];
+				std::lock_guard<std::mutex> guard(desc.latch);
+
+				// Written since, by an eviction, the writer or a flush, or evicted and read in
+				// again
+				if (desc.file != entry.file || desc.pageNo != entry.pageNo || desc.recLsn >= target ||
+						!(desc.dirty || desc.writing || (log != NULL && desc.pinCnt > 0))) {
+					continue;
+				}
+				if (!desc.valid || desc.writing || desc.loading || desc.pinCnt > 0) {
+					busy.push_back(entry);
+					checkpointStats.busyRetries++;
+					continue;
+				}
+				desc.writing = true;
+				desc.dirty = false;
+				desc.recLsn = pinLsn();
+				batch.push_back(entry.frame);
+				written.insert(entry.file);
+			}
+
+			if (!batch.empty()) {
+				try {
+					writeFrames(batch);
+				}
+				catch (...) {
+					endWriteBack(batch, true);
+					throw;
+				}
+				endWriteBack(batch, false);
+				checkpointStats.pagesWritten += batch.size();
+
+				if (checkpointRate > 0) {
+					std::this_thread::sleep_for(std::chrono::microseconds(batch.size() * 1000000 / checkpointRate));
+				}
+				continue;
+			}
+
+			// Come back to the busy pages until they are done or the pins outlast the wait
+			if (busy.empty() || std::chrono::steady_clock::now() >= deadline) {
+				break;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			pending.swap(busy);
+			busy.clear();
+			next = 0;
+		}
+
+		// The pages left hold the redo start back; anything written after this point
+		// was counted here while dirty or being written
+		const Lsn redo = log != NULL ? std::min(target, redoLsn()) : 0;
+		if (log != NULL) {
+			std::lock_guard<std::mutex> guard(unsyncedLatch);
+			written.insert(unsyncedFiles.begin(), unsyncedFiles.end());
+			unsyncedFiles.clear();
+		}
+		for (std::set<const File*>::const_iterator it = written.begin(); it != written.end(); ++it) {
+			(*it)->sync();
+		}
+		if (log != NULL) {
+			log->checkpoint(redo);
+		}
+
+		checkpointStats.redoLsn = redo;
+		checkpointStats.checkpoints++;
+		return redo;
+	}
+
+	void BufMgr::dirtyPages(std::vector<BufDirtyPage>& pages)
+	{
+		pages.clear();
+		for (std::uint32_t i = 0; i < reservedBufs; i++) {
+			BufDesc& desc = bufDescTable[i];
+			std::lock_guard<std::mutex> guard(desc.latch);
+			if (desc.file != NULL && (desc.dirty || desc.writing)) {
+				BufDirtyPage page = {desc.file, desc.pageNo, desc.recLsn};
+				pages.push_back(page);
+			}
+		}
+	}
+
+	// A victim is unmapped (not valid) before it is written, so frames count by their
+	// file rather than their valid bit
+	Lsn BufMgr::redoLsn()
+	{
+		if (log == NULL) {
+			return 0;
+		}
+		Lsn redo = log->endLsn();
+		for (std::uint32_t i = 0; i < reservedBufs; i++) {
+			BufDesc& desc = bufDescTable[i];
+			std::lock_guard<std::mutex> guard(desc.latch);
+			if (desc.file != NULL && (desc.dirty || desc.writing || desc.pinCnt > 0)) {
+				redo = std::min(redo, desc.recLsn);
+			}
+		}
+		return redo;
+	}
+
+	// The dirty bit is cleared before the write.  Only an unpinned page is written and
+	// hits wait for the write to finish (see pinIfPresent()), so nothing sets it again
+	// until the page is on its way.
+	bool BufMgr::beginWriteBack(const FrameId frame)
+	{
+		BufDesc& desc = bufDescTable[frame];
+		std::lock_guard<std::mutex> guard(desc.latch);
+		if (!desc.valid || desc.writing || desc.loading || desc.pinCnt > 0) {
+			return false;
+		}
+		if (!desc.dirty) {
+			writerStats.alreadyClean++;
+			return false;
+		}
+		desc.writing = true;
+		desc.dirty = false;
+		desc.recLsn = pinLsn();
+		return true;
+	}
+
+	void BufMgr::endWriteBack(const std::vector<FrameId>& frames, const bool failed)
+	{
+		for (std::size_t i = 0; i < frames.size(); i++) {
+			BufDesc& desc = bufDescTable[frames[i]];
+			std::lock_guard<std::mutex> guard(desc.latch);
+			desc.writing = false;
+			if (failed) {
+				// The changes are older than the write began; how much older is not kept
+				desc.dirty = true;
+				desc.recLsn = 0;
+			}
+		}
+	}
+
+	// Writes hold ioLatch from checking that the pages are allocated (prepareWrite) until
+	// the data is on its way, so deletePage cannot free a page in between.
+	// Each file written is synced once, after ioLatch is released.
+	void BufMgr::writeFrames(const std::vector<FrameId>& frames)
+	{
+		if (frames.empty()) {
+			return;
+		}
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		// Where each page goes and its LSN are read under the frame latch.  Nobody can pin
+		// the frames until they are written, so these are the pages written, and File sets
+		// their checksums in the frames without them changing under it.
+		struct Write {
+			FrameId frame;
+			File* file;
+			PageId pageNo;
+		};
+		std::vector<Write> sorted(frames.size());
+		Lsn newest = 0;
+		for (std::size_t i = 0; i < frames.size(); i++) {
+			BufDesc& desc = bufDescTable[frames[i]];
+			std::lock_guard<std::mutex> guard(desc.latch);
+			const Write write = {frames[i], desc.file, desc.pageNo};
+			sorted[i] = write;
+			newest = std::max(newest, bufPool[frames[i]].lsn());
+		}
+
+		// Sort by file and page number, so that the file sees ascending offsets and
+		// adjacent pages can share a write
+		std::sort(sorted.begin(), sorted.end(), [](const Write& left, const Write& right) {
+			return std::less<File*>()(left.file, right.file) ||
+				(left.file == right.file && left.pageNo < right.pageNo);
+		});
+		std::vector<Page*> pages(sorted.size());
+		for (std::size_t i = 0; i < sorted.size(); i++) {
+			pages[i] = &bufPool[sorted[i].frame];
+		}
+
+		// runs[r] is the index in sorted of the first page of run r
+		std::vector<std::size_t> runs;
+		for (std::size_t i = 0; i < sorted.size(); i++) {
+			if (runs.empty() || i - runs.back() == maxWriteRun ||
+					sorted[i - 1].file != sorted[i].file ||
+					sorted[i - 1].pageNo + 1 != sorted[i].pageNo) {
+				runs.push_back(i);
+			}
+		}
+		runs.push_back(sorted.size());
+
+		// Write-ahead rule: the log must hold every change a page carries before the page
+		// reaches its file
+		if (log != NULL) {
+			log->flush(newest);
+
+			// Registered before the write, so a checkpoint that misses the file here
+			// counted the pages as dirty
+			std::lock_guard<std::mutex> guard(unsyncedLatch);
+			for (std::size_t r = 0; r + 1 < runs.size(); r++) {
+				unsyncedFiles.insert(sorted[runs[r]].file);
+			}
+		}
+
+		File::SyncBatch batch;
+		{
+			std::lock_guard<std::mutex> ioGuard(ioLatch);
+			if (io == NULL) {
+				for (std::size_t r = 0; r + 1 < runs.size(); r++) {
+					sorted[runs[r]].file->writePages(&pages[runs[r]], runs[r + 1] - runs[r]);
+				}
+			}
+			else {
+				const std::size_t count = runs.size() - 1;
+				std::vector<IoRequest> requests(count);
+				std::vector<IoRequest*> pending(count);
+				std::vector<struct iovec> iovs(sorted.size());
+				for (std::size_t r = 0; r < count; r++) {
+					sorted[runs[r]].file->prepareWrite(&pages[runs[r]], runs[r + 1] - runs[r],
+						&iovs[runs[r]], requests[r]);
+					pending[r] = &requests[r];
+				}
+				io->submit(&pending[0], pending.size());
+				for (std::size_t r = 0; r < count; r++) {
+					io->wait(requests[r]);
+				}
+				for (std::size_t r = 0; r < count; r++) {
+					sorted[runs[r]].file->finishWrite(*pages[runs[r]], requests[r]);
+				}
+			}
+		}
+		batch.commit();
+
+		BufStatShard& shard = statShard();
+		std::lock_guard<std::mutex> statsGuard(shard.latch);
+		shard.stats.writeLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count());
+		for (std::size_t r = 0; r + 1 < runs.size(); r++) {
+			shard.of(sorted[runs[r]].file).writebacks += runs[r + 1] - runs[r];
+		}
+	}
+
+	void BufMgr::fetchPage(File* file, const PageId pageNo, Page& page)
+	{
+		// A mapped file is read faster by copying out of its mapping than through the engine
+		if (io == NULL || file->mapped()) {
+			file->readPage(pageNo, page);
+			return;
+		}
+
+		IoRequest request;
+		file->prepareRead(pageNo, page, request);
+		io->run(request);
+		file->finishRead(pageNo, page, request);
+	}
+
+	// Write-backs take microseconds, so yielding is cheaper than a condition variable
+	void BufMgr::waitForIo(BufDesc& desc, std::unique_lock<std::mutex>& guard)
+	{
+		while (desc.writing || desc.loading) {
+			guard.unlock();
+			if (desc.loading) {
+				waitForLoad(desc);
+			}
+			else {
+				std::this_thread::yield();
+			}
+			guard.lock();
+		}
+	}
+
+	void BufMgr::waitForLoad(BufDesc& desc)
+	{
+		std::unique_lock<std::mutex> guard(loadLatch);
+		while (desc.loading) {
+			loadDone.wait(guard);
+		}
+	}
+
+	// Runs from the first prefetch until the buffer manager is destroyed, completing
+	// prefetch reads in the order they were started
+	void BufMgr::loaderLoop()
+	{
+		std::unique_lock<std::mutex> guard(loadLatch);
+		for (;;) {
+			while (!loaderStop && loadQueue.empty()) {
+				loaderWake.wait(guard);
+			}
+			if (loadQueue.empty()) {
+				return;
+			}
+			const FrameId frame = loadQueue.front();
+			loadQueue.pop_front();
+			guard.unlock();
+
+			finishLoad(frame);
+
+			guard.lock();
+		}
+	}
+
+	// The page stays mapped while it loads, so a failed read unmaps it here.  The policy
+	// still counts the frame as holding a page; reclaim() takes it as the free frame it
+	// is when the policy picks it.  That keeps allocLatch, which threads waiting for the
+	// load may hold, out of the loader.
+	void BufMgr::finishLoad(const FrameId frame)
+	{
+		BufDesc& desc = bufDescTable[frame];
+		bool failed = false;
+
+		if (io == NULL) {
+			try {
+				desc.file->readPage(desc.pageNo, bufPool[frame]);
+			}
+			catch (BadgerDbException& e) {
+				failed = true;
+			}
+		}
+		else {
+			io->wait(frameIo[frame]);
+			try {
+				desc.file->finishRead(desc.pageNo, bufPool[frame], frameIo[frame]);
+			}
+			catch (BadgerDbException& e) {
+				failed = true;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(desc.latch);
+			if (failed) {
+				homeOf(desc.file, desc.pageNo).table->erase(desc.file, desc.pageNo);
+				desc.Clear();
+			}
+			desc.loading = false;
+		}
+
+		std::lock_guard<std::mutex> guard(loadLatch);
+		loadDone.notify_all();
+	}
+
+	// Looks up the page in the hashtable and, if it is there, pins the frame holding it.
+	// The hashtable shard latch is released before the frame latch is taken, so the frame
+	// may have been recycled in between; the descriptor is checked again under its latch.
+	bool BufMgr::pinIfPresent(File* file, const PageId pageNo, FrameId& frameNo)
+	{
+		for (;;) {
+			// A miss is reported through the return value; no exception is built
+			if (!homeOf(file, pageNo).table->find(file, pageNo, frameNo)) {
+				return false;
+			}
+
+			BufDesc& desc = bufDescTable[frameNo];
+			{
+				std::unique_lock<std::mutex> guard(desc.latch);
+				if (!desc.valid || desc.file != file || desc.pageNo != pageNo) {
+					continue;
+				}
+
+				// A prefetch is reading the page: wait for it rather than read it again.  A
+				// write-back is writing it: wait, so that the page cannot change before it is
+				// on its way.  Then look again, since a read may have failed.
+				if (desc.loading || desc.writing) {
+					waitForIo(desc, guard);
+					continue;
+				}
+
+				// Inc pint count; a clean page changed from now on is changed after the
+				// current end of the log
+				if (desc.pinCnt++ == 0 && !desc.dirty) {
+					desc.recLsn = pinLsn();
+				}
+				desc.hits++;
+			}
+
+			// Tell the policy outside the frame latch; the page is pinned so it stays put
+			BufPartition& owner = ownerOf(frameNo);
+			owner.policy->accessed(frameNo - owner.first);
+			if (tracer != NULL) {
+				tracer->record(TRACE_HIT, file, pageNo, frameNo);
+			}
+			return true;
 		}
 	}
 
@@ -127,45 +1190,176 @@ namespace badgerdb {
 	// 1. Page is not in buffer buffer pool
 	// Call allocBuf, file->readPage, insert into hashtable, invoke Set(), return pointer to frame
 	// 2. Page is in buffer pool
-	// set appropriate refbit, increment pinCnt, return pointer to frame containing the page
-	void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+	// report the hit to the policy, increment pinCnt, return pointer to frame containing the page
+	FrameId BufMgr::pinPage(File* file, const PageId pageNo, BufAccessStrategy* strategy)
 	{
 		FrameId frameNo;
-		try {
-			// Fetch the desired hashtable
-			hashTable->lookup(file, pageNo, frameNo);
 
-			//  Set refbit to true
-			bufDescTable[frameNo].refbit = true;
+		// One hit in HIT_SAMPLE is timed: the clock costs more than the rest of a hit
+		const bool timed = (++hitTicks & (HIT_SAMPLE - 1)) == 0;
+		const std::chrono::steady_clock::time_point hitStart =
+			timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
 
-			// Inc pint count
-			bufDescTable[frameNo].pinCnt++;
+		// Fast path: page is in the pool, only the shard and the frame get latched
+		if (!pinIfPresent(file, pageNo, frameNo)) {
 
-			// Return the page reference
-			page = &bufPool[frameNo];
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::lock_guard<std::mutex> guard(allocLatch);
+
+			// Another thread may have read the page in while we waited for the latch
+			if (!pinIfPresent(file, pageNo, frameNo)) {
+
+				// If page is not in hashtable, which indicates buffer pool does not contain it
+				// Therefore, allocate buffer frame that will hold the page
+				bool recycled = false;
+				if (strategy) {
+					recycled = allocFromRing(*strategy, frameNo, file, pageNo);
+				}
+				else {
+					allocBuf(frameNo, file, pageNo);
+				}
+
+				// and read from disk straight into it; the frame is unmapped, so nobody else
+				// looks at it until it is Set()
+				try {
+					fetchPage(file, pageNo, bufPool[frameNo]);
+				}
+				catch (...) {
+					abandonFrame(frameNo, recycled, file, pageNo);
+					throw;
+				}
+				{
+					BufStatShard& shard = statShard();
+					std::lock_guard<std::mutex> statsGuard(shard.latch);
+					shard.stats.diskreads++;
+					shard.stats.misses++;
+					shard.of(file).misses++;
+				}
+
+				// Set appropriate frame attr before the page becomes visible to other threads
+				{
+					std::lock_guard<std::mutex> descGuard(bufDescTable[frameNo].latch);
+					bufDescTable[frameNo].Set(file, pageNo, pinLsn());
+				}
+				BufPartition& owner = ownerOf(frameNo);
+				if (recycled) {
+					owner.policy->recycled(frameNo - owner.first, file, pageNo);
+				}
+				else {
+					owner.policy->loaded(frameNo - owner.first, file, pageNo);
+				}
+
+				// Insert record into hash table
+				homeOf(file, pageNo).table->insert(file, pageNo, frameNo);
+				if (tracer != NULL) {
+					tracer->name(file);
+					tracer->record(TRACE_MISS, file, pageNo, frameNo);
+				}
+			}
 
+			BufStatShard& shard = statShard();
+			std::lock_guard<std::mutex> statsGuard(shard.latch);
+			shard.stats.missLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count());
 		}
-		catch (HashNotFoundException h) {
+		else if (timed) {
+			BufStatShard& shard = statShard();
+			std::lock_guard<std::mutex> statsGuard(shard.latch);
+			shard.stats.hitLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - hitStart).count());
+		}
+
+		return frameNo;
+	}
+
+	void BufMgr::readPage(File* file, const PageId pageNo, Page*& page, BufAccessStrategy* strategy)
+	{
+		// Return the page reference
+		page = &bufPool[pinPage(file, pageNo, strategy)];
+	}
+
+	PageHandle BufMgr::readPage(File* file, const PageId pageNo, BufAccessStrategy* strategy)
+	{
+		const FrameId frameNo = pinPage(file, pageNo, strategy);
+		return PageHandle(this, frameNo, file, pageNo);
+	}
+
+	// Maps each page to a frame marked as loading and puts all the reads in flight at
+	// once; the loader completes them
+	void BufMgr::prefetch(File* file, const std::vector<PageId>& pageNos)
+	{
+		std::vector<IoRequest*> started;
+		std::vector<FrameId> frames;
+		{
+			std::lock_guard<std::mutex> allocGuard(allocLatch);
+
+			for (std::size_t i = 0; i < pageNos.size(); i++) {
+				const PageId pageNo = pageNos[i];
+				FrameId frameNo;
+				if (pageNo == Page::INVALID_NUMBER || homeOf(file, pageNo).table->find(file, pageNo, frameNo)) {
+					continue;
+				}
 
-			// If page is not in hashtable, which indicates buffer pool does not contain it
-			// Therefore, we need to read from disk
-			Page p = file->readPage(pageNo);
+				// A prefetch never waits for frames to be unpinned
+				try {
+					allocBuf(frameNo, file, pageNo);
+				}
+				catch (BufferExceededException& e) {
+					break;
+				}
 
-			// allocate buffer frame that will hold the page
-			allocBuf(frameNo);
+				{
+					std::lock_guard<std::mutex> descGuard(bufDescTable[frameNo].latch);
+					bufDescTable[frameNo].Set(file, pageNo, pinLsn());
+					bufDescTable[frameNo].pinCnt = 0;
+					bufDescTable[frameNo].loading = true;
+				}
+				BufPartition& owner = ownerOf(frameNo);
+				owner.policy->loaded(frameNo - owner.first, file, pageNo);
+				homeOf(file, pageNo).table->insert(file, pageNo, frameNo);
+				if (tracer != NULL) {
+					tracer->name(file);
+					tracer->record(TRACE_MISS, file, pageNo, frameNo, TRACE_PREFETCH);
+				}
 
-			// Add the page to buffer pool
-			bufPool[frameNo] = p;
+				if (io != NULL) {
+					file->prepareRead(pageNo, bufPool[frameNo], frameIo[frameNo]);
+					started.push_back(&frameIo[frameNo]);
+				}
+				frames.push_back(frameNo);
+			}
 
-			// Insert record into hash table
-			hashTable->insert(file, pageNo, frameNo);
+			if (!frames.empty()) {
+				BufStatShard& shard = statShard();
+				std::lock_guard<std::mutex> statsGuard(shard.latch);
+				shard.stats.diskreads += frames.size();
+				shard.stats.prefetched += frames.size();
+				shard.of(file).prefetched += frames.size();
+			}
 
-			// Set appropriate frame attr
-			bufDescTable[frameNo].Set(file, pageNo);
+			if (!started.empty()) {
+				io->submit(&started[0], started.size());
+			}
+		}
 
-			// Return by page ref
-			page = &bufPool[frameNo];
+		if (frames.empty()) {
+			return;
 		}
+		std::lock_guard<std::mutex> guard(loadLatch);
+		if (!loader.joinable()) {
+			loader = std::thread(&BufMgr::loaderLoop, this);
+		}
+		loadQueue.insert(loadQueue.end(), frames.begin(), frames.end());
+		loaderWake.notify_one();
+	}
+
+	void BufMgr::prefetch(File* file, const PageId first, const PageId count)
+	{
+		std::vector<PageId> pageNos(count);
+		for (PageId i = 0; i < count; i++) {
+			pageNos[i] = first + i;
+		}
+		prefetch(file, pageNos);
 	}
 
 	// decrememnts pinCntof frame, if dirty == true sets dirty bit, throws page_not_pinned_exception if pinCnt == 0
@@ -175,113 +1369,355 @@ namespace badgerdb {
 		FrameId frame_id;
 
 		// Lookup hash
-		hashTable->lookup(file, pageNo, frame_id);
+		if (!homeOf(file, pageNo).table->find(file, pageNo, frame_id)) {
+			return;
+		}
 
 		// find frame in table
-		BufDesc frame = bufDescTable[frame_id];
+		BufDesc& frame = bufDescTable[frame_id];
+		std::lock_guard<std::mutex> guard(frame.latch);
 
-		if (frame.pinCnt <= 0) {
+		// An unpinned frame may have been recycled since the lookup
+		if (frame.pinCnt <= 0 || frame.file != file || frame.pageNo != pageNo) {
 			throw PageNotPinnedException(file->filename(), pageNo, frame_id);
 		}
 
 		// udpate dirty value
 		if (dirty) {
-			bufDescTable[frame_id].dirty = true;
+			frame.dirty = true;
 		}
 
 		// decrement from being unpinned
-		bufDescTable[frame_id].pinCnt--;
+		frame.pinCnt--;
+		if (tracer != NULL) {
+			tracer->record(TRACE_UNPIN, file, pageNo, frame_id, dirty ? TRACE_DIRTY : 0);
+		}
 
 	}
 
+	// The handle pinned the frame, so it still holds the page: no lookup needed
+	void BufMgr::unPinFrame(const FrameId frameNo, File* file, const PageId pageNo, const bool dirty)
+	{
+		BufDesc& frame = bufDescTable[frameNo];
+		std::lock_guard<std::mutex> guard(frame.latch);
+
+		// The pin may have been given up already, and the frame since cleared or reused
+		if (frame.file != file || frame.pageNo != pageNo || frame.pinCnt <= 0) {
+			throw PageNotPinnedException(file->filename(), pageNo, frameNo);
+		}
+		if (dirty) {
+			frame.dirty = true;
+		}
+		frame.pinCnt--;
+		if (tracer != NULL) {
+			tracer->record(TRACE_UNPIN, frame.file, frame.pageNo, frameNo, dirty ? TRACE_DIRTY : 0);
+		}
+	}
+
 	// scans bufTable for pages belonging to file
-	// if page dirty, file-writePage() and then set dirty back to false
+	// writes all the dirty pages in one batch, then clears dirty
 	// remove page from hashtable
 	// invoke Clear() method of bufDesc for page frame
 	// throws page_pinned_exception if file pinned
 	// throws bad_buffer_exception if invalid page encountered
 	void BufMgr::flushFile(const File* file)
 	{
-		
-		// Iterate through buffer and flush all frames belonging to current file
-		for (uint32_t i = 0; i < numBufs; i++) {
+		std::lock_guard<std::mutex> allocGuard(allocLatch);
+		std::vector<FrameId> dirtyFrames;
+
+		// Check every frame belonging to the current file, and collect the dirty ones
+		for (uint32_t i = 0; i < reservedBufs; i++) {
 
-			BufDesc currDesc = bufDescTable[i];
+			BufDesc& currDesc = bufDescTable[i];
+			std::unique_lock<std::mutex> guard(currDesc.latch);
 
 			if (currDesc.file == file) {
 
+				waitForIo(currDesc, guard);
+
+				// A prefetch of a page that does not exist leaves the frame free
+				if (currDesc.file != file)
+					continue;
+
 				// If not valid, throw a BadBufferException
-				if (!currDesc.valid)
-					throw BadBufferException(currDesc.frameNo, currDesc.dirty, currDesc.valid, currDesc.refbit);
+				if (!currDesc.valid) {
+					guard.unlock();
+					endWriteBack(dirtyFrames, true);
+					throw BadBufferException(currDesc.frameNo, currDesc.dirty, currDesc.valid);
+				}
 
 				// If pinned, throw a PagePinnedException
-				if (currDesc.pinCnt > 0)
+				if (currDesc.pinCnt > 0) {
+					guard.unlock();
+					endWriteBack(dirtyFrames, true);
 					throw PagePinnedException(file->filename(), currDesc.pageNo, currDesc.frameNo);
+				}
 
-				// If dirty, write to disk and clear dirty bit
+				// Keep the background writer off the page until it is written
 				if (currDesc.dirty) {
+					currDesc.writing = true;
+					currDesc.dirty = false;
+					currDesc.recLsn = pinLsn();
+					dirtyFrames.push_back(currDesc.frameNo);
+				}
+			}
+		}
+
+		// Write all the dirty pages at once
+		try {
+			writeFrames(dirtyFrames);
+		}
+		catch (...) {
+			endWriteBack(dirtyFrames, true);
+			throw;
+		}
+		endWriteBack(dirtyFrames, false);
+		{
+			BufStatShard& shard = statShard();
+			std::lock_guard<std::mutex> statsGuard(shard.latch);
+			shard.stats.diskwrites += dirtyFrames.size();
+		}
+
+		for (uint32_t i = 0; i < reservedBufs; i++) {
 
-					Page currPage = bufPool[currDesc.frameNo];
-					bufDescTable[i].file->writePage(currPage);
-					bufDescTable[i].dirty = false;
+			BufDesc& currDesc = bufDescTable[i];
+			std::unique_lock<std::mutex> guard(currDesc.latch);
+
+			if (currDesc.file == file) {
+
+				// Hits do not take allocLatch, so a page may have been pinned meanwhile, or
+				// pinned, dirtied and unpinned again
+				bool written = std::binary_search(dirtyFrames.begin(), dirtyFrames.end(), currDesc.frameNo);
+				for (;;) {
+					if (currDesc.pinCnt > 0)
+						throw PagePinnedException(file->filename(), currDesc.pageNo, currDesc.frameNo);
+					if (!currDesc.dirty)
+						break;
+
+					// Written like any other write-back, which reads the frame under its latch
+					const std::vector<FrameId> frame(1, currDesc.frameNo);
+					currDesc.writing = true;
+					currDesc.dirty = false;
+					currDesc.recLsn = pinLsn();
+					guard.unlock();
+					try {
+						writeFrames(frame);
+					}
+					catch (...) {
+						endWriteBack(frame, true);
+						throw;
+					}
+					endWriteBack(frame, false);
+					written = true;
+					{
+						BufStatShard& shard = statShard();
+						std::lock_guard<std::mutex> statsGuard(shard.latch);
+						shard.stats.diskwrites++;
+					}
+					guard.lock();
 				}
 
 				// Remove frame mapping from hash table and clear buffer location
-				hashTable->remove(file, currDesc.pageNo);
+				countLeaving(currDesc, false);
+				if (tracer != NULL) {
+					tracer->record(TRACE_FLUSH, file, currDesc.pageNo, currDesc.frameNo, written ? TRACE_DIRTY : 0);
+				}
+				homeOf(file, currDesc.pageNo).table->remove(file, currDesc.pageNo);
 
-				bufDescTable[i].Clear();
+				currDesc.Clear();
+				BufPartition& owner = ownerOf(currDesc.frameNo);
+				owner.policy->freed(currDesc.frameNo - owner.first);
 			}
 		}
+
+		// A checkpoint must not sync the file once the caller has closed it
+		if (log != NULL) {
+			file->sync();
+			std::lock_guard<std::mutex> guard(unsyncedLatch);
+			unsyncedFiles.erase(file);
+		}
 	}
 
 	// allocate empty page in file
 	// call allocBuf
 	// entry inserted into hash table and Set()
 	// returns page number and pointer to buffer frame
-	void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
+	FrameId BufMgr::pinNewPage(File* file, PageId &pageNo)
 	{
-		// Available frame (filled by allocBuf)
+		// The victim written back and the new page are synced together
+		File::SyncBatch batch;
 		FrameId frame;
+		{
+			std::lock_guard<std::mutex> allocGuard(allocLatch);
 
-		// Allocate new page
-		Page currPage = file->allocatePage();
+			// Available frame (filled by allocBuf); the number of the new page is not known
+			// yet, which only costs ARC a ghost lookup that cannot hit
+			allocBuf(frame, file, Page::INVALID_NUMBER);
 
-		// Allocate buffer frame
-		allocBuf(frame);
+			// Allocate new page, built in place in the frame
+			Page& currPage = bufPool[frame];
+			try {
+				std::lock_guard<std::mutex> ioGuard(ioLatch);
+				file->allocatePage(currPage);
+			}
+			catch (...) {
+				abandonFrame(frame, false, file, Page::INVALID_NUMBER);
+				throw;
+			}
+			pageNo = currPage.page_number();
+			{
+				BufStatShard& shard = statShard();
+				std::lock_guard<std::mutex> statsGuard(shard.latch);
+				shard.stats.diskreads++;
+				shard.stats.allocs++;
+				shard.of(file).allocs++;
+			}
 
-		// Put page in buffer pool
-		bufPool[frame] = currPage;
+			{
+				std::lock_guard<std::mutex> guard(bufDescTable[frame].latch);
+				bufDescTable[frame].Set(file, pageNo, pinLsn());
+			}
+			BufPartition& owner = ownerOf(frame);
+			owner.policy->loaded(frame - owner.first, file, pageNo);
+
+			// Add record to hashTable
+			homeOf(file, pageNo).table->insert(file, pageNo, frame);
+			if (tracer != NULL) {
+				tracer->name(file);
+				tracer->record(TRACE_ALLOC, file, pageNo, frame);
+			}
+		}
+		batch.commit();
 
-		// Add record to hashTable
-		hashTable->insert(file, currPage.page_number(), frame);
+		return frame;
+	}
 
-		bufDescTable[frame].Set(file, currPage.page_number());
+	void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
+	{
+		page = &bufPool[pinNewPage(file, pageNo)];
+	}
 
-		pageNo = currPage.page_number();
-		page = &bufPool[frame];
+	PageHandle BufMgr::allocPage(File* file, PageId &pageNo)
+	{
+		const FrameId frame = pinNewPage(file, pageNo);
+		return PageHandle(this, frame, file, pageNo);
 	}
 
 	// deletes page from file
 	// if page to be deleted is allocated a frame in pool, free it and remove from hashtable
 	void BufMgr::disposePage(File* file, const PageId PageNo)
 	{
+		std::lock_guard<std::mutex> allocGuard(allocLatch);
+
 		FrameId frame_id;
+		FrameId traced = BufTraceEvent::NO_FRAME;
+
+		// lookup in hashtable; if not found there is nothing to free in the pool
+		BufTable* table = homeOf(file, PageNo).table;
+		if (table->find(file, PageNo, frame_id)) {
+			traced = frame_id;
+
+			// if found, remove it and clear buffer frame, unless someone still holds it
+			std::unique_lock<std::mutex> guard(bufDescTable[frame_id].latch);
+			waitForIo(bufDescTable[frame_id], guard);
+			if (bufDescTable[frame_id].pinCnt > 0) {
+				throw PagePinnedException(file->filename(), PageNo, frame_id);
+			}
+			countLeaving(bufDescTable[frame_id], false);
+			table->erase(file, PageNo);
+			bufDescTable[frame_id].Clear();
+			BufPartition& owner = ownerOf(frame_id);
+			owner.policy->freed(frame_id - owner.first);
+		}
 
-		try {
-			// lookup in hashtable
-			hashTable->lookup(file, PageNo, frame_id);
+		// delete page
+		{
+			std::lock_guard<std::mutex> ioGuard(ioLatch);
+			file->deletePage(PageNo);
+		}
+		if (tracer != NULL) {
+			tracer->record(TRACE_DISPOSE, file, PageNo, traced);
+		}
 
-			// if found, remove it and clear buffer frame
-			hashTable->remove(file, PageNo);
-			bufDescTable[frame_id].Clear();
+		BufStatShard& shard = statShard();
+		std::lock_guard<std::mutex> statsGuard(shard.latch);
+		shard.stats.disposes++;
+		shard.of(file).disposes++;
+	}
 
+	BufStatShard& BufMgr::statShard()
+	{
+		return statShards[statsSlot()];
+	}
+
+	void BufMgr::countLeaving(BufDesc& desc, const bool evicted)
+	{
+		BufStatShard& shard = statShard();
+		std::lock_guard<std::mutex> statsGuard(shard.latch);
+		BufFileStats& stats = shard.of(desc.file);
+		stats.hits += desc.hits;
+		shard.stats.hits += desc.hits;
+		desc.hits = 0;
+		if (evicted) {
+			stats.evictions++;
+			shard.stats.evictions++;
 		}
-		catch (HashNotFoundException h) {
-			// not found, ignore not found and delete
+	}
+
+	// Shards are added up one at a time, and then the hits counted in the frames of the
+	// pages still in the pool, so nothing is stopped for long
+	BufStats BufMgr::getBufStats()
+	{
+		BufStats stats;
+		std::unordered_map<const File*, BufFileStats> files;
+		for (std::uint32_t s = 0; s < STATS_SHARDS; s++) {
+			BufStatShard& shard = statShards[s];
+			std::lock_guard<std::mutex> statsGuard(shard.latch);
+			stats.add(shard.stats);
+			for (std::unordered_map<const File*, BufFileStats>::const_iterator it = shard.files.begin();
+					it != shard.files.end(); ++it) {
+				BufFileStats& file = files[it->first];
+				file.filename = it->second.filename;
+				file.add(it->second);
+			}
 		}
 
-		// delete page
-		file->deletePage(PageNo);
+		for (FrameId i = 0; i < reservedBufs; i++) {
+			BufDesc& desc = bufDescTable[i];
+			std::lock_guard<std::mutex> guard(desc.latch);
+			if (desc.valid && desc.hits > 0) {
+				BufFileStats& file = files[desc.file];
+				if (file.filename.empty()) {
+					file.filename = desc.file->filename();
+				}
+				file.hits += desc.hits;
+				stats.hits += desc.hits;
+			}
+		}
+		stats.accesses = stats.hits + stats.misses;
+
+		for (std::unordered_map<const File*, BufFileStats>::const_iterator it = files.begin(); it != files.end(); ++it) {
+			stats.files.push_back(it->second);
+		}
+		std::sort(stats.files.begin(), stats.files.end(), [](const BufFileStats& a, const BufFileStats& b) {
+			return a.filename < b.filename;
+		});
+		return stats;
+	}
+
+	void BufMgr::clearBufStats()
+	{
+		for (std::uint32_t s = 0; s < STATS_SHARDS; s++) {
+			BufStatShard& shard = statShards[s];
+			std::lock_guard<std::mutex> statsGuard(shard.latch);
+			shard.stats.clear();
+			shard.files.clear();
+		}
+		for (FrameId i = 0; i < reservedBufs; i++) {
+			BufDesc& desc = bufDescTable[i];
+			std::lock_guard<std::mutex> guard(desc.latch);
+			desc.hits = 0;
+		}
 	}
 
 	void BufMgr::printSelf(void)
@@ -289,9 +1725,10 @@ namespace badgerdb {
 		BufDesc* tmpbuf;
 		int validFrames = 0;
 
-		for (std::uint32_t i = 0; i < numBufs; i++)
+		for (std::uint32_t i = 0; i < reservedBufs; i++)
 		{
 			tmpbuf = &(bufDescTable[i]);
+			std::lock_guard<std::mutex> guard(tmpbuf->latch);
 			std::cout << "FrameNo:" << i << " ";
 			tmpbuf->Print();
 
@@ -7,8 +7,28 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "file.h"
+#include "bufTable.h"
 #include "bufHashTbl.h"
+#include "bufArena.h"
+#include "bufPolicy.h"
+#include "bufStrategy.h"
+#include "bufTrace.h"
+#include "io_engine.h"
+#include "log_manager.h"
+#include "numa.h"
+#include "exceptions/page_not_pinned_exception.h"
 
 namespace badgerdb {
 
@@ -16,15 +36,25 @@ namespace badgerdb {
 * forward declaration of BufMgr class 
 */
 class BufMgr;
+class PageHandle;
 
 /**
 * @brief Class for maintaining information about buffer pool frames
+*
+* Every descriptor carries its own latch.  The latch protects all the other members
+* of the descriptor, so pinning or unpinning a page only ever latches the frame that
+* holds it.
 */
 class BufDesc {
 
 	friend class BufMgr;
 
  private:
+	/**
+   * Latch protecting the members of this descriptor
+	 */
+  std::mutex latch;
+
 	/**
    * Pointer to file to which corresponding frame is assigned
 	 */
@@ -56,9 +86,32 @@ class BufDesc {
   bool valid;
 
 	/**
-   * Has this buffer frame been reference recently
+   * True while the page is written back.  The frame cannot be pinned, reclaimed,
+	 * flushed or disposed of until it is cleared again, so the page does not change
+	 * while it is written.
+	 */
+  bool writing;
+
+	/**
+   * True while a prefetch reads the page into the frame.  The frame is mapped and
+	 * valid, but readPage() waits for the read to finish before pinning it.  Atomic so
+	 * that waiters can check it without the latch.
+	 */
+  std::atomic<bool> loading;
+
+	/**
+   * Recovery LSN: the end of the log when the page was last pinned while clean, or
+	 * when its write-back began.  Every change the frame holds that its file does not
+	 * was logged after it, so recovery must start no later.  0 without a log, or after
+	 * a failed write-back.
+	 */
+  Lsn recLsn;
+
+	/**
+   * Number of hits on the page since it entered the frame.  Counted here, under the latch
+	 * a hit takes anyway, and added to the statistics of its file when the page leaves.
 	 */
-  bool refbit;
+  std::uint64_t hits;
 
 	/**
    * Initialize buffer frame for a new user
@@ -66,11 +119,14 @@ class BufDesc {
   void Clear()
 	{
     pinCnt = 0;
+		hits = 0;
 		file = NULL;
 		pageNo = Page::INVALID_NUMBER;
     dirty = false;
-    refbit = false;
 		valid = false;
+		writing = false;
+		loading = false;
+		recLsn = 0;
   };
 
 	/**
@@ -79,15 +135,17 @@ class BufDesc {
 	 *
 	 * @param filePtr	File object
 	 * @param pageNum	Page number in the file
+	 * @param lsn			End of the log as the page is read in
 	 */
-  void Set(File* filePtr, PageId pageNum)
+  void Set(File* filePtr, PageId pageNum, Lsn lsn)
 	{ 
 		file = filePtr;
     pageNo = pageNum;
     pinCnt = 1;
     dirty = false;
     valid = true;
-    refbit = true;
+		recLsn = lsn;
+		hits = 0;
   }
 
   void Print()
@@ -102,8 +160,7 @@ class BufDesc {
 
 		std::cout << "valid:" << valid << " ";
 		std::cout << "pinCnt:" << pinCnt << " ";
-		std::cout << "dirty:" << dirty << " ";
-		std::cout << "refbit:" << refbit << "\n";
+		std::cout << "dirty:" << dirty << "\n";
   }
 
 	/**
@@ -116,33 +173,225 @@ class BufDesc {
 };
 
 
+/**
+* @brief Histogram of latencies in nanoseconds
+*
+* Buckets are log-linear: every power of two is split into 8 buckets, so a percentile
+* is reported within 12.5% of the true value.  Recording is a handful of instructions
+* and never allocates.
+*/
+struct LatencyHistogram
+{
+	/**
+   * Sub-buckets per power of two, as a power of two
+	 */
+  static const int SUB_BITS = 3;
+
+	/**
+   * Number of buckets, enough for any 64 bit value
+	 */
+  static const int BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+	/**
+   * Number of values recorded in each bucket
+	 */
+  std::uint64_t counts[BUCKETS];
+
+	/**
+   * Number of values recorded
+	 */
+  std::uint64_t total;
+
+	/**
+   * Adds a value to the histogram
+	 */
+  void record(const std::uint64_t nanos)
+  {
+		counts[bucketOf(nanos)]++;
+		total++;
+  }
+
+	/**
+   * Adds the values recorded in another histogram
+	 */
+  void add(const LatencyHistogram& other);
+
+	/**
+   * Returns the smallest value v such that at least the fraction q of the recorded
+	 * values are at most v, rounded down to the start of its bucket; 0 if empty
+	 *
+	 * @param q   Fraction between 0 and 1, e.g. 0.99 for the 99th percentile
+	 */
+  std::uint64_t percentile(const double q) const;
+
+	/**
+   * Clear all values
+	 */
+  void clear();
+
+	/**
+   * Constructor of LatencyHistogram class
+	 */
+  LatencyHistogram()
+  {
+		clear();
+  }
+
+ private:
+  static int bucketOf(const std::uint64_t value)
+  {
+		if (value < (1u << SUB_BITS))
+			return (int)value;
+		const int msb = 63 - __builtin_clzll(value);
+		return ((msb - SUB_BITS + 1) << SUB_BITS) + (int)((value >> (msb - SUB_BITS)) & ((1u << SUB_BITS) - 1));
+  }
+
+  static std::uint64_t bucketStart(const int bucket);
+};
+
+
+/**
+* @brief Statistics of the buffer pool events of one file
+*/
+struct BufFileStats
+{
+	/**
+   * Name of the file
+	 */
+  std::string filename;
+
+	/**
+   * Number of readPage() calls that found the page in the buffer pool
+	 */
+  std::uint64_t hits;
+
+	/**
+   * Number of readPage() calls that read the page from disk
+	 */
+  std::uint64_t misses;
+
+	/**
+   * Number of pages read by prefetch()
+	 */
+  std::uint64_t prefetched;
+
+	/**
+   * Number of pages the replacement policy, or a BufAccessStrategy, evicted
+	 */
+  std::uint64_t evictions;
+
+	/**
+   * Number of pages written back to disk, by anyone: victims, flushFile(), the writer,
+	 * checkpoints and the destructor
+	 */
+  std::uint64_t writebacks;
+
+	/**
+   * Number of pages allocated by allocPage() and disposed of by disposePage()
+	 */
+  std::uint64_t allocs;
+  std::uint64_t disposes;
+
+	/**
+   * Adds the values of another file's statistics
+	 */
+  void add(const BufFileStats& other);
+
+	/**
+   * Constructor of BufFileStats class
+	 */
+  BufFileStats()
+		: hits(0), misses(0), prefetched(0), evictions(0), writebacks(0), allocs(0), disposes(0) {}
+};
+
+
 /**
 * @brief Class to maintain statistics of buffer usage 
+*
+* BufMgr::getBufStats() returns a snapshot, added up from the counters every thread
+* keeps, while the pool goes on; events in flight as it is taken may be left out.
 */
 struct BufStats
 {
 	/**
-   * Total number of accesses to buffer pool
+   * Total number of accesses to buffer pool: readPage() calls, hits and misses
 	 */
-  int accesses;
+  std::uint64_t accesses;
+
+	/**
+   * Number of readPage() calls that found the page in the buffer pool, and that did not
+	 */
+  std::uint64_t hits;
+  std::uint64_t misses;
 
 	/**
    * Number of pages read from disk (including allocs)
 	 */
-  int diskreads;
+  std::uint64_t diskreads;
 
 	/**
    * Number of pages written back to disk
 	 */
-  int diskwrites;
+  std::uint64_t diskwrites;
+
+	/**
+   * Number of pages read by prefetch(), included in diskreads
+	 */
+  std::uint64_t prefetched;
+
+	/**
+   * Number of dirty victims a readPage() or allocPage() had to write back itself,
+	 * included in diskwrites
+	 */
+  std::uint64_t victimwrites;
+
+	/**
+   * Number of misses made through a BufAccessStrategy that reused a frame of its ring
+	 * instead of taking a victim from the replacement policy
+	 */
+  std::uint64_t ringreuses;
+
+	/**
+   * Number of pages the replacement policy, or a BufAccessStrategy, evicted
+	 */
+  std::uint64_t evictions;
+
+	/**
+   * Number of pages allocated by allocPage() and disposed of by disposePage()
+	 */
+  std::uint64_t allocs;
+  std::uint64_t disposes;
+
+	/**
+   * Time readPage() took for one hit in BufMgr::HIT_SAMPLE: timing every hit would cost
+	 * more than the rest of it
+	 */
+  LatencyHistogram hitLatency;
+
+	/**
+   * Time readPage() took for every call that missed the buffer pool
+	 */
+  LatencyHistogram missLatency;
+
+	/**
+   * Time every write-back of a batch of pages took, sync included
+	 */
+  LatencyHistogram writeLatency;
+
+	/**
+   * Statistics of every file the pool has seen since they were last cleared
+	 */
+  std::vector<BufFileStats> files;
+
+	/**
+   * Adds the values of another BufStats, except the files
+	 */
+  void add(const BufStats& other);
 
 	/**
    * Clear all values 
 	 */
-  void clear()
-  {
-		accesses = diskreads = diskwrites = 0;
-  }
+  void clear();
       
 	/**
    * Constructor of BufStats class 
@@ -155,136 +404,1267 @@ struct BufStats
 
 
 /**
-* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+* @brief Statistics counted by the threads using one shard
+*
+* Every thread counts in a shard of its own while there are no more threads than
+* BufMgr::STATS_SHARDS, so the latch is hardly ever contended.  Hits are counted in
+* their frames (BufDesc::hits) instead; only the timed ones come here.
 */
-class BufMgr 
+struct BufStatShard
 {
- private:
 	/**
-   * Current position of clockhand in our buffer pool
+   * Latch protecting the members of this shard
 	 */
-  FrameId clockHand;
+  std::mutex latch;
 
 	/**
-   * Number of frames in the buffer pool
+   * Counters and histograms; files is not used
 	 */
-  std::uint32_t numBufs;
-	
+  BufStats stats;
+
 	/**
-   * Hash table mapping (File, page) to frame
+   * Statistics of each file, keyed by the File object.  A File object created where a
+	 * destroyed one was adds to its entry until the statistics are cleared.
 	 */
-  BufHashTbl *hashTable;
+  std::unordered_map<const File*, BufFileStats> files;
 
 	/**
-   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+   * Returns the statistics of a file, made on its first event.
 	 */
-  BufDesc *bufDescTable;
+  BufFileStats& of(const File* file);
 
 	/**
-   * Maintains Buffer pool usage statistics 
+   * Keeps the latch of the next shard off the cache lines of this one
 	 */
-  BufStats bufStats;
+  char pad[64];
+};
+
 
+/**
+* @brief Statistics of the background writer
+*
+* Updated by the writer thread while other threads read them, hence atomic.
+*/
+struct BufWriterStats
+{
 	/**
-   * Advance clock to next frame in the buffer pool
+   * Number of passes the writer made over the frames the policy will evict next
 	 */
-  void advanceClock();
+  std::atomic<std::uint64_t> passes;
 
 	/**
-	 * Allocate a free frame.  
-	 *
-	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
-	 * @throws BufferExceededException If no such buffer is found which can be allocated
+   * Number of pages the writer wrote back; not included in BufStats::diskwrites
 	 */
-  void allocBuf(FrameId & frame);
+  std::atomic<std::uint64_t> pagesWritten;
 
- public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Number of upcoming victims the writer found already clean
 	 */
-  Page* bufPool;
+  std::atomic<std::uint64_t> alreadyClean;
 
 	/**
-   * Constructor of BufMgr class
+   * Clear all values
 	 */
-  BufMgr(std::uint32_t bufs);
-	
+  void clear()
+  {
+		passes = 0;
+		pagesWritten = 0;
+		alreadyClean = 0;
+  }
+
 	/**
-   * Destructor of BufMgr class
+   * Constructor of BufWriterStats class
 	 */
-  ~BufMgr();
+  BufWriterStats()
+  {
+		clear();
+  }
+};
 
+
+/**
+* @brief A share of the buffer pool placed on one NUMA node
+*
+* A partition owns a contiguous range of frames, their descriptors, a hash table and a
+* replacement policy, all in memory of its node.  Its range is reserved for its share of
+* BufMgrOptions::maxBufs; only the first frames of it are in use, as many as its share
+* of the current pool size.  Every (file, page) has a home
+* partition picked by hashing: the home's table maps the page, and a miss takes its frame
+* from the home's policy.  The policy numbers the partition's frames from 0; the
+* partition translates when it takes a victim through BufMgr.
+*/
+class BufPartition : public FrameReclaimer
+{
+	friend class BufMgr;
+
+ private:
 	/**
-	 * Reads the given page from the file into a frame and returns the pointer to page.
-	 * If the requested page is already present in the buffer pool pointer to that frame is returned
-	 * otherwise a new frame is allocated from the buffer pool for reading the page.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number in the file to be read
-	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+   * Buffer manager the partition belongs to
 	 */
-  void readPage(File* file, const PageId PageNo, Page*& page);
+  BufMgr* mgr;
 
 	/**
-	 * Unpin a page from memory since it is no longer required for it to remain in memory.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number
-	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
-   * @throws  PageNotPinnedException If the page is not already pinned
+   * First frame of the partition and number of frames in use; changed by
+	 * BufMgr::resize() with allocLatch held
 	 */
-  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+  FrameId first;
+  std::uint32_t frames;
 
 	/**
-	 * Allocates a new, empty page in the file and returns the Page object.
-	 * The newly allocated page is also assigned a frame in the buffer pool.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
-	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+   * Number of frames that stay in use: frames, except while a shrink empties the frames
+	 * from keep on, which no miss may take meanwhile
 	 */
-  void allocPage(File* file, PageId &PageNo, Page*& page); 
+  std::uint32_t keep;
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
-	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
-	 * Otherwise Error returned.
-	 *
-	 * @param file   	File object
-   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
-   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+   * NUMA node the partition's memory is placed on, and whether the kernel bound it there
 	 */
-  void flushFile(const File* file);
+  int node;
+  bool bound;
 
 	/**
-	 * Delete page from file and also from buffer pool if present.
-	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number
+   * Hash table mapping the pages whose home this is to their frames; the frame is
+	 * normally one of the partition's, but may be another's (see BufMgr::allocBuf())
 	 */
-  void disposePage(File* file, const PageId PageNo);
+  BufTable* table;
 
 	/**
-   * Print member variable values. 
+   * Replacement policy over the partition's frames, numbered from 0
 	 */
-  void  printSelf();
+  BufPolicy* policy;
+
+	/**
+	 * Takes frame first + frame through BufMgr::reclaim()
+	 */
+  virtual bool reclaim(const FrameId frame);
+
+ public:
+	/**
+   * Constructor of BufPartition class; BufMgr fills it in
+	 */
+  BufPartition()
+		: mgr(NULL), first(0), frames(0), keep(0), node(0), bound(false), table(NULL), policy(NULL) {}
+};
+
+
+/**
+* @brief Statistics of checkpoints
+*
+* Updated by the checkpointing thread while other threads read them, hence atomic.
+*/
+struct BufCheckpointStats
+{
+	/**
+   * Number of checkpoints completed
+	 */
+  std::atomic<std::uint64_t> checkpoints;
+
+	/**
+   * Number of pages checkpoints wrote back; not included in BufStats::diskwrites
+	 */
+  std::atomic<std::uint64_t> pagesWritten;
+
+	/**
+   * Number of times a checkpoint found a page pinned or being written and came back
+	 * to it later
+	 */
+  std::atomic<std::uint64_t> busyRetries;
 
 	/**
-   * Get buffer pool usage statistics
+   * LSN the last checkpoint moved the start of the log to
 	 */
-  BufStats & getBufStats()
+  std::atomic<Lsn> redoLsn;
+
+	/**
+   * Clear all values
+	 */
+  void clear()
   {
-		return bufStats;
+		checkpoints = 0;
+		pagesWritten = 0;
+		busyRetries = 0;
+		redoLsn = 0;
   }
 
 	/**
-   * Clear buffer pool usage statistics
+   * Constructor of BufCheckpointStats class
 	 */
-  void clearBufStats() 
+  BufCheckpointStats()
   {
-		bufStats.clear();
+		clear();
   }
 };
 
+
+/**
+* @brief Entry of the dirty page table returned by BufMgr::dirtyPages()
+*/
+struct BufDirtyPage
+{
+	/**
+   * File and number of the page
+	 */
+  File* file;
+  PageId pageNo;
+
+	/**
+   * Recovery LSN of the page: its changes not yet written were all logged after it
+	 */
+  Lsn recLsn;
+};
+
+
+/**
+* @brief Kinds of table BufMgr can use to map (File, page) to frames
+*/
+enum BufTableType {
+	/**
+	 * BufHashTbl: buckets chained through heap allocated nodes
+	 */
+	CHAINED_TABLE,
+
+	/**
+	 * BufProbeTbl: open addressing with Robin Hood probing, no per-entry allocation
+	 */
+	PROBING_TABLE
+};
+
+
+/**
+* @brief Page replacement policies BufMgr can use to pick victim frames
+*/
+enum BufPolicyType {
+	/**
+	 * ClockPolicy: one reference bit per frame, second chance sweep
+	 */
+	CLOCK_POLICY,
+
+	/**
+	 * LruKPolicy: evicts the page whose K-th most recent reference is oldest
+	 */
+	LRU_K_POLICY,
+
+	/**
+	 * TwoQPolicy: FIFO for pages seen once, LRU for pages seen again
+	 */
+	TWO_Q_POLICY,
+
+	/**
+	 * ArcPolicy: adaptive split between recency and frequency
+	 */
+	ARC_POLICY
+};
+
+
+/**
+* @brief Construction time settings of the buffer manager
+*/
+struct BufMgrOptions
+{
+	/**
+   * Kind of table mapping (File, page) to frames; CHAINED_TABLE by default
+	 */
+  BufTableType tableType;
+
+	/**
+   * Number of independently latched shards the table is split into
+	 */
+  int tableShards;
+
+	/**
+   * Page replacement policy
+	 */
+  BufPolicyType policyType;
+
+	/**
+   * Number of references LRU_K_POLICY ranks pages by
+	 */
+  int lruK;
+
+	/**
+   * Start a background thread that writes back dirty pages before they are evicted
+	 */
+  bool backgroundWriter;
+
+	/**
+   * Number of frames the policy will evict next that the writer keeps clean; 0 for an
+	 * eighth of the buffer pool
+	 */
+  std::uint32_t writerCleanTarget;
+
+	/**
+   * Maximum number of pages the writer writes per second; 0 for no limit
+	 */
+  std::uint32_t writerPagesPerSec;
+
+	/**
+   * Do page I/O through the blocking calls of File (pread/pwrite), one page at a time,
+	 * instead of through an IoEngine
+	 */
+  bool streamIo;
+
+	/**
+   * Kind of IoEngine to use unless streamIo is set
+	 */
+  IoEngineType ioEngine;
+
+	/**
+   * Number of page reads and writes the IoEngine keeps in flight at most
+	 */
+  unsigned ioDepth;
+
+	/**
+   * Back the buffer pool with 2 MB pages where the system allows (see BufArena)
+	 */
+  bool hugePages;
+
+	/**
+   * Most pages with consecutive numbers a write-back writes with one vectored write;
+	 * 1 writes every page on its own.  Capped at File::MAX_WRITE_RUN
+	 */
+  std::uint32_t maxWriteRun;
+
+	/**
+   * Write-ahead log of the changes to the pages, or NULL.  Before a page is written
+	 * back, the log is flushed up to the page's LSN
+	 */
+  LogManager* log;
+
+	/**
+   * Start a background thread that checkpoints whenever this many bytes have been
+	 * logged since the last checkpoint began, which bounds the log recovery reads.  0
+	 * for no checkpointer; ignored without a log
+	 */
+  std::uint64_t checkpointLogBytes;
+
+	/**
+   * Maximum number of pages a checkpoint writes per second; 0 for no limit
+	 */
+  std::uint32_t checkpointPagesPerSec;
+
+	/**
+   * Number of BufPartition the frames, descriptors and hash table are split into, 0 for
+	 * one per NUMA node.  Partition i is placed on the (i mod nodes)-th online node
+	 */
+  std::uint32_t partitions;
+
+	/**
+   * Largest number of frames BufMgr::resize() may grow the pool to; 0 for the number it
+	 * is constructed with.  Address space, descriptors and policy state are set aside for
+	 * all of them up front, but frames only take memory while they are in use
+	 */
+  std::uint32_t maxBufs;
+
+	/**
+   * Number of events each thread's trace ring holds, 0 to record no trace.  See
+	 * BufMgr::trace()
+	 */
+  std::uint32_t traceEvents;
+
+	/**
+   * Constructor of BufMgrOptions class, sets every option to its default
+	 */
+  BufMgrOptions()
+		: tableType(CHAINED_TABLE),
+		  tableShards(BufHashTbl::DEFAULT_SHARDS),
+		  policyType(CLOCK_POLICY),
+		  lruK(2),
+		  backgroundWriter(false),
+		  writerCleanTarget(0),
+		  writerPagesPerSec(0),
+		  streamIo(false),
+		  ioEngine(AUTO_ENGINE),
+		  ioDepth(32),
+		  hugePages(false),
+		  maxWriteRun(File::MAX_WRITE_RUN),
+		  log(NULL),
+		  checkpointLogBytes(0),
+		  checkpointPagesPerSec(0),
+		  partitions(1),
+		  maxBufs(0),
+		  traceEvents(0)
+  {
+  }
+};
+
+
+/**
+* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* BufMgr is safe to use from many threads at once.  A buffer hit latches one shard of
+* the hash table and then the descriptor of the frame holding the page, so hits on
+* different pages do not serialize.  Everything that assigns frames to pages or talks
+* to the files underneath (misses, allocPage, disposePage, flushFile) is serialized
+* by a single allocation latch.
+*
+* Which frame is recycled on a miss is decided by a BufPolicy chosen at construction.
+* Optionally a background writer thread writes back the dirty pages the policy is about
+* to evict, so that misses rarely have to write a victim before reading their page.
+* The pool can be split into BufPartition, one per NUMA node, each holding its frames,
+* descriptors, hash table and policy in its node's memory.
+* prefetch() puts reads in flight without waiting for them; a loader thread completes
+* them.
+*
+* resize() grows and shrinks the pool while it is in use.  Frames never move: the pool is
+* mapped for BufMgrOptions::maxBufs frames, and a shrink moves the pages out of the
+* frames it gives back, waiting for pinned ones to be unpinned.
+*
+* With a write-ahead log, every frame keeps the recovery LSN of its page, so the
+* descriptors double as the dirty page table.  checkpoint() writes back the pages
+* changed before the log end it started at, pinned pages last, and then moves the start
+* of the log forward; optionally a checkpointer thread does so as the log grows.
+*/
+class BufMgr
+{
+	friend class PageHandle;
+	friend class BufPartition;
+
+ private:
+	/**
+   * Number of frames in the buffer pool; atomic so that poolSize() can read it while
+	 * resize() changes it
+	 */
+  std::atomic<std::uint32_t> numBufs;
+
+	/**
+   * Largest number of frames the pool may grow to (BufMgrOptions::maxBufs)
+	 */
+  std::uint32_t maxBufs;
+
+	/**
+   * Number of frames set aside for each partition, and for all of them: maxBufs rounded
+	 * up to a multiple of the partitions.  Loops over the descriptors cover all of them,
+	 * since frames not in use are clear
+	 */
+  std::uint32_t sliceFrames;
+  std::uint32_t reservedBufs;
+	
+	/**
+   * Partitions of the buffer pool, each with the hash table and the replacement policy
+	 * of its frames
+	 */
+  BufPartition* partitions;
+  std::uint32_t numPartitions;
+
+	/**
+   * Next partition pinNewPage() takes a frame from, among those on the caller's node
+	 */
+  std::atomic<std::uint32_t> nextNewPartition;
+
+	/**
+   * Mapping that holds the frames of bufPool
+	 */
+  BufArena* arena;
+
+	/**
+   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+	 */
+  BufDesc *bufDescTable;
+
+	/**
+   * Maintains Buffer pool usage statistics, STATS_SHARDS shards of them
+	 */
+  BufStatShard* statShards;
+
+	/**
+   * Event trace, NULL unless BufMgrOptions::traceEvents is set
+	 */
+  BufTrace* tracer;
+
+	/**
+   * Serializes frame allocation
+	 */
+  std::mutex allocLatch;
+
+	/**
+   * Engine carrying out page reads and writes; NULL to use the blocking calls of File
+	 */
+  IoEngine *io;
+
+	/**
+   * Serializes page write-backs with allocatePage and deletePage: a write-back checks
+	 * that the page is still allocated and then writes it, so the file must not free the
+	 * page in between.  Reads do without it, since File reads with pread.
+	 * Never held while latching anything else.
+	 */
+  std::mutex ioLatch;
+
+	/**
+   * Most pages per vectored write-back (BufMgrOptions::maxWriteRun)
+	 */
+  std::uint32_t maxWriteRun;
+
+	/**
+   * Write-ahead log the write-backs follow (BufMgrOptions::log), or NULL
+	 */
+  LogManager* log;
+
+	/**
+   * Statistics of the background writer
+	 */
+  BufWriterStats writerStats;
+
+	/**
+   * Number of upcoming victims the writer keeps clean, and its write rate limit.  The
+	 * target follows the pool size unless BufMgrOptions::writerCleanTarget set it
+	 */
+  std::atomic<std::uint32_t> cleanTarget;
+  bool cleanTargetFixed;
+  std::uint32_t writerRate;
+
+	/**
+   * Set to stop the writer; writerLatch protects it and writerWake wakes the writer early
+	 */
+  bool writerStop;
+  std::mutex writerLatch;
+  std::condition_variable writerWake;
+
+	/**
+   * Background writer thread, not joinable if there is no writer
+	 */
+  std::thread writer;
+
+	/**
+   * Pages a checkpoint writes at a time
+	 */
+  static const std::size_t CHECKPOINT_BATCH = 1024;
+
+	/**
+   * How long a checkpoint keeps coming back to pinned pages before it leaves them,
+	 * and their recovery LSNs, to the next checkpoint
+	 */
+  static const int CHECKPOINT_PIN_WAIT_MS = 100;
+
+	/**
+   * Frames a resize moves pages out of per turn at allocLatch
+	 */
+  static const std::uint32_t RESIZE_BATCH = 256;
+
+	/**
+   * How long a shrink waits for the pages pinned in the frames it gives back
+	 */
+  static const int RESIZE_PIN_WAIT_MS = 1000;
+
+	/**
+   * Serializes resizes
+	 */
+  std::mutex resizeLatch;
+
+	/**
+   * Set while a shrink takes a victim, which may then be a frame being given back;
+	 * guarded by allocLatch
+	 */
+  bool evacuating;
+
+	/**
+   * Statistics of checkpoints
+	 */
+  BufCheckpointStats checkpointStats;
+
+	/**
+   * Log bytes between background checkpoints, and the checkpoint write rate limit
+	 */
+  std::uint64_t checkpointBytes;
+  std::uint32_t checkpointRate;
+
+	/**
+   * Serializes checkpoints
+	 */
+  std::mutex checkpointLatch;
+
+	/**
+   * Files written back since the last checkpoint, which it must sync before the log can
+	 * forget the changes; only tracked with a log.  Guarded by unsyncedLatch.
+	 */
+  std::set<const File*> unsyncedFiles;
+  std::mutex unsyncedLatch;
+
+	/**
+   * Background checkpointer thread, not joinable if there is none.  It stops with the
+	 * writer (writerStop); checkpointerWake wakes it early
+	 */
+  std::thread checkpointer;
+  std::condition_variable checkpointerWake;
+
+	/**
+   * Read request of each frame being loaded by a prefetch
+	 */
+  IoRequest *frameIo;
+
+	/**
+   * Frames being loaded by a prefetch, oldest first, and whether the loader must stop;
+	 * loadLatch protects both.  loaderWake wakes the loader, loadDone the threads
+	 * waiting for a frame to finish loading.
+	 */
+  std::deque<FrameId> loadQueue;
+  bool loaderStop;
+  std::mutex loadLatch;
+  std::condition_variable loaderWake;
+  std::condition_variable loadDone;
+
+	/**
+   * Thread completing prefetch reads, started by the first prefetch()
+	 */
+  std::thread loader;
+
+	/**
+   * Body of the loader thread
+	 */
+  void loaderLoop();
+
+	/**
+	 * Completes the prefetch read of a frame: marks it loaded, or unmaps it if the read
+	 * failed, then wakes the threads waiting for it.
+	 *
+	 * @param frame   Frame loaded
+	 */
+  void finishLoad(const FrameId frame);
+
+	/**
+	 * Waits until a frame is no longer loading.
+	 *
+	 * @param desc   	Descriptor of the frame
+	 */
+  void waitForLoad(BufDesc& desc);
+
+	/**
+   * Body of the background writer thread
+	 */
+  void writerLoop();
+
+	/**
+   * Body of the background checkpointer thread
+	 */
+  void checkpointerLoop();
+
+	/**
+   * Returns the recovery LSN of a page pinned now while clean: the end of the log, or 0
+	 * without a log
+	 */
+  Lsn pinLsn() const
+  {
+		return log != NULL ? log->endLsn() : 0;
+  }
+
+	/**
+	 * Marks a frame as being written back if it holds a valid, dirty, unpinned page, and
+	 * clears its dirty bit.  The frame is not evicted until endWriteBack().
+	 *
+	 * @param frame   Frame to clean
+	 * @return  			True if the page needs writing and the frame was marked
+	 */
+  bool beginWriteBack(const FrameId frame);
+
+	/**
+	 * Clears the marks set by beginWriteBack().
+	 *
+	 * @param frames  Frames marked
+	 * @param failed  True if the pages were not written, so they are dirty again
+	 */
+  void endWriteBack(const std::vector<FrameId>& frames, const bool failed);
+
+	/**
+	 * Writes the pages held by frames back to their files, all in flight at once.  The
+	 * pages are written in page number order, each run of consecutive pages of a file
+	 * with one vectored write, once the log is durable up to their LSNs.  The frames
+	 * must be out of reach of pins, so that they do not change meanwhile: marked writing
+	 * (see beginWriteBack()), or unmapped.  Their latches must not be held.
+	 *
+	 * @param frames  Frames to write
+	 */
+  void writeFrames(const std::vector<FrameId>& frames);
+
+	/**
+	 * Reads a page from its file.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param page  	Page to read into
+	 */
+  void fetchPage(File* file, const PageId pageNo, Page& page);
+
+	/**
+	 * Waits until any write-back and any prefetch are done with a frame.  The
+	 * latch of the frame is dropped while waiting.
+	 *
+	 * @param desc   	Descriptor of the frame
+	 * @param guard   Lock holding the latch of the frame
+	 */
+  void waitForIo(BufDesc& desc, std::unique_lock<std::mutex>& guard);
+
+	/**
+	 * Allocate a free frame.  Must be called with allocLatch held.
+	 *
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param file   	File of the page the frame is allocated for
+	 * @param pageNo  Page number of the page the frame is allocated for
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  void allocBuf(FrameId & frame, const File* file, const PageId pageNo);
+
+	/**
+	 * Writes back the page a frame that was just taken for another page held, if it is
+	 * dirty, and clears the frame.  Must be called with allocLatch held.
+	 *
+	 * @param frame   Frame taken
+	 */
+  void cleanVictim(const FrameId frame);
+
+	/**
+	 * Returns the statistics shard of the calling thread.
+	 */
+  BufStatShard& statShard();
+
+	/**
+	 * Counts a page leaving the pool in the statistics of its file, with the hits it had
+	 * in its frame.  Must be called with the frame latched.
+	 *
+	 * @param desc    Descriptor of the frame, still naming the page
+	 * @param evicted True if the page was evicted, false if flushed or disposed of
+	 */
+  void countLeaving(BufDesc& desc, const bool evicted);
+
+	/**
+	 * Allocates a frame for a miss made through an access strategy: reuses the next
+	 * frame of the ring if it still holds the page the ring loaded into it and is not
+	 * pinned, otherwise allocates one as allocBuf() does.  Either way the frame becomes
+	 * the ring's.  Must be called with allocLatch held.
+	 *
+	 * @param strategy  Strategy the miss was made through
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param file   		File of the page the frame is allocated for
+	 * @param pageNo  	Page number of the page the frame is allocated for
+	 * @return  				True if a frame of the ring was reused, which the policy must be told
+	 *                  through BufPolicy::recycled() rather than BufPolicy::loaded()
+	 * @throws BufferExceededException If the ring frame cannot be reused and no other frame can be allocated
+	 */
+  bool allocFromRing(BufAccessStrategy& strategy, FrameId& frame, const File* file, const PageId pageNo);
+
+	/**
+	 * Hands a frame allocated for a page that could not be read back to the policy as a
+	 * free frame.  The frame must be clear.  Must be called with allocLatch held.
+	 *
+	 * @param frame   	Frame allocated
+	 * @param recycled 	True if allocFromRing() reused the frame from its ring
+	 * @param file   		File of the page the frame was allocated for
+	 * @param pageNo  	Page number of the page the frame was allocated for
+	 */
+  void abandonFrame(const FrameId frame, const bool recycled, const File* file, const PageId pageNo);
+
+	/**
+	 * Called by the policy, through its partition, to take a frame it picked as victim.
+	 * Unmaps the page held by the frame unless it is pinned; allocBuf() then writes it
+	 * back if it is dirty.
+	 *
+	 * @param frame   Frame to take
+	 * @param ring    True if a BufAccessStrategy ring takes the frame back
+	 * @return  			False if the frame is pinned
+	 */
+  bool reclaim(const FrameId frame, const bool ring = false);
+
+	/**
+	 * Returns the home partition of a page, whose table maps it.
+	 */
+  BufPartition& homeOf(const File* file, const PageId pageNo) const
+  {
+		return partitions[homePartition(file, pageNo)];
+  }
+
+	/**
+	 * Returns the partition owning a frame, whose policy tracks it.
+	 */
+  BufPartition& ownerOf(const FrameId frame) const
+  {
+		if (numPartitions == 1)
+			return partitions[0];
+		return partitions[frame / sliceFrames];
+  }
+
+	/**
+	 * Returns true if a frame is in use and not being given back by a shrink.  Must be
+	 * called with allocLatch held.
+	 */
+  bool inUse(const FrameId frame) const
+  {
+		const BufPartition& owner = ownerOf(frame);
+		return frame - owner.first < owner.keep;
+  }
+
+	/**
+	 * Takes one step of emptying the frames a partition gives back: takes a victim from the
+	 * policy, which may be one of those frames, and if it is a frame that stays, moves the
+	 * page of a frame given back into it.  So the coldest pages leave the pool, wherever
+	 * they are.  Must be called with allocLatch held.
+	 *
+	 * @param part    Partition shrinking; frames from part.keep on are given back
+	 * @param pending Frames given back that may hold a page; emptied ones are taken off
+	 * @param busy    Frames of pending found pinned, or being read or written, go here
+	 * @param pinned  Set to a frame found pinned that kept the step from being taken, if
+	 *                one was; left alone otherwise
+	 * @return  			False if no step could be taken: pending is empty, or every frame left is
+	 *                pinned or busy
+	 */
+  bool evacuateStep(BufPartition& part, std::vector<FrameId>& pending, std::vector<FrameId>& busy,
+		FrameId& pinned);
+
+	/**
+	 * Takes a victim frame from one partition's policy.  Must be called with allocLatch
+	 * held.
+	 *
+	 * @return  			False if every frame of the partition is pinned
+	 */
+  bool victimFrom(BufPartition& part, const File* file, const PageId pageNo, FrameId& frame);
+
+	/**
+	 * Pins the frame holding (file, pageNo) if the page is in the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frameNo Frame number of the pinned frame, returned via this reference
+	 * @return  			True if the page was found and pinned, false if it is not in the buffer pool
+	 */
+  bool pinIfPresent(File* file, const PageId pageNo, FrameId& frameNo);
+
+	/**
+	 * Pins the frame holding the page, reading the page in on a miss.  Does the work of
+	 * both forms of readPage().
+	 *
+	 * @return  			Frame holding the page
+	 */
+  FrameId pinPage(File* file, const PageId pageNo, BufAccessStrategy* strategy);
+
+	/**
+	 * Allocates a page in the file and pins it in a frame.  Does the work of both forms
+	 * of allocPage().
+	 *
+	 * @return  			Frame holding the new page
+	 */
+  FrameId pinNewPage(File* file, PageId& pageNo);
+
+	/**
+	 * Unpins a frame pinned through a PageHandle.  Unlike unPinPage() it needs no hash
+	 * table lookup: the pin keeps the page in the frame.
+	 *
+	 * @param frameNo Frame to unpin
+	 * @param file   	File of the page the handle pinned
+	 * @param pageNo  Page number of the page the handle pinned
+	 * @param dirty		True if the page needs to be marked dirty
+   * @throws  PageNotPinnedException If the frame no longer holds that page pinned
+	 */
+  void unPinFrame(const FrameId frameNo, File* file, const PageId pageNo, const bool dirty);
+
+ public:
+	/**
+   * Number of statistics shards; threads beyond it share them
+	 */
+  static const std::uint32_t STATS_SHARDS = 16;
+
+	/**
+   * readPage() times one hit in HIT_SAMPLE for BufStats::hitLatency; a power of two
+	 */
+  static const std::uint32_t HIT_SAMPLE = 1024;
+
+	/**
+   * Actual buffer pool from which frames are allocated; frame i is the page-aligned
+	 * Page at bufPool + i, inside one contiguous arena
+	 */
+  Page* bufPool;
+
+	/**
+   * Constructor of BufMgr class
+	 *
+	 * @param bufs   	Number of frames in the buffer pool
+	 * @param options Construction time settings
+	 */
+  BufMgr(std::uint32_t bufs, const BufMgrOptions& options = BufMgrOptions());
+	
+	/**
+   * Destructor of BufMgr class
+	 */
+  ~BufMgr();
+
+	/**
+	 * Reads the given page from the file into a frame and returns the pointer to page.
+	 * If the requested page is already present in the buffer pool pointer to that frame is returned
+	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param strategy Ring that a miss takes its frame from, so that a large scan does not
+	 *                evict the rest of the pool; NULL to let the replacement policy decide
+	 */
+  void readPage(File* file, const PageId PageNo, Page*& page, BufAccessStrategy* strategy = NULL);
+
+	/**
+	 * Reads the given page as the other form of readPage() does, and returns a handle that
+	 * holds the pin.  Releasing the handle unpins the frame without looking the page up
+	 * again.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param strategy Ring that a miss takes its frame from, NULL to let the replacement
+	 *                policy decide
+	 * @return  			Handle holding the pin on the page
+	 */
+  PageHandle readPage(File* file, const PageId PageNo, BufAccessStrategy* strategy = NULL);
+
+	/**
+	 * Starts reading the given pages of the file into unpinned frames and returns
+	 * without waiting for them.  A later readPage() of one of the pages is a hit, or
+	 * waits for the read already in flight.  Pages already in the buffer pool are
+	 * skipped.  This is only a hint: it stops quietly when every frame is pinned, and a
+	 * page that does not exist is reported by the readPage() that asks for it.
+	 *
+	 * @param file   	File object
+	 * @param first  	Number of the first page to read
+	 * @param count  	Number of consecutive pages to read
+	 */
+  void prefetch(File* file, const PageId first, const PageId count);
+
+	/**
+	 * Starts reading the listed pages of the file, as prefetch() of a range does.
+	 *
+	 * @param file   	File object
+	 * @param pageNos Numbers of the pages to read, in the order to read them
+	 */
+  void prefetch(File* file, const std::vector<PageId>& pageNos);
+
+	/**
+	 * Unpin a page from memory since it is no longer required for it to remain in memory.
+	 * Does nothing if the page is not in the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
+   * @throws  PageNotPinnedException If the page is not already pinned
+	 */
+  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+
+	/**
+	 * Allocates a new, empty page in the file and returns the Page object.
+	 * The newly allocated page is also assigned a frame in the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 */
+  void allocPage(File* file, PageId &PageNo, Page*& page); 
+
+	/**
+	 * Allocates a new, empty page in the file as the other form of allocPage() does, and
+	 * returns a handle that holds the pin.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @return  			Handle holding the pin on the new page
+	 */
+  PageHandle allocPage(File* file, PageId &PageNo);
+
+	/**
+	 * Writes out all dirty pages of the file to disk.
+	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
+	 * Otherwise Error returned.  With a log, the file is also synced, since a later
+	 * checkpoint must not sync a file the caller may have closed.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
+   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+	 */
+  void flushFile(const File* file);
+
+	/**
+	 * Writes back every page changed before the current end of the log, syncs the files
+	 * written since the last checkpoint and moves the start of the log forward, so that
+	 * recovery reads only what was logged since.  Fuzzy: users keep pinning, changing and
+	 * unpinning pages meanwhile.  Pages are written in batches of CHECKPOINT_BATCH, no
+	 * faster than BufMgrOptions::checkpointPagesPerSec; a page that is pinned is written
+	 * once it is unpinned, unless it stays pinned for CHECKPOINT_PIN_WAIT_MS, in which
+	 * case the log keeps the records from its recovery LSN on.
+	 *
+	 * Without a log it writes back the pages dirty when it starts and syncs their files.
+	 *
+	 * @return  			LSN the log now starts at, 0 without a log
+	 * @throws  IoErrorException If a page or the log could not be written
+	 */
+  Lsn checkpoint();
+
+	/**
+	 * Returns the dirty page table: the pages whose changes have not all been written to
+	 * their files, with their recovery LSNs.  Pages being written back are included.
+	 *
+	 * @param pages  	Filled with the dirty pages
+	 */
+  void dirtyPages(std::vector<BufDirtyPage>& pages);
+
+	/**
+	 * Returns the LSN recovery would have to start from if the log were checkpointed now:
+	 * the oldest recovery LSN of the pages holding unwritten changes, pinned pages
+	 * included, or the end of the log if there are none.  0 without a log.
+	 */
+  Lsn redoLsn();
+
+	/**
+	 * Delete page from file and also from buffer pool if present.
+	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+   * @throws  PagePinnedException If the page is pinned in the pool; nothing is deleted
+	 */
+  void disposePage(File* file, const PageId PageNo);
+
+	/**
+   * Print member variable values. 
+	 */
+  void  printSelf();
+
+	/**
+   * Get buffer pool usage statistics: a snapshot taken while the pool goes on, sorted
+	 * by file name
+	 */
+  BufStats getBufStats();
+
+	/**
+   * Clear buffer pool usage statistics
+	 */
+  void clearBufStats();
+
+	/**
+   * Get the event trace: every hit, miss, alloc, unpin, eviction, flush and dispose,
+	 * with its page, frame and time.  NULL unless BufMgrOptions::traceEvents is set;
+	 * otherwise each of them costs one test of the pointer
+	 */
+  BufTrace* trace()
+  {
+		return tracer;
+  }
+
+	/**
+   * Get background writer statistics; all zero if there is no writer
+	 */
+  const BufWriterStats& getWriterStats() const
+  {
+		return writerStats;
+  }
+
+	/**
+	 * Grows or shrinks the buffer pool to a number of frames while it is in use; every
+	 * partition gets its share.  Frames added are free.  A shrink evicts pages as the
+	 * replacement policy picks them, from all the frames, and moves the pages of the
+	 * frames it gives back into the frames the evictions free, until the frames given
+	 * back are empty; so the pages the policy values most stay.  Hits go on meanwhile
+	 * and see each page either where it was or where it went.  A pinned page never moves:
+	 * the shrink waits up to RESIZE_PIN_WAIT_MS for it to be unpinned.  The hash tables
+	 * are resized afterwards, one shard at a time.
+	 *
+	 * @param bufs   	Number of frames, at most BufMgrOptions::maxBufs; raised to the
+	 *                number of partitions if smaller
+	 * @throws BufferExceededException If bufs is above BufMgrOptions::maxBufs
+	 * @throws PagePinnedException If a page in a frame to be given back stayed pinned;
+	 *                the pool keeps its size then, though pages may have moved
+	 */
+  void resize(std::uint32_t bufs);
+
+	/**
+   * Returns the number of frames in the buffer pool
+	 */
+  std::uint32_t poolSize() const
+  {
+		return numBufs;
+  }
+
+	/**
+   * Returns the largest number of frames resize() can grow the pool to
+	 */
+  std::uint32_t maxPoolSize() const
+  {
+		return maxBufs;
+  }
+
+	/**
+   * Returns the number of partitions the buffer pool is split into
+	 */
+  std::uint32_t partitionCount() const
+  {
+		return numPartitions;
+  }
+
+	/**
+   * Returns the home partition of a page: the one whose table maps it and whose frames
+	 * a miss on it takes first.  Callers that know their node can send work on a page to
+	 * a thread on the home's node.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  std::uint32_t homePartition(const File* file, const PageId pageNo) const
+  {
+		if (numPartitions == 1)
+			return 0;
+		// Bits neither table uses for its shard or slot
+		return (std::uint16_t)(BufTable::mix(file, pageNo) >> 32) % numPartitions;
+  }
+
+	/**
+   * Returns the NUMA node a partition is placed on
+	 */
+  int partitionNode(const std::uint32_t partition) const
+  {
+		return partitions[partition].node;
+  }
+
+	/**
+   * Returns true if the kernel bound the memory of a partition's frames and descriptors
+	 * to its node, rather than leaving it where first touch put it
+	 */
+  bool partitionBound(const std::uint32_t partition) const
+  {
+		return partitions[partition].bound;
+  }
+
+	/**
+   * Returns the number of buckets or slots of a partition's hash table, which resize()
+	 * sizes for the partition's frames
+	 */
+  std::uint32_t tableSlots(const std::uint32_t partition) const
+  {
+		return partitions[partition].table->slots();
+  }
+
+	/**
+   * Get checkpoint statistics
+	 */
+  const BufCheckpointStats& getCheckpointStats() const
+  {
+		return checkpointStats;
+  }
+};
+
+
+/**
+* @brief Pin on a page of the buffer pool, returned by BufMgr::readPage() and BufMgr::allocPage()
+*
+* The handle remembers the frame holding the page, so giving up the pin goes straight to
+* the frame's descriptor instead of looking the page up in the hash table as unPinPage()
+* does.  It is move-only: exactly one handle owns each pin, and the pin is released when
+* that handle is released, assigned over or destroyed.  The page must not also be
+* unpinned through unPinPage() for the pin a handle holds; if the frame no longer holds
+* the page pinned when the handle lets go, release() throws PageNotPinnedException and
+* the destructor leaves the frame alone.
+*/
+class PageHandle
+{
+	friend class BufMgr;
+
+ private:
+	/**
+   * Buffer manager the pin belongs to, NULL if the handle holds no pin
+	 */
+  BufMgr* bufMgr;
+
+	/**
+   * Frame holding the page
+	 */
+  FrameId frame;
+
+	/**
+   * File and number of the page, checked against the frame when the pin is released
+	 */
+  File* file;
+  PageId pageNo;
+
+	/**
+   * True if the page is to be marked dirty when the pin is released
+	 */
+  bool dirty;
+
+	/**
+   * Takes over a pin the buffer manager has just taken
+	 */
+  PageHandle(BufMgr* mgr, const FrameId frameNo, File* pageFile, const PageId pageNumber)
+		: bufMgr(mgr), frame(frameNo), file(pageFile), pageNo(pageNumber), dirty(false) {}
+
+  PageHandle(const PageHandle&) = delete;
+  PageHandle& operator=(const PageHandle&) = delete;
+
+ public:
+	/**
+   * Constructs a handle that holds no pin
+	 */
+  PageHandle() : bufMgr(NULL), frame(0), file(NULL), pageNo(0), dirty(false) {}
+
+	/**
+   * Takes over the pin of another handle, which is left empty
+	 */
+  PageHandle(PageHandle&& other)
+		: bufMgr(other.bufMgr), frame(other.frame), file(other.file), pageNo(other.pageNo),
+			dirty(other.dirty)
+	{
+		other.bufMgr = NULL;
+	}
+
+	/**
+   * Releases the pin this handle holds, then takes over the pin of another handle
+	 */
+  PageHandle& operator=(PageHandle&& other)
+	{
+		if (this != &other) {
+			release();
+			bufMgr = other.bufMgr;
+			frame = other.frame;
+			file = other.file;
+			pageNo = other.pageNo;
+			dirty = other.dirty;
+			other.bufMgr = NULL;
+		}
+		return *this;
+	}
+
+	/**
+   * Releases the pin, if the handle holds one.  Never throws: a pin already given up
+	 * some other way is not released twice
+	 */
+  ~PageHandle()
+	{
+		try {
+			release();
+		}
+		catch (const PageNotPinnedException&) {
+		}
+	}
+
+	/**
+   * Returns true if the handle holds a pin
+	 */
+  bool valid() const { return bufMgr != NULL; }
+
+	/**
+   * Returns the pinned page
+	 */
+  Page* page() const { return &bufMgr->bufPool[frame]; }
+  Page* operator->() const { return page(); }
+  Page& operator*() const { return *page(); }
+
+	/**
+   * Marks the page dirty once the pin is released
+	 */
+  void markDirty() { dirty = true; }
+
+	/**
+   * Unpins the page now, marking it dirty if markDirty() was called; the handle is
+	 * empty afterwards
+	 *
+   * @throws  PageNotPinnedException If the frame no longer holds the page pinned
+	 */
+  void release()
+	{
+		if (bufMgr) {
+			BufMgr* mgr = bufMgr;
+			bufMgr = NULL;
+			mgr->unPinFrame(frame, file, pageNo, dirty);
+		}
+	}
+};
+
 }
@@ -0,0 +1,93 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "clockPolicy.h"
+
+namespace badgerdb {
+
+ClockPolicy::ClockPolicy(const std::uint32_t bufs)
+	: numBufs(bufs), clockHand(bufs - 1), refbits(bufs)
+{
+}
+
+void ClockPolicy::loaded(const FrameId frame, const File* file, const PageId pageNo)
+{
+  refbits[frame].store(true, std::memory_order_relaxed);
+}
+
+void ClockPolicy::accessed(const FrameId frame)
+{
+  refbits[frame].store(true, std::memory_order_relaxed);
+}
+
+void ClockPolicy::freed(const FrameId frame)
+{
+  refbits[frame].store(false, std::memory_order_relaxed);
+}
+
+// Leave the bit clear so the next sweep takes the frame back
+void ClockPolicy::recycled(const FrameId frame, const File* file, const PageId pageNo)
+{
+  refbits[frame].store(false, std::memory_order_relaxed);
+}
+
+// Sweep until a frame is taken, or until a whole round of frames in a row turned out
+// pinned.  A frame whose refbit was set resets the count: concurrent hits may keep
+// setting bits behind the hand, and the frame may be free by the time it comes round
+bool ClockPolicy::victim(FrameReclaimer& reclaimer, const File* file, const PageId pageNo, FrameId& frame)
+{
+  const std::uint32_t bufs = numBufs.load(std::memory_order_relaxed);
+  std::uint32_t pinned = 0;
+  while (pinned < bufs) {
+
+    advanceClock();
+    const FrameId hand = clockHand.load(std::memory_order_relaxed);
+
+    // If refbit set, clear refbit and advance clock
+    if (refbits[hand].exchange(false, std::memory_order_relaxed)) {
+      pinned = 0;
+      continue;
+    }
+
+    // Free or unpinned frame: use it
+    if (reclaimer.reclaim(hand)) {
+      frame = hand;
+      return true;
+    }
+    pinned++;
+  }
+  return false;
+}
+
+// The frames ahead of the hand whose refbit is already clear are the ones the next
+// sweep takes; frames with the bit set get another round first
+void ClockPolicy::upcoming(const std::size_t count, std::vector<FrameId>& frames)
+{
+  const std::uint32_t bufs = numBufs.load(std::memory_order_relaxed);
+  FrameId hand = clockHand.load(std::memory_order_relaxed);
+  std::size_t listed = 0;
+  for (std::uint32_t steps = 0; steps < bufs && listed < count; steps++) {
+    hand = (hand + 1) % bufs;
+    if (!refbits[hand].load(std::memory_order_relaxed)) {
+      frames.push_back(hand);
+      listed++;
+    }
+  }
+}
+
+// Frames added start with a clear bit, so the next sweep takes them.  A hand left
+// beyond the last frame by a shrink goes back to it, so the sweep goes on at frame 0
+void ClockPolicy::resize(const std::uint32_t frames)
+{
+  for (FrameId f = numBufs.load(std::memory_order_relaxed); f < frames; f++)
+    refbits[f].store(false, std::memory_order_relaxed);
+  numBufs.store(frames, std::memory_order_relaxed);
+  if (clockHand.load(std::memory_order_relaxed) >= frames)
+    clockHand.store(frames - 1, std::memory_order_relaxed);
+}
+
+}
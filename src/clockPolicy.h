@@ -0,0 +1,72 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "bufPolicy.h"
+
+namespace badgerdb {
+
+/**
+* @brief Clock (second chance) replacement
+*
+* Every frame has a reference bit which is set when its page is loaded or hit.  The clock
+* hand sweeps the frames in order, clearing set bits and taking the first frame whose bit
+* is already clear and that is not pinned.  A hit only sets a bit, so hits never latch.
+* The hand is atomic only so that upcoming() can read it while victim() moves it.
+*/
+class ClockPolicy : public BufPolicy
+{
+ private:
+	/**
+   * Number of frames in the buffer pool; refbits may hold more.  Atomic so that
+	 * upcoming() can read it while resize() changes it
+	 */
+  std::atomic<std::uint32_t> numBufs;
+
+	/**
+   * Current position of clockhand in our buffer pool
+	 */
+  std::atomic<FrameId> clockHand;
+
+	/**
+   * Has each buffer frame been referenced recently
+	 */
+  std::vector<std::atomic<bool> > refbits;
+
+	/**
+   * Advance clock to next frame in the buffer pool
+	 */
+  void advanceClock()
+	{
+		clockHand.store((clockHand.load(std::memory_order_relaxed) + 1) % numBufs.load(std::memory_order_relaxed),
+			std::memory_order_relaxed);
+	}
+
+ public:
+	/**
+   * Constructor of ClockPolicy class
+	 *
+	 * @param bufs   	Number of frames in the buffer pool
+	 */
+  explicit ClockPolicy(const std::uint32_t bufs);
+
+  virtual void loaded(const FrameId frame, const File* file, const PageId pageNo);
+  virtual void accessed(const FrameId frame);
+  virtual void freed(const FrameId frame);
+  virtual void recycled(const FrameId frame, const File* file, const PageId pageNo);
+  virtual bool victim(FrameReclaimer& reclaimer, const File* file, const PageId pageNo, FrameId& frame);
+  virtual void upcoming(const std::size_t count, std::vector<FrameId>& frames);
+  virtual void resize(const std::uint32_t frames);
+  virtual const char* name() const { return "clock"; }
+};
+
+}
@@ -0,0 +1,193 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BADGERDB_CRC32C_SSE42 1
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+// Reflected Castagnoli polynomial
+const std::uint32_t POLY = 0x82f63b78;
+
+// Bytes each of the three interleaved streams of the hardware version covers
+// before they are combined; a power of two
+const std::size_t STRIDE = 512;
+
+// Product of a 32x32 matrix over GF(2), one column per word, and a vector
+std::uint32_t matrixTimes(const std::uint32_t* matrix, std::uint32_t vector) {
+  std::uint32_t sum = 0;
+  for (; vector != 0; vector >>= 1, ++matrix) {
+    if (vector & 1) {
+      sum ^= *matrix;
+    }
+  }
+  return sum;
+}
+
+void matrixSquare(std::uint32_t* square, const std::uint32_t* matrix) {
+  for (int n = 0; n < 32; ++n) {
+    square[n] = matrixTimes(matrix, matrix[n]);
+  }
+}
+
+struct Tables {
+  // Slicing-by-8 tables of the software version
+  std::uint32_t bytes[8][256];
+
+  // Operator appending STRIDE zero bytes to a CRC, one table per CRC byte
+  std::uint32_t stride[4][256];
+
+  Tables() {
+    for (std::uint32_t n = 0; n < 256; ++n) {
+      std::uint32_t crc = n;
+      for (int k = 0; k < 8; ++k) {
+        crc = crc & 1 ? (crc >> 1) ^ POLY : crc >> 1;
+      }
+      bytes[0][n] = crc;
+    }
+    for (std::uint32_t n = 0; n < 256; ++n) {
+      for (int k = 1; k < 8; ++k) {
+        bytes[k][n] = (bytes[k - 1][n] >> 8) ^ bytes[0][bytes[k - 1][n] & 0xff];
+      }
+    }
+
+    // Square the operator for one zero bit up to STRIDE * 8 bits
+    std::uint32_t op[32];
+    std::uint32_t square[32];
+    op[0] = POLY;
+    for (int n = 1; n < 32; ++n) {
+      op[n] = 1u << (n - 1);
+    }
+    for (std::size_t bits = 1; bits < STRIDE * 8; bits *= 2) {
+      matrixSquare(square, op);
+      std::memcpy(op, square, sizeof(op));
+    }
+    for (std::uint32_t n = 0; n < 256; ++n) {
+      for (int k = 0; k < 4; ++k) {
+        stride[k][n] = matrixTimes(op, n << (8 * k));
+      }
+    }
+  }
+};
+
+const Tables& tables() {
+  static const Tables instance;
+  return instance;
+}
+
+std::uint64_t load64(const unsigned char* p) {
+  std::uint64_t word = 0;
+  for (int i = 7; i >= 0; --i) {
+    word = (word << 8) | p[i];
+  }
+  return word;
+}
+
+#ifdef BADGERDB_CRC32C_SSE42
+
+// Appends STRIDE zero bytes to a CRC state
+std::uint32_t shiftStride(const Tables& t, std::uint32_t crc) {
+  return t.stride[0][crc & 0xff] ^ t.stride[1][(crc >> 8) & 0xff] ^
+      t.stride[2][(crc >> 16) & 0xff] ^ t.stride[3][crc >> 24];
+}
+
+// Three streams, each a STRIDE apart, hide the latency of the crc32
+// instruction; the CRCs of the second and third are folded into the first.
+__attribute__((target("sse4.2")))
+std::uint32_t crc32cHard(std::uint32_t crc, const void* data,
+                         std::size_t length) {
+  const Tables& t = tables();
+  const unsigned char* next = static_cast<const unsigned char*>(data);
+  std::uint64_t crc0 = ~crc;
+  while (length >= 3 * STRIDE) {
+    std::uint64_t crc1 = 0;
+    std::uint64_t crc2 = 0;
+    const unsigned char* const end = next + STRIDE;
+    do {
+      std::uint64_t word0;
+      std::uint64_t word1;
+      std::uint64_t word2;
+      std::memcpy(&word0, next, 8);
+      std::memcpy(&word1, next + STRIDE, 8);
+      std::memcpy(&word2, next + 2 * STRIDE, 8);
+      crc0 = __builtin_ia32_crc32di(crc0, word0);
+      crc1 = __builtin_ia32_crc32di(crc1, word1);
+      crc2 = __builtin_ia32_crc32di(crc2, word2);
+      next += 8;
+    } while (next < end);
+    crc0 = shiftStride(t, static_cast<std::uint32_t>(crc0)) ^ crc1;
+    crc0 = shiftStride(t, static_cast<std::uint32_t>(crc0)) ^ crc2;
+    next += 2 * STRIDE;
+    length -= 3 * STRIDE;
+  }
+  for (; length >= 8; length -= 8, next += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, next, 8);
+    crc0 = __builtin_ia32_crc32di(crc0, word);
+  }
+  std::uint32_t tail = static_cast<std::uint32_t>(crc0);
+  for (; length > 0; --length, ++next) {
+    tail = __builtin_ia32_crc32qi(tail, *next);
+  }
+  return ~tail;
+}
+
+#endif
+
+typedef std::uint32_t (*Crc32cFunction)(std::uint32_t, const void*,
+                                        std::size_t);
+
+Crc32cFunction choose() {
+#ifdef BADGERDB_CRC32C_SSE42
+  // Runs as a static initializer, possibly before the one that fills in the
+  // CPU model
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2")) {
+    return crc32cHard;
+  }
+#endif
+  return crc32cSoftware;
+}
+
+const Crc32cFunction implementation = choose();
+
+}
+
+std::uint32_t crc32c(std::uint32_t crc, const void* data, std::size_t length) {
+  return implementation(crc, data, length);
+}
+
+std::uint32_t crc32cSoftware(std::uint32_t crc, const void* data,
+                             std::size_t length) {
+  const Tables& t = tables();
+  const unsigned char* next = static_cast<const unsigned char*>(data);
+  crc = ~crc;
+  for (; length >= 8; length -= 8, next += 8) {
+    const std::uint64_t word = load64(next) ^ crc;
+    crc = t.bytes[7][word & 0xff] ^ t.bytes[6][(word >> 8) & 0xff] ^
+        t.bytes[5][(word >> 16) & 0xff] ^ t.bytes[4][(word >> 24) & 0xff] ^
+        t.bytes[3][(word >> 32) & 0xff] ^ t.bytes[2][(word >> 40) & 0xff] ^
+        t.bytes[1][(word >> 48) & 0xff] ^ t.bytes[0][word >> 56];
+  }
+  for (; length > 0; --length, ++next) {
+    crc = (crc >> 8) ^ t.bytes[0][(crc ^ *next) & 0xff];
+  }
+  return ~crc;
+}
+
+bool crc32cHardware() {
+  return implementation != crc32cSoftware;
+}
+
+}
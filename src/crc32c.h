@@ -0,0 +1,39 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * Returns the CRC-32C (Castagnoli) of length bytes at data, continuing from
+ * the CRC crc of the bytes before them (0 to start).  Uses the SSE4.2 crc32
+ * instruction when the CPU has it, checked once at run time, and a table
+ * driven version otherwise.
+ *
+ * @param crc     CRC of the preceding bytes, or 0.
+ * @param data    Bytes to add.
+ * @param length  Number of bytes.
+ * @return  CRC of the preceding bytes followed by these.
+ */
+std::uint32_t crc32c(std::uint32_t crc, const void* data, std::size_t length);
+
+/**
+ * The table driven version crc32c() falls back to; same result.
+ */
+std::uint32_t crc32cSoftware(std::uint32_t crc, const void* data,
+                             std::size_t length);
+
+/**
+ * Returns true if crc32c() uses the SSE4.2 crc32 instruction.
+ */
+bool crc32cHardware();
+
+}
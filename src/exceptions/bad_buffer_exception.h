@@ -22,7 +22,7 @@ class BadBufferException : public BadgerDbException {
   /**
    * Constructs a bad buffer exception for the given file.
    */
-  explicit BadBufferException(FrameId frameNoIn, bool dirtyIn, bool validIn, bool refbitIn);
+  explicit BadBufferException(FrameId frameNoIn, bool dirtyIn, bool validIn);
 
  protected:
   /**
@@ -39,11 +39,6 @@ class BadBufferException : public BadgerDbException {
 	 * True if buffer is valid
 	 */
 	bool valid;
-
-	/**
-	 * Has this buffer frame been reference recently
-	 */
-	bool refbit;
 };
 
 }
@@ -0,0 +1,23 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_format_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+FileFormatException::FileFormatException(const std::string& file,
+                                         const std::string& problem)
+    : BadgerDbException(""), filename_(file) {
+  std::stringstream ss;
+  ss << "Cannot open file '" << filename_ << "': " << problem;
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,48 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a file is opened whose on-disk
+ *        layout this build cannot read or upgrade.
+ */
+class FileFormatException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a format exception for the given file.
+   *
+   * @param file      Name of file.
+   * @param problem   What is wrong with its layout.
+   */
+  FileFormatException(const std::string& file, const std::string& problem);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~FileFormatException() throw() {}
+
+  /**
+   * Returns name of the file.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of file.
+   */
+  const std::string filename_;
+};
+
+}
@@ -0,0 +1,28 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_error_exception.h"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+IoErrorException::IoErrorException(const std::string& file,
+                                   const PageId page_number, const int error)
+    : BadgerDbException(""),
+      filename_(file),
+      page_number_(page_number),
+      error_(error) {
+  std::stringstream ss;
+  ss << "I/O failed on page " << page_number_ << " of file '" << filename_
+     << "': " << (error_ != 0 ? std::strerror(error_) : "short transfer");
+  message_.assign(ss.str());
+}
+
+}
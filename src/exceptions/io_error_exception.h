@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when the operating system fails a read
+ *        or write of a page.
+ */
+class IoErrorException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an I/O error exception for the given page of a file.
+   *
+   * @param file          Name of file the page belongs to.
+   * @param page_number   Number of page that could not be transferred.
+   * @param error         errno value reported, 0 for a short transfer.
+   */
+  IoErrorException(const std::string& file, const PageId page_number,
+                   const int error);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~IoErrorException() throw() {}
+
+  /**
+   * Returns the errno value reported, 0 for a short transfer.
+   */
+  virtual int error() const { return error_; }
+
+ protected:
+  /**
+   * Name of file the page belongs to.
+   */
+  const std::string filename_;
+
+  /**
+   * Number of page that could not be transferred.
+   */
+  const PageId page_number_;
+
+  /**
+   * errno value reported, 0 for a short transfer.
+   */
+  const int error_;
+};
+
+}
@@ -0,0 +1,33 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_checksum_exception.h"
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+PageChecksumException::PageChecksumException(const std::string& file,
+                                             const PageId page_number,
+                                             const std::uint32_t stored,
+                                             const std::uint32_t computed)
+    : BadgerDbException(""),
+      filename_(file),
+      page_number_(page_number),
+      stored_(stored),
+      computed_(computed) {
+  std::stringstream ss;
+  ss << "Checksum mismatch on page " << page_number_ << " of file '"
+     << filename_ << "': stored " << std::hex << std::setw(8)
+     << std::setfill('0') << stored_ << ", computed " << std::setw(8)
+     << computed_;
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,70 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a page read from a file does not
+ *        match the checksum it was written with.
+ */
+class PageChecksumException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a checksum exception for the given page of a file.
+   *
+   * @param file          Name of file the page belongs to.
+   * @param page_number   Number of page read.
+   * @param stored        Checksum stored in the page.
+   * @param computed      Checksum of the page as read.
+   */
+  PageChecksumException(const std::string& file, const PageId page_number,
+                        const std::uint32_t stored,
+                        const std::uint32_t computed);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PageChecksumException() throw() {}
+
+  /**
+   * Returns the number of the page that failed the check.
+   */
+  virtual PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns name of the file the page belongs to.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of file the page belongs to.
+   */
+  const std::string filename_;
+
+  /**
+   * Number of page that failed the check.
+   */
+  const PageId page_number_;
+
+  /**
+   * Checksum stored in the page and checksum of the page as read.
+   */
+  const std::uint32_t stored_;
+  const std::uint32_t computed_;
+};
+
+}
@@ -7,31 +7,68 @@
 
 #include "file.h"
 
-#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <cstddef>
+#include <new>
+#include <cstdint>
 #include <cstdio>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_format_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_error_exception.h"
+#include "exceptions/page_checksum_exception.h"
+#include "crc32c.h"
 #include "file_iterator.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
-File::CountMap File::open_counts_;
+namespace {
+
+// Size of the header of baseline files: the first four fields of FileHeader
+const std::size_t BASELINE_HEADER_SIZE = offsetof(FileHeader, format);
+
+// Size of the file header of MAP_FORMAT files: the fields up to flags
+const std::size_t MAP_HEADER_SIZE = offsetof(FileHeader, flags);
+
+// Size of the page header of files from before CHECKSUM_FORMAT, baseline
+// files included: the fields up to next_page_number
+const std::size_t SHORT_PAGE_HEADER_SIZE = offsetof(PageHeader, lsn);
+
+// Size of the page header of CHECKSUM_FORMAT files: those fields and the
+// checksum
+const std::size_t CHECKSUM_PAGE_HEADER_SIZE =
+    SHORT_PAGE_HEADER_SIZE + sizeof(std::uint32_t);
 
-File File::create(const std::string& filename) {
-  return File(filename, true /* create_new */);
 }
 
-File File::open(const std::string& filename) {
-  return File(filename, false /* create_new */);
+File::OpenFileMap File::open_files_;
+std::mutex File::open_files_latch_;
+thread_local int File::batch_depth_ = 0;
+thread_local std::vector<std::shared_ptr<File::OpenFile> > File::batch_files_;
+
+File File::create(const std::string& filename, const FileOptions& options) {
+  return File(filename, true /* create_new */, options);
+}
+
+File File::open(const std::string& filename, const FileOptions& options) {
+  return File(filename, false /* create_new */, options);
 }
 
 void File::remove(const std::string& filename) {
@@ -48,24 +85,21 @@ bool File::isOpen(const std::string& filename) {
   if (!exists(filename)) {
     return false;
   }
-  return open_counts_.find(filename) != open_counts_.end();
+  std::lock_guard<std::mutex> guard(open_files_latch_);
+  return open_files_.find(filename) != open_files_.end();
 }
 
 bool File::exists(const std::string& filename) {
-	std::fstream file(filename);
-	if(file)
-	{
-		file.close();
-		return true;
-	}
-
-	return false;
+  struct stat info;
+  return stat(filename.c_str(), &info) == 0;
 }
 
 File::File(const File& other)
   : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
-  ++open_counts_[filename_];
+    open_(other.open_),
+    fd_(other.fd_) {
+  std::lock_guard<std::mutex> guard(open_files_latch_);
+  ++open_->count;
 }
 
 File& File::operator=(const File& rhs) {
@@ -73,7 +107,7 @@ File& File::operator=(const File& rhs) {
   // same file.
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
-  openIfNeeded(false /* create_new */);
+  openIfNeeded(false /* create_new */, FileOptions());
   return *this;
 }
 
@@ -82,162 +116,311 @@ File::~File() {
 }
 
 Page File::allocatePage() {
-  FileHeader header = readHeader();
   Page new_page;
-  Page existing_page;
+  allocatePage(new_page);
+  return new_page;
+}
+
+void File::allocatePage(Page& new_page) {
+  std::unique_lock<std::mutex> guard(open_->latch);
+  FileHeader header = readHeader();
+  PageId page_number;
   if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
+    page_number = findFreePage();
     --header.num_free_pages;
-
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
-
-    assert((header.num_free_pages == 0) ==
-           (header.first_free_page == Page::INVALID_NUMBER));
   } else {
-    new_page.set_page_number(header.num_pages);
-    if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
-    } else {
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+    // Extend the map first if the new page is past its end
+    while (header.num_pages / PAGES_PER_MAP >=
+           open_->num_maps.load(std::memory_order_relaxed)) {
+      addMapPage(*open_, header);
     }
-    ++header.num_pages;
-  }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+    page_number = header.num_pages++;
   }
+  new_page.initialize();
+  new_page.set_page_number(page_number);
+  writePage(page_number, new_page);
+  setUsed(*open_, page_number, true);
   writeHeader(header);
-
-  return new_page;
+  // The file now holds every page the header counts
+  growMapping(header.num_pages);
+  // The map and the header are written back at the sync
+  guard.unlock();
+  noteWrite();
 }
 
 Page File::readPage(const PageId page_number) const {
-  FileHeader header = readHeader();
-  if (page_number >= header.num_pages) {
-    throw InvalidPageException(page_number, filename_);
-  }
-  return readPage(page_number, false /* allow_free */);
+  Page page;
+  readPage(page_number, page);
+  return page;
 }
 
-Page File::readPage(const PageId page_number, const bool allow_free) const {
-  Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
-  if (!allow_free && !page.isUsed()) {
+void File::readPage(const PageId page_number, Page& page) const {
+  // Page 0 holds the file header, and the map says which pages are in use
+  if (!isUsedPage(page_number)) {
     throw InvalidPageException(page_number, filename_);
   }
-
-  return page;
+  const char* mapped = mappedPage(page_number);
+  if (mapped != NULL) {
+    std::memcpy(&page, mapped, Page::SIZE);
+    adviseMappedRead(page_number);
+    verifyChecksum(page_number, page);
+    return;
+  }
+  // Header and data are contiguous in Page as on disk, so one pread fills both
+  if (readAt(&page, Page::SIZE, pagePosition(page_number), page_number) !=
+          Page::SIZE ||
+      !page.isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  verifyChecksum(page_number, page);
 }
 
 void File::writePage(const Page& new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
+  std::unique_lock<std::mutex> guard(open_->latch);
+  if (!isUsedPage(new_page.page_number())) {
     // Page has been deleted since it was read.
     throw InvalidPageException(new_page.page_number(), filename_);
   }
-  // Page on disk may have had its next page pointer updated since it was read;
-  // we don't modify that, but we do keep all the other modifications to the
-  // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
-  writePage(new_page.page_number(), header, new_page);
+  // The checksum goes into a copy: the caller's page is const and may change
+  Page page(new_page);
+  writePage(page.page_number(), page);
+  guard.unlock();
+  noteWrite();
 }
 
-void File::deletePage(const PageId page_number) {
-  FileHeader header = readHeader();
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
-  } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
-      }
+void File::writePages(Page* const* pages, const std::size_t count) {
+  assert(count <= MAX_WRITE_RUN);
+  if (count == 0) {
+    return;
+  }
+  std::unique_lock<std::mutex> guard(open_->latch);
+  checkRun(pages, count);
+  struct iovec iovs[MAX_WRITE_RUN];
+  bool aligned = true;
+  for (std::size_t i = 0; i < count; ++i) {
+    stampChecksum(*pages[i]);
+    iovs[i].iov_base = pages[i];
+    iovs[i].iov_len = Page::SIZE;
+    aligned = aligned && isAligned(pages[i], Page::SIZE, 0);
+  }
+  const PageId first = pages[0]->page_number();
+  if (open_->direct_io && !aligned) {
+    // Pages outside the buffer pool go through the bounce buffer one by one
+    for (std::size_t i = 0; i < count; ++i) {
+      writeAt(pages[i], Page::SIZE, pagePosition(first + i), first + i);
     }
+  } else {
+    pwritevFully(iovs, count, pagePosition(first), first);
   }
-  // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
-  existing_page.set_next_page_number(header.first_free_page);
-  header.first_free_page = page_number;
-  ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
+  guard.unlock();
+  noteWrite();
+}
+
+void File::deletePage(const PageId page_number) {
+  std::unique_lock<std::mutex> guard(open_->latch);
+  if (!isUsedPage(page_number)) {
+    throw InvalidPageException(page_number, filename_);
   }
+  FileHeader header = readHeader();
+  // Clear the page on disk as well, so that it reads as unused
+  Page existing_page;
+  existing_page.initialize();
   writePage(page_number, existing_page);
+  setUsed(*open_, page_number, false);
+  ++header.num_free_pages;
   writeHeader(header);
+  guard.unlock();
+  noteWrite();
+}
+
+void File::prepareRead(const PageId page_number, Page& page,
+                       IoRequest& request) const {
+  if (page_number == Page::INVALID_NUMBER) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  request.op = IoRequest::READ;
+  request.fd = fd_;
+  request.offset = pagePosition(page_number);
+  request.iov[0].iov_base = &page;
+  request.iov[0].iov_len = Page::SIZE;
+  request.iov_count = 1;
+  request.iov_array = NULL;
+}
+
+void File::finishRead(const PageId page_number, const Page& page,
+                      const IoRequest& request) const {
+  if (request.result < 0) {
+    throw IoErrorException(filename_, page_number, -request.result);
+  }
+  // A short read means the page is past the end of the file
+  if (static_cast<std::size_t>(request.result) != request.length() ||
+      !page.isUsed() || !isUsedPage(page_number)) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  verifyChecksum(page_number, page);
+}
+
+void File::prepareWrite(Page& page, IoRequest& request) const {
+  // Same check as writePage()
+  if (!isUsedPage(page.page_number())) {
+    throw InvalidPageException(page.page_number(), filename_);
+  }
+
+  stampChecksum(page);
+  request.op = IoRequest::WRITE;
+  request.fd = fd_;
+  request.offset = pagePosition(page.page_number());
+  request.iov[0].iov_base = &page;
+  request.iov[0].iov_len = Page::SIZE;
+  request.iov_count = 1;
+  request.iov_array = NULL;
+}
+
+void File::prepareWrite(Page* const* pages, const std::size_t count,
+                        struct iovec* iovs, IoRequest& request) const {
+  assert(count > 0 && count <= MAX_WRITE_RUN);
+  checkRun(pages, count);
+  for (std::size_t i = 0; i < count; ++i) {
+    stampChecksum(*pages[i]);
+    iovs[i].iov_base = pages[i];
+    iovs[i].iov_len = Page::SIZE;
+  }
+  request.op = IoRequest::WRITE;
+  request.fd = fd_;
+  request.offset = pagePosition(pages[0]->page_number());
+  request.iov_array = iovs;
+  request.iov_count = count;
+}
+
+void File::finishWrite(const Page& page, const IoRequest& request) const {
+  if (request.result < 0 ||
+      static_cast<std::size_t>(request.result) != request.length()) {
+    throw IoErrorException(filename_, page.page_number(),
+                           request.result < 0 ? -request.result : 0);
+  }
+  noteWrite();
+}
+
+void File::sync() const {
+  syncOpenFile(*open_);
+}
+
+void File::noteWrite() const {
+  if (open_->durability == NO_SYNC) {
+    return;
+  }
+  if (batch_depth_ == 0) {
+    syncOpenFile(*open_);
+    return;
+  }
+  if (std::find(batch_files_.begin(), batch_files_.end(), open_) ==
+      batch_files_.end()) {
+    batch_files_.push_back(open_);
+  }
+}
+
+void File::syncOpenFile(OpenFile& file) {
+  // The cached header and map are written back first, so the sync covers them
+  flushMetadata(file);
+  if (file.durability != GROUP_COMMIT) {
+    if (fdatasync(file.fd) != 0) {
+      throw IoErrorException(file.filename, Page::INVALID_NUMBER, errno);
+    }
+    file.syncs.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  // Group commit: the first thread to ask waits out the window, so that the
+  // threads asking meanwhile join it, then syncs once for all of them.  A
+  // sync only covers the writes made before it starts, so a thread that asks
+  // while one is running waits for the next.
+  std::unique_lock<std::mutex> guard(file.sync_latch);
+  const std::uint64_t ticket = ++file.sync_requests;
+  while (file.synced_requests < ticket) {
+    if (file.syncing) {
+      file.sync_done.wait(guard);
+      continue;
+    }
+    file.syncing = true;
+    guard.unlock();
+    if (file.group_commit_us > 0) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(file.group_commit_us));
+    }
+    guard.lock();
+    const std::uint64_t covered = file.sync_requests;
+    guard.unlock();
+    const int result = fdatasync(file.fd);
+    const int error = errno;
+    guard.lock();
+    file.syncing = false;
+    if (result == 0) {
+      file.synced_requests = covered;
+      file.syncs.fetch_add(1, std::memory_order_relaxed);
+    }
+    file.sync_done.notify_all();
+    if (result != 0) {
+      // The threads waiting retry the sync themselves
+      throw IoErrorException(file.filename, Page::INVALID_NUMBER, error);
+    }
+  }
+}
+
+File::SyncBatch::SyncBatch() : committed_(false) {
+  ++batch_depth_;
+}
+
+File::SyncBatch::~SyncBatch() {
+  // A batch abandoned by an exception leaves its writes to the next sync
+  if (--batch_depth_ == 0) {
+    batch_files_.clear();
+  }
+}
+
+void File::SyncBatch::commit() {
+  if (committed_ || batch_depth_ > 1) {
+    committed_ = true;
+    return;
+  }
+  committed_ = true;
+  while (!batch_files_.empty()) {
+    std::shared_ptr<OpenFile> file = batch_files_.back();
+    syncOpenFile(*file);
+    batch_files_.pop_back();
+  }
 }
 
 FileIterator File::begin() {
-  const FileHeader& header = readHeader();
-  return FileIterator(this, header.first_used_page);
+  return FileIterator(this, nextUsedPage(1));
 }
 
 FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+File::File(const std::string& name, const bool create_new,
+           const FileOptions& options) : filename_(name) {
+  openIfNeeded(create_new, options);
 
   if (create_new) {
-    // File starts with 1 page (the header).
+    // File starts with 1 page (the header, which takes the place of page 0).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         FILE_FORMAT, 0 /* num_map_pages */,
+                         options.checksums ? CHECKSUM_FLAG : 0};
     writeHeader(header);
+    noteWrite();
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
-  if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
-    ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+void File::openIfNeeded(const bool create_new, const FileOptions& options) {
+  std::lock_guard<std::mutex> guard(open_files_latch_);
+  OpenFileMap::iterator it = open_files_.find(filename_);
+  if (it != open_files_.end()) {	//exists an entry already
+    open_ = it->second;
+    ++open_->count;
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
+    int flags = O_RDWR;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
@@ -245,61 +428,725 @@ void File::openIfNeeded(const bool create_new) {
         throw FileExistsException(filename_);
       }
       // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
+      flags |= O_CREAT | O_TRUNC;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
-    open_counts_[filename_] = 1;
+    int fd = -1;
+    bool direct_io = false;
+    if (options.direct_io) {
+      // Filesystems without O_DIRECT support (tmpfs) refuse it with EINVAL
+      fd = ::open(filename_.c_str(), flags | O_DIRECT, 0666);
+      direct_io = fd >= 0;
+    }
+    if (fd < 0) {
+      fd = ::open(filename_.c_str(), flags, 0666);
+    }
+    if (fd < 0) {
+      throw IoErrorException(filename_, Page::INVALID_NUMBER, errno);
+    }
+    open_.reset(new OpenFile);
+    open_->fd = fd;
+    open_->count = 1;
+    open_->direct_io = direct_io;
+    open_->checksums = options.checksums;
+    open_->filename = filename_;
+    open_->durability = options.durability;
+    open_->group_commit_us = options.group_commit_us;
+    open_->header_dirty = false;
+    open_->num_pages = 0;
+    // The part of the map in page 0
+    open_->maps.reserve(MAX_MAPS);
+    open_->maps.push_back(std::unique_ptr<AllocationMap>(new AllocationMap));
+    for (std::size_t w = 0; w < MAP_WORDS; ++w) {
+      open_->maps[0]->words[w] = 0;
+    }
+    open_->maps[0]->page_number = 0;
+    open_->maps[0]->dirty = create_new;
+    open_->num_maps = 1;
+    open_->free_hint = 1;
+    open_->sync_requests = 0;
+    open_->synced_requests = 0;
+    open_->syncing = false;
+    open_->syncs = 0;
+    open_->map_base = NULL;
+    open_->map_reserved_pages = 0;
+    open_->mapped_pages = 0;
+    open_->next_mapped_read = Page::INVALID_NUMBER;
+    open_->sequential_reads = 0;
+    if (!create_new) {
+      try {
+        loadMetadata(*open_);
+      }
+      catch (...) {
+        ::close(fd);
+        open_.reset();
+        throw;
+      }
+    }
+    open_files_[filename_] = open_;
+    fd_ = fd;
+    // Direct writes would bypass the pages the mapping reads from
+    if (options.mmap_reads && !direct_io) {
+      mapFile(options.mmap_reserve_pages);
+    }
   }
+  fd_ = open_->fd;
 }
 
 void File::close() {
-  --open_counts_[filename_];
-  stream_.reset();
-  if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
-    open_counts_.erase(filename_);
+  // Closing twice (an explicit destructor call followed by the implicit one)
+  // must not release another File's reference
+  if (!open_) {
+    return;
   }
+  std::lock_guard<std::mutex> guard(open_files_latch_);
+  if (--open_->count == 0) {
+    try {
+      flushMetadata(*open_);
+    }
+    catch (IoErrorException&) {
+      // Called from the destructor, which cannot report it; the header on disk
+      // is left as of the last sync
+    }
+    if (open_->map_base != NULL) {
+      munmap(open_->map_base, pagePosition(open_->map_reserved_pages));
+    }
+    ::close(open_->fd);
+    open_files_.erase(filename_);
+  }
+  open_.reset();
 }
 
-void File::writePage(const PageId page_number, const Page& new_page) {
-  writePage(page_number, new_page.header_, new_page);
+void File::mapFile(const PageId reserve_pages) {
+  // Mapping the file itself would tie the address to its current size, so
+  // reserve the address space first and map the file over its start, then
+  // over the next pages as it grows.  Readers never see the base move.
+  void* base = mmap(NULL, pagePosition(reserve_pages), PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) {
+    return;
+  }
+  open_->map_base = static_cast<char*>(base);
+  open_->map_reserved_pages = reserve_pages;
+  struct stat info;
+  if (fstat(fd_, &info) == 0) {
+    growMapping(info.st_size / Page::SIZE);
+  }
 }
 
-void File::writePage(const PageId page_number, const PageHeader& header,
-                     const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
-  stream_->flush();
+void File::growMapping(const PageId num_pages) {
+  const PageId mapped = open_->mapped_pages.load(std::memory_order_relaxed);
+  const PageId target = std::min(num_pages, open_->map_reserved_pages);
+  if (open_->map_base == NULL || target <= mapped) {
+    return;
+  }
+  char* start = open_->map_base + pagePosition(mapped);
+  const std::size_t length = pagePosition(target - mapped);
+  if (mmap(start, length, PROT_READ, MAP_SHARED | MAP_FIXED, fd_,
+           pagePosition(mapped)) == MAP_FAILED) {
+    // The pages stay unmapped and are read with pread instead
+    return;
+  }
+  madvise(start, length, MADV_RANDOM);
+  open_->mapped_pages.store(target, std::memory_order_release);
 }
 
-FileHeader File::readHeader() const {
-  FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+void File::adviseMappedRead(const PageId page_number) const {
+  // Reading the same page again is not a step of a scan
+  if (open_->next_mapped_read.load(std::memory_order_relaxed) ==
+      page_number + 1) {
+    return;
+  }
+  const PageId expected = open_->next_mapped_read.exchange(
+      page_number + 1, std::memory_order_relaxed);
+  if (page_number != expected) {
+    open_->sequential_reads.store(0, std::memory_order_relaxed);
+    return;
+  }
+  const unsigned run =
+      open_->sequential_reads.fetch_add(1, std::memory_order_relaxed) + 1;
+  // Ask for the next batch when the reader enters the current one
+  if (run < SEQUENTIAL_RUN ||
+      (run != SEQUENTIAL_RUN && page_number % READ_AHEAD_PAGES != 0)) {
+    return;
+  }
+  const PageId mapped = open_->mapped_pages.load(std::memory_order_acquire);
+  const PageId first = page_number + 1;
+  if (first >= mapped) {
+    return;
+  }
+  const PageId count =
+      mapped - first < READ_AHEAD_PAGES ? mapped - first : READ_AHEAD_PAGES;
+  madvise(open_->map_base + pagePosition(first), pagePosition(count),
+          MADV_WILLNEED);
+}
 
-  return header;
+bool File::isAligned(const void* buffer, const std::size_t length,
+                     const off_t offset) {
+  return reinterpret_cast<std::uintptr_t>(buffer) % DIRECT_ALIGNMENT == 0 &&
+      length % DIRECT_ALIGNMENT == 0 && offset % DIRECT_ALIGNMENT == 0;
+}
+
+char* File::bounceBuffer() {
+  alignas(DIRECT_ALIGNMENT) static thread_local char bounce[Page::SIZE];
+  return bounce;
+}
+
+std::size_t File::readAt(void* buffer, const std::size_t length,
+                         const off_t offset, const PageId page_number) const {
+  if (!open_->direct_io || isAligned(buffer, length, offset)) {
+    return preadFully(buffer, length, offset, page_number);
+  }
+  // Read the aligned blocks around the range and copy the range out
+  const off_t start = offset - offset % DIRECT_ALIGNMENT;
+  const std::size_t span = (offset + length - start + DIRECT_ALIGNMENT - 1) /
+      DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+  assert(span <= Page::SIZE);
+  char* bounce = bounceBuffer();
+  const std::size_t read = preadFully(bounce, span, start, page_number);
+  const std::size_t skip = offset - start;
+  const std::size_t copied =
+      read <= skip ? 0 : std::min(length, read - skip);
+  std::memcpy(buffer, bounce + skip, copied);
+  return copied;
+}
+
+void File::writeAt(const void* buffer, const std::size_t length,
+                   const off_t offset, const PageId page_number) {
+  if (!open_->direct_io || isAligned(buffer, length, offset)) {
+    pwriteFully(buffer, length, offset, page_number);
+    return;
+  }
+  // Patch the range into the aligned blocks around it.  Only the file header
+  // and whole pages are written, so no other thread writes the same blocks.
+  const off_t start = offset - offset % DIRECT_ALIGNMENT;
+  const std::size_t span = (offset + length - start + DIRECT_ALIGNMENT - 1) /
+      DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+  assert(span <= Page::SIZE);
+  char* bounce = bounceBuffer();
+  if (offset != start || length != span) {
+    const std::size_t read = preadFully(bounce, span, start, page_number);
+    std::memset(bounce + read, 0, span - read);
+  }
+  std::memcpy(bounce + (offset - start), buffer, length);
+  pwriteFully(bounce, span, start, page_number);
+}
+
+std::size_t File::preadFully(void* buffer, const std::size_t length,
+                             const off_t offset,
+                             const PageId page_number) const {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t result = pread(fd_, static_cast<char*>(buffer) + done,
+                                 length - done, offset + done);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoErrorException(filename_, page_number, errno);
+    }
+    if (result == 0) {
+      break;
+    }
+    done += result;
+  }
+  return done;
+}
+
+void File::pwriteFully(const void* buffer, const std::size_t length,
+                       const off_t offset, const PageId page_number) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t result = pwrite(fd_, static_cast<const char*>(buffer) + done,
+                                  length - done, offset + done);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoErrorException(filename_, page_number, errno);
+    }
+    done += result;
+  }
+}
+
+void File::pwritevFully(struct iovec* iovs, int count, off_t offset,
+                        const PageId page_number) {
+  while (count > 0) {
+    ssize_t result = pwritev(fd_, iovs, count, offset);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoErrorException(filename_, page_number, errno);
+    }
+    offset += result;
+    // Skip the buffers written in full, then the written part of the next
+    while (count > 0 && static_cast<std::size_t>(result) >= iovs->iov_len) {
+      result -= iovs->iov_len;
+      ++iovs;
+      --count;
+    }
+    if (count > 0) {
+      iovs->iov_base = static_cast<char*>(iovs->iov_base) + result;
+      iovs->iov_len -= result;
+    }
+  }
+}
+
+void File::writePage(const PageId page_number, Page& new_page) {
+  stampChecksum(new_page);
+  writeAt(&new_page, Page::SIZE, pagePosition(page_number), page_number);
+}
+
+void File::upgradePages(OpenFile& file, const std::vector<bool>& used,
+                        const std::size_t header_size, const off_t shift) {
+  char* block = bounceBuffer();
+  std::vector<char> old(Page::SIZE);
+  for (int pass = 0; pass < 2; ++pass) {
+    // Highest first, so that a page moved up a little overwrites only pages
+    // already moved
+    for (PageId n = used.size(); n-- > 1;) {
+      if (!used[n]) {
+        if (pass == 1 && shift != 0) {
+          std::memset(block, 0, Page::SIZE);
+          writeBlock(file, block, Page::SIZE, pagePosition(n));
+        }
+        continue;
+      }
+      const std::size_t got =
+          readBlock(file, block, Page::SIZE, pagePosition(n) + shift);
+      std::memset(block + got, 0, Page::SIZE - got);
+      std::memcpy(&old[0], block, Page::SIZE);
+      if (pass == 0 && file.checksums) {
+        // The checksum ended the page header and covered the rest of the page
+        const std::size_t covered = header_size - sizeof(std::uint32_t);
+        std::uint32_t stored;
+        std::memcpy(&stored, &old[covered], sizeof(stored));
+        std::uint32_t computed =
+            crc32c(crc32c(0, &old[0], covered), &old[header_size],
+                   Page::SIZE - header_size);
+        computed = computed != 0 ? computed : 1;
+        if (stored != computed) {
+          throw PageChecksumException(file.filename, n, stored, computed);
+        }
+      }
+      Page* page = new (block) Page;
+      if (!upgradePage(&old[0], header_size, *page)) {
+        char problem[96];
+        std::snprintf(problem, sizeof(problem),
+                      "page %u is too full to take the current page header",
+                      n);
+        throw FileFormatException(file.filename, problem);
+      }
+      if (pass == 1) {
+        page->set_next_page_number(Page::INVALID_NUMBER);
+        page->header_.checksum = file.checksums ? pageChecksum(*page) : 0;
+        writeBlock(file, block, Page::SIZE, pagePosition(n));
+      }
+    }
+  }
+}
+
+bool File::upgradePage(const char* old, const std::size_t header_size,
+                       Page& page) {
+  // Every page header so far starts with the fields up to next_page_number
+  PageHeader legacy;
+  std::memcpy(&legacy, old, SHORT_PAGE_HEADER_SIZE);
+  const std::size_t grow = sizeof(PageHeader) - header_size;
+  const std::size_t lower = legacy.free_space_lower_bound;
+  const std::size_t upper = legacy.free_space_upper_bound;
+  const std::size_t old_data_size = Page::SIZE - header_size;
+  if (lower > upper || upper > old_data_size || upper - lower < grow) {
+    return false;
+  }
+  page.initialize();
+  page.header_.free_space_lower_bound = lower;
+  page.header_.free_space_upper_bound = upper - grow;
+  page.header_.num_slots = legacy.num_slots;
+  page.header_.num_free_slots = legacy.num_free_slots;
+  page.header_.current_page_number = legacy.current_page_number;
+  page.header_.next_page_number = legacy.next_page_number;
+  // The slot array stays at the start of the data, the records move down
+  const char* data = old + header_size;
+  std::memcpy(page.data_, data, lower);
+  std::memcpy(page.data_ + upper - grow, data + upper, old_data_size - upper);
+  for (SlotId i = 1; i <= page.header_.num_slots; ++i) {
+    PageSlot* slot = page.getSlot(i);
+    if (slot->used) {
+      slot->item_offset -= grow;
+    }
+  }
+  return true;
+}
+
+static_assert(offsetof(PageHeader, checksum) + sizeof(std::uint32_t) ==
+                  sizeof(PageHeader),
+              "The page checksum must end the page header.");
+
+std::uint32_t File::pageChecksum(const Page& page) {
+  // The checksum ends the header, so what follows it is the data
+  const std::uint32_t crc =
+      crc32c(crc32c(0, &page.header_, offsetof(PageHeader, checksum)),
+             page.data_, Page::DATA_SIZE);
+  return crc != 0 ? crc : 1;
+}
+
+void File::stampChecksum(Page& page) const {
+  page.header_.checksum = open_->checksums ? pageChecksum(page) : 0;
+}
+
+void File::verifyChecksum(const PageId page_number, const Page& page) const {
+  if (!open_->checksums) {
+    return;
+  }
+  const std::uint32_t stored = page.header_.checksum;
+  const std::uint32_t computed = pageChecksum(page);
+  if (computed != stored) {
+    throw PageChecksumException(filename_, page_number, stored, computed);
+  }
+}
+
+void File::checkRun(const Page* const* pages, const std::size_t count) const {
+  const PageId first = pages[0]->page_number();
+  for (std::size_t i = 0; i < count; ++i) {
+    assert(pages[i]->page_number() == first + i);
+    if (!isUsedPage(pages[i]->page_number())) {
+      throw InvalidPageException(pages[i]->page_number(), filename_);
+    }
+  }
+}
+
+FileHeader File::readHeader() const {
+  std::lock_guard<std::mutex> guard(open_->header_latch);
+  return open_->header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->flush();
+  std::lock_guard<std::mutex> guard(open_->header_latch);
+  open_->header = header;
+  open_->header_dirty = true;
+  open_->num_pages.store(header.num_pages, std::memory_order_release);
 }
 
-PageHeader File::readPageHeader(PageId page_number) const {
-  PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+std::size_t File::readBlock(const OpenFile& file, void* buffer,
+                            const std::size_t length, const off_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t result = pread(file.fd, static_cast<char*>(buffer) + done,
+                                 length - done, offset + done);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      throw IoErrorException(file.filename, Page::INVALID_NUMBER, errno);
+    }
+    if (result == 0) {
+      break;
+    }
+    done += result;
+  }
+  return done;
+}
 
-  return header;
+void File::writeBlock(const OpenFile& file, const void* buffer,
+                      const std::size_t length, const off_t offset) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t result = pwrite(file.fd,
+                                  static_cast<const char*>(buffer) + done,
+                                  length - done, offset + done);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result <= 0) {
+      throw IoErrorException(file.filename, Page::INVALID_NUMBER,
+                             result < 0 ? errno : EIO);
+    }
+    done += result;
+  }
+}
+
+// Page 0 holds the header and the list of map pages in its first half and the
+// first part of the map in its second half.  Map pages hold a part in their
+// first half.
+void File::loadMetadata(OpenFile& file) {
+  // Every layout since the header moved into page 0 is whole pages long; the
+  // baseline layout put its header, the first four fields of FileHeader,
+  // alone before page 1, so it ends that far into a page
+  struct stat info;
+  if (fstat(file.fd, &info) != 0) {
+    throw IoErrorException(file.filename, Page::INVALID_NUMBER, errno);
+  }
+  const bool baseline = info.st_size % Page::SIZE == BASELINE_HEADER_SIZE;
+  if (info.st_size % Page::SIZE != 0 && !baseline) {
+    throw FileFormatException(file.filename,
+                              "its size is not a whole number of pages");
+  }
+
+  char* block = bounceBuffer();
+  const std::size_t read = readBlock(file, block, Page::SIZE, 0);
+  std::memset(block + read, 0, Page::SIZE - read);
+  std::memcpy(&file.header, block, sizeof(file.header));
+  // Fields the header of the file's format does not have read as 0
+  std::size_t header_size = sizeof(FileHeader);
+  if (baseline) {
+    header_size = BASELINE_HEADER_SIZE;
+  } else if (file.header.format == LINKED_FORMAT ||
+             file.header.format == MAP_FORMAT) {
+    header_size = MAP_HEADER_SIZE;
+  }
+  std::memset(reinterpret_cast<char*>(&file.header) + header_size, 0,
+              sizeof(file.header) - header_size);
+  file.header_dirty = false;
+  file.checksums = (file.header.flags & CHECKSUM_FLAG) != 0;
+  if (baseline || file.header.format == LINKED_FORMAT) {
+    upgradeLinkedFormat(file, baseline);
+    file.num_pages = file.header.num_pages;
+    return;
+  }
+  if (file.header.format != FILE_FORMAT &&
+      file.header.format != MAP_FORMAT &&
+      file.header.format != CHECKSUM_FORMAT) {
+    char problem[64];
+    std::snprintf(problem, sizeof(problem), "unknown format %08x",
+                  file.header.format);
+    throw FileFormatException(file.filename, problem);
+  }
+
+  if (file.header.num_map_pages >= MAX_MAPS) {
+    throw FileFormatException(file.filename, "too many allocation map pages");
+  }
+  const PageId* map_pages =
+      reinterpret_cast<const PageId*>(block + header_size);
+  std::vector<PageId> numbers(map_pages,
+                              map_pages + file.header.num_map_pages);
+  for (std::size_t k = 0; k <= numbers.size(); ++k) {
+    if (k > 0) {
+      file.maps.push_back(std::unique_ptr<AllocationMap>(new AllocationMap));
+      file.maps[k]->page_number = numbers[k - 1];
+      file.maps[k]->dirty = false;
+      const std::size_t got =
+          readBlock(file, block, Page::SIZE, pagePosition(numbers[k - 1]));
+      std::memset(block + got, 0, Page::SIZE - got);
+    }
+    const std::uint64_t* words =
+        reinterpret_cast<const std::uint64_t*>(block + Page::SIZE / 2);
+    if (k > 0) {
+      words = reinterpret_cast<const std::uint64_t*>(block);
+    }
+    for (std::size_t w = 0; w < MAP_WORDS; ++w) {
+      file.maps[k]->words[w] = words[w];
+    }
+  }
+  file.num_maps = file.maps.size();
+  file.num_pages = file.header.num_pages;
+
+  // Pages written before the LSN have a shorter page header; before
+  // checksums, shorter still
+  if (file.header.format != FILE_FORMAT) {
+    std::vector<bool> used(file.header.num_pages, false);
+    for (PageId n = 1; n < file.header.num_pages; ++n) {
+      const AllocationMap& map = *file.maps[n / PAGES_PER_MAP];
+      const PageId bit = n % PAGES_PER_MAP;
+      used[n] = (map.words[bit / 64].load(std::memory_order_relaxed) >>
+                 (bit % 64)) & 1;
+    }
+    upgradePages(file, used,
+                 file.header.format == MAP_FORMAT ? SHORT_PAGE_HEADER_SIZE
+                                                  : CHECKSUM_PAGE_HEADER_SIZE,
+                 0);
+    file.header.format = FILE_FORMAT;
+    file.header_dirty = true;
+  }
+}
+
+void File::upgradeLinkedFormat(OpenFile& file, const bool baseline) {
+  FileHeader header = file.header;
+  const PageId data_pages = header.num_pages;
+  // Page n of the baseline layout follows the header and n - 1 pages
+  const off_t shift = baseline ? static_cast<off_t>(BASELINE_HEADER_SIZE) -
+                                     static_cast<off_t>(Page::SIZE)
+                               : 0;
+
+  // Walk the used list; whatever it does not reach is free
+  char* block = bounceBuffer();
+  std::vector<bool> used(data_pages, false);
+  std::vector<PageId> order;
+  PageId page_number = header.first_used_page;
+  while (page_number != Page::INVALID_NUMBER && page_number < data_pages &&
+         !used[page_number]) {
+    PageHeader page_header;
+    if (readBlock(file, block, Page::SIZE,
+                  pagePosition(page_number) + shift) < Page::SIZE) {
+      break;
+    }
+    std::memcpy(&page_header, block, SHORT_PAGE_HEADER_SIZE);
+    used[page_number] = true;
+    order.push_back(page_number);
+    page_number = page_header.next_page_number;
+  }
+  upgradePages(file, used, SHORT_PAGE_HEADER_SIZE, shift);
+
+  header.format = FILE_FORMAT;
+  header.num_map_pages = 0;
+  while (header.num_pages > file.maps.size() * PAGES_PER_MAP) {
+    addMapPage(file, header);
+  }
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    setUsed(file, order[i], true);
+  }
+  header.num_free_pages = data_pages - 1 - order.size();
+  header.first_used_page = Page::INVALID_NUMBER;
+  header.first_free_page = Page::INVALID_NUMBER;
+  file.header = header;
+  file.header_dirty = true;
+  file.maps[0]->dirty = true;
+}
+
+void File::flushMetadata(OpenFile& file) {
+  std::lock_guard<std::mutex> latch_guard(file.latch);
+  std::lock_guard<std::mutex> guard(file.header_latch);
+  char* block = bounceBuffer();
+  for (std::size_t k = 1; k < file.maps.size(); ++k) {
+    AllocationMap& map = *file.maps[k];
+    if (!map.dirty) {
+      continue;
+    }
+    std::memset(block, 0, Page::SIZE);
+    for (std::size_t w = 0; w < MAP_WORDS; ++w) {
+      const std::uint64_t word = map.words[w].load(std::memory_order_relaxed);
+      std::memcpy(block + w * sizeof(word), &word, sizeof(word));
+    }
+    writeBlock(file, block, Page::SIZE, pagePosition(map.page_number));
+    map.dirty = false;
+  }
+  if (!file.header_dirty && !file.maps[0]->dirty) {
+    return;
+  }
+  // Page 0 goes out whole, as one aligned write
+  std::memset(block, 0, Page::SIZE);
+  std::memcpy(block, &file.header, sizeof(file.header));
+  PageId* map_pages = reinterpret_cast<PageId*>(block + sizeof(FileHeader));
+  for (std::size_t k = 1; k < file.maps.size(); ++k) {
+    map_pages[k - 1] = file.maps[k]->page_number;
+  }
+  for (std::size_t w = 0; w < MAP_WORDS; ++w) {
+    const std::uint64_t word =
+        file.maps[0]->words[w].load(std::memory_order_relaxed);
+    std::memcpy(block + Page::SIZE / 2 + w * sizeof(word), &word,
+                sizeof(word));
+  }
+  writeBlock(file, block, Page::SIZE, 0);
+  file.header_dirty = false;
+  file.maps[0]->dirty = false;
+}
+
+bool File::isUsedPage(const PageId page_number) const {
+  const std::size_t k = page_number / PAGES_PER_MAP;
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= open_->num_pages.load(std::memory_order_acquire) ||
+      k >= open_->num_maps.load(std::memory_order_acquire)) {
+    return false;
+  }
+  const PageId bit = page_number % PAGES_PER_MAP;
+  const std::uint64_t word =
+      open_->maps[k]->words[bit / 64].load(std::memory_order_acquire);
+  return (word >> (bit % 64)) & 1;
+}
+
+PageId File::nextUsedPage(const PageId from) const {
+  const PageId num_pages = open_->num_pages.load(std::memory_order_acquire);
+  const std::size_t num_maps = open_->num_maps.load(std::memory_order_acquire);
+  PageId page_number = from;
+  while (page_number < num_pages &&
+         page_number / PAGES_PER_MAP < num_maps) {
+    const AllocationMap& map = *open_->maps[page_number / PAGES_PER_MAP];
+    const PageId bit = page_number % PAGES_PER_MAP;
+    std::uint64_t word =
+        map.words[bit / 64].load(std::memory_order_acquire) >> (bit % 64);
+    if (word != 0) {
+      page_number += __builtin_ctzll(word);
+      return page_number < num_pages ? page_number : Page::INVALID_NUMBER;
+    }
+    // Move on to the next word
+    page_number += 64 - bit % 64;
+  }
+  return Page::INVALID_NUMBER;
+}
+
+void File::setUsed(OpenFile& file, const PageId page_number,
+                   const bool used) {
+  AllocationMap& map = *file.maps[page_number / PAGES_PER_MAP];
+  const PageId bit = page_number % PAGES_PER_MAP;
+  const std::uint64_t mask = std::uint64_t(1) << (bit % 64);
+  if (used) {
+    map.words[bit / 64].fetch_or(mask, std::memory_order_release);
+  } else {
+    map.words[bit / 64].fetch_and(~mask, std::memory_order_release);
+    if (page_number < file.free_hint) {
+      file.free_hint = page_number;
+    }
+  }
+  map.dirty = true;
+}
+
+PageId File::findFreePage() const {
+  const PageId num_pages = open_->num_pages.load(std::memory_order_relaxed);
+  PageId page_number = open_->free_hint;
+  while (page_number < num_pages) {
+    const AllocationMap& map = *open_->maps[page_number / PAGES_PER_MAP];
+    const PageId bit = page_number % PAGES_PER_MAP;
+    const std::uint64_t free_bits =
+        ~map.words[bit / 64].load(std::memory_order_relaxed) >> (bit % 64);
+    if (free_bits == 0) {
+      page_number += 64 - bit % 64;
+      continue;
+    }
+    page_number += __builtin_ctzll(free_bits);
+    // Map pages never have their bits set; step over them
+    if (page_number < num_pages && isMapPage(*open_, page_number)) {
+      ++page_number;
+      continue;
+    }
+    break;
+  }
+  assert(page_number < num_pages);
+  open_->free_hint = page_number + 1;
+  return page_number;
+}
+
+bool File::isMapPage(const OpenFile& file, const PageId page_number) {
+  // Map pages are added at the end of the file, so their numbers ascend
+  std::size_t low = 0;
+  std::size_t high = file.maps.size();
+  while (low < high) {
+    const std::size_t middle = (low + high) / 2;
+    if (file.maps[middle]->page_number < page_number) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low < file.maps.size() && file.maps[low]->page_number == page_number;
+}
+
+void File::addMapPage(OpenFile& file, FileHeader& header) {
+  if (file.maps.size() == MAX_MAPS) {
+    throw IoErrorException(file.filename, header.num_pages, EFBIG);
+  }
+  std::unique_ptr<AllocationMap> map(new AllocationMap);
+  for (std::size_t w = 0; w < MAP_WORDS; ++w) {
+    map->words[w] = 0;
+  }
+  map->page_number = header.num_pages++;
+  map->dirty = true;
+  file.maps.push_back(std::move(map));
+  ++header.num_map_pages;
+  file.num_maps.store(file.maps.size(), std::memory_order_release);
 }
 
 }
@@ -7,17 +7,103 @@
 
 #pragma once
 
-#include <fstream>
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "page.h"
+#include "io_engine.h"
 
 namespace badgerdb {
 
 class FileIterator;
 
+/**
+ * @brief How writes to a file are made durable.
+ */
+enum FileDurability {
+  /**
+   * Never sync; the kernel writes pages back when it chooses.
+   */
+  NO_SYNC,
+
+  /**
+   * fdatasync once per batch of writes: per File write call, or once for
+   * all the writes of a File::SyncBatch.
+   */
+  SYNC_PER_BATCH,
+
+  /**
+   * Batches ending within FileOptions::group_commit_us of each other share
+   * one fdatasync.
+   */
+  GROUP_COMMIT
+};
+
+/**
+ * @brief Options chosen when a file is created or opened.
+ */
+struct FileOptions {
+  /**
+   * Open the file with O_DIRECT, so that its pages bypass the kernel page
+   * cache instead of being cached twice, once there and once in a buffer
+   * pool.  Transfers to and from buffers that are not aligned to
+   * File::DIRECT_ALIGNMENT go through an aligned bounce buffer.  If the
+   * filesystem does not support O_DIRECT the file is opened buffered; see
+   * File::directIo().
+   */
+  bool direct_io;
+
+  /**
+   * Map the file read-only and serve page reads from the mapping instead of
+   * issuing a pread for each.  Meant for read-mostly
+   * files; writes still go through pwrite, which the mapping sees at once.
+   * Ignored for a file opened with O_DIRECT.  See File::mapped().
+   */
+  bool mmap_reads;
+
+  /**
+   * Number of pages of address space reserved for the mapping, so that it
+   * can grow with the file without moving.  Pages past it are read with
+   * pread.
+   */
+  PageId mmap_reserve_pages;
+
+  /**
+   * When writes are made durable.  The header and the allocation map are
+   * held in memory and written back only at a sync and when the file is
+   * closed.  Under NO_SYNC, pages allocated or deleted since the last sync()
+   * or close are therefore lost if the process dies, even though the kernel
+   * still writes back the page data.  Call sync() to bound that window.
+   */
+  FileDurability durability;
+
+  /**
+   * With GROUP_COMMIT, how long the first batch to end waits for others to
+   * join its fdatasync, in microseconds.  Even with 0, the batches that end
+   * while a sync runs share the next one.
+   */
+  unsigned group_commit_us;
+
+  /**
+   * Store a CRC-32C in each page written (PageHeader::checksum), and check
+   * it when the page is read.  Only taken when the file is created: the file
+   * header records it, and every later open follows the header.
+   */
+  bool checksums;
+
+  FileOptions()
+      : direct_io(false), mmap_reads(false), mmap_reserve_pages(1 << 20),
+        durability(NO_SYNC), group_commit_us(0), checksums(false) {}
+};
+
 /**
  * @brief Header metadata for files on disk which contain pages.
  */
@@ -28,7 +114,8 @@ struct FileHeader {
   PageId num_pages;
 
   /**
-   * Page number of the first used page in the file.
+   * Page number of the first used page in the file.  Only files of the
+   * linked-list format, before the allocation map, keep it.
    */
   PageId first_used_page;
 
@@ -39,9 +126,28 @@ struct FileHeader {
 
   /**
    * Page number of the first free (allocated but unused) page in the file.
+   * Only files of the linked-list format keep it.
    */
   PageId first_free_page;
 
+  /**
+   * Version of the on-disk layout the file was written in: File::FILE_FORMAT
+   * for files written by this build.  Files of an earlier version File knows
+   * are upgraded when opened; others are refused with FileFormatException.
+   */
+  std::uint32_t format;
+
+  /**
+   * Number of allocation map pages listed after the header, besides the map
+   * held in page 0 itself.
+   */
+  PageId num_map_pages;
+
+  /**
+   * File::CHECKSUM_FLAG if the file was created with checksums.
+   */
+  std::uint32_t flags;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -52,7 +158,10 @@ struct FileHeader {
     return num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        first_free_page == rhs.first_free_page &&
+        format == rhs.format &&
+        num_map_pages == rhs.num_map_pages &&
+        flags == rhs.flags;
   }
 };
 
@@ -67,30 +176,88 @@ struct FileHeader {
  * If a file that has already been opened (possibly by another query), then the File class
  * detects this (by looking in the open_streams_ map) and just returns a file object with
  * the already created stream for the file without actually opening the UNIX file again. 
+ * The same descriptor lets an IoEngine transfer pages through prepareRead()
+ * and prepareWrite().
+ *
+ * The file header takes the place of page 0, so page n starts at offset
+ * n * Page::SIZE and every page is aligned for direct I/O.  It is cached in
+ * memory while the file is open and written back at syncs and on close, so
+ * reading a page costs exactly one read.
+ *
+ * Which pages are in use is kept in an allocation map, one bit per page, held
+ * in memory and written back with the header.  Its first part fills the
+ * second half of page 0; the header lists the map pages holding the rest.
+ * Allocating or deleting a page writes only that page, and iterating over
+ * the file reads only the pages it returns.  Pages are allocated lowest
+ * number first, reusing deleted pages.
  *
- * @warning This class is not threadsafe.
+ * A file opened with FileOptions::mmap_reads is also mapped into memory, and
+ * readPage() copies pages out of the mapping without a system call.
+ *
+ * Writes are made durable as FileOptions::durability says, once per call
+ * that writes or once per SyncBatch.
+ *
+ * Threads may share a file, through one File object or several.  Page reads
+ * and writes are positional, so they share no seek position and need no
+ * lock; writePage() and writePages() take the per-file latch only to check
+ * that the pages are still allocated.  allocatePage() and deletePage(), which
+ * change the allocation map and the header, are serialized by that latch.
+ * Assigning to or destroying a File object other threads still use is not
+ * safe; each thread can hold a copy instead.
  */
 class File {
  public:
+  /**
+   * @brief Groups the writes one thread makes to any number of files, so
+   *        that each file is synced once at commit() rather than after
+   *        every write.
+   *
+   * Batches nest; only the outermost one syncs.  A batch destroyed without
+   * commit() (say by an exception) leaves its writes to the next sync.
+   */
+  class SyncBatch {
+   public:
+    SyncBatch();
+    ~SyncBatch();
+
+    /**
+     * Syncs every file written during the batch, as its durability says.
+     *
+     * @throws  IoErrorException  If a sync failed.
+     */
+    void commit();
+
+   private:
+    SyncBatch(const SyncBatch&) = delete;
+    SyncBatch& operator=(const SyncBatch&) = delete;
+
+    bool committed_;
+  };
+
   /**
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param options   How to open the file.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static File create(const std::string& filename);
+  static File create(const std::string& filename,
+                     const FileOptions& options = FileOptions());
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
-	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * It first checks if the file is already open. If so, then the new File object created uses the same file descriptor to read to or write fom
+	 * that already open file. Reference count (the OpenFile entry in the open_files_ static map) is incremented whenever an already open file is
+	 * opened again. Otherwise the UNIX file is actually opened and its descriptor is inserted into the open_files_ map.
+   *
+   * The options only take effect if the file is not open already.
    *
    * @param filename  Name of the file.
+   * @param options   How to open the file.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
    */
-  static File open(const std::string& filename);
+  static File open(const std::string& filename,
+                   const FileOptions& options = FileOptions());
 
   /**
    * Deletes an existing file.
@@ -139,12 +306,23 @@ class File {
   ~File();
 
   /**
-   * Allocates a new page in the file.
+   * Allocates a new page in the file.  The header and allocation map that
+   * record the page reach the file at the next sync, which under NO_SYNC is
+   * only sync() or close (see FileOptions::durability).  Until then a crash
+   * forgets the allocation.
    *
    * @return The new page.
    */
   Page allocatePage();
 
+  /**
+   * Allocates a new page in the file, building it in place in the given page
+   * instead of returning a copy.
+   *
+   * @param new_page  Page overwritten with the new page.
+   */
+  void allocatePage(Page& new_page);
+
   /**
    * Reads an existing page from the file.
    *
@@ -155,6 +333,17 @@ class File {
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads an existing page from the file straight into the given page instead
+   * of returning a copy.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page overwritten with the contents read.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPage(const PageId page_number, Page& page) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
@@ -165,12 +354,96 @@ class File {
   void writePage(const Page& new_page);
 
   /**
-   * Deletes a page from the file.
+   * Writes a run of pages with consecutive page numbers, pages[0] first, with
+   * one vectored write.  Every page must have been allocated, as for
+   * writePage(); if one has not, nothing is written.  The checksum of each
+   * page is set in the page, so the pages must not change until it returns.
+   *
+   * @param pages   Pages to write, in page number order.
+   * @param count   Number of pages, at most MAX_WRITE_RUN.
+   * @throws  InvalidPageException  If one of the pages has been deleted.
+   */
+  void writePages(Page* const* pages, const std::size_t count);
+
+  /**
+   * Deletes a page from the file.  As with allocatePage(), the file records
+   * the deletion at the next sync.
    *
    * @param page_number   Number of page to delete.
    */
   void deletePage(const PageId page_number);
 
+  /**
+   * Fills in an I/O request that reads a page of this file into page, for an
+   * IoEngine to carry out.  Once the request is complete, finishRead() checks
+   * it.  page and request must stay alive until then.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @param request       Request to fill in.
+   * @throws  InvalidPageException  If the page number is invalid.
+   */
+  void prepareRead(const PageId page_number, Page& page,
+                   IoRequest& request) const;
+
+  /**
+   * Checks a completed request filled in by prepareRead().
+   *
+   * @param page_number   Number of page read.
+   * @param page          Page read into.
+   * @param request       Completed request.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  IoErrorException      If the read failed.
+   */
+  void finishRead(const PageId page_number, const Page& page,
+                  const IoRequest& request) const;
+
+  /**
+   * Fills in an I/O request that writes a page into the file, for an IoEngine
+   * to carry out.  The checksum of the page is set in it now, so the page must
+   * not change, and it and request must stay alive, until the request is
+   * complete.
+   *
+   * @param page      Page to write.
+   * @param request   Request to fill in.
+   * @throws  InvalidPageException  If the page has been deleted.
+   */
+  void prepareWrite(Page& page, IoRequest& request) const;
+
+  /**
+   * Fills in an I/O request that writes a run of pages with consecutive page
+   * numbers, pages[0] first, as one vectored write.  The checksums of the
+   * pages are set in them now, so the pages must not change, and pages, iovs
+   * and request must stay alive, until the request is complete; finishWrite()
+   * with *pages[0] checks it.
+   *
+   * @param pages     Pages to write, in page number order.
+   * @param count     Number of pages, at most MAX_WRITE_RUN.
+   * @param iovs      Array of count entries for the request to point at.
+   * @param request   Request to fill in.
+   * @throws  InvalidPageException  If one of the pages has been deleted.
+   */
+  void prepareWrite(Page* const* pages, const std::size_t count,
+                    struct iovec* iovs, IoRequest& request) const;
+
+  /**
+   * Checks a completed request filled in by prepareWrite().
+   *
+   * @param page      Page written, or the first page of a run.
+   * @param request   Completed request.
+   * @throws  IoErrorException      If the write failed.
+   */
+  void finishWrite(const Page& page, const IoRequest& request) const;
+
+  /**
+   * Makes every write made so far durable with fdatasync, sharing it with
+   * other threads under GROUP_COMMIT.  Syncs even under NO_SYNC.
+   *
+   * @throws  IoErrorException  If the sync failed.
+   */
+  void sync() const;
+
   /**
    * Returns the name of the file this object represents.
    *
@@ -178,6 +451,82 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns true if the file was opened with O_DIRECT.
+   */
+  bool directIo() const { return open_->direct_io; }
+
+  /**
+   * Returns true if pages are written and read with a checksum, as the file
+   * was created.
+   */
+  bool checksums() const { return open_->checksums; }
+
+  /**
+   * Returns the number of fdatasync calls that completed on the file since it
+   * was opened, by every File object of it.
+   */
+  std::uint64_t syncCount() const {
+    return open_->syncs.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the checksum of a page, taken without PageHeader::checksum.
+   * Never 0, which marks a page written without one.
+   */
+  static std::uint32_t pageChecksum(const Page& page);
+
+  /**
+   * Returns true if page reads are served from a memory mapping of the file.
+   */
+  bool mapped() const { return open_->map_base != NULL; }
+
+  /**
+   * Alignment of buffers, offsets and lengths that O_DIRECT transfers need.
+   */
+  static const std::size_t DIRECT_ALIGNMENT = 4096;
+
+  /**
+   * Most pages writePages() and the run prepareWrite() take, well under
+   * IOV_MAX.
+   */
+  static const std::size_t MAX_WRITE_RUN = 128;
+
+  /**
+   * Value of FileHeader::format in files that link their used and free pages
+   * into lists, with the header in page 0.
+   */
+  static const std::uint32_t LINKED_FORMAT = 0;
+
+  /**
+   * Value of FileHeader::format in files that keep an allocation map, with a
+   * page header that ends at next_page_number and a file header without
+   * flags.
+   */
+  static const std::uint32_t MAP_FORMAT = 0x4d415031;
+
+  /**
+   * Value of FileHeader::format in files whose file header has flags and
+   * whose page header has a checksum right after next_page_number.
+   */
+  static const std::uint32_t CHECKSUM_FORMAT = 0x4d415032;
+
+  /**
+   * Value of FileHeader::format in files whose page header also has an LSN
+   * before its checksum.
+   */
+  static const std::uint32_t LSN_FORMAT = 0x4d415033;
+
+  /**
+   * Value of FileHeader::format in files written by this build.
+   */
+  static const std::uint32_t FILE_FORMAT = LSN_FORMAT;
+
+  /**
+   * Bit of FileHeader::flags set in files created with checksums.
+   */
+  static const std::uint32_t CHECKSUM_FLAG = 1;
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -201,8 +550,8 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static off_t pagePosition(const PageId page_number) {
+    return static_cast<off_t>(page_number) * Page::SIZE;
   }
 
   /**
@@ -214,106 +563,455 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param options     How to open the file.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const FileOptions& options);
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor.
    *
    * @param create_new  Whether to create a new file.
+   * @param options     How to open the file if it is not open yet.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const bool create_new, const FileOptions& options);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying file descriptor in <fd_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
   void close();
 
   /**
-   * Reads a page from the file.  If <allow_free> is not set, an exception
-   * will be thrown if the page read from disk is not currently in use.
-   *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * Writes a page into the file at the given page number.  This does not
+   * ensure that the number in the header equals the position on disk, nor
+   * that the page is allocated.  No bounds checking is performed.
    *
-   * @param page_number   Number of page to read.
-   * @param allow_free    Whether to allow reading a free (unused) page.
-   * @return  The page.
-   * @throws  InvalidPageException  If the page is free (unused) and
-   *                                allow_free is false.
+   * @param page_number Number of page whose contents to replace.
+   * @param new_page    Page to write; its checksum is set first.
    */
-  Page readPage(const PageId page_number, const bool allow_free) const;
+  void writePage(const PageId page_number, Page& new_page);
 
   /**
-   * Writes a page into the file at the given page number.  This does not
-   * update ensure that the number in the header equals the position on disk.
-   * No bounds checking is performed.
+   * Sets the checksum of a page about to be written: pageChecksum(), or 0 if
+   * the file is written without checksums.
+   */
+  void stampChecksum(Page& page) const;
+
+  /**
+   * Checks the checksum of a page read, if the file has checksums.
    *
-   * @param page_number Number of page whose contents to replace.
-   * @param new_page    Page to write.
+   * @throws  PageChecksumException  If the page does not match it.
    */
-  void writePage(const PageId page_number, const Page& new_page);
+  void verifyChecksum(const PageId page_number, const Page& page) const;
 
   /**
-   * Writes a page into the file at the given page number with the given header.
-   * This does not ensure that the number in the header equals the position on
-   * disk.  No bounds checking is performed.
+   * Throws unless every page of a run is allocated.  Asserts that their page
+   * numbers are consecutive.
    *
-   * @param page_number Number of page whose contents to replace.
-   * @param header      Header of page to write.
-   * @param new_page    Page to write.
+   * @param pages   Pages of the run, in page number order.
+   * @param count   Number of pages, between 1 and MAX_WRITE_RUN.
+   * @throws  InvalidPageException  If one of the pages is not allocated.
    */
-  void writePage(const PageId page_number, const PageHeader& header,
-                 const Page& new_page);
+  void checkRun(const Page* const* pages, const std::size_t count) const;
 
   /**
-   * Reads the header for this file from disk.
+   * Returns the header for this file, from the copy cached in memory.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Replaces the cached header for this file.  The header reaches the disk at
+   * the next sync, or when the last File object for the file is closed.
    *
    * @param header  File header to write.
    */
   void writeHeader(const FileHeader& header);
 
   /**
-   * Reads only the header of the given page from disk (not the record data
-   * or slot table).  No bounds checking is performed.
+   * Reads the header and allocation map of an open file from disk into
+   * memory, upgrading a file of an earlier format.
+   *
+   * @throws  IoErrorException      If a read failed.
+   * @throws  FileFormatException   If the file is of a layout this build
+   *                                cannot read.
+   * @throws  PageChecksumException If a page of a file being upgraded does
+   *                                not match its checksum.
+   */
+  struct OpenFile;
+  static void loadMetadata(OpenFile& file);
+
+  /**
+   * Builds the allocation map of a file of the linked-list format by walking
+   * its used list, once.  The map pages it needs are added at the end.  Its
+   * pages, written with the shorter page header of the time, are rewritten
+   * in the current layout; a baseline file, whose pages follow a header
+   * alone at offset 0, also has them moved to their page-aligned places.
+   * The file is rewritten in place, so an upgrade cut short by a crash
+   * leaves it unreadable.
+   *
+   * @param baseline  True if the file is in the baseline layout.
+   * @throws  FileFormatException   If a page is too full to take the current
+   *                                page header; the file is left untouched.
+   */
+  static void upgradeLinkedFormat(OpenFile& file, const bool baseline);
+
+  /**
+   * Rewrites the pages of a file of an earlier layout in the current one,
+   * with upgradePage(), after checking that every one of them can be.
+   *
+   * Pages of a file with checksums must match the checksum they were
+   * written with, which ends their header.
+   *
+   * @param used          Which pages hold data, by page number.
+   * @param header_size   Size of the page header they were written with.
+   * @param shift         Offset of page n in the file from pagePosition(n);
+   *                      if not 0, free pages are zeroed at pagePosition(n).
+   * @throws  FileFormatException   If a page is too full to take the current
+   *                                page header; the file is left untouched.
+   * @throws  PageChecksumException If a page does not match its checksum;
+   *                                the file is left untouched.
+   */
+  static void upgradePages(OpenFile& file, const std::vector<bool>& used,
+                           const std::size_t header_size, const off_t shift);
+
+  /**
+   * Builds the current form of a page written with an earlier, shorter page
+   * header, whose data starts header_size bytes in.  The data area shrinks
+   * by the difference, taken from the page's free space.
+   *
+   * @param old           Page as read from disk.
+   * @param header_size   Size of the page header it was written with.
+   * @param page          Page overwritten with the upgraded page.
+   * @return  False if the page does not have that much free space.
+   */
+  static bool upgradePage(const char* old, const std::size_t header_size,
+                          Page& page);
+
+  /**
+   * Writes the header and the parts of the allocation map that have changed.
    *
-   * @param page_number   Number of page whose header is to be read.
-   * @return  Header of page.
+   * @throws  IoErrorException  If a write failed.
    */
-  PageHeader readPageHeader(const PageId page_number) const;
+  static void flushMetadata(OpenFile& file);
 
-  typedef std::map<std::string,
-                   std::shared_ptr<std::fstream> > StreamMap;
-  typedef std::map<std::string, int> CountMap;
+  /**
+   * Whole-buffer pread and pwrite on the descriptor of an open file, for
+   * metadata; the buffer must be aligned for O_DIRECT.
+   *
+   * @return  Number of bytes read, less than length only at the end of the file.
+   */
+  static std::size_t readBlock(const OpenFile& file, void* buffer,
+                               const std::size_t length, const off_t offset);
+  static void writeBlock(const OpenFile& file, const void* buffer,
+                         const std::size_t length, const off_t offset);
 
   /**
-   * Streams for opened files.
+   * Returns true if the page is allocated and holds data.  Needs no latch.
    */
-  static StreamMap open_streams_;
+  bool isUsedPage(const PageId page_number) const;
 
   /**
-   * Counts for opened files.
+   * Returns the lowest used page numbered from or above, or
+   * Page::INVALID_NUMBER if there is none.  Needs no latch.
+   */
+  PageId nextUsedPage(const PageId from) const;
+
+  /**
+   * Marks a page used or free in the allocation map.  Called with the file
+   * latch held.
+   */
+  static void setUsed(OpenFile& file, const PageId page_number,
+                      const bool used);
+
+  /**
+   * Returns the lowest free page, not counting the map pages.  There must be
+   * one.  Called with the file latch held.
+   */
+  PageId findFreePage() const;
+
+  /**
+   * Returns true if the page holds part of the allocation map (page 0
+   * included).  Called with the file latch held.
+   */
+  static bool isMapPage(const OpenFile& file, const PageId page_number);
+
+  /**
+   * Adds a map page at the end of the file, extending the map by
+   * PAGES_PER_MAP pages.  Called with the file latch held.
+   *
+   * @throws  IoErrorException  If the header has no room left to list it.
+   */
+  static void addMapPage(OpenFile& file, FileHeader& header);
+
+  /**
+   * Pages covered by each part of the allocation map, its size in 64-bit
+   * words, and the number of parts the header has room to list.
+   */
+  static const PageId PAGES_PER_MAP = Page::SIZE / 2 * 8;
+  static const std::size_t MAP_WORDS = PAGES_PER_MAP / 64;
+  static const std::size_t MAX_MAPS =
+      1 + (Page::SIZE / 2 - sizeof(FileHeader)) / sizeof(PageId);
+
+  /**
+   * Part of the allocation map: one bit per page, set while the page is used.
+   */
+  struct AllocationMap {
+    /**
+     * Bits of the pages, set and cleared under the file latch and read
+     * without it.
+     */
+    std::atomic<std::uint64_t> words[MAP_WORDS];
+
+    /**
+     * Page holding this part; 0 for the part in page 0.
+     */
+    PageId page_number;
+
+    /**
+     * True if the part has changed since it was last written.  Guarded by
+     * the file latch.
+     */
+    bool dirty;
+  };
+
+  /**
+   * Reads length bytes at offset with pread, retrying short reads.  On a
+   * direct file, a transfer that is not aligned goes through the calling
+   * thread's bounce buffer.
+   *
+   * @return  Number of bytes read, less than length only at the end of the file.
+   * @throws  IoErrorException  If the read failed.
+   */
+  std::size_t readAt(void* buffer, const std::size_t length,
+                     const off_t offset, const PageId page_number) const;
+
+  /**
+   * Writes length bytes at offset with pwrite, retrying short writes.  On a
+   * direct file, a transfer that is not aligned reads the blocks it covers
+   * into the calling thread's bounce buffer, patches them and writes them.
+   *
+   * @throws  IoErrorException  If the write failed.
    */
-  static CountMap open_counts_;
+  void writeAt(const void* buffer, const std::size_t length,
+               const off_t offset, const PageId page_number);
+
+  /**
+   * Reads and writes exactly as given, without bounce buffers.
+   */
+  std::size_t preadFully(void* buffer, const std::size_t length,
+                         const off_t offset, const PageId page_number) const;
+  void pwriteFully(const void* buffer, const std::size_t length,
+                   const off_t offset, const PageId page_number);
+
+  /**
+   * Writes count buffers, in order, with pwritev, calling it again after a
+   * short write.  iovs is updated as it goes.
+   *
+   * @throws  IoErrorException  If the write failed.
+   */
+  void pwritevFully(struct iovec* iovs, int count, off_t offset,
+                    const PageId page_number);
+
+  /**
+   * Called after every call that writes.  Outside a SyncBatch, syncs the
+   * file as its durability says; inside one, adds it to the files the batch
+   * syncs.
+   */
+  void noteWrite() const;
+
+  /**
+   * Syncs an open file, alone or as part of a group commit.
+   */
+  static void syncOpenFile(OpenFile& file);
+
+  /**
+   * Returns true if an O_DIRECT transfer may use the buffer, offset and length
+   * as they are.
+   */
+  static bool isAligned(const void* buffer, const std::size_t length,
+                        const off_t offset);
+
+  /**
+   * Returns the calling thread's bounce buffer for direct transfers: one page,
+   * aligned to DIRECT_ALIGNMENT.
+   */
+  static char* bounceBuffer();
+
+  /**
+   * Reserves address space for the mapping and maps the whole pages the file
+   * holds.  Leaves the file unmapped if the reservation fails.
+   */
+  void mapFile(const PageId reserve_pages);
+
+  /**
+   * Extends the mapping to cover the first num_pages pages, which must all be
+   * in the file.  Called with the file latch held when the file grows.
+   */
+  void growMapping(const PageId num_pages);
+
+  /**
+   * Returns the mapped copy of the page, or NULL if it is not mapped.
+   */
+  const char* mappedPage(const PageId page_number) const {
+    if (open_->map_base == NULL ||
+        page_number >= open_->mapped_pages.load(std::memory_order_acquire)) {
+      return NULL;
+    }
+    return open_->map_base + pagePosition(page_number);
+  }
+
+  /**
+   * Tells the kernel how the mapping is being read.  The mapping is advised
+   * as random, so that a fault does not read around the page; once reads
+   * have been sequential for a while, the pages ahead are asked for in
+   * batches instead.
+   *
+   * @param page_number   Number of page just read from the mapping.
+   */
+  void adviseMappedRead(const PageId page_number) const;
+
+  /**
+   * Number of consecutive page reads after which the mapping reads ahead, and
+   * the number of pages it asks for at a time.
+   */
+  static const unsigned SEQUENTIAL_RUN = 8;
+  static const PageId READ_AHEAD_PAGES = 32;
+
+  /**
+   * State shared by every File object open on the same filesystem file.
+   */
+  struct OpenFile {
+    /**
+     * File descriptor for the underlying filesystem object.
+     */
+    int fd;
+
+    /**
+     * Number of File objects open on the file.
+     */
+    int count;
+
+    /**
+     * Whether fd was opened with O_DIRECT.
+     */
+    bool direct_io;
+
+    /**
+     * Whether pages are written and read with a checksum, as the header says.
+     */
+    bool checksums;
+
+    /**
+     * Authoritative copy of the file header, shared by every File object for
+     * the file, and whether it differs from the header on disk.  Guarded by
+     * header_latch.  num_pages mirrors header.num_pages, so that page reads
+     * can check the page number without the latch.
+     */
+    FileHeader header;
+    bool header_dirty;
+    std::mutex header_latch;
+    std::atomic<PageId> num_pages;
+
+    /**
+     * Parts of the allocation map; part k covers pages [k, k + 1) times
+     * PAGES_PER_MAP.  Room for MAX_MAPS is reserved up front, so that readers
+     * may index it without a latch while parts are added; num_maps counts
+     * the parts they may use.  free_hint is no higher than the lowest free
+     * page.  Both are guarded by latch.
+     */
+    std::vector<std::unique_ptr<AllocationMap> > maps;
+    std::atomic<std::size_t> num_maps;
+    PageId free_hint;
+
+    /**
+     * Name of the file, for errors found while syncing.
+     */
+    std::string filename;
+
+    /**
+     * Durability and group commit window the file was opened with.
+     */
+    FileDurability durability;
+    unsigned group_commit_us;
+
+    /**
+     * Group commit state, guarded by sync_latch: the number of syncs asked
+     * for, how many of them a completed fdatasync covers, and whether a
+     * thread is running one.  sync_done wakes the threads waiting for it.
+     */
+    std::mutex sync_latch;
+    std::condition_variable sync_done;
+    std::uint64_t sync_requests;
+    std::uint64_t synced_requests;
+    bool syncing;
+
+    /**
+     * Number of fdatasync calls completed, for syncCount().
+     */
+    std::atomic<std::uint64_t> syncs;
+
+    /**
+     * Start of the address space reserved for the mapping, NULL if the file
+     * is not mapped, and the number of pages the reservation spans.
+     */
+    char* map_base;
+    PageId map_reserved_pages;
+
+    /**
+     * Number of leading pages of the file that are mapped.  Only grows, and
+     * only under latch; readers load it without a latch.
+     */
+    std::atomic<PageId> mapped_pages;
+
+    /**
+     * Page a sequential reader of the mapping would read next, and for how
+     * many reads it has been right.  Only hints: races merely skip a hint.
+     */
+    mutable std::atomic<PageId> next_mapped_read;
+    mutable std::atomic<unsigned> sequential_reads;
+
+    /**
+     * Serializes the operations that change the allocation map or the file
+     * header (allocatePage() and deletePage()) with each other and with
+     * writePage(), which checks the page is still allocated, so that they can
+     * be called from many threads.  Page reads need no latch: positional I/O
+     * shares no seek position.
+     */
+    std::mutex latch;
+  };
+
+  typedef std::map<std::string, std::shared_ptr<OpenFile> > OpenFileMap;
+
+  /**
+   * Opened files.
+   */
+  static OpenFileMap open_files_;
+
+  /**
+   * Guards open_files_ and the open counts.
+   */
+  static std::mutex open_files_latch_;
+
+  /**
+   * Nesting depth of the calling thread's SyncBatch objects, and the files
+   * written during the outermost one.
+   */
+  static thread_local int batch_depth_;
+  static thread_local std::vector<std::shared_ptr<OpenFile> > batch_files_;
 
   /**
    * Name of the file this object represents.
@@ -321,9 +1019,14 @@ class File {
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * State of the open file, shared with other File objects for it.
+   */
+  std::shared_ptr<OpenFile> open_;
+
+  /**
+   * File descriptor for underlying filesystem object, cached from open_.
    */
-  std::shared_ptr<std::fstream> stream_;
+  int fd_;
 
   friend class FileIterator;
   friend class FileTest;
@@ -39,8 +39,7 @@ class FileIterator {
   FileIterator(File* file)
       : file_(file) {
     assert(file_ != NULL);
-    const FileHeader& header = file_->readHeader();
-    current_page_number_ = header.first_used_page;
+    current_page_number_ = file_->nextUsedPage(1);
   }
 
   /**
@@ -56,12 +55,12 @@ class FileIterator {
   }
 
   /**
-   * Advances the iterator to the next page in the file.
+   * Advances the iterator to the next page in the file, found in the
+   * allocation map without reading the file.
    */
 	inline FileIterator& operator++() {
     assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    current_page_number_ = file_->nextUsedPage(current_page_number_ + 1);
 
 		return *this;
 	}
@@ -72,8 +71,7 @@ class FileIterator {
 		FileIterator tmp = *this;   // copy ourselves
 
     assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    current_page_number_ = file_->nextUsedPage(current_page_number_ + 1);
 
 		return tmp;
 	}
@@ -0,0 +1,325 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+int ioUringSetup(unsigned entries, struct io_uring_params* params) {
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+int ioUringEnter(int fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                      NULL, 0);
+}
+
+unsigned loadAcquire(const unsigned* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void storeRelease(unsigned* p, unsigned v) {
+  __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+unsigned* ringField(void* ring, std::uint32_t offset) {
+  return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+}
+
+}
+
+IoEngine* IoEngine::create(const IoEngineType type, const unsigned depth) {
+  if (type != THREAD_POOL_ENGINE) {
+    UringEngine* uring = new UringEngine(depth);
+    if (uring->ok()) {
+      return uring;
+    }
+    delete uring;
+    if (type == URING_ENGINE) {
+      return NULL;
+    }
+  }
+  return new ThreadPoolEngine(depth);
+}
+
+UringEngine::UringEngine(const unsigned depth)
+    : ring_fd_(-1), depth_(0), in_flight_(0), reaping_(false),
+      sq_ring_(MAP_FAILED), sq_ring_size_(0), sqes_(MAP_FAILED), sqes_size_(0),
+      cq_ring_(MAP_FAILED), cq_ring_size_(0) {
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  const int fd = ioUringSetup(std::max(depth, 1u), &params);
+  if (fd < 0) {
+    return;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+
+  sq_ring_ = mmap(NULL, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap
+                 ? sq_ring_
+                 : mmap(NULL, cq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+    close(fd);
+    return;
+  }
+
+  sq_head_ = ringField(sq_ring_, params.sq_off.head);
+  sq_tail_ = ringField(sq_ring_, params.sq_off.tail);
+  sq_mask_ = ringField(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = ringField(sq_ring_, params.sq_off.array);
+  cq_head_ = ringField(cq_ring_, params.cq_off.head);
+  cq_tail_ = ringField(cq_ring_, params.cq_off.tail);
+  cq_mask_ = ringField(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = static_cast<char*>(cq_ring_) + params.cq_off.cqes;
+
+  // The completion queue is at least as large as the submission queue, so
+  // capping what is in flight at the latter means completions never overflow
+  depth_ = std::min(std::max(depth, 1u), params.sq_entries);
+  ring_fd_ = fd;
+}
+
+UringEngine::~UringEngine() {
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != MAP_FAILED) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+}
+
+void UringEngine::enterSubmit(unsigned count) {
+  int error = 0;
+  while (count > 0) {
+    const int submitted = ioUringEnter(ring_fd_, count, 0, 0);
+    if (submitted > 0) {
+      count -= submitted;
+      continue;
+    }
+    error = submitted == 0 ? EIO : errno;
+    if (error != EINTR && error != EAGAIN && error != EBUSY) {
+      break;
+    }
+  }
+  if (count == 0) {
+    return;
+  }
+
+  // Without SQPOLL the kernel only takes entries inside io_uring_enter, so
+  // under the latch the ones past its head are still ours to take back
+  const unsigned head = loadAcquire(sq_head_);
+  const unsigned tail = *sq_tail_;
+  for (unsigned i = head; i != tail; ++i) {
+    const struct io_uring_sqe* sqe = static_cast<const struct io_uring_sqe*>(
+        sqes_) + sq_array_[i & *sq_mask_];
+    IoRequest* request = reinterpret_cast<IoRequest*>(sqe->user_data);
+    request->result = -error;
+    request->done = true;
+    --in_flight_;
+  }
+  storeRelease(sq_tail_, head);
+  completed_.notify_all();
+}
+
+void UringEngine::submit(IoRequest* const* requests, const std::size_t count) {
+  std::unique_lock<std::mutex> lock(latch_);
+  unsigned queued = 0;
+
+  for (std::size_t i = 0; i < count; ++i) {
+    // Queued entries must reach the kernel before we wait for completions
+    while (in_flight_ >= depth_) {
+      enterSubmit(queued);
+      queued = 0;
+      // Entries the kernel refused are no longer in flight
+      if (in_flight_ < depth_) {
+        break;
+      }
+      if (!reaping_) {
+        waitForCompletion(lock);
+      } else {
+        completed_.wait(lock);
+      }
+    }
+
+    IoRequest& request = *requests[i];
+    request.done = false;
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & *sq_mask_;
+    struct io_uring_sqe* sqe =
+        static_cast<struct io_uring_sqe*>(sqes_) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode =
+        request.op == IoRequest::READ ? IORING_OP_READV : IORING_OP_WRITEV;
+    sqe->fd = request.fd;
+    sqe->off = request.offset;
+    sqe->addr = reinterpret_cast<std::uint64_t>(request.buffers());
+    sqe->len = request.iov_count;
+    sqe->user_data = reinterpret_cast<std::uint64_t>(&request);
+    sq_array_[index] = index;
+    storeRelease(sq_tail_, tail + 1);
+    ++in_flight_;
+    ++queued;
+  }
+  enterSubmit(queued);
+}
+
+void UringEngine::wait(IoRequest& request) {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (!request.done) {
+    if (!reaping_) {
+      waitForCompletion(lock);
+    } else {
+      completed_.wait(lock);
+    }
+  }
+}
+
+unsigned UringEngine::reapLocked() {
+  unsigned head = *cq_head_;
+  const unsigned tail = loadAcquire(cq_tail_);
+  unsigned reaped = 0;
+  while (head != tail) {
+    const struct io_uring_cqe* cqe =
+        static_cast<const struct io_uring_cqe*>(cqes_) + (head & *cq_mask_);
+    IoRequest* request = reinterpret_cast<IoRequest*>(cqe->user_data);
+    request->result = cqe->res;
+    request->done = true;
+    --in_flight_;
+    ++head;
+    ++reaped;
+  }
+  storeRelease(cq_head_, head);
+  return reaped;
+}
+
+void UringEngine::waitForCompletion(std::unique_lock<std::mutex>& lock) {
+  reaping_ = true;
+  if (reapLocked() == 0) {
+    lock.unlock();
+    while (ioUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+           errno == EINTR) {
+    }
+    lock.lock();
+    reapLocked();
+  }
+  reaping_ = false;
+  completed_.notify_all();
+}
+
+ThreadPoolEngine::ThreadPoolEngine(const unsigned depth)
+    : head_(NULL), tail_(NULL), stop_(false) {
+  for (unsigned i = 0; i < std::max(depth, 1u); ++i) {
+    threads_.push_back(std::thread(&ThreadPoolEngine::work, this));
+  }
+}
+
+ThreadPoolEngine::~ThreadPoolEngine() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    stop_ = true;
+  }
+  pending_.notify_all();
+  for (std::size_t i = 0; i < threads_.size(); ++i) {
+    threads_[i].join();
+  }
+}
+
+void ThreadPoolEngine::submit(IoRequest* const* requests,
+                              const std::size_t count) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    for (std::size_t i = 0; i < count; ++i) {
+      IoRequest* request = requests[i];
+      request->done = false;
+      request->next_ = NULL;
+      if (tail_) {
+        tail_->next_ = request;
+      } else {
+        head_ = request;
+      }
+      tail_ = request;
+    }
+  }
+  if (count == 1) {
+    pending_.notify_one();
+  } else {
+    pending_.notify_all();
+  }
+}
+
+void ThreadPoolEngine::wait(IoRequest& request) {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (!request.done) {
+    completed_.wait(lock);
+  }
+}
+
+void ThreadPoolEngine::work() {
+  std::unique_lock<std::mutex> lock(latch_);
+  for (;;) {
+    while (!stop_ && head_ == NULL) {
+      pending_.wait(lock);
+    }
+    if (head_ == NULL) {
+      return;
+    }
+    IoRequest* request = head_;
+    head_ = request->next_;
+    if (head_ == NULL) {
+      tail_ = NULL;
+    }
+    lock.unlock();
+
+    ssize_t result;
+    int error = 0;
+    const struct iovec* buffers = request->buffers();
+    do {
+      result = request->op == IoRequest::READ
+                   ? preadv(request->fd, buffers, request->iov_count,
+                            request->offset)
+                   : pwritev(request->fd, buffers, request->iov_count,
+                             request->offset);
+      error = result < 0 ? errno : 0;
+    } while (error == EINTR);
+
+    lock.lock();
+    request->result = error != 0 ? -error : result;
+    request->done = true;
+    completed_.notify_all();
+  }
+}
+
+}
@@ -0,0 +1,288 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief One positional read or write of one or more buffers, owned by the caller.
+ *
+ * The caller fills in the operation (File::prepareRead() and
+ * File::prepareWrite() do that for pages), hands the request to an IoEngine and
+ * keeps it alive until IoEngine::wait() has returned for it.  The engine never
+ * allocates per request; it links pending requests through next_.
+ */
+struct IoRequest {
+  /**
+   * Kinds of operation.
+   */
+  enum Op { READ, WRITE };
+
+  /**
+   * Operation to perform.
+   */
+  Op op;
+
+  /**
+   * File descriptor to read from or write to.
+   */
+  int fd;
+
+  /**
+   * Offset in the file of the first byte.
+   */
+  off_t offset;
+
+  /**
+   * Buffers, filled or written in order; iov_count of them are used.
+   */
+  struct iovec iov[2];
+  int iov_count;
+
+  /**
+   * When not NULL, the iov_count buffers used instead of iov, in an array the
+   * caller keeps alive until the request is complete.
+   */
+  struct iovec* iov_array;
+
+  /**
+   * Number of bytes transferred, or minus the errno, once complete.
+   */
+  ssize_t result;
+
+  /**
+   * Set by the engine once the request is complete.
+   */
+  bool done;
+
+  /**
+   * Links pending requests inside the engine.
+   */
+  IoRequest* next_;
+
+  /**
+   * Returns the buffers the request fills or writes.
+   */
+  const struct iovec* buffers() const {
+    return iov_array != NULL ? iov_array : iov;
+  }
+
+  /**
+   * Returns the total number of bytes the request covers.
+   */
+  std::size_t length() const {
+    const struct iovec* vectors = buffers();
+    std::size_t total = 0;
+    for (int i = 0; i < iov_count; ++i) {
+      total += vectors[i].iov_len;
+    }
+    return total;
+  }
+};
+
+/**
+ * @brief Kinds of IoEngine.
+ */
+enum IoEngineType {
+  /**
+   * io_uring if the kernel provides it, a thread pool otherwise.
+   */
+  AUTO_ENGINE,
+
+  /**
+   * io_uring; creating the engine fails if the kernel does not provide it.
+   */
+  URING_ENGINE,
+
+  /**
+   * Pool of threads issuing blocking preadv/pwritev calls.
+   */
+  THREAD_POOL_ENGINE
+};
+
+/**
+ * @brief Keeps many page reads and writes in flight at once.
+ *
+ * submit() queues requests without waiting for them and wait() blocks until a
+ * given request is complete, so a caller can put a whole batch in flight and
+ * then collect it.  Both may be called from any number of threads; a thread
+ * waiting for its request may complete other threads' requests on the way.
+ */
+class IoEngine {
+ public:
+  /**
+   * Creates an engine.
+   *
+   * @param type    Kind of engine.
+   * @param depth   Number of requests the engine keeps in flight at most;
+   *                further submissions wait for earlier ones to complete.
+   * @return  New engine, owned by the caller, or NULL if the kind of engine
+   *          asked for is not available.
+   */
+  static IoEngine* create(const IoEngineType type, const unsigned depth);
+
+  /**
+   * Destroys the engine.  Every submitted request must have been waited for.
+   */
+  virtual ~IoEngine() {}
+
+  /**
+   * Starts requests.  Returns once all of them are queued, which may mean
+   * waiting for the engine to drain if more than its depth is in flight.
+   *
+   * @param requests  Requests to start.
+   * @param count     Number of requests.
+   */
+  virtual void submit(IoRequest* const* requests, const std::size_t count) = 0;
+
+  /**
+   * Blocks until a submitted request is complete.
+   *
+   * @param request   Request to wait for.
+   */
+  virtual void wait(IoRequest& request) = 0;
+
+  /**
+   * Starts a request and waits for it.
+   */
+  void run(IoRequest& request) {
+    IoRequest* requests[1] = {&request};
+    submit(requests, 1);
+    wait(request);
+  }
+
+  /**
+   * Returns the name of the engine, for reports.
+   */
+  virtual const char* name() const = 0;
+};
+
+/**
+ * @brief IoEngine on io_uring, driven through the raw system calls.
+ *
+ * Requests become READV/WRITEV submission queue entries whose user data is
+ * the request itself.  Threads waiting for a request take turns at reaping the
+ * completion queue: one thread at a time waits in the kernel and marks what it
+ * reaps as done; the others wait on a condition variable.
+ */
+class UringEngine : public IoEngine {
+ public:
+  /**
+   * Sets up a ring with room for depth requests.  Check ok() afterwards.
+   */
+  explicit UringEngine(const unsigned depth);
+
+  virtual ~UringEngine();
+
+  /**
+   * Returns false if the kernel refused to set up the ring.
+   */
+  bool ok() const { return ring_fd_ >= 0; }
+
+  virtual void submit(IoRequest* const* requests, const std::size_t count);
+  virtual void wait(IoRequest& request);
+  virtual const char* name() const { return "io_uring"; }
+
+ private:
+  /**
+   * Hands count queued submission queue entries to the kernel.  Called with
+   * latch_ held.  If the kernel fails the call, or takes none of them, the
+   * entries it has not taken are withdrawn and their requests complete with
+   * the negated errno (EIO if it took none without an error).
+   */
+  void enterSubmit(unsigned count);
+
+  /**
+   * Moves completions from the completion queue to their requests.  Called
+   * with latch_ held.
+   *
+   * @return  Number of completions reaped.
+   */
+  unsigned reapLocked();
+
+  /**
+   * Waits in the kernel for at least one completion, then reaps.  Called with
+   * latch_ held through lock; drops it while in the kernel.
+   */
+  void waitForCompletion(std::unique_lock<std::mutex>& lock);
+
+  int ring_fd_;
+  unsigned depth_;
+  unsigned in_flight_;
+  bool reaping_;
+  std::mutex latch_;
+  std::condition_variable completed_;
+
+  /**
+   * Mapped submission queue ring, its entries and the completion queue ring.
+   */
+  void* sq_ring_;
+  std::size_t sq_ring_size_;
+  void* sqes_;
+  std::size_t sqes_size_;
+  void* cq_ring_;
+  std::size_t cq_ring_size_;
+
+  /**
+   * Pointers into the mapped rings.
+   */
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  void* cqes_;
+};
+
+/**
+ * @brief IoEngine on a pool of threads issuing blocking preadv/pwritev calls.
+ *
+ * Works everywhere.  The number of requests in flight is the number of
+ * threads, so depth is both the queue depth and the size of the pool.
+ */
+class ThreadPoolEngine : public IoEngine {
+ public:
+  /**
+   * Starts depth threads (at least one).
+   */
+  explicit ThreadPoolEngine(const unsigned depth);
+
+  virtual ~ThreadPoolEngine();
+
+  virtual void submit(IoRequest* const* requests, const std::size_t count);
+  virtual void wait(IoRequest& request);
+  virtual const char* name() const { return "thread pool"; }
+
+ private:
+  /**
+   * Body of the pool threads.
+   */
+  void work();
+
+  std::mutex latch_;
+  std::condition_variable pending_;
+  std::condition_variable completed_;
+  IoRequest* head_;
+  IoRequest* tail_;
+  bool stop_;
+  std::vector<std::thread> threads_;
+};
+
+}
@@ -0,0 +1,413 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "log_manager.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "crc32c.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_error_exception.h"
+#include "exceptions/page_checksum_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+// Reads up to length bytes at offset, fewer only at the end of the file.
+std::size_t preadFully(const int fd, char* buffer, const std::size_t length,
+                       const off_t offset, const std::string& filename) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t result = pread(fd, buffer + done, length - done,
+                                 offset + done);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoErrorException(filename, Page::INVALID_NUMBER, errno);
+    }
+    if (result == 0) {
+      break;
+    }
+    done += result;
+  }
+  return done;
+}
+
+void pwriteFully(const int fd, const char* buffer, const std::size_t length,
+                 const off_t offset, const std::string& filename) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t result = pwrite(fd, buffer + done, length - done,
+                                  offset + done);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IoErrorException(filename, Page::INVALID_NUMBER, errno);
+    }
+    done += result;
+  }
+}
+
+}
+
+LogManager::LogManager(const std::string& filename, const LogOptions& options)
+    : filename_(filename),
+      fd_(-1),
+      options_(options),
+      start_(HEADER_SIZE),
+      buffer_lsn_(0),
+      end_lsn_(0),
+      zeroed_end_(0),
+      flushed_lsn_(0),
+      flushing_(false),
+      syncs_(0) {
+  fd_ = ::open(filename_.c_str(), O_RDWR | O_CREAT, 0666);
+  if (fd_ < 0) {
+    throw IoErrorException(filename_, Page::INVALID_NUMBER, errno);
+  }
+  try {
+    struct stat status;
+    if (fstat(fd_, &status) != 0) {
+      throw IoErrorException(filename_, Page::INVALID_NUMBER, errno);
+    }
+    LogHeader header;
+    if (status.st_size == 0) {
+      std::vector<char> block(HEADER_SIZE, 0);
+      header.magic = MAGIC;
+      header.reserved = 0;
+      header.start = HEADER_SIZE;
+      std::memcpy(&block[0], &header, sizeof(header));
+      pwriteFully(fd_, &block[0], block.size(), 0, filename_);
+      if (fdatasync(fd_) != 0) {
+        throw IoErrorException(filename_, Page::INVALID_NUMBER, errno);
+      }
+    } else if (preadFully(fd_, reinterpret_cast<char*>(&header),
+                          sizeof(header), 0, filename_) != sizeof(header) ||
+               header.magic != MAGIC || header.start < HEADER_SIZE) {
+      throw IoErrorException(filename_, Page::INVALID_NUMBER, EINVAL);
+    }
+    start_ = header.start;
+
+    // Cut off whatever follows the last valid record
+    end_lsn_ = scan(start_, [](const RecordHeader&, const char*,
+                               const char*) {});
+    if (ftruncate(fd_, end_lsn_) != 0) {
+      throw IoErrorException(filename_, Page::INVALID_NUMBER, errno);
+    }
+  } catch (...) {
+    ::close(fd_);
+    throw;
+  }
+  buffer_lsn_ = end_lsn_.load();
+  flushed_lsn_ = end_lsn_.load();
+  zeroed_end_ = end_lsn_.load();
+  buffer_.reserve(options_.buffer_bytes);
+  spare_.reserve(options_.buffer_bytes);
+}
+
+LogManager::~LogManager() {
+  try {
+    flush(endLsn());
+  } catch (IoErrorException&) {
+    // Nothing to report to; the records lost were never committed
+  }
+  ::close(fd_);
+}
+
+Lsn LogManager::logPage(const File& file, Page& page) {
+  return append(PAGE_IMAGE, &file, &page, 0, Page::SIZE);
+}
+
+Lsn LogManager::logUpdate(const File& file, Page& page,
+                          const std::size_t offset, const std::size_t length) {
+  return append(PAGE_UPDATE, &file, &page, offset, length);
+}
+
+Lsn LogManager::commit() {
+  const Lsn lsn = append(COMMIT, NULL, NULL, 0, 0);
+  flush(lsn);
+  return lsn;
+}
+
+Lsn LogManager::startLsn() const {
+  std::lock_guard<std::mutex> guard(latch_);
+  return start_;
+}
+
+void LogManager::checkpoint(const Lsn redo_start) {
+  std::lock_guard<std::mutex> guard(checkpoint_latch_);
+  const Lsn old_start = startLsn();
+  if (redo_start <= old_start) {
+    return;
+  }
+  // The header must never point past the end of the log on disk
+  flush(redo_start);
+
+  LogHeader header;
+  header.magic = MAGIC;
+  header.reserved = 0;
+  header.start = redo_start;
+  pwriteFully(fd_, reinterpret_cast<const char*>(&header), sizeof(header), 0,
+              filename_);
+  if (fdatasync(fd_) != 0) {
+    throw IoErrorException(filename_, Page::INVALID_NUMBER, errno);
+  }
+  ++syncs_;
+  {
+    std::lock_guard<std::mutex> latch_guard(latch_);
+    start_ = redo_start;
+  }
+
+  // Nothing reads the records before the start again.  Offsets stay as they
+  // are, so the file keeps its size; where holes cannot be punched the blocks
+  // just stay allocated.
+  const off_t from = (old_start + HEADER_SIZE - 1) / HEADER_SIZE * HEADER_SIZE;
+  const off_t to = redo_start / HEADER_SIZE * HEADER_SIZE;
+  if (to > from) {
+    fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, from, to - from);
+  }
+}
+
+Lsn LogManager::append(const RecordType type, const File* file, Page* page,
+                       const std::size_t offset, const std::size_t length) {
+  assert(offset + length <= Page::SIZE);
+  const std::string empty;
+  const std::string& name = file != NULL ? file->filename() : empty;
+  assert(name.size() <= 0xffff);
+
+  RecordHeader header;
+  header.checksum = 0;
+  header.length = sizeof(header) + name.size() + length;
+  header.type = type;
+  header.name_length = name.size();
+  header.page_number =
+      page != NULL ? page->page_number() : Page::INVALID_NUMBER;
+  header.offset = offset;
+  header.data_length = length;
+
+  Lsn lsn;
+  bool full;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    lsn = end_lsn_ + header.length;
+    header.lsn = lsn;
+    // Set first, so that an image or an update of the header carries it
+    if (page != NULL) {
+      page->set_lsn(lsn);
+    }
+    const std::size_t at = buffer_.size();
+    buffer_.resize(at + header.length);
+    char* record = &buffer_[at];
+    std::memcpy(record, &header, sizeof(header));
+    std::memcpy(record + sizeof(header), name.data(), name.size());
+    if (length > 0) {
+      std::memcpy(record + sizeof(header) + name.size(),
+                  reinterpret_cast<const char*>(page) + offset, length);
+    }
+    header.checksum = crc32c(0, record + sizeof(header.checksum),
+                             header.length - sizeof(header.checksum));
+    std::memcpy(record, &header.checksum, sizeof(header.checksum));
+    end_lsn_ = lsn;
+    full = buffer_.size() >= options_.buffer_bytes;
+  }
+  if (full) {
+    flush(lsn);
+  }
+  return lsn;
+}
+
+// One thread writes and syncs at a time.  It takes everything appended so far,
+// so the threads that wait meanwhile usually find their records durable when
+// it is done: they share its fdatasync instead of each making one.
+void LogManager::flush(const Lsn lsn) {
+  if (flushed_lsn_.load() >= lsn) {
+    return;
+  }
+  std::unique_lock<std::mutex> guard(flush_latch_);
+  while (flushed_lsn_.load() < lsn) {
+    if (flushing_) {
+      flush_done_.wait(guard);
+      continue;
+    }
+    flushing_ = true;
+    guard.unlock();
+
+    if (options_.group_commit_us > 0) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(options_.group_commit_us));
+    }
+    Lsn at;
+    Lsn end;
+    {
+      std::lock_guard<std::mutex> latch_guard(latch_);
+      spare_.clear();
+      spare_.swap(buffer_);
+      at = buffer_lsn_;
+      end = end_lsn_;
+      buffer_lsn_ = end_lsn_;
+    }
+    try {
+      zeroAhead(end);
+      if (!spare_.empty()) {
+        pwriteFully(fd_, &spare_[0], spare_.size(), at, filename_);
+      }
+      if (fdatasync(fd_) != 0) {
+        throw IoErrorException(filename_, Page::INVALID_NUMBER, errno);
+      }
+      ++syncs_;
+    } catch (...) {
+      // Put the records back in front of those appended since
+      {
+        std::lock_guard<std::mutex> latch_guard(latch_);
+        spare_.insert(spare_.end(), buffer_.begin(), buffer_.end());
+        spare_.swap(buffer_);
+        buffer_lsn_ = at;
+      }
+      guard.lock();
+      flushing_ = false;
+      flush_done_.notify_all();
+      throw;
+    }
+
+    guard.lock();
+    flushed_lsn_ = end;
+    flushing_ = false;
+    flush_done_.notify_all();
+  }
+}
+
+void LogManager::zeroAhead(const Lsn end) {
+  if (end <= zeroed_end_) {
+    return;
+  }
+  const Lsn target =
+      (end + ZERO_AHEAD_BYTES - 1) / ZERO_AHEAD_BYTES * ZERO_AHEAD_BYTES;
+  const std::vector<char> zeros(1 << 20, 0);
+  while (zeroed_end_ < target) {
+    const std::size_t length =
+        std::min<Lsn>(zeros.size(), target - zeroed_end_);
+    pwriteFully(fd_, &zeros[0], length, zeroed_end_, filename_);
+    zeroed_end_ += length;
+  }
+}
+
+Lsn LogManager::scan(
+    const Lsn start,
+    const std::function<void(const RecordHeader&, const char*, const char*)>&
+        visit) const {
+  std::vector<char> chunk(1 << 20);
+  Lsn chunk_start = start;
+  std::size_t chunk_length = 0;
+  Lsn position = start;
+  while (true) {
+    // Refill the chunk from position unless it holds a whole header, then a
+    // whole record
+    RecordHeader header;
+    for (int part = 0; part < 2; ++part) {
+      const std::size_t needed = part == 0 ? sizeof(header) : header.length;
+      if (position + needed > chunk_start + chunk_length) {
+        if (needed > chunk.size()) {
+          chunk.resize(needed);
+        }
+        chunk_start = position;
+        chunk_length = preadFully(fd_, &chunk[0], chunk.size(), chunk_start,
+                                  filename_);
+        if (chunk_length < needed) {
+          return position;
+        }
+      }
+      if (part == 0) {
+        std::memcpy(&header, &chunk[position - chunk_start], sizeof(header));
+        if (header.length != sizeof(header) + header.name_length +
+                                 header.data_length ||
+            header.data_length > Page::SIZE ||
+            header.lsn != position + header.length) {
+          return position;
+        }
+      }
+    }
+    const char* record = &chunk[position - chunk_start];
+    if (crc32c(0, record + sizeof(header.checksum),
+               header.length - sizeof(header.checksum)) != header.checksum) {
+      return position;
+    }
+    const char* name = record + sizeof(header);
+    visit(header, name, name + header.name_length);
+    position = header.lsn;
+  }
+}
+
+LogRecoveryStats LogManager::recover() {
+  LogRecoveryStats stats = {0, 0, 0, 0};
+  std::map<std::string, File> files;
+  flush(endLsn());
+  stats.end = scan(startLsn(), [this, &files, &stats](
+                                   const RecordHeader& record,
+                                   const char* name, const char* data) {
+    ++stats.records;
+    if (record.type == PAGE_IMAGE || record.type == PAGE_UPDATE) {
+      redo(record, std::string(name, record.name_length), data, files, stats);
+    }
+  });
+  for (std::map<std::string, File>::iterator it = files.begin();
+       it != files.end(); ++it) {
+    it->second.sync();
+  }
+  return stats;
+}
+
+void LogManager::redo(const RecordHeader& record, const std::string& name,
+                      const char* data, std::map<std::string, File>& files,
+                      LogRecoveryStats& stats) {
+  std::map<std::string, File>::iterator it = files.find(name);
+  if (it == files.end()) {
+    try {
+      it = files.insert(std::make_pair(name, File::open(name))).first;
+    } catch (FileNotFoundException&) {
+      ++stats.skipped;
+      return;
+    }
+  }
+  File& file = it->second;
+
+  Page page;
+  try {
+    file.readPage(record.page_number, page);
+  } catch (InvalidPageException&) {
+    ++stats.skipped;
+    return;
+  } catch (PageChecksumException&) {
+    // Torn by the crash; only a whole image can replace it
+    if (record.type != PAGE_IMAGE) {
+      throw;
+    }
+    page.set_lsn(0);
+  }
+  if (page.lsn() >= record.lsn) {
+    return;
+  }
+
+  char* bytes = reinterpret_cast<char*>(&page);
+  std::memcpy(bytes + record.offset, data, record.data_length);
+  page.set_lsn(record.lsn);
+  file.writePage(page);
+  ++stats.redone;
+}
+
+}
@@ -0,0 +1,397 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Options a LogManager is opened with.
+ */
+struct LogOptions {
+  /**
+   * Bytes of records kept in memory; an append that fills the buffer flushes
+   * it.
+   */
+  std::size_t buffer_bytes;
+
+  /**
+   * How long the first flush to start waits for more commits to join its
+   * fdatasync, in microseconds.  Even with 0, the commits that arrive while a
+   * flush runs share the next one.
+   */
+  unsigned group_commit_us;
+
+  LogOptions() : buffer_bytes(1 << 20), group_commit_us(0) {}
+};
+
+/**
+ * @brief What LogManager::recover() did.
+ */
+struct LogRecoveryStats {
+  /**
+   * Valid records read from the log.
+   */
+  std::uint64_t records;
+
+  /**
+   * Page records applied because the page on disk was older.
+   */
+  std::uint64_t redone;
+
+  /**
+   * Page records of files or pages that no longer exist.
+   */
+  std::uint64_t skipped;
+
+  /**
+   * LSN recovery stopped at, where the log now ends.
+   */
+  Lsn end;
+};
+
+/**
+ * @brief Append-only redo log of page changes (write-ahead logging).
+ *
+ * A change to a page is logged before the page is written back: logPage()
+ * or logUpdate() appends a redo record of the change and sets the page LSN
+ * to the LSN of the record.  A BufMgr given the log in BufMgrOptions::log
+ * flushes the log up to a page's LSN before writing the page back, so the
+ * file never holds a change the log could lose.  Pages therefore need not be
+ * written at commit: commit() appends a commit record and makes the log
+ * durable up to it, with one fdatasync shared by every commit waiting at
+ * the time.  After a crash, recover() reapplies every logged change a page
+ * on disk is missing.
+ *
+ * Records are buffered in memory and appended to the log file by flush().
+ * Each record carries a CRC-32C, so recovery stops at the first torn or
+ * stale record.  The LSN of a record is the log offset just past it.
+ * checkpoint() moves the start of the log forward once the pages changed
+ * before the new start are durable (BufMgr::checkpoint()), which bounds how
+ * much recovery reads.
+ *
+ * Allocating and deleting pages is not logged: File makes those durable
+ * according to its FileDurability.
+ */
+class LogManager {
+ public:
+  /**
+   * Kinds of log record.
+   */
+  enum RecordType {
+    /**
+     * The whole page after the change.
+     */
+    PAGE_IMAGE = 1,
+
+    /**
+     * A range of bytes of the page after the change.
+     */
+    PAGE_UPDATE = 2,
+
+    /**
+     * End of a transaction; carries no page.
+     */
+    COMMIT = 3
+  };
+
+  /**
+   * Bytes at the start of the log file holding its header.
+   */
+  static const std::size_t HEADER_SIZE = 4096;
+
+  /**
+   * Value of the first word of a log file.
+   */
+  static const std::uint32_t MAGIC = 0x4c4f4731;
+
+  /**
+   * Bytes of zeros written ahead of the log at a time.
+   */
+  static const std::size_t ZERO_AHEAD_BYTES = 4 << 20;
+
+  /**
+   * Opens the log file, creating it if it does not exist.  The log ends at
+   * its last valid record; a torn tail left by a crash is cut off.
+   *
+   * @param filename  Name of the log file.
+   * @param options   Buffering and group commit.
+   * @throws  IoErrorException  If the log cannot be opened or read, or the
+   *                            file is not a log.
+   */
+  explicit LogManager(const std::string& filename,
+                      const LogOptions& options = LogOptions());
+
+  /**
+   * Flushes the records still buffered and closes the log.
+   */
+  ~LogManager();
+
+  LogManager(const LogManager&) = delete;
+  LogManager& operator=(const LogManager&) = delete;
+
+  /**
+   * Logs the whole of page, a page of file, as it is now, and sets its LSN.
+   * The caller keeps the page from changing meanwhile, e.g. by holding it
+   * pinned.
+   *
+   * @param file  File the page belongs to.
+   * @param page  Page changed.
+   * @return  LSN of the record.
+   */
+  Lsn logPage(const File& file, Page& page);
+
+  /**
+   * Logs length bytes of page, a page of file, starting at byte offset of
+   * the page, as they are now, and sets the page LSN.
+   *
+   * @param file    File the page belongs to.
+   * @param page    Page changed.
+   * @param offset  Offset of the bytes changed in the page.
+   * @param length  Number of bytes changed.
+   * @return  LSN of the record.
+   */
+  Lsn logUpdate(const File& file, Page& page, const std::size_t offset,
+                const std::size_t length);
+
+  /**
+   * Appends a commit record and returns once the log is durable up to it.
+   *
+   * @return  LSN of the commit record.
+   * @throws  IoErrorException  If the log could not be written.
+   */
+  Lsn commit();
+
+  /**
+   * Makes the log durable up to lsn; returns at once if it already is.
+   *
+   * @param lsn   LSN to flush up to; at most endLsn().
+   * @throws  IoErrorException  If the log could not be written.
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Returns the LSN up to which the log is durable.
+   */
+  Lsn flushedLsn() const { return flushed_lsn_.load(); }
+
+  /**
+   * Returns the LSN of the last record appended.  Does not latch, so that
+   * BufMgr can read it on every pin.
+   */
+  Lsn endLsn() const { return end_lsn_.load(); }
+
+  /**
+   * Returns where recovery starts reading the log.
+   */
+  Lsn startLsn() const;
+
+  /**
+   * Moves the start of the log forward to redo_start, after a checkpoint has
+   * made every page change logged before it durable in its file.  Flushes
+   * the log up to redo_start, then writes and syncs the log header; the
+   * blocks before the new start are given back to the file system where it
+   * can punch holes.  Does nothing if the log already starts there or later.
+   *
+   * @param redo_start  LSN recovery is to start from; at most endLsn().
+   * @throws  IoErrorException  If the log could not be written.
+   */
+  void checkpoint(const Lsn redo_start);
+
+  /**
+   * Reapplies every logged change that the page on disk is missing (its LSN
+   * is older than the record's), then syncs the files changed.  Meant to run
+   * once, before the files are used, after a crash.  Files are opened by
+   * name; records of files or pages that no longer exist are skipped.
+   *
+   * @return  What recovery did.
+   * @throws  IoErrorException  If the log or a page could not be read or
+   *                            written.
+   * @throws  PageChecksumException  If a page torn by the crash has only a
+   *                                 PAGE_UPDATE record to redo, which cannot
+   *                                 repair it.
+   */
+  LogRecoveryStats recover();
+
+  /**
+   * Returns the number of fdatasync calls made on the log so far.
+   */
+  std::uint64_t syncs() const { return syncs_.load(); }
+
+  /**
+   * Returns the name of the log file.
+   */
+  const std::string& filename() const { return filename_; }
+
+ private:
+  /**
+   * Header of every log record, followed by name_length bytes of file name
+   * and data_length bytes of page data.
+   */
+  struct RecordHeader {
+    /**
+     * CRC-32C of the record after this field.
+     */
+    std::uint32_t checksum;
+
+    /**
+     * Bytes in the record, header included.
+     */
+    std::uint32_t length;
+
+    /**
+     * LSN of the record, so that stale bytes past the end of the log are
+     * not taken for records.
+     */
+    Lsn lsn;
+
+    /**
+     * A RecordType.
+     */
+    std::uint16_t type;
+
+    /**
+     * Bytes of file name following the header.
+     */
+    std::uint16_t name_length;
+
+    /**
+     * Page changed, and offset in it of the data.
+     */
+    PageId page_number;
+    std::uint32_t offset;
+
+    /**
+     * Bytes of page data following the file name.
+     */
+    std::uint32_t data_length;
+  };
+
+  /**
+   * Header of the log file, at offset 0.
+   */
+  struct LogHeader {
+    std::uint32_t magic;
+    std::uint32_t reserved;
+
+    /**
+     * Where the first record is.
+     */
+    Lsn start;
+  };
+
+  /**
+   * Appends a record and sets the LSN of page, if given, to it.  Flushes the
+   * buffer if the record fills it.
+   */
+  Lsn append(const RecordType type, const File* file, Page* page,
+             const std::size_t offset, const std::size_t length);
+
+  /**
+   * Writes zeros past the end of the log file up to at least end, a
+   * ZERO_AHEAD_BYTES step at a time.  Appending into blocks the file already
+   * has lets fdatasync skip the file size and extent updates; the zeros do
+   * not parse as a record.
+   */
+  void zeroAhead(const Lsn end);
+
+  /**
+   * Calls visit on every valid record from start on, in order, and returns
+   * the LSN past the last one.
+   */
+  Lsn scan(const Lsn start,
+           const std::function<void(const RecordHeader&, const char* name,
+                                    const char* data)>& visit) const;
+
+  /**
+   * Redoes one page record during recovery, opening its file into files if
+   * needed, and counts it in stats.
+   */
+  void redo(const RecordHeader& record, const std::string& name,
+            const char* data, std::map<std::string, File>& files,
+            LogRecoveryStats& stats);
+
+  /**
+   * Name of the log file and its descriptor.
+   */
+  const std::string filename_;
+  int fd_;
+
+  /**
+   * Options the log was opened with.
+   */
+  const LogOptions options_;
+
+  /**
+   * Where the first record is.  Guarded by latch_ once the log is open.
+   */
+  Lsn start_;
+
+  /**
+   * Records appended but not yet handed to the file, starting at LSN
+   * buffer_lsn_ (their offset in the file), and the LSN past the last one.
+   * Guarded by latch_; end_lsn_ is also read without it.
+   */
+  std::vector<char> buffer_;
+  Lsn buffer_lsn_;
+  std::atomic<Lsn> end_lsn_;
+  mutable std::mutex latch_;
+
+  /**
+   * Buffer the flushing thread swaps with buffer_, so that appends go on
+   * while it writes.  Used only by the thread that set flushing_.
+   */
+  std::vector<char> spare_;
+
+  /**
+   * End of the zeros written ahead of the log.  Used only by the thread that
+   * set flushing_.
+   */
+  Lsn zeroed_end_;
+
+  /**
+   * LSN up to which the log is durable.  Set while holding flush_latch_.
+   */
+  std::atomic<Lsn> flushed_lsn_;
+
+  /**
+   * One flush at a time: flushing_ is set while a thread writes and syncs
+   * the log, and flush_done_ wakes the threads waiting for it.  Guarded by
+   * flush_latch_, which is never held together with latch_.
+   */
+  bool flushing_;
+  std::mutex flush_latch_;
+  std::condition_variable flush_done_;
+
+  /**
+   * Serializes checkpoint(), which writes the log header.
+   */
+  std::mutex checkpoint_latch_;
+
+  /**
+   * Number of fdatasync calls made on the log.
+   */
+  std::atomic<std::uint64_t> syncs_;
+};
+
+}
@@ -0,0 +1,177 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "lruKPolicy.h"
+
+namespace badgerdb {
+
+LruKPolicy::LruKPolicy(const std::uint32_t bufs, const std::uint32_t kIn)
+	: accesses(bufs), k(kIn < 1 ? 1 : kIn), numBufs(bufs), now(0), history(bufs * k), refs(bufs), resident(bufs, false),
+	  keys(bufs), rankOf(bufs)
+{
+  for (std::uint32_t i = bufs; i > 0; i--)
+    freeFrames.push_back(i - 1);
+}
+
+void LruKPolicy::reference(const FrameId frame)
+{
+  std::uint64_t* times = &history[frame * k];
+  for (std::uint32_t i = k - 1; i > 0; i--)
+    times[i] = times[i - 1];
+  times[0] = ++now;
+  if (refs[frame] < k)
+    refs[frame]++;
+
+  ranks.erase(rankOf[frame]);
+  Rank rank = {refs[frame] < k ? 0 : times[k - 1], times[0], frame};
+  rankOf[frame] = rank;
+  ranks.insert(rank);
+}
+
+// A page hit several times since the last call gets as many references, up to K, all
+// at the time of the call; pages are taken in the order of their first hits
+void LruKPolicy::applyAccesses()
+{
+  accesses.replay([this](const FrameId frame, const std::uint32_t hits) {
+    if (frame < numBufs && resident[frame]) {
+      for (std::uint32_t i = 0; i < hits && i < k; i++)
+        reference(frame);
+    }
+  });
+}
+
+void LruKPolicy::unrank(const FrameId frame)
+{
+  ranks.erase(rankOf[frame]);
+  resident[frame] = false;
+}
+
+void LruKPolicy::retain(const FrameId frame)
+{
+  if (!retainedOrder.empty() && retainedOrder.size() >= numBufs) {
+    retained.erase(retainedOrder.back());
+    retainedOrder.pop_back();
+  }
+  const std::uint64_t* times = &history[frame * k];
+  retainedOrder.push_front(keys[frame]);
+  Retained& entry = retained[keys[frame]];
+  entry.times.assign(times, times + refs[frame]);
+  entry.pos = retainedOrder.begin();
+}
+
+void LruKPolicy::loaded(const FrameId frame, const File* file, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  PageKey key = {file, pageNo};
+  keys[frame] = key;
+  resident[frame] = true;
+
+  // Pick up the history the page had when it was last evicted
+  std::unordered_map<PageKey, Retained, PageKeyHash>::iterator it = retained.find(key);
+  if (it != retained.end()) {
+    std::copy(it->second.times.begin(), it->second.times.end(), history.begin() + frame * k);
+    refs[frame] = it->second.times.size();
+    retainedOrder.erase(it->second.pos);
+    retained.erase(it);
+  }
+  else {
+    refs[frame] = 0;
+  }
+
+  // Make sure the stale rank of the frame's previous page cannot match
+  rankOf[frame].frame = ~FrameId(0);
+  reference(frame);
+}
+
+void LruKPolicy::accessed(const FrameId frame)
+{
+  accesses.record(frame);
+}
+
+void LruKPolicy::freed(const FrameId frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  if (resident[frame]) {
+    unrank(frame);
+    freeFrames.push_back(frame);
+  }
+}
+
+// The new page starts without history, so it ranks among the pages referenced fewer
+// than K times whatever the previous page of the frame had earned
+void LruKPolicy::recycled(const FrameId frame, const File* file, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  if (!resident[frame])
+    return;
+  PageKey key = {file, pageNo};
+  keys[frame] = key;
+  refs[frame] = 0;
+  reference(frame);
+}
+
+bool LruKPolicy::victim(FrameReclaimer& reclaimer, const File* file, const PageId pageNo, FrameId& frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+
+  if (!freeFrames.empty() && reclaimer.reclaim(freeFrames.back())) {
+    frame = freeFrames.back();
+    freeFrames.pop_back();
+    return true;
+  }
+
+  for (std::set<Rank>::iterator it = ranks.begin(); it != ranks.end(); ++it) {
+    if (!reclaimer.reclaim(it->frame))
+      continue;
+
+    frame = it->frame;
+    unrank(frame);
+    retain(frame);
+    return true;
+  }
+  return false;
+}
+
+void LruKPolicy::upcoming(const std::size_t count, std::vector<FrameId>& frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  std::size_t listed = 0;
+  for (std::set<Rank>::iterator it = ranks.begin(); it != ranks.end() && listed < count; ++it, listed++)
+    frames.push_back(it->frame);
+}
+
+// The pages of dropped frames keep their history as evicted pages do, so that a page
+// the buffer manager moves to another frame picks it up again through loaded()
+void LruKPolicy::resize(const std::uint32_t frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  for (FrameId f = frames; f < numBufs; f++) {
+    if (resident[f]) {
+      unrank(f);
+      retain(f);
+    }
+  }
+  freeFrames.erase(std::remove_if(freeFrames.begin(), freeFrames.end(),
+      [frames](const FrameId f) { return f >= frames; }), freeFrames.end());
+  for (FrameId f = frames; f > numBufs; f--)
+    freeFrames.push_back(f - 1);
+  numBufs = frames;
+
+  while (retainedOrder.size() > numBufs) {
+    retained.erase(retainedOrder.back());
+    retainedOrder.pop_back();
+  }
+}
+
+}
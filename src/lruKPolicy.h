@@ -0,0 +1,170 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "bufPolicy.h"
+
+namespace badgerdb {
+
+/**
+* @brief LRU-K replacement (O'Neil, O'Neil and Weikum)
+*
+* Keeps the times of the last K references to every resident page and evicts the page
+* whose K-th most recent reference is oldest.  Pages referenced fewer than K times are
+* evicted first, least recently used first, so a page touched once by a scan goes before
+* a page that is hit over and over.  The reference history of evicted pages is retained
+* for as many pages as there are frames, so a page that comes back soon keeps its rank.
+*/
+class LruKPolicy : public BufPolicy
+{
+ private:
+	/**
+	 * Eviction order of a resident frame; smaller ranks are evicted first
+	 */
+  struct Rank {
+		/**
+		 * Time of the K-th most recent reference, 0 if there were fewer than K
+		 */
+    std::uint64_t kth;
+
+		/**
+		 * Time of the most recent reference
+		 */
+    std::uint64_t last;
+
+    FrameId frame;
+
+    bool operator<(const Rank& rhs) const {
+      if (kth != rhs.kth) return kth < rhs.kth;
+      if (last != rhs.last) return last < rhs.last;
+      return frame < rhs.frame;
+    }
+  };
+
+	/**
+	 * Hits not yet applied; record() needs no latch
+	 */
+  AccessLog accesses;
+
+	/**
+	 * Protects all the members below
+	 */
+  std::mutex latch;
+
+	/**
+	 * Number of references kept per page
+	 */
+  std::uint32_t k;
+
+	/**
+	 * Number of frames in the buffer pool; the arrays below may hold more
+	 */
+  std::uint32_t numBufs;
+
+	/**
+	 * Logical time, advanced on every reference
+	 */
+  std::uint64_t now;
+
+	/**
+	 * Reference times of each frame's page, k per frame, most recent first
+	 */
+  std::vector<std::uint64_t> history;
+
+	/**
+	 * Number of valid entries in each frame's history (at most k)
+	 */
+  std::vector<std::uint32_t> refs;
+
+	/**
+	 * True for frames holding a page
+	 */
+  std::vector<bool> resident;
+
+	/**
+	 * Page held by each resident frame
+	 */
+  std::vector<PageKey> keys;
+
+	/**
+	 * Rank of each resident frame, and all of them in eviction order
+	 */
+  std::vector<Rank> rankOf;
+  std::set<Rank> ranks;
+
+	/**
+	 * Frames holding no page
+	 */
+  std::vector<FrameId> freeFrames;
+
+	/**
+	 * Reference history of an evicted page
+	 */
+  struct Retained {
+    std::vector<std::uint64_t> times;
+
+		/**
+		 * Position of the page in retainedOrder
+		 */
+    std::list<PageKey>::iterator pos;
+  };
+
+	/**
+	 * Retained reference history of evicted pages, oldest eviction at the back of retainedOrder
+	 */
+  std::unordered_map<PageKey, Retained, PageKeyHash> retained;
+  std::list<PageKey> retainedOrder;
+
+	/**
+	 * Records a reference to the page in a resident frame and re-ranks it
+	 */
+  void reference(const FrameId frame);
+
+	/**
+	 * Applies the hits noted in accesses since the last call; called under the latch
+	 */
+  void applyAccesses();
+
+	/**
+	 * Removes a frame from the ranking
+	 */
+  void unrank(const FrameId frame);
+
+	/**
+	 * Retains the reference history of the page in a frame that is leaving the ranking,
+	 * forgetting the oldest retained page if there are as many as frames
+	 */
+  void retain(const FrameId frame);
+
+ public:
+	/**
+   * Constructor of LruKPolicy class
+	 *
+	 * @param bufs   	Number of frames in the buffer pool
+	 * @param kIn   	Number of references kept per page, at least 1
+	 */
+  LruKPolicy(const std::uint32_t bufs, const std::uint32_t kIn);
+
+  virtual void loaded(const FrameId frame, const File* file, const PageId pageNo);
+  virtual void accessed(const FrameId frame);
+  virtual void freed(const FrameId frame);
+  virtual void recycled(const FrameId frame, const File* file, const PageId pageNo);
+  virtual bool victim(FrameReclaimer& reclaimer, const File* file, const PageId pageNo, FrameId& frame);
+  virtual void upcoming(const std::size_t count, std::vector<FrameId>& frames);
+  virtual void resize(const std::uint32_t frames);
+  virtual const char* name() const { return "lru-k"; }
+};
+
+}
@@ -1,17 +1,42 @@
 #include <iostream>
+#include <atomic>
+#include <new>
 #include <stdlib.h>
 //#include <stdio.h>
 #include <cstring>
+#include <cstdint>
 #include <memory>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include "page.h"
 #include "buffer.h"
+#include "crc32c.h"
+#include "bufHashTbl.h"
+#include "bufProbeTbl.h"
+#include "arcPolicy.h"
+#include "clockPolicy.h"
+#include "lruKPolicy.h"
+#include "io_engine.h"
+#include "log_manager.h"
+#include "numa.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
+#include "exceptions/file_format_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/invalid_record_exception.h"
+#include "exceptions/page_checksum_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/hash_not_found_exception.h"
+#include "exceptions/io_error_exception.h"
 
 #define PRINT_ERROR(str) \
 { \
@@ -30,12 +55,54 @@ char tmpbuf[100];
 BufMgr* bufMgr;
 File *file1ptr, *file2ptr, *file3ptr, *file4ptr, *file5ptr;
 
+//Every heap allocation of the program is counted, so tests can check that a code path
+//makes none
+std::atomic<long> heapAllocations(0);
+
+void* operator new(std::size_t size)
+{
+	heapAllocations++;
+	void* block = malloc(size > 0 ? size : 1);
+	if (!block)
+		throw std::bad_alloc();
+	return block;
+}
+
+void operator delete(void* block) noexcept
+{
+	free(block);
+}
+
 void test1();
 void test2();
 void test3();
 void test4();
 void test5();
 void test6();
+void test7();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
 void testBufMgr();
 
 int main() 
@@ -75,8 +142,10 @@ int main()
          iter != new_file.end();
          ++iter) {
       // Iterate through all records on the page.
-      for (PageIterator page_iter = (*iter).begin();
-           page_iter != (*iter).end();
+      // Keep a copy of the page alive while its records are iterated.
+      Page curr_page = *iter;
+      for (PageIterator page_iter = curr_page.begin();
+           page_iter != curr_page.end();
            ++page_iter) {
         std::cout << "Found record: " << *page_iter
             << " on page " << (*iter).page_number() << "\n";
@@ -146,6 +215,30 @@ void testBufMgr()
 	test4();
 	test5();
 	test6();
+	test7();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
 
 	//Close files before deleting them
 	file1.~File();
@@ -319,3 +412,2499 @@ void test6()
 
 	bufMgr->flushFile(file1ptr);
 }
+
+void test7()
+{
+	//Several threads reading the same resident pages at once. Every read must see the
+	//right contents and every pin must be released again afterwards.
+	const int numThreads = 4;
+	bool failed[numThreads] = {false};
+	std::vector<std::thread> threads;
+
+	for (i = 1; i <= num; i++) {
+		bufMgr->readPage(file1ptr, i, page);
+		bufMgr->unPinPage(file1ptr, i, false);
+	}
+
+	for (int t = 0; t < numThreads; t++) {
+		threads.push_back(std::thread([t, &failed]() {
+			char expected[100];
+			Page* threadPage;
+			for (int round = 0; round < 20; round++) {
+				for (PageId j = 0; j < num; j++) {
+					//Each page of file1 holds its record in the first slot
+					PageId pageNo = (j + t * 7) % num + 1;
+					RecordId recordId = {pageNo, 1};
+					bufMgr->readPage(file1ptr, pageNo, threadPage);
+					sprintf(expected, "test.1 Page %d %7.1f", pageNo, (float)pageNo);
+					if (strncmp(threadPage->getRecord(recordId).c_str(), expected, strlen(expected)) != 0)
+						failed[t] = true;
+					bufMgr->unPinPage(file1ptr, pageNo, false);
+				}
+			}
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+
+	for (int t = 0; t < numThreads; t++) {
+		if (failed[t])
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+
+	//All pins dropped, so the file can be flushed
+	bufMgr->flushFile(file1ptr);
+
+	std::cout << "Test 7 passed" << "\n";
+}
+
+void test8()
+{
+	//Random inserts, lookups and removes on both kinds of table must agree with std::map
+	BufHashTbl chained(13, 4);
+	BufProbeTbl probing(16, 4);
+	BufTable* tables[2] = {&chained, &probing};
+
+	for (int t = 0; t < 2; t++) {
+		std::map<std::pair<const File*, PageId>, FrameId> expected;
+		const File* files[2] = {file1ptr, file2ptr};
+		FrameId frameNo;
+
+		for (int op = 0; op < 20000; op++) {
+			const File* file = files[random() % 2];
+			PageId pageNo = random() % 300 + 1;
+			std::pair<const File*, PageId> key(file, pageNo);
+			bool present = expected.count(key) != 0;
+
+			if (random() % 2 == 0) {
+				if (!present) {
+					tables[t]->insert(file, pageNo, op);
+					expected[key] = op;
+				}
+			}
+			else if (present) {
+				tables[t]->remove(file, pageNo);
+				expected.erase(key);
+			}
+
+			//Tables are resized now and then, keeping their entries
+			if (op % 2500 == 0)
+				tables[t]->resize(op % 5000 == 0 ? 700 : 40);
+
+			PageId probe = random() % 300 + 1;
+			std::pair<const File*, PageId> probeKey(file, probe);
+			try {
+				tables[t]->lookup(file, probe, frameNo);
+				if (expected.count(probeKey) == 0 || expected[probeKey] != frameNo)
+				{
+					PRINT_ERROR("ERROR :: Table returned a wrong frame.");
+				}
+			}
+			catch(const HashNotFoundException& e)
+			{
+				if (expected.count(probeKey) != 0)
+				{
+					PRINT_ERROR("ERROR :: Table lost an entry.");
+				}
+			}
+		}
+	}
+
+	//A page missing from a table is reported through find and erase returning false,
+	//which leave the table and the frame number alone
+	for (int t = 0; t < 2; t++) {
+		tables[t]->insert(file1ptr, 1000, 7);
+		FrameId frameNo = 99;
+		if (tables[t]->find(file1ptr, 1001, frameNo) || tables[t]->find(file2ptr, 1000, frameNo) ||
+				frameNo != 99)
+		{
+			PRINT_ERROR("ERROR :: Table found a page it does not hold.");
+		}
+		if (tables[t]->erase(file1ptr, 1001) || !tables[t]->find(file1ptr, 1000, frameNo) || frameNo != 7)
+		{
+			PRINT_ERROR("ERROR :: Erasing a missing page changed the table.");
+		}
+		if (!tables[t]->erase(file1ptr, 1000) || tables[t]->erase(file1ptr, 1000) ||
+				tables[t]->find(file1ptr, 1000, frameNo))
+		{
+			PRINT_ERROR("ERROR :: Table did not erase its page exactly once.");
+		}
+	}
+
+	//Unpinning a page that is not in the pool returns without a word and touches no
+	//frame; a page in the pool but not pinned still throws
+	BufMgr unpinMgr(4);
+	Page* page;
+	unpinMgr.readPage(file1ptr, 1, page);
+	unpinMgr.unPinPage(file1ptr, 2, true);
+	unpinMgr.unPinPage(file2ptr, 1, true);
+	unpinMgr.unPinPage(file1ptr, 1, false);
+	try
+	{
+		unpinMgr.unPinPage(file1ptr, 1, false);
+		PRINT_ERROR("ERROR :: Page 1 is no longer pinned. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(PageNotPinnedException& e)
+	{
+	}
+	unpinMgr.flushFile(file1ptr);
+	unpinMgr.flushFile(file2ptr);
+	if (unpinMgr.getBufStats().diskwrites != 0)
+	{
+		PRINT_ERROR("ERROR :: Unpinning a page not in the pool marked a frame dirty.");
+	}
+
+	std::cout << "Test 8 passed" << "\n";
+}
+
+//Takes only the one frame left unpinned, if any.  Every frame it fails to take stands
+//for a hit on that frame, until hitsLeft runs out.
+class PinnedReclaimer : public FrameReclaimer
+{
+ public:
+	BufPolicy* policy;
+	FrameId unpinned;
+	int hitsLeft;
+
+	virtual bool reclaim(const FrameId frame)
+	{
+		if (frame == unpinned)
+			return true;
+		if (hitsLeft > 0) {
+			hitsLeft--;
+			policy->accessed(unpinned);
+		}
+		return false;
+	}
+};
+
+void test9()
+{
+	//Every replacement policy must return the right pages from a pool much smaller than
+	//the file, keep resident pages resident and refuse to evict pinned pages
+	BufPolicyType policies[4] = {CLOCK_POLICY, LRU_K_POLICY, TWO_Q_POLICY, ARC_POLICY};
+	const std::uint32_t frames = 10;
+	char expected[100];
+
+	for (int p = 0; p < 4; p++) {
+		BufMgrOptions options;
+		options.policyType = policies[p];
+		BufMgr policyMgr(frames, options);
+		Page* policyPage;
+
+		for (int op = 0; op < 2000; op++) {
+			//Half the reads go to a few hot pages, the rest scan the file
+			PageId pageNo = op % 2 == 0 ? (PageId)(op / 2 % 3 + 1) : (PageId)(op / 2 % num + 1);
+			RecordId recordId = {pageNo, 1};
+			policyMgr.readPage(file1ptr, pageNo, policyPage);
+			sprintf(expected, "test.1 Page %d %7.1f", pageNo, (float)pageNo);
+			if (strncmp(policyPage->getRecord(recordId).c_str(), expected, strlen(expected)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			policyMgr.unPinPage(file1ptr, pageNo, false);
+		}
+
+		//Every page is read from disk at least once, and hits never are
+		if (policyMgr.getBufStats().diskreads < (int)num || policyMgr.getBufStats().diskreads >= 2000)
+		{
+			PRINT_ERROR("ERROR :: Unexpected number of disk reads.");
+		}
+
+		for (i = 1; i <= frames; i++)
+			policyMgr.readPage(file1ptr, i, policyPage);
+
+		try
+		{
+			policyMgr.readPage(file1ptr, frames + 1, policyPage);
+			PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(BufferExceededException& e)
+		{
+		}
+
+		for (i = 1; i <= frames; i++)
+			policyMgr.unPinPage(file1ptr, i, false);
+		policyMgr.flushFile(file1ptr);
+	}
+
+	//Hits noted since the last victim count when it is chosen
+	for (int p = 0; p < 2; p++) {
+		std::unique_ptr<BufPolicy> policy(p == 0 ? (BufPolicy*)new LruKPolicy(3, 2) : new ArcPolicy(3));
+		for (FrameId f = 0; f < 3; f++)
+			policy->loaded(f, file1ptr, f + 1);
+		policy->accessed(0);
+		policy->accessed(0);
+		PinnedReclaimer reclaimer;
+		reclaimer.policy = policy.get();
+		reclaimer.unpinned = 1;
+		reclaimer.hitsLeft = 0;
+		FrameId victim;
+		if (!policy->victim(reclaimer, file1ptr, 4, victim) || victim != 1)
+		{
+			PRINT_ERROR("ERROR :: Hit page evicted before pages that were not hit.");
+		}
+	}
+
+	//The clock gives up only after a round of pinned frames, however long hits on the
+	//one unpinned frame keep setting its bit before the hand gets there
+	ClockPolicy clock(frames);
+	for (FrameId f = 0; f < frames; f++)
+		clock.loaded(f, file1ptr, f + 1);
+	PinnedReclaimer reclaimer;
+	reclaimer.policy = &clock;
+	reclaimer.unpinned = 5;
+	reclaimer.hitsLeft = 4 * frames;
+	FrameId victim;
+	if (!clock.victim(reclaimer, file1ptr, frames + 1, victim) || victim != 5)
+	{
+		PRINT_ERROR("ERROR :: Clock gave up with a frame unpinned.");
+	}
+	reclaimer.unpinned = frames;
+	reclaimer.hitsLeft = 0;
+	if (clock.victim(reclaimer, file1ptr, frames + 1, victim))
+	{
+		PRINT_ERROR("ERROR :: Clock took a pinned frame.");
+	}
+
+	std::cout << "Test 9 passed" << "\n";
+}
+
+void test10()
+{
+	//With the background writer running, pages updated over and over in a pool much
+	//smaller than the file must reach the file with their last contents
+	const std::string filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		BufMgrOptions options;
+		options.backgroundWriter = true;
+		BufMgr writerMgr(10, options);
+		Page* writerPage;
+		PageId pages[num];
+		int versions[num];
+		char record[100];
+
+		for (i = 0; i < num; i++) {
+			writerMgr.allocPage(&file6, pages[i], writerPage);
+			versions[i] = 0;
+			sprintf(record, "test.6 Page %d v%06d", pages[i], 0);
+			writerPage->insertRecord(record);
+			writerMgr.unPinPage(&file6, pages[i], true);
+		}
+
+		for (int op = 0; op < 3000; op++) {
+			PageId j = random() % num;
+			RecordId recordId = {pages[j], 1};
+			writerMgr.readPage(&file6, pages[j], writerPage);
+			sprintf(record, "test.6 Page %d v%06d", pages[j], ++versions[j]);
+			writerPage->updateRecord(recordId, record);
+			writerMgr.unPinPage(&file6, pages[j], true);
+		}
+
+		//The pool is full of dirty pages, so the writer has work to do
+		for (int wait = 0; wait < 200 && writerMgr.getWriterStats().pagesWritten == 0; wait++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		if (writerMgr.getWriterStats().pagesWritten == 0)
+		{
+			PRINT_ERROR("ERROR :: Background writer did not write any page.");
+		}
+
+		writerMgr.flushFile(&file6);
+		for (i = 0; i < num; i++) {
+			RecordId recordId = {pages[i], 1};
+			sprintf(record, "test.6 Page %d v%06d", pages[i], versions[i]);
+			if (file6.readPage(pages[i]).getRecord(recordId) != record)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 10 passed" << "\n";
+}
+
+void test11()
+{
+	//Pages written back and read again through each kind of IoEngine must round trip,
+	//and reads past the end of the file must still be reported as invalid pages
+	IoEngineType engines[2] = {THREAD_POOL_ENGINE, URING_ENGINE};
+	const std::string filename = "test.6";
+
+	for (int e = 0; e < 2; e++) {
+		IoEngine* probe = IoEngine::create(engines[e], 1);
+		if (probe == NULL)
+			continue;  // no io_uring in this kernel
+		delete probe;
+
+		try
+		{
+			File::remove(filename);
+		}
+		catch(FileNotFoundException& e)
+		{
+		}
+
+		{
+			File file6 = File::create(filename);
+			BufMgrOptions options;
+			options.ioEngine = engines[e];
+			options.ioDepth = 8;
+			BufMgr engineMgr(20, options);
+			Page* enginePage;
+			PageId pages[num];
+			char record[100];
+
+			for (i = 0; i < num; i++) {
+				engineMgr.allocPage(&file6, pages[i], enginePage);
+				sprintf(record, "test.6 Page %d %7.1f", pages[i], (float)pages[i]);
+				enginePage->insertRecord(record);
+				engineMgr.unPinPage(&file6, pages[i], true);
+			}
+			engineMgr.flushFile(&file6);
+
+			for (i = 0; i < num; i++) {
+				RecordId recordId = {pages[i], 1};
+				sprintf(record, "test.6 Page %d %7.1f", pages[i], (float)pages[i]);
+				engineMgr.readPage(&file6, pages[i], enginePage);
+				if (enginePage->getRecord(recordId) != record || file6.readPage(pages[i]).getRecord(recordId) != record)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				engineMgr.unPinPage(&file6, pages[i], false);
+			}
+
+			try
+			{
+				engineMgr.readPage(&file6, pages[num - 1] + 1, enginePage);
+				PRINT_ERROR("ERROR :: Page is past the end of the file. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(InvalidPageException& e)
+			{
+			}
+			engineMgr.flushFile(&file6);
+		}
+		File::remove(filename);
+	}
+
+	std::cout << "Test 11 passed" << "\n";
+}
+
+void test12()
+{
+	//Prefetched pages must be read from disk once, by the prefetch, and then be hits;
+	//pages that do not exist are only reported when they are read
+	for (int streamIo = 0; streamIo < 2; streamIo++) {
+		BufMgrOptions options;
+		options.streamIo = streamIo;
+		BufMgr prefetchMgr(40, options);
+		Page* prefetchPage;
+		char expected[100];
+
+		std::vector<PageId> listed;
+		for (i = 30; i >= 21; i--)
+			listed.push_back(i);
+		prefetchMgr.prefetch(file1ptr, 1, 20);
+		prefetchMgr.prefetch(file1ptr, listed);
+		prefetchMgr.prefetch(file1ptr, 1, 5);  //already in the pool, skipped
+
+		for (i = 1; i <= 30; i++) {
+			RecordId recordId = {i, 1};
+			prefetchMgr.readPage(file1ptr, i, prefetchPage);
+			sprintf(expected, "test.1 Page %d %7.1f", i, (float)i);
+			if (strncmp(prefetchPage->getRecord(recordId).c_str(), expected, strlen(expected)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			prefetchMgr.unPinPage(file1ptr, i, false);
+		}
+		if (prefetchMgr.getBufStats().diskreads != 30 || prefetchMgr.getBufStats().prefetched != 30)
+		{
+			PRINT_ERROR("ERROR :: Prefetched pages were read again.");
+		}
+
+		prefetchMgr.prefetch(file1ptr, num + 1, 3);
+		try
+		{
+			prefetchMgr.readPage(file1ptr, num + 2, prefetchPage);
+			PRINT_ERROR("ERROR :: Page is past the end of the file. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(InvalidPageException& e)
+		{
+		}
+		prefetchMgr.flushFile(file1ptr);
+	}
+
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	//A scan through an access strategy must recycle its ring instead of evicting the hot
+	//pages, whatever the policy, and must still work while it pins more pages than the
+	//ring holds
+	BufPolicyType policies[4] = {CLOCK_POLICY, LRU_K_POLICY, TWO_Q_POLICY, ARC_POLICY};
+	const PageId hot = 10;
+	char expected[100];
+
+	for (int p = 0; p < 4; p++) {
+		BufMgrOptions options;
+		options.policyType = policies[p];
+		BufMgr ringMgr(30, options);
+		BufAccessStrategy ring(4);
+		Page* ringPage;
+
+		for (int pass = 0; pass < 3; pass++) {
+			for (i = 1; i <= hot; i++) {
+				ringMgr.readPage(file1ptr, i, ringPage);
+				ringMgr.unPinPage(file1ptr, i, false);
+			}
+		}
+
+		for (i = hot + 1; i <= num; i++) {
+			RecordId recordId = {i, 1};
+			ringMgr.readPage(file1ptr, i, ringPage, &ring);
+			sprintf(expected, "test.1 Page %d %7.1f", i, (float)i);
+			if (strncmp(ringPage->getRecord(recordId).c_str(), expected, strlen(expected)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			//Keep a window of six pages pinned for a while, more than the ring holds
+			if (i < 50 || i >= 56)
+				ringMgr.unPinPage(file1ptr, i, false);
+			if (i == 61) {
+				for (PageId pinned = 50; pinned < 56; pinned++)
+					ringMgr.unPinPage(file1ptr, pinned, false);
+			}
+		}
+		if (ringMgr.getBufStats().ringreuses == 0)
+		{
+			PRINT_ERROR("ERROR :: Scan did not reuse its ring.");
+		}
+
+		const std::uint64_t diskreads = ringMgr.getBufStats().diskreads;
+		for (i = 1; i <= hot; i++) {
+			ringMgr.readPage(file1ptr, i, ringPage);
+			ringMgr.unPinPage(file1ptr, i, false);
+		}
+		if (ringMgr.getBufStats().diskreads != diskreads)
+		{
+			PRINT_ERROR("ERROR :: Scan evicted hot pages.");
+		}
+		ringMgr.flushFile(file1ptr);
+	}
+
+	std::cout << "Test 13 passed" << "\n";
+}
+
+void test14()
+{
+	//A handle holds its pin until it is released, moved over or destroyed, and marks
+	//the page dirty on the way out
+	BufMgr handleMgr(10);
+	PageId newPageNo;
+	RecordId newRid;
+	{
+		PageHandle created = handleMgr.allocPage(file1ptr, newPageNo);
+		newRid = created->insertRecord("test.1 handle page");
+		created.markDirty();
+
+		PageHandle moved(std::move(created));
+		if (created.valid() || !moved.valid())
+		{
+			PRINT_ERROR("ERROR :: Pin did not move with the handle.");
+		}
+
+		try
+		{
+			handleMgr.flushFile(file1ptr);
+			PRINT_ERROR("ERROR :: Page is still pinned through its handle. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(PagePinnedException& e)
+		{
+		}
+	}
+	handleMgr.flushFile(file1ptr);
+	if (file1ptr->readPage(newPageNo).getRecord(newRid) != "test.1 handle page")
+	{
+		PRINT_ERROR("ERROR :: Page marked dirty through its handle was not written back.");
+	}
+
+	//Assigning over a handle releases the pin it held; a second pin on the same page
+	//stays until released
+	PageHandle first = handleMgr.readPage(file1ptr, 1);
+	PageHandle second = handleMgr.readPage(file1ptr, 1);
+	if (first.page() != second.page())
+	{
+		PRINT_ERROR("ERROR :: Two pins on one page returned different frames.");
+	}
+	first = handleMgr.readPage(file1ptr, 2);
+	second.release();
+	if (second.valid())
+	{
+		PRINT_ERROR("ERROR :: Released handle still holds a pin.");
+	}
+	try
+	{
+		handleMgr.unPinPage(file1ptr, 1, false);
+		PRINT_ERROR("ERROR :: Page 1 is no longer pinned. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(PageNotPinnedException& e)
+	{
+	}
+	first.release();
+	handleMgr.flushFile(file1ptr);
+
+	//A page pinned through a handle cannot be disposed of
+	{
+		PageHandle pinned = handleMgr.allocPage(file1ptr, newPageNo);
+		try
+		{
+			handleMgr.disposePage(file1ptr, newPageNo);
+			PRINT_ERROR("ERROR :: Page is pinned through its handle. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(PagePinnedException& e)
+		{
+		}
+		if (pinned->page_number() != newPageNo)
+		{
+			PRINT_ERROR("ERROR :: Pinned page was cleared.");
+		}
+	}
+	handleMgr.disposePage(file1ptr, newPageNo);
+
+	//A handle whose pin was given up behind its back leaves the frame alone once it holds
+	//another page: release() throws and the destructor does nothing
+	BufMgr oneFrameMgr(1);
+	for (int destroy = 0; destroy < 2; destroy++) {
+		PageHandle stale = oneFrameMgr.allocPage(file1ptr, newPageNo);
+		oneFrameMgr.unPinPage(file1ptr, newPageNo, false);
+		oneFrameMgr.disposePage(file1ptr, newPageNo);
+		PageHandle other = oneFrameMgr.readPage(file1ptr, 1);
+		if (other.page() != stale.page())
+		{
+			PRINT_ERROR("ERROR :: Pool of one frame used another.");
+		}
+		if (destroy) {
+			PageHandle moved(std::move(stale));
+		}
+		else {
+			try
+			{
+				stale.release();
+				PRINT_ERROR("ERROR :: Frame no longer holds the page. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(PageNotPinnedException& e)
+			{
+			}
+		}
+		try
+		{
+			oneFrameMgr.flushFile(file1ptr);
+			PRINT_ERROR("ERROR :: Stale handle unpinned another page. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(PagePinnedException& e)
+		{
+		}
+	}
+	oneFrameMgr.flushFile(file1ptr);
+
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	//The pool is one page-aligned arena, with or without huge pages, and its frames
+	//hold pages read through it like any others
+	for (int huge = 0; huge < 2; huge++) {
+		BufMgrOptions options;
+		options.hugePages = huge;
+		BufMgr arenaMgr(num / 2, options);
+		Page* arenaPage;
+		char expected[100];
+
+		if (reinterpret_cast<std::uintptr_t>(arenaMgr.bufPool) % sysconf(_SC_PAGESIZE) != 0)
+		{
+			PRINT_ERROR("ERROR :: Buffer pool is not page aligned.");
+		}
+
+		for (i = 1; i <= num; i++) {
+			RecordId recordId = {i, 1};
+			arenaMgr.readPage(file1ptr, i, arenaPage);
+			if (arenaPage < arenaMgr.bufPool || arenaPage >= arenaMgr.bufPool + num / 2)
+			{
+				PRINT_ERROR("ERROR :: Page is outside the buffer pool arena.");
+			}
+			sprintf(expected, "test.1 Page %d %7.1f", i, (float)i);
+			if (strncmp(arenaPage->getRecord(recordId).c_str(), expected, strlen(expected)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			arenaMgr.unPinPage(file1ptr, i, false);
+		}
+		arenaMgr.flushFile(file1ptr);
+	}
+
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	//A miss reads straight into its frame: once the pool is warm, misses and their
+	//evictions make no heap allocation at all, through the stream or an I/O engine, with
+	//the probing table, whose entries are not allocated one by one
+	for (int streamIo = 0; streamIo < 2; streamIo++) {
+		BufMgrOptions options;
+		options.streamIo = streamIo;
+		options.tableType = PROBING_TABLE;
+		BufMgr missMgr(10, options);
+		Page* missPage;
+		char expected[100];
+
+		for (i = 1; i <= 10; i++) {
+			missMgr.readPage(file1ptr, i, missPage);
+			missMgr.unPinPage(file1ptr, i, false);
+		}
+
+		const long before = heapAllocations;
+		for (i = 11; i <= 40; i++) {
+			missMgr.readPage(file1ptr, i, missPage);
+			missMgr.unPinPage(file1ptr, i, false);
+		}
+		const long allocations = heapAllocations - before;
+		if (allocations != 0)
+		{
+			PRINT_ERROR("ERROR :: Misses allocated on the heap " << allocations << " times.");
+		}
+		if (missMgr.getBufStats().diskreads != 40)
+		{
+			PRINT_ERROR("ERROR :: Unexpected number of disk reads.");
+		}
+
+		//Failed reads hand their frames back, so every frame can still be pinned
+		for (int attempt = 0; attempt < 20; attempt++) {
+			try
+			{
+				missMgr.readPage(file1ptr, num + 2 + attempt, missPage);
+				PRINT_ERROR("ERROR :: Page is past the end of the file. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(InvalidPageException& e)
+			{
+			}
+		}
+		for (i = 1; i <= 10; i++) {
+			RecordId recordId = {i, 1};
+			missMgr.readPage(file1ptr, i, missPage);
+			sprintf(expected, "test.1 Page %d %7.1f", i, (float)i);
+			if (strncmp(missPage->getRecord(recordId).c_str(), expected, strlen(expected)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		for (i = 1; i <= 10; i++)
+			missMgr.unPinPage(file1ptr, i, false);
+		missMgr.flushFile(file1ptr);
+	}
+
+	std::cout << "Test 16 passed" << "\n";
+}
+
+void test17()
+{
+	//File uses positional I/O, so several threads may read one File at once, and the
+	//calls that allocate pages may be made from several threads too
+	std::vector<std::thread> readers;
+	std::atomic<int> mismatches(0);
+	for (int t = 0; t < 4; t++) {
+		readers.push_back(std::thread([t, &mismatches]() {
+			Page threadPage;
+			char expected[100];
+			for (int op = 0; op < 2000; op++) {
+				const PageId pageNo = (op * 7 + t * 13) % num + 1;
+				RecordId recordId = {pageNo, 1};
+				file1ptr->readPage(pageNo, threadPage);
+				sprintf(expected, "test.1 Page %d %7.1f", pageNo, (float)pageNo);
+				if (strncmp(threadPage.getRecord(recordId).c_str(), expected, strlen(expected)) != 0)
+					mismatches++;
+			}
+		}));
+	}
+	for (size_t t = 0; t < readers.size(); t++)
+		readers[t].join();
+	if (mismatches != 0)
+	{
+		PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+	}
+
+	const std::string filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+	{
+		File file6 = File::create(filename);
+		std::vector<PageId> allocated[2];
+		std::vector<std::thread> allocators;
+		for (int t = 0; t < 2; t++) {
+			allocators.push_back(std::thread([t, &file6, &allocated]() {
+				char record[100];
+				for (int n = 0; n < 25; n++) {
+					Page newPage = file6.allocatePage();
+					sprintf(record, "test.6 Page %d", newPage.page_number());
+					newPage.insertRecord(record);
+					file6.writePage(newPage);
+					allocated[t].push_back(newPage.page_number());
+				}
+			}));
+		}
+		for (size_t t = 0; t < allocators.size(); t++)
+			allocators[t].join();
+
+		std::map<PageId, int> seen;
+		for (int t = 0; t < 2; t++) {
+			for (size_t n = 0; n < allocated[t].size(); n++) {
+				char record[100];
+				RecordId recordId = {allocated[t][n], 1};
+				sprintf(record, "test.6 Page %d", allocated[t][n]);
+				if (++seen[allocated[t][n]] > 1 || file6.readPage(allocated[t][n]).getRecord(recordId) != record)
+				{
+					PRINT_ERROR("ERROR :: Concurrent allocations collided.");
+				}
+			}
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 17 passed" << "\n";
+}
+
+void test18()
+{
+	//A file opened with O_DIRECT holds the same layout as a buffered one; pages reach it
+	//through File (unaligned pages, bounced) and through the buffer pool (aligned frames)
+	const std::string filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+
+	FileOptions directOptions;
+	directOptions.direct_io = true;
+	std::vector<PageId> pageIds;
+	char record[100];
+	{
+		File file6 = File::create(filename, directOptions);
+		for (i = 0; i < 30; i++) {
+			Page newPage = file6.allocatePage();
+			sprintf(record, "test.6 Page %d", newPage.page_number());
+			newPage.insertRecord(record);
+			file6.writePage(newPage);
+			pageIds.push_back(newPage.page_number());
+		}
+		//Deleting a page frees it in the allocation map; reallocating it reuses the page
+		file6.deletePage(pageIds[10]);
+		Page reused = file6.allocatePage();
+		if (reused.page_number() != pageIds[10])
+		{
+			PRINT_ERROR("ERROR :: Deleted page was not reused.");
+		}
+		sprintf(record, "test.6 Page %d", reused.page_number());
+		reused.insertRecord(record);
+		file6.writePage(reused);
+
+		for (int streamIo = 0; streamIo < 2; streamIo++) {
+			BufMgrOptions options;
+			options.streamIo = streamIo;
+			BufMgr directMgr(10, options);
+			Page* directPage;
+			for (size_t n = 0; n < pageIds.size(); n++) {
+				RecordId recordId = {pageIds[n], 1};
+				sprintf(record, "test.6 Page %d", pageIds[n]);
+				directMgr.readPage(&file6, pageIds[n], directPage);
+				if (directPage->getRecord(recordId) != record)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				sprintf(record, "test.6 Page %d pass %d", pageIds[n], streamIo);
+				directPage->insertRecord(record);
+				directMgr.unPinPage(&file6, pageIds[n], true);
+			}
+			directMgr.flushFile(&file6);
+		}
+	}
+
+	//Reopened buffered, the file reads back as written
+	{
+		File file6 = File::open(filename);
+		if (file6.directIo())
+		{
+			PRINT_ERROR("ERROR :: Buffered file was opened with O_DIRECT.");
+		}
+		for (size_t n = 0; n < pageIds.size(); n++) {
+			Page page = file6.readPage(pageIds[n]);
+			for (int pass = 0; pass < 2; pass++) {
+				RecordId recordId = {pageIds[n], (SlotId)(pass + 2)};
+				sprintf(record, "test.6 Page %d pass %d", pageIds[n], pass);
+				if (page.getRecord(recordId) != record)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+		}
+		int pagesInFile = 0;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter)
+			pagesInFile++;
+		if (pagesInFile != (int)pageIds.size())
+		{
+			PRINT_ERROR("ERROR :: Used page list is broken.");
+		}
+		struct stat info;
+		if (stat(filename.c_str(), &info) != 0 || info.st_size % Page::SIZE != 0)
+		{
+			PRINT_ERROR("ERROR :: Pages are not aligned in the file.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 18 passed" << "\n";
+}
+
+void test19()
+{
+	//A mapped file serves reads from its mapping, which grows as pages are allocated and
+	//sees every write made through pwrite
+	const std::string filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+
+	FileOptions mapOptions;
+	mapOptions.mmap_reads = true;
+	std::vector<PageId> pageIds;
+	char record[100];
+	{
+		File file6 = File::create(filename, mapOptions);
+		if (!file6.mapped())
+		{
+			PRINT_ERROR("ERROR :: File was not mapped.");
+		}
+		for (i = 0; i < 40; i++) {
+			Page newPage = file6.allocatePage();
+			sprintf(record, "test.6 Page %d", newPage.page_number());
+			newPage.insertRecord(record);
+			file6.writePage(newPage);
+			pageIds.push_back(newPage.page_number());
+		}
+		//Every page just allocated reads back from the mapping, in order and at random
+		for (int pass = 0; pass < 2; pass++) {
+			for (size_t n = 0; n < pageIds.size(); n++) {
+				const PageId pageNo = pass == 0 ? pageIds[n] : pageIds[(n * 17) % pageIds.size()];
+				RecordId recordId = {pageNo, 1};
+				sprintf(record, "test.6 Page %d", pageNo);
+				if (file6.readPage(pageNo).getRecord(recordId) != record)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+		}
+		//Deleting frees a page; the iterator skips it without reading the file
+		file6.deletePage(pageIds[5]);
+		int pagesInFile = 0;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter)
+			pagesInFile++;
+		if (pagesInFile != (int)pageIds.size() - 1)
+		{
+			PRINT_ERROR("ERROR :: Used page list is broken.");
+		}
+		try
+		{
+			file6.readPage(pageIds[5]);
+			PRINT_ERROR("ERROR :: Page is deleted. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(InvalidPageException& e)
+		{
+		}
+		try
+		{
+			file6.readPage(pageIds.back() + 1);
+			PRINT_ERROR("ERROR :: Page is past the end of the file. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(InvalidPageException& e)
+		{
+		}
+
+		//Pages written back by the buffer pool are read back through the mapping
+		pageIds.erase(pageIds.begin() + 5);
+		{
+			BufMgr mapMgr(10);
+			Page* mapPage;
+			for (size_t n = 0; n < pageIds.size(); n++) {
+				mapMgr.readPage(&file6, pageIds[n], mapPage);
+				sprintf(record, "test.6 Page %d again", pageIds[n]);
+				mapPage->insertRecord(record);
+				mapMgr.unPinPage(&file6, pageIds[n], true);
+			}
+			mapMgr.flushFile(&file6);
+		}
+		for (size_t n = 0; n < pageIds.size(); n++) {
+			RecordId recordId = {pageIds[n], 2};
+			sprintf(record, "test.6 Page %d again", pageIds[n]);
+			if (file6.readPage(pageIds[n]).getRecord(recordId) != record)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+	}
+
+	//Reopened, an existing file is mapped from the start
+	{
+		File file6 = File::open(filename, mapOptions);
+		if (!file6.mapped())
+		{
+			PRINT_ERROR("ERROR :: File was not mapped.");
+		}
+		RecordId recordId = {pageIds.back(), 2};
+		sprintf(record, "test.6 Page %d again", pageIds.back());
+		if (file6.readPage(pageIds.back()).getRecord(recordId) != record)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 19 passed" << "\n";
+}
+
+void test20()
+{
+	//Every durability mode keeps the file intact, whether writes are synced alone, per
+	//SyncBatch or in group commits shared by several threads, and syncs as often as it
+	//says: never without an explicit sync under NO_SYNC, once per write under
+	//SYNC_PER_BATCH, at most once per write under GROUP_COMMIT
+	const std::string filename = "test.6";
+	const FileDurability modes[3] = {NO_SYNC, SYNC_PER_BATCH, GROUP_COMMIT};
+	std::uint64_t perWriteSyncs = 0;
+	for (int m = 0; m < 3; m++) {
+		try
+		{
+			File::remove(filename);
+		}
+		catch(FileNotFoundException& e)
+		{
+		}
+
+		FileOptions syncOptions;
+		syncOptions.durability = modes[m];
+		syncOptions.group_commit_us = 200;
+		std::vector<PageId> allocated[3];
+		{
+			File file6 = File::create(filename, syncOptions);
+			std::vector<std::thread> writers;
+			for (int t = 0; t < 3; t++) {
+				writers.push_back(std::thread([t, &file6, &allocated]() {
+					char record[100];
+					for (int n = 0; n < 10; n++) {
+						Page newPage = file6.allocatePage();
+						sprintf(record, "test.6 Page %d", newPage.page_number());
+						newPage.insertRecord(record);
+						file6.writePage(newPage);
+						allocated[t].push_back(newPage.page_number());
+					}
+				}));
+			}
+			for (size_t t = 0; t < writers.size(); t++)
+				writers[t].join();
+			const std::uint64_t writeSyncs = file6.syncCount();
+			if (modes[m] == SYNC_PER_BATCH)
+				perWriteSyncs = writeSyncs;
+			if ((modes[m] == NO_SYNC && writeSyncs != 0) ||
+					(modes[m] == SYNC_PER_BATCH && writeSyncs < 30) ||
+					(modes[m] == GROUP_COMMIT && (writeSyncs == 0 || writeSyncs > perWriteSyncs)))
+			{
+				PRINT_ERROR("ERROR :: Writes synced against the durability mode.");
+			}
+
+			//Write-back by the buffer pool syncs once per batch of frames
+			BufMgr syncMgr(8);
+			Page* syncPage;
+			char record[100];
+			for (int t = 0; t < 3; t++) {
+				for (size_t n = 0; n < allocated[t].size(); n++) {
+					syncMgr.readPage(&file6, allocated[t][n], syncPage);
+					sprintf(record, "test.6 Page %d again", allocated[t][n]);
+					syncPage->insertRecord(record);
+					syncMgr.unPinPage(&file6, allocated[t][n], true);
+				}
+			}
+			syncMgr.flushFile(&file6);
+			const std::uint64_t flushSyncs = file6.syncCount() - writeSyncs;
+			if ((modes[m] == NO_SYNC && flushSyncs != 0) ||
+					(modes[m] != NO_SYNC && (flushSyncs == 0 || flushSyncs >= 30)))
+			{
+				PRINT_ERROR("ERROR :: Write-back synced against the durability mode.");
+			}
+			file6.sync();
+			if (file6.syncCount() != writeSyncs + flushSyncs + 1)
+			{
+				PRINT_ERROR("ERROR :: Explicit sync not made.");
+			}
+		}
+
+		File file6 = File::open(filename);
+		char record[100];
+		for (int t = 0; t < 3; t++) {
+			for (size_t n = 0; n < allocated[t].size(); n++) {
+				Page page = file6.readPage(allocated[t][n]);
+				RecordId recordId = {allocated[t][n], 2};
+				sprintf(record, "test.6 Page %d again", allocated[t][n]);
+				if (page.getRecord(recordId) != record)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 20 passed" << "\n";
+}
+
+//Reads the file header stored on disk, bypassing File
+FileHeader headerOnDisk(const std::string& filename)
+{
+	FileHeader header = {0, 0, 0, 0};
+	const int fd = open(filename.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+			header.num_pages = 0;
+		close(fd);
+	}
+	return header;
+}
+
+void test21()
+{
+	//The file header is cached in memory, shared by every File object of the file, and
+	//written to disk at syncs and when the file is closed
+	const std::string filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+
+	{
+		File file6 = File::create(filename);
+		File sameFile = File::open(filename);
+		for (i = 0; i < 5; i++)
+			file6.allocatePage();
+
+		//The other object sees the new pages at once; the page after them does not exist
+		sameFile.readPage(5);
+		try
+		{
+			sameFile.readPage(6);
+			PRINT_ERROR("ERROR :: Page is past the end of the file. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(InvalidPageException& e)
+		{
+		}
+
+		file6.sync();
+		if (headerOnDisk(filename).num_pages != 6)
+		{
+			PRINT_ERROR("ERROR :: Header was not written at the sync.");
+		}
+		sameFile.deletePage(2);
+		sameFile.allocatePage();
+		sameFile.allocatePage();
+	}
+	if (headerOnDisk(filename).num_pages != 7)
+	{
+		PRINT_ERROR("ERROR :: Header was not written when the file was closed.");
+	}
+
+	{
+		File file6 = File::open(filename);
+		int pagesInFile = 0;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter)
+			pagesInFile++;
+		if (pagesInFile != 6)
+		{
+			PRINT_ERROR("ERROR :: Used page list is broken.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 21 passed" << "\n";
+}
+
+//Lays out page n as earlier formats did: a page header of pageHeaderSize bytes, whose
+//first 16 are those of the baseline and the rest 0, then its slot array and, from the
+//end of the page down, its records
+std::vector<char> legacyPage(const std::size_t pageHeaderSize, const PageId n, const PageId next,
+		const std::vector<std::string>& records)
+{
+	std::vector<char> bytes(Page::SIZE, 0);
+	char* data = &bytes[pageHeaderSize];
+	std::uint16_t lower = 0;
+	std::uint16_t upper = Page::SIZE - pageHeaderSize;
+	for (std::size_t r = 0; r < records.size(); r++) {
+		upper -= records[r].size();
+		std::memcpy(data + upper, records[r].data(), records[r].size());
+		PageSlot slot = {true, upper, (std::uint16_t)records[r].size()};
+		std::memcpy(data + lower, &slot, sizeof(slot));
+		lower += sizeof(PageSlot);
+	}
+	const SlotId numSlots = records.size();
+	const SlotId numFreeSlots = 0;
+	const PageId current = records.empty() ? Page::INVALID_NUMBER : n;
+	std::memcpy(&bytes[0], &lower, 2);
+	std::memcpy(&bytes[2], &upper, 2);
+	std::memcpy(&bytes[4], &numSlots, 2);
+	std::memcpy(&bytes[6], &numFreeSlots, 2);
+	std::memcpy(&bytes[8], &current, 4);
+	std::memcpy(&bytes[12], &next, 4);
+	return bytes;
+}
+
+//Writes a file as the baseline build did: a 16 byte header alone at offset 0, then
+//page n at 16 + (n - 1) * Page::SIZE with a 16 byte page header.  Pages not in
+//records are free.
+void writeBaselineFile(const std::string& filename, const PageId header[4], const PageId* next,
+		const std::vector<std::vector<std::string> >& records)
+{
+	const int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (pwrite(fd, header, 4 * sizeof(PageId), 0) != (ssize_t)(4 * sizeof(PageId)))
+		PRINT_ERROR("ERROR :: Could not write the test file.");
+	for (PageId n = 1; n < header[0]; n++) {
+		const std::vector<char> bytes = legacyPage(16, n, next[n], records[n]);
+		if (pwrite(fd, &bytes[0], Page::SIZE, 4 * sizeof(PageId) + (n - 1) * Page::SIZE) != (ssize_t)Page::SIZE)
+			PRINT_ERROR("ERROR :: Could not write the test file.");
+	}
+	close(fd);
+}
+
+//Writes a file of an allocation map format: the first fileHeaderSize bytes of the
+//header in page 0 and the map bits in its second half, then page n at n * Page::SIZE
+//with a page header of pageHeaderSize bytes, ending with the page's checksum if flags
+//has File::CHECKSUM_FLAG.  Pages without records are free.
+void writeMapFile(const std::string& filename, const std::uint32_t format, const std::size_t fileHeaderSize,
+		const std::uint32_t flags, const std::size_t pageHeaderSize,
+		const std::vector<std::vector<std::string> >& records)
+{
+	std::vector<char> block(Page::SIZE, 0);
+	FileHeader header = {(PageId)records.size(), 0, 0, 0, format, 0, flags};
+	std::uint64_t* words = reinterpret_cast<std::uint64_t*>(&block[Page::SIZE / 2]);
+	for (PageId n = 1; n < records.size(); n++) {
+		if (records[n].empty())
+			header.num_free_pages++;
+		else
+			words[n / 64] |= std::uint64_t(1) << (n % 64);
+	}
+	std::memcpy(&block[0], &header, fileHeaderSize);
+	const int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (pwrite(fd, &block[0], Page::SIZE, 0) != (ssize_t)Page::SIZE)
+		PRINT_ERROR("ERROR :: Could not write the test file.");
+	for (PageId n = 1; n < records.size(); n++) {
+		std::vector<char> bytes = legacyPage(pageHeaderSize, n, Page::INVALID_NUMBER, records[n]);
+		if (flags & File::CHECKSUM_FLAG) {
+			const std::size_t covered = pageHeaderSize - sizeof(std::uint32_t);
+			std::uint32_t checksum = crc32c(crc32c(0, &bytes[0], covered), &bytes[pageHeaderSize],
+					Page::SIZE - pageHeaderSize);
+			checksum = checksum != 0 ? checksum : 1;
+			std::memcpy(&bytes[covered], &checksum, sizeof(checksum));
+		}
+		if (pwrite(fd, &bytes[0], Page::SIZE, (off_t)n * Page::SIZE) != (ssize_t)Page::SIZE)
+			PRINT_ERROR("ERROR :: Could not write the test file.");
+	}
+	close(fd);
+}
+
+void test22()
+{
+	//Files of the baseline layout are upgraded when opened: their pages move to page
+	//aligned places, take the current page header, and are listed in an allocation map,
+	//which grows past its part in page 0 onto map pages of its own
+	const std::string filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+
+	//Pages 1 to 10 with two records each, but 4 and 7 on the free list
+	const PageId legacyHeader[4] = {11, 1, 2, 7};
+	const PageId next[11] = {0, 2, 3, 5, 0, 6, 8, 4, 9, 10, 0};
+	std::vector<std::vector<std::string> > records(11);
+	for (PageId n = 1; n <= 10; n++) {
+		if (n == 4 || n == 7)
+			continue;
+		char record[100];
+		sprintf(record, "legacy page %d", n);
+		records[n].push_back(record);
+		records[n].push_back(std::string(100 * n, 'a' + n));
+	}
+	writeBaselineFile(filename, legacyHeader, next, records);
+
+	{
+		File file6 = File::open(filename);
+		int pagesInFile = 0;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter) {
+			Page page = *iter;
+			const PageId n = page.page_number();
+			for (SlotId slot = 1; slot <= 2; slot++) {
+				RecordId recordId = {n, slot};
+				if (n > 10 || page.getRecord(recordId) != records[n][slot - 1])
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+			pagesInFile++;
+		}
+		if (pagesInFile != 8)
+		{
+			PRINT_ERROR("ERROR :: Used page list was not carried over.");
+		}
+		//Free pages are reused lowest first, then the file grows
+		const PageId expected[3] = {4, 7, 11};
+		for (i = 0; i < 3; i++) {
+			if (file6.allocatePage().page_number() != expected[i])
+			{
+				PRINT_ERROR("ERROR :: Free pages were not reused.");
+			}
+		}
+	}
+	{
+		File file6 = File::open(filename);
+		int pagesInFile = 0;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter)
+			pagesInFile++;
+		struct stat info;
+		if (pagesInFile != 11 || headerOnDisk(filename).num_pages != 12 ||
+				headerOnDisk(filename).format != File::FILE_FORMAT ||
+				stat(filename.c_str(), &info) != 0 || info.st_size % Page::SIZE != 0)
+		{
+			PRINT_ERROR("ERROR :: Upgraded file was not written back.");
+		}
+	}
+	File::remove(filename);
+
+	//A page too full for the larger page header is refused, and the file left as it was
+	records.assign(3, std::vector<std::string>());
+	records[1].push_back("fits");
+	records[2].push_back(std::string(Page::SIZE - 16 - sizeof(PageSlot) - 8, 'f'));
+	const PageId fullHeader[4] = {3, 1, 0, 0};
+	const PageId fullNext[3] = {0, 2, 0};
+	writeBaselineFile(filename, fullHeader, fullNext, records);
+	{
+		bool threw = false;
+		try
+		{
+			File file6 = File::open(filename);
+		}
+		catch(FileFormatException& e)
+		{
+			threw = true;
+		}
+		struct stat info;
+		if (!threw || stat(filename.c_str(), &info) != 0 || info.st_size != (off_t)(16 + 2 * Page::SIZE))
+			PRINT_ERROR("ERROR :: Page too full to upgrade was not refused.");
+	}
+	File::remove(filename);
+
+	//Files whose layout this build does not know are refused rather than misread: one
+	//that is not whole pages long, and one of a later format
+	for (int layout = 0; layout < 2; layout++) {
+		{
+			const int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+			std::vector<char> bytes(layout == 0 ? Page::SIZE + 100 : Page::SIZE, 0);
+			FileHeader header = {2, 1, 0, 0, File::FILE_FORMAT + 1, 0};
+			std::memcpy(&bytes[0], &header, sizeof(header));
+			if (pwrite(fd, &bytes[0], bytes.size(), 0) != (ssize_t)bytes.size())
+				PRINT_ERROR("ERROR :: Could not write the test file.");
+			close(fd);
+		}
+		bool threw = false;
+		try
+		{
+			File file6 = File::open(filename);
+		}
+		catch(FileFormatException& e)
+		{
+			threw = true;
+		}
+		if (!threw || File::isOpen(filename))
+			PRINT_ERROR("ERROR :: File of an unknown layout was opened.");
+		File::remove(filename);
+	}
+
+	//Past the part of the map in page 0, a map page is added and never handed out
+	const int manyPages = 40000;
+	{
+		File file6 = File::create(filename);
+		for (i = 0; i < manyPages; i++)
+			file6.allocatePage();
+		file6.deletePage(100);
+		file6.deletePage(35000);
+		if (file6.allocatePage().page_number() != 100)
+		{
+			PRINT_ERROR("ERROR :: Free pages were not reused.");
+		}
+	}
+	{
+		File file6 = File::open(filename);
+		int pagesInFile = 0;
+		for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter)
+			pagesInFile++;
+		if (pagesInFile != manyPages - 1)
+		{
+			PRINT_ERROR("ERROR :: Allocation map was not read back.");
+		}
+		if (file6.allocatePage().page_number() != 35000 ||
+				file6.allocatePage().page_number() != (PageId)manyPages + 2)
+		{
+			PRINT_ERROR("ERROR :: Free pages were not reused.");
+		}
+	}
+	File::remove(filename);
+
+	std::cout << "Test 22 passed" << "\n";
+}
+
+void test23()
+{
+	//Write-back sorts the dirty pages and writes runs of adjacent pages with one vectored
+	//write, through File and through the IoEngine, and across files in one batch
+	const std::string filename6 = "test.6";
+	const std::string filename7 = "test.7";
+	const std::uint32_t runs[3] = {1, 5, File::MAX_WRITE_RUN};
+	char record[100];
+	for (int mode = 0; mode < 6; mode++) {
+		try
+		{
+			File::remove(filename6);
+			File::remove(filename7);
+		}
+		catch(FileNotFoundException& e)
+		{
+		}
+
+		std::vector<PageId> pages6;
+		std::vector<PageId> pages7;
+		{
+			File file6 = File::create(filename6);
+			File file7 = File::create(filename7);
+			for (int i = 0; i < 300; i++) {
+				pages6.push_back(file6.allocatePage().page_number());
+				pages7.push_back(file7.allocatePage().page_number());
+			}
+			//Holes split the runs
+			for (int i = 290; i >= 0; i -= 7) {
+				file6.deletePage(pages6[i]);
+				pages6.erase(pages6.begin() + i);
+			}
+
+			BufMgrOptions runOptions;
+			runOptions.streamIo = mode % 2 == 0;
+			runOptions.maxWriteRun = runs[mode / 2];
+			BufMgr* runMgr = new BufMgr(1024, runOptions);
+			Page* runPage;
+			//Dirty the pages out of order: odd positions backwards, then even ones
+			for (int pass = 0; pass < 2; pass++) {
+				for (int i = (int)pages6.size() - 1; i >= 0; i--) {
+					if (i % 2 != pass) {
+						continue;
+					}
+					runMgr->readPage(&file6, pages6[i], runPage);
+					sprintf(record, "test.6 Page %d run", pages6[i]);
+					runPage->insertRecord(record);
+					runMgr->unPinPage(&file6, pages6[i], true);
+				}
+			}
+			runMgr->flushFile(&file6);
+
+			//The destructor writes back the pages of both files in one batch
+			for (size_t i = 0; i < pages7.size(); i++) {
+				const PageId pageNo = pages7[(i * 37) % pages7.size()];
+				runMgr->readPage(&file7, pageNo, runPage);
+				sprintf(record, "test.7 Page %d run", pageNo);
+				runPage->insertRecord(record);
+				runMgr->unPinPage(&file7, pageNo, true);
+			}
+			for (size_t i = 0; i < pages6.size(); i += 3) {
+				runMgr->readPage(&file6, pages6[i], runPage);
+				sprintf(record, "test.6 Page %d again", pages6[i]);
+				runPage->insertRecord(record);
+				runMgr->unPinPage(&file6, pages6[i], true);
+			}
+			delete runMgr;
+		}
+
+		File file6 = File::open(filename6);
+		File file7 = File::open(filename7);
+		for (size_t i = 0; i < pages6.size(); i++) {
+			Page page = file6.readPage(pages6[i]);
+			RecordId recordId = {pages6[i], 1};
+			sprintf(record, "test.6 Page %d run", pages6[i]);
+			if (page.getRecord(recordId) != record)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			if (i % 3 == 0) {
+				RecordId againId = {pages6[i], 2};
+				sprintf(record, "test.6 Page %d again", pages6[i]);
+				if (page.getRecord(againId) != record)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+		}
+		for (size_t i = 0; i < pages7.size(); i++) {
+			Page page = file7.readPage(pages7[i]);
+			RecordId recordId = {pages7[i], 1};
+			sprintf(record, "test.7 Page %d run", pages7[i]);
+			if (page.getRecord(recordId) != record)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+	}
+
+	//A run holding a deleted page is refused whole
+	{
+		File file6 = File::open(filename6);
+		Page run[3];
+		Page* runPages[3];
+		for (int i = 0; i < 3; i++) {
+			run[i] = file6.readPage(i + 1);
+			run[i].insertRecord("test.6 refused");
+			runPages[i] = &run[i];
+		}
+		file6.deletePage(2);
+		try
+		{
+			file6.writePages(runPages, 3);
+			PRINT_ERROR("ERROR :: Writing a deleted page should have thrown InvalidPageException.");
+		}
+		catch(InvalidPageException& e)
+		{
+		}
+		Page first = file6.readPage(1);
+		RecordId refusedId = {1, 3};
+		try
+		{
+			first.getRecord(refusedId);
+			PRINT_ERROR("ERROR :: A refused run was written.");
+		}
+		catch(InvalidRecordException& e)
+		{
+		}
+	}
+	File::remove(filename6);
+	File::remove(filename7);
+
+	std::cout << "Test 23 passed" << "\n";
+}
+
+void test24()
+{
+	//CRC-32C matches its check value in hardware and software, pages written with
+	//checksums fail their read once corrupted, and pages written without are not checked
+	if (crc32c(0, "123456789", 9) != 0xe3069283 || crc32cSoftware(0, "123456789", 9) != 0xe3069283)
+		PRINT_ERROR("ERROR :: Wrong CRC-32C check value.");
+	std::vector<unsigned char> bytes(5000);
+	for (size_t i = 0; i < bytes.size(); i++)
+		bytes[i] = (unsigned char)(i * 131 + (i >> 7));
+	for (size_t length = 0; length < bytes.size(); length += 97) {
+		const std::uint32_t whole = crc32cSoftware(0, &bytes[1], length);
+		if (crc32c(0, &bytes[1], length) != whole ||
+				crc32c(crc32c(0, &bytes[1], length / 3), &bytes[1 + length / 3], length - length / 3) != whole)
+			PRINT_ERROR("ERROR :: CRC-32C versions disagree.");
+	}
+
+	const std::string filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+	FileOptions checkedOptions;
+	checkedOptions.checksums = true;
+	std::vector<PageId> pages;
+	{
+		File file6 = File::create(filename, checkedOptions);
+		char record[100];
+		for (int i = 0; i < 6; i++) {
+			Page page = file6.allocatePage();
+			sprintf(record, "test.6 Page %d checked", page.page_number());
+			page.insertRecord(record);
+			file6.writePage(page);
+			Page written = file6.readPage(page.page_number());
+			if (reinterpret_cast<PageHeader*>(&written)->checksum != File::pageChecksum(written))
+				PRINT_ERROR("ERROR :: Page written without its checksum.");
+			pages.push_back(page.page_number());
+		}
+	}
+
+	//Flip one data byte of the third page on disk
+	{
+		const int fd = open(filename.c_str(), O_RDWR);
+		const off_t position = (off_t)pages[2] * Page::SIZE + Page::SIZE - 100;
+		char byte;
+		if (pread(fd, &byte, 1, position) != 1)
+			PRINT_ERROR("ERROR :: Could not read the test file.");
+		byte ^= 0x10;
+		if (pwrite(fd, &byte, 1, position) != 1)
+			PRINT_ERROR("ERROR :: Could not write the test file.");
+		close(fd);
+	}
+
+	for (int mode = 0; mode < 3; mode++) {
+		//Checked through File, the stream BufMgr and the IoEngine alike, with or without
+		//the option, since the file was created with checksums
+		File file6 = File::open(filename, mode == 0 ? checkedOptions : FileOptions());
+		BufMgrOptions checkOptions;
+		checkOptions.streamIo = mode == 1;
+		BufMgr checkMgr(8, checkOptions);
+		for (size_t i = 0; i < pages.size(); i++) {
+			bool threw = false;
+			try
+			{
+				if (mode == 0) {
+					file6.readPage(pages[i]);
+				}
+				else {
+					Page* page;
+					checkMgr.readPage(&file6, pages[i], page);
+					checkMgr.unPinPage(&file6, pages[i], false);
+				}
+			}
+			catch(PageChecksumException& e)
+			{
+				threw = true;
+				if (e.page_number() != pages[i])
+					PRINT_ERROR("ERROR :: Checksum exception for the wrong page.");
+			}
+			if (threw != (i == 2))
+				PRINT_ERROR("ERROR :: Corrupt page not caught, or intact page refused.");
+		}
+	}
+
+	//Opened without the option, a file created with checksums still writes them
+	{
+		File file6 = File::open(filename);
+		if (!file6.checksums())
+			PRINT_ERROR("ERROR :: Checksums not taken from the file header.");
+		Page page = file6.readPage(pages[1]);
+		page.insertRecord("test.6 still checked");
+		file6.writePage(page);
+		Page written = file6.readPage(pages[1]);
+		if (reinterpret_cast<PageHeader*>(&written)->checksum != File::pageChecksum(written))
+			PRINT_ERROR("ERROR :: Page written without its checksum.");
+	}
+	File::remove(filename);
+
+	//Opened with the option, a file created without checksums is never checked, whatever
+	//its pages hold where the checksum goes
+	{
+		File file6 = File::create(filename);
+		Page page = file6.allocatePage();
+		page.insertRecord("test.6 unchecked");
+		reinterpret_cast<PageHeader*>(&page)->checksum = 3;
+		file6.writePage(page);
+		pages[0] = page.page_number();
+	}
+	{
+		File file6 = File::open(filename, checkedOptions);
+		if (file6.checksums())
+			PRINT_ERROR("ERROR :: Checksums not taken from the file header.");
+		Page page = file6.readPage(pages[0]);
+		RecordId recordId = {pages[0], 1};
+		if (page.getRecord(recordId) != "test.6 unchecked")
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	File::remove(filename);
+
+	//Files from before checksums have no flags in their header and a 16 byte page header,
+	//and files from before the LSN a 20 byte one ending with the checksum; both are
+	//upgraded when opened, keeping their records and whether they have checksums
+	std::vector<std::vector<std::string> > records(4);
+	records[1].push_back("test.6 older format page 1");
+	records[3].push_back("test.6 older format page 3");
+	records[3].push_back(std::string(3000, 'm'));
+	const std::uint32_t olderFlags[3] = {0, 0, File::CHECKSUM_FLAG};
+	for (int format = 0; format < 3; format++) {
+		if (format == 0)
+			writeMapFile(filename, File::MAP_FORMAT, offsetof(FileHeader, flags), 0, 16, records);
+		else
+			writeMapFile(filename, File::CHECKSUM_FORMAT, sizeof(FileHeader), olderFlags[format], 20, records);
+		for (int i = 0; i < 2; i++) {
+			File file6 = File::open(filename, format == 2 ? FileOptions() : checkedOptions);
+			if (file6.checksums() != (format == 2) ||
+					(i == 1 && headerOnDisk(filename).format != File::FILE_FORMAT))
+				PRINT_ERROR("ERROR :: File of an older format not upgraded.");
+			for (PageId n = 1; n <= 3; n += 2) {
+				Page page = file6.readPage(n);
+				if (reinterpret_cast<PageHeader*>(&page)->lsn != 0)
+					PRINT_ERROR("ERROR :: Upgraded page has an LSN.");
+				for (SlotId slot = 1; slot <= records[n].size(); slot++) {
+					RecordId recordId = {n, slot};
+					if (page.getRecord(recordId) != records[n][slot - 1])
+					{
+						PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+					}
+				}
+			}
+			if (i == 0 && file6.allocatePage().page_number() != 2)
+				PRINT_ERROR("ERROR :: Free page of an older format not reused.");
+		}
+		File::remove(filename);
+	}
+
+	//A page that fails its old checksum stops the upgrade before anything is rewritten
+	writeMapFile(filename, File::CHECKSUM_FORMAT, sizeof(FileHeader), File::CHECKSUM_FLAG, 20, records);
+	{
+		const int fd = open(filename.c_str(), O_RDWR);
+		const off_t position = 3 * (off_t)Page::SIZE + Page::SIZE - 1;
+		const char byte = 'n';
+		if (pwrite(fd, &byte, 1, position) != 1)
+			PRINT_ERROR("ERROR :: Could not write the test file.");
+		close(fd);
+	}
+	bool threw = false;
+	try
+	{
+		File file6 = File::open(filename);
+	}
+	catch(PageChecksumException& e)
+	{
+		threw = e.page_number() == 3;
+	}
+	if (!threw || headerOnDisk(filename).format != File::CHECKSUM_FORMAT)
+		PRINT_ERROR("ERROR :: Corrupt page of an older format upgraded.");
+	File::remove(filename);
+
+	std::cout << "Test 24 passed" << "\n";
+}
+
+void test25()
+{
+	//Changes logged before their pages are written back are redone from the log when the
+	//pages on disk miss them, and the log ends at its last whole record
+	const std::string filename = "test.6";
+	const std::string logname = "test.log";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+	unlink(logname.c_str());
+
+	std::vector<Page> before;
+	Lsn committed;
+	{
+		File file6 = File::create(filename);
+		for (int i = 0; i < 20; i++) {
+			before.push_back(file6.allocatePage());
+		}
+
+		LogManager log(logname);
+		BufMgrOptions logOptions;
+		logOptions.log = &log;
+		BufMgr logMgr(4, logOptions);
+		Page* page;
+		char record[100];
+		for (int i = 0; i < 20; i++) {
+			const PageId pageNo = before[i].page_number();
+			logMgr.readPage(&file6, pageNo, page);
+			sprintf(record, "test.6 Page %d logged", pageNo);
+			page->insertRecord(record);
+			if (i % 2 == 0) {
+				log.logPage(file6, *page);
+			}
+			else {
+				//Only the header and slot at the front and the record at the back changed
+				log.logUpdate(file6, *page, 0, 64);
+				log.logUpdate(file6, *page, Page::SIZE - 64, 64);
+			}
+			logMgr.unPinPage(&file6, pageNo, true);
+		}
+		committed = log.commit();
+		if (log.flushedLsn() < committed)
+			PRINT_ERROR("ERROR :: Commit returned before the log was durable.");
+
+		//Pages evicted from the 4 frames were written after their log records
+		for (int i = 0; i < 20; i++) {
+			Page onDisk = file6.readPage(before[i].page_number());
+			if (onDisk.lsn() > log.flushedLsn())
+				PRINT_ERROR("ERROR :: Page written ahead of its log records.");
+		}
+		logMgr.flushFile(&file6);
+
+		//Lose the pages as if the crash came before they were written
+		for (int i = 0; i < 20; i++) {
+			file6.writePage(before[i]);
+		}
+	}
+
+	for (int pass = 0; pass < 2; pass++) {
+		LogRecoveryStats stats;
+		{
+			LogManager log(logname);
+			stats = log.recover();
+		}
+		if (stats.end != committed || stats.skipped != 0 ||
+				stats.records != 31 || stats.redone != (pass == 0 ? 30 : 0u))
+			PRINT_ERROR("ERROR :: Recovery did not redo the logged changes once.");
+
+		File file6 = File::open(filename);
+		char record[100];
+		for (int i = 0; i < 20; i++) {
+			const PageId pageNo = before[i].page_number();
+			Page page = file6.readPage(pageNo);
+			RecordId recordId = {pageNo, 1};
+			sprintf(record, "test.6 Page %d logged", pageNo);
+			if (page.getRecord(recordId) != record)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+	}
+
+	//A torn record at the end is cut off when the log is opened
+	{
+		const int fd = open(logname.c_str(), O_WRONLY | O_APPEND);
+		const char garbage[100] = {1, 2, 3};
+		if (write(fd, garbage, sizeof(garbage)) != (ssize_t)sizeof(garbage))
+			PRINT_ERROR("ERROR :: Could not write the test log.");
+		close(fd);
+		LogManager log(logname);
+		struct stat status;
+		if (log.endLsn() != committed || stat(logname.c_str(), &status) != 0 ||
+				(Lsn)status.st_size != committed)
+			PRINT_ERROR("ERROR :: Torn log tail not cut off.");
+		if (log.commit() <= committed)
+			PRINT_ERROR("ERROR :: Log did not go on from its end.");
+	}
+	File::remove(filename);
+	unlink(logname.c_str());
+
+	std::cout << "Test 25 passed" << "\n";
+}
+
+void test26()
+{
+	//A checkpoint writes the pages changed before it without waiting for a page that stays
+	//pinned, and recovery then reads only the records logged since
+	const std::string filename = "test.6";
+	const std::string logname = "test.log";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+	unlink(logname.c_str());
+
+	std::vector<PageId> pageNos;
+	std::vector<Page> checkpointed;
+	Lsn end;
+	{
+		File file6 = File::create(filename);
+		for (int i = 0; i < 20; i++) {
+			pageNos.push_back(file6.allocatePage().page_number());
+		}
+
+		LogManager log(logname);
+		BufMgrOptions logOptions;
+		logOptions.log = &log;
+		BufMgr logMgr(8, logOptions);
+		Page* page;
+		char record[100];
+		for (int i = 0; i < 20; i++) {
+			logMgr.readPage(&file6, pageNos[i], page);
+			sprintf(record, "test.6 Page %d checkpointed", pageNos[i]);
+			page->insertRecord(record);
+			log.logPage(file6, *page);
+			logMgr.unPinPage(&file6, pageNos[i], true);
+		}
+
+		std::vector<BufDirtyPage> dirty;
+		logMgr.dirtyPages(dirty);
+		if (dirty.empty())
+			PRINT_ERROR("ERROR :: Dirty pages missing from the dirty page table.");
+		for (std::size_t i = 0; i < dirty.size(); i++) {
+			if (dirty[i].file != &file6 || dirty[i].recLsn >= log.endLsn())
+				PRINT_ERROR("ERROR :: Wrong recovery LSN in the dirty page table.");
+		}
+
+		//Change the first page, evicted by now, while it stays pinned through the checkpoint
+		const Lsn pinnedAt = log.endLsn();
+		logMgr.readPage(&file6, pageNos[0], page);
+		page->insertRecord("test.6 pinned");
+		log.logPage(file6, *page);
+		const Lsn redo = logMgr.checkpoint();
+		if (redo != pinnedAt || log.startLsn() != pinnedAt || logMgr.redoLsn() != pinnedAt)
+			PRINT_ERROR("ERROR :: Pinned page did not hold the redo start back.");
+		logMgr.dirtyPages(dirty);
+		if (!dirty.empty())
+			PRINT_ERROR("ERROR :: Checkpoint left pages dirty.");
+		logMgr.unPinPage(&file6, pageNos[0], true);
+
+		end = log.endLsn();
+		if (logMgr.checkpoint() != end || log.startLsn() != end)
+			PRINT_ERROR("ERROR :: Checkpoint did not move the log start to its end.");
+		for (int i = 0; i < 20; i++) {
+			checkpointed.push_back(file6.readPage(pageNos[i]));
+			RecordId recordId = {pageNos[i], 1};
+			sprintf(record, "test.6 Page %d checkpointed", pageNos[i]);
+			if (checkpointed[i].getRecord(recordId) != record)
+				PRINT_ERROR("ERROR :: Checkpoint did not write the page.");
+		}
+
+		//Three changes after the checkpoint, lost with their pages
+		for (int i = 0; i < 3; i++) {
+			logMgr.readPage(&file6, pageNos[i], page);
+			page->insertRecord("test.6 after checkpoint");
+			log.logUpdate(file6, *page, 0, 64);
+			log.logUpdate(file6, *page, Page::SIZE - 64, 64);
+			logMgr.unPinPage(&file6, pageNos[i], true);
+		}
+		end = log.commit();
+		logMgr.flushFile(&file6);
+		for (int i = 0; i < 3; i++) {
+			file6.writePage(checkpointed[i]);
+		}
+	}
+
+	{
+		LogRecoveryStats stats;
+		{
+			LogManager log(logname);
+			stats = log.recover();
+		}
+		if (stats.end != end || stats.records != 7 || stats.redone != 6)
+			PRINT_ERROR("ERROR :: Recovery did not start at the checkpoint.");
+		File file6 = File::open(filename);
+		for (int i = 0; i < 3; i++) {
+			Page page = file6.readPage(pageNos[i]);
+			//The first page also holds the record added while it was pinned
+			RecordId recordId = {pageNos[i], (SlotId)(i == 0 ? 3 : 2)};
+			if (page.getRecord(recordId) != "test.6 after checkpoint")
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+
+	//The checkpointer keeps the log start close behind its end
+	{
+		File file6 = File::open(filename);
+		LogManager log(logname);
+		BufMgrOptions logOptions;
+		logOptions.log = &log;
+		logOptions.checkpointLogBytes = 64 * Page::SIZE;
+		BufMgr logMgr(8, logOptions);
+		Page* page;
+		for (int i = 0; i < 200; i++) {
+			logMgr.readPage(&file6, pageNos[i % 20], page);
+			log.logPage(file6, *page);
+			logMgr.unPinPage(&file6, pageNos[i % 20], true);
+		}
+		for (int wait = 0; wait < 1000 && logMgr.getCheckpointStats().checkpoints == 0; wait++) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (logMgr.getCheckpointStats().checkpoints == 0 || log.startLsn() <= end)
+			PRINT_ERROR("ERROR :: Checkpointer did not checkpoint.");
+		logMgr.flushFile(&file6);
+	}
+	File::remove(filename);
+	unlink(logname.c_str());
+
+	std::cout << "Test 26 passed" << "\n";
+}
+
+void test27()
+{
+	//A pool split into partitions maps every page in its home partition, takes frames
+	//from the other partitions once the home's are all pinned, and runs out only when
+	//every frame is pinned
+	const std::uint32_t frames = 10;
+	char expected[100];
+	BufMgrOptions options;
+	options.partitions = 4;
+	BufMgr partMgr(frames, options);
+	if (partMgr.partitionCount() != 4)
+		PRINT_ERROR("ERROR :: Wrong number of partitions.");
+
+	std::vector<int> homes(4, 0);
+	for (i = 1; i <= num; i++) {
+		homes[partMgr.homePartition(file1ptr, i)]++;
+	}
+	for (int p = 0; p < 4; p++) {
+		if (homes[p] == 0)
+			PRINT_ERROR("ERROR :: A partition is home to no page.");
+	}
+
+	Page* partPage;
+	for (int op = 0; op < 2000; op++) {
+		PageId pageNo = op % 2 == 0 ? (PageId)(op / 2 % 3 + 1) : (PageId)(op / 2 % num + 1);
+		RecordId recordId = {pageNo, 1};
+		partMgr.readPage(file1ptr, pageNo, partPage);
+		sprintf(expected, "test.1 Page %d %7.1f", pageNo, (float)pageNo);
+		if (strncmp(partPage->getRecord(recordId).c_str(), expected, strlen(expected)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		partMgr.unPinPage(file1ptr, pageNo, false);
+	}
+
+	for (i = 1; i <= frames; i++)
+		partMgr.readPage(file1ptr, i, partPage);
+	try
+	{
+		partMgr.readPage(file1ptr, frames + 1, partPage);
+		PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(BufferExceededException& e)
+	{
+	}
+	for (i = 1; i <= frames; i++)
+		partMgr.unPinPage(file1ptr, i, false);
+	partMgr.flushFile(file1ptr);
+
+	//New pages, which have no home until they are numbered, come back through their home
+	const std::string filename = "test.6";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+	{
+		File file6 = File::create(filename);
+		std::vector<PageId> pageNos;
+		PageId pageNo;
+		for (i = 0; i < 30; i++) {
+			partMgr.allocPage(&file6, pageNo, partPage);
+			sprintf(expected, "test.6 Page %d partitioned", pageNo);
+			partPage->insertRecord(expected);
+			partMgr.unPinPage(&file6, pageNo, true);
+			pageNos.push_back(pageNo);
+		}
+		for (i = 0; i < 30; i++) {
+			partMgr.readPage(&file6, pageNos[i], partPage);
+			RecordId recordId = {pageNos[i], 1};
+			sprintf(expected, "test.6 Page %d partitioned", pageNos[i]);
+			if (partPage->getRecord(recordId) != expected)
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			partMgr.unPinPage(&file6, pageNos[i], false);
+		}
+		partMgr.flushFile(&file6);
+	}
+	File::remove(filename);
+
+	//One partition per node by default
+	BufMgrOptions nodeOptions;
+	nodeOptions.partitions = 0;
+	BufMgr nodeMgr(frames, nodeOptions);
+	if (nodeMgr.partitionCount() != std::min<std::uint32_t>(numaNodes().size(), frames))
+		PRINT_ERROR("ERROR :: Expected one partition per NUMA node.");
+
+	std::cout << "Test 27 passed" << "\n";
+}
+
+void test28()
+{
+	//The pool grows and shrinks while threads read through it: pinned pages stay where
+	//they are, and pages moved out of frames given back keep their changes
+	const std::uint32_t sizes[6] = {60, 10, 45, 12, 33, 20};
+	const std::string filename = "test.7";
+	char expected[100];
+	Page* resizePage;
+	for (int policy = CLOCK_POLICY; policy <= ARC_POLICY; policy++) {
+		for (std::uint32_t parts = 1; parts <= 3; parts += 2) {
+			BufMgrOptions options;
+			options.policyType = BufPolicyType(policy);
+			options.tableType = policy % 2 == 0 ? PROBING_TABLE : CHAINED_TABLE;
+			options.partitions = parts;
+			options.maxBufs = 60;
+			BufMgr resizeMgr(20, options);
+			if (resizeMgr.poolSize() != 20 || resizeMgr.maxPoolSize() != 60)
+				PRINT_ERROR("ERROR :: Wrong pool size.");
+
+			//Three pinned pages, read first, so they sit in frames every size keeps
+			Page* pinned[3];
+			for (i = 0; i < 3; i++)
+				resizeMgr.readPage(file1ptr, i + 1, pinned[i]);
+
+			//Dirty pages of a new file, left unpinned to be moved around
+			try
+			{
+				File::remove(filename);
+			}
+			catch(FileNotFoundException& e)
+			{
+			}
+			File file7 = File::create(filename);
+			std::vector<PageId> pageNos;
+			PageId pageNo;
+			for (i = 0; i < 5; i++) {
+				resizeMgr.allocPage(&file7, pageNo, resizePage);
+				sprintf(expected, "test.7 Page %d resized", pageNo);
+				resizePage->insertRecord(expected);
+				resizeMgr.unPinPage(&file7, pageNo, true);
+				pageNos.push_back(pageNo);
+			}
+
+			std::atomic<bool> stop(false);
+			std::atomic<int> errors(0);
+			std::vector<std::thread> readers;
+			for (int t = 0; t < 3; t++) {
+				readers.push_back(std::thread([&resizeMgr, &stop, &errors, t]() {
+					unsigned seed = t + 1;
+					char want[100];
+					Page* readerPage;
+					while (!stop) {
+						const PageId readNo = rand_r(&seed) % num + 1;
+						RecordId recordId = {readNo, 1};
+						resizeMgr.readPage(file1ptr, readNo, readerPage);
+						sprintf(want, "test.1 Page %d %7.1f", readNo, (float)readNo);
+						if (strncmp(readerPage->getRecord(recordId).c_str(), want, strlen(want)) != 0)
+							errors++;
+						resizeMgr.unPinPage(file1ptr, readNo, false);
+					}
+				}));
+			}
+
+			for (int s = 0; s < 6; s++) {
+				resizeMgr.resize(sizes[s]);
+				if (resizeMgr.poolSize() != sizes[s])
+					PRINT_ERROR("ERROR :: Pool was not resized.");
+				for (i = 0; i < 3; i++) {
+					resizeMgr.readPage(file1ptr, i + 1, resizePage);
+					RecordId recordId = {i + 1, 1};
+					sprintf(expected, "test.1 Page %d %7.1f", i + 1, (float)(i + 1));
+					if (resizePage != pinned[i] ||
+							strncmp(pinned[i]->getRecord(recordId).c_str(), expected, strlen(expected)) != 0)
+						PRINT_ERROR("ERROR :: A pinned page moved.");
+					resizeMgr.unPinPage(file1ptr, i + 1, false);
+				}
+			}
+			stop = true;
+			for (int t = 0; t < 3; t++)
+				readers[t].join();
+			if (errors > 0)
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+
+			for (i = 0; i < 5; i++) {
+				resizeMgr.readPage(&file7, pageNos[i], resizePage);
+				RecordId recordId = {pageNos[i], 1};
+				sprintf(expected, "test.7 Page %d resized", pageNos[i]);
+				if (resizePage->getRecord(recordId) != expected)
+					PRINT_ERROR("ERROR :: A moved page lost its changes.");
+				resizeMgr.unPinPage(&file7, pageNos[i], false);
+			}
+			resizeMgr.flushFile(&file7);
+			for (i = 0; i < 5; i++) {
+				Page onDisk = file7.readPage(pageNos[i]);
+				RecordId recordId = {pageNos[i], 1};
+				sprintf(expected, "test.7 Page %d resized", pageNos[i]);
+				if (onDisk.getRecord(recordId) != expected)
+					PRINT_ERROR("ERROR :: A moved page was not written back.");
+			}
+			for (i = 0; i < 3; i++)
+				resizeMgr.unPinPage(file1ptr, i + 1, false);
+		}
+	}
+	File::remove(filename);
+
+	//A shrink that would move a pinned page gives up and leaves the pool as it was
+	BufMgrOptions options;
+	options.maxBufs = 10;
+	BufMgr pinnedMgr(10, options);
+	for (i = 1; i <= 10; i++)
+		pinnedMgr.readPage(file1ptr, i, resizePage);
+	try
+	{
+		pinnedMgr.resize(5);
+		PRINT_ERROR("ERROR :: Page pinned in a frame given back. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(PagePinnedException& e)
+	{
+	}
+	if (pinnedMgr.poolSize() != 10)
+		PRINT_ERROR("ERROR :: A failed shrink changed the pool size.");
+
+	//With a single page left pinned in a frame given back, that is the page reported
+	FrameId frameOf[11];
+	PageId stuckPage = 0;
+	for (i = 1; i <= 10; i++) {
+		pinnedMgr.readPage(file1ptr, i, resizePage);
+		frameOf[i] = resizePage - pinnedMgr.bufPool;
+		pinnedMgr.unPinPage(file1ptr, i, false);
+		if (frameOf[i] >= 5 && stuckPage == 0)
+			stuckPage = i;
+	}
+	for (i = 1; i <= 10; i++) {
+		if (i != stuckPage)
+			pinnedMgr.unPinPage(file1ptr, i, false);
+	}
+	try
+	{
+		pinnedMgr.resize(5);
+		PRINT_ERROR("ERROR :: Page pinned in a frame given back. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(PagePinnedException& e)
+	{
+		PagePinnedException expected(file1ptr->filename(), stuckPage, frameOf[stuckPage]);
+		if (std::string(e.what()) != expected.what())
+			PRINT_ERROR("ERROR :: Shrink reported another frame than the pinned one.");
+	}
+	for (i = 1; i <= 10; i++) {
+		if (i != stuckPage)
+			pinnedMgr.readPage(file1ptr, i, resizePage);
+	}
+	pinnedMgr.unPinPage(file1ptr, 10, false);
+	pinnedMgr.readPage(file1ptr, 11, resizePage);
+	pinnedMgr.unPinPage(file1ptr, 11, false);
+	for (i = 1; i <= 9; i++)
+		pinnedMgr.unPinPage(file1ptr, i, false);
+
+	//Once unpinned it shrinks, and holds no more pages than it has frames
+	pinnedMgr.resize(5);
+	for (i = 1; i <= 5; i++)
+		pinnedMgr.readPage(file1ptr, i, resizePage);
+	try
+	{
+		pinnedMgr.readPage(file1ptr, 6, resizePage);
+		PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(BufferExceededException& e)
+	{
+	}
+	for (i = 1; i <= 5; i++)
+		pinnedMgr.unPinPage(file1ptr, i, false);
+	try
+	{
+		pinnedMgr.resize(11);
+		PRINT_ERROR("ERROR :: Grew beyond maxBufs. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(BufferExceededException& e)
+	{
+	}
+	pinnedMgr.flushFile(file1ptr);
+
+	//A shrink gives the memory of the frames back and sizes the tables down with the pool
+	const long systemPage = sysconf(_SC_PAGESIZE);
+	for (int table = CHAINED_TABLE; table <= PROBING_TABLE; table++) {
+		BufMgrOptions shrinkOptions;
+		shrinkOptions.tableType = BufTableType(table);
+		shrinkOptions.maxBufs = 4096;
+		BufMgr shrinkMgr(4096, shrinkOptions);
+		for (i = 1; i <= num; i++) {
+			shrinkMgr.readPage(file1ptr, i, resizePage);
+			shrinkMgr.unPinPage(file1ptr, i, false);
+		}
+		const std::uint32_t slotsBefore = shrinkMgr.tableSlots(0);
+		shrinkMgr.resize(64);
+		if (shrinkMgr.tableSlots(0) >= slotsBefore)
+			PRINT_ERROR("ERROR :: The table kept its size after a shrink.");
+		const std::size_t length = (std::size_t)(4096 - 64) * Page::SIZE;
+		std::vector<unsigned char> resident(length / systemPage);
+		if (mincore(shrinkMgr.bufPool + 64, length, &resident[0]) != 0)
+			PRINT_ERROR("ERROR :: Could not tell which frames are in memory.");
+		for (std::size_t p = 0; p < resident.size(); p++) {
+			if (resident[p] & 1) {
+				PRINT_ERROR("ERROR :: A frame given back still holds memory.");
+				break;
+			}
+		}
+		for (i = 1; i <= 64; i++) {
+			shrinkMgr.readPage(file1ptr, i, resizePage);
+			shrinkMgr.unPinPage(file1ptr, i, false);
+		}
+		shrinkMgr.resize(4096);
+		if (shrinkMgr.tableSlots(0) != slotsBefore)
+			PRINT_ERROR("ERROR :: The table did not grow back with the pool.");
+		for (i = 1; i <= num; i++) {
+			shrinkMgr.readPage(file1ptr, i, resizePage);
+			RecordId recordId = {i, 1};
+			sprintf(expected, "test.1 Page %d %7.1f", i, (float)i);
+			if (strncmp(resizePage->getRecord(recordId).c_str(), expected, strlen(expected)) != 0)
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			shrinkMgr.unPinPage(file1ptr, i, false);
+		}
+	}
+
+	std::cout << "Test 28 passed" << "\n";
+}
+
+void test29()
+{
+	//Every event is counted, per file too, and threads counting at once lose none.  Each
+	//reader times its last hit
+	BufMgr statsMgr(10);
+	Page* statsPage;
+	for (i = 1; i <= 10; i++) {
+		statsMgr.readPage(file1ptr, i, statsPage);
+		statsMgr.unPinPage(file1ptr, i, false);
+	}
+
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++) {
+		readers.push_back(std::thread([&statsMgr, t]() {
+			Page* readerPage;
+			for (std::uint32_t r = 0; r < BufMgr::HIT_SAMPLE; r++) {
+				const PageId readNo = (t + r) % 10 + 1;
+				statsMgr.readPage(file1ptr, readNo, readerPage);
+				statsMgr.unPinPage(file1ptr, readNo, false);
+			}
+		}));
+	}
+	for (std::size_t t = 0; t < readers.size(); t++)
+		readers[t].join();
+
+	//Five misses evict five pages, and three allocs three more
+	for (i = 11; i <= 15; i++) {
+		statsMgr.readPage(file1ptr, i, statsPage);
+		statsMgr.unPinPage(file1ptr, i, false);
+	}
+	const std::string filename = "test.8";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+	{
+		File file8 = File::create(filename);
+		PageId pageNos[3];
+		for (i = 0; i < 3; i++) {
+			statsMgr.allocPage(&file8, pageNos[i], statsPage);
+			statsMgr.unPinPage(&file8, pageNos[i], true);
+		}
+		statsMgr.disposePage(&file8, pageNos[0]);
+		statsMgr.flushFile(&file8);
+	}
+
+	BufStats stats = statsMgr.getBufStats();
+	if (stats.accesses != 4111 || stats.hits != 4096 || stats.misses != 15 || stats.evictions != 8 ||
+			stats.allocs != 3 || stats.disposes != 1 || stats.diskreads != 18 || stats.diskwrites != 2)
+		PRINT_ERROR("ERROR :: Wrong buffer pool counters.");
+	if (stats.missLatency.total != 15 || stats.hitLatency.total != 4 || stats.writeLatency.total == 0)
+		PRINT_ERROR("ERROR :: Wrong latency histograms.");
+	if (stats.files.size() != 2 || stats.files[0].filename != "test.1" || stats.files[1].filename != filename)
+		PRINT_ERROR("ERROR :: Wrong files in statistics.");
+	const BufFileStats& stats1 = stats.files[0];
+	const BufFileStats& stats8 = stats.files[1];
+	if (stats1.hits != 4096 || stats1.misses != 15 || stats1.evictions != 8 || stats1.writebacks != 0 ||
+			stats8.hits != 0 || stats8.allocs != 3 || stats8.disposes != 1 || stats8.writebacks != 2)
+		PRINT_ERROR("ERROR :: Wrong per file counters.");
+
+	//Cleared statistics count from zero, hits in frames included
+	statsMgr.clearBufStats();
+	statsMgr.readPage(file1ptr, 15, statsPage);
+	statsMgr.unPinPage(file1ptr, 15, false);
+	stats = statsMgr.getBufStats();
+	if (stats.accesses != 1 || stats.hits != 1 || stats.misses != 0 || stats.files.size() != 1 ||
+			stats.files[0].hits != 1 || stats.missLatency.total != 0)
+		PRINT_ERROR("ERROR :: Statistics were not cleared.");
+
+	File::remove(filename);
+
+	std::cout << "Test 29 passed" << "\n";
+}
+
+void test30()
+{
+	//Three frames: page 1 is reused after one other page, page 4 evicts a page x and
+	//reading x again evicts another
+	BufMgrOptions options;
+	options.traceEvents = 1024;
+	BufMgr traceMgr(3, options);
+	if (traceMgr.trace() == NULL || traceMgr.trace()->capacity() != 1024)
+		PRINT_ERROR("ERROR :: Trace was not made.");
+	Page* tracePage;
+	const PageId readNos[5] = {1, 2, 1, 3, 4};
+	for (i = 0; i < 5; i++) {
+		traceMgr.readPage(file1ptr, readNos[i], tracePage);
+		traceMgr.unPinPage(file1ptr, readNos[i], false);
+	}
+
+	std::vector<BufTraceEvent> events;
+	std::map<std::uint64_t, std::string> names;
+	traceMgr.trace()->snapshot(events, names);
+	PageId evictedNo = Page::INVALID_NUMBER;
+	int counts[TRACE_DISPOSE + 1] = {0};
+	for (std::size_t e = 0; e < events.size(); e++) {
+		counts[events[e].type]++;
+		if (events[e].type == TRACE_EVICT)
+			evictedNo = events[e].pageNo;
+	}
+	if (events.size() != 11 || counts[TRACE_MISS] != 4 || counts[TRACE_HIT] != 1 || counts[TRACE_UNPIN] != 5 ||
+			counts[TRACE_EVICT] != 1 || events[4].type != TRACE_HIT || events[4].pageNo != 1)
+		PRINT_ERROR("ERROR :: Wrong events traced.");
+	if (evictedNo == 4 || evictedNo == Page::INVALID_NUMBER)
+		PRINT_ERROR("ERROR :: Wrong page evicted in trace.");
+
+	//The evicted page comes back and is changed; the flush writes it
+	traceMgr.readPage(file1ptr, evictedNo, tracePage);
+	traceMgr.unPinPage(file1ptr, evictedNo, false);
+	traceMgr.readPage(file1ptr, evictedNo, tracePage);
+	traceMgr.unPinPage(file1ptr, evictedNo, true);
+	traceMgr.flushFile(file1ptr);
+
+	const std::string filename = "test.9";
+	try
+	{
+		File::remove(filename);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+	{
+		File file9 = File::create(filename);
+		PageId pageNo;
+		traceMgr.allocPage(&file9, pageNo, tracePage);
+		traceMgr.unPinPage(&file9, pageNo, false);
+		traceMgr.disposePage(&file9, pageNo);
+
+		events.clear();
+		names.clear();
+		traceMgr.trace()->snapshot(events, names);
+	}
+	File::remove(filename);
+
+	int flushedDirty = 0;
+	std::fill(counts, counts + TRACE_DISPOSE + 1, 0);
+	for (std::size_t e = 0; e < events.size(); e++) {
+		counts[events[e].type]++;
+		if (events[e].type == TRACE_FLUSH && (events[e].flags & TRACE_DIRTY)) {
+			flushedDirty++;
+			if (events[e].pageNo != evictedNo)
+				PRINT_ERROR("ERROR :: Wrong page flushed dirty in trace.");
+		}
+		if (e > 0 && events[e].nanos < events[e - 1].nanos)
+			PRINT_ERROR("ERROR :: Trace is out of order.");
+	}
+	if (events.size() != 22 || counts[TRACE_EVICT] != 2 || counts[TRACE_FLUSH] != 3 || flushedDirty != 1 ||
+			counts[TRACE_ALLOC] != 1 || counts[TRACE_DISPOSE] != 1 ||
+			events.back().frame == BufTraceEvent::NO_FRAME || names.size() != 2)
+		PRINT_ERROR("ERROR :: Wrong events traced.");
+
+	//Page 1 was reused after one other page and x right after itself; x was read again
+	BufTraceReport report;
+	report.build(events, names, 10);
+	if (report.files.size() != 2 || report.files[0].filename != "test.1" || report.files[1].filename != filename)
+		PRINT_ERROR("ERROR :: Wrong files in trace report.");
+	const BufTraceFileReport& report1 = report.files[0];
+	if (report1.accesses != 7 || report1.hits != 2 || report1.misses != 5 || report1.cold != 4 ||
+			report1.reuse[0] != 1 || report1.reuse[1] + report1.reuse[2] != 2 || report1.evictedClean != 2 ||
+			report1.flushed != 3 || report1.refetches != 1 || report1.lruFrames(0.3) != 1)
+		PRINT_ERROR("ERROR :: Wrong trace report.");
+	if (report.files[1].accesses != 1 || report.files[1].cold != 1 || report.files[1].disposed != 1)
+		PRINT_ERROR("ERROR :: Wrong trace report.");
+	if (report.topRefetches.size() != 1 || report.topRefetches[0].pageNo != evictedNo ||
+			report.topRefetches[0].count != 1)
+		PRINT_ERROR("ERROR :: Wrong refetched pages in trace report.");
+
+	//A trace file reads back as it was written; other files are refused
+	traceMgr.trace()->save("test.trace");
+	std::vector<BufTraceEvent> loaded;
+	std::map<std::uint64_t, std::string> loadedNames;
+	BufTrace::load("test.trace", loaded, loadedNames);
+	File::remove("test.trace");
+	if (loaded.size() != events.size() || loadedNames != names ||
+			std::memcmp(&loaded[0], &events[0], events.size() * sizeof(BufTraceEvent)) != 0)
+		PRINT_ERROR("ERROR :: Trace file was not read back.");
+	try
+	{
+		BufTrace::load("test.1", loaded, loadedNames);
+		PRINT_ERROR("ERROR :: Loaded a file that is not a trace.");
+	}
+	catch(IoErrorException& e)
+	{
+	}
+
+	//A small ring keeps the latest events of its thread; a snapshot leaves out the oldest,
+	//whose slot the next event may be taking
+	options.traceEvents = 3;
+	BufMgr ringMgr(3, options);
+	for (i = 1; i <= 3; i++) {
+		ringMgr.readPage(file1ptr, i, tracePage);
+		ringMgr.unPinPage(file1ptr, i, false);
+	}
+	events.clear();
+	ringMgr.trace()->snapshot(events, names);
+	if (ringMgr.trace()->capacity() != 4 || events.size() != 3 || events[0].type != TRACE_UNPIN ||
+			events[0].pageNo != 2 || events[2].type != TRACE_UNPIN || events[2].pageNo != 3)
+		PRINT_ERROR("ERROR :: Wrong events kept in a full ring.");
+	ringMgr.flushFile(file1ptr);
+
+	//Every thread records in a ring of its own; a snapshot merges them in time order
+	options.traceEvents = 1024;
+	BufMgr threadMgr(10, options);
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; t++) {
+		readers.push_back(std::thread([&threadMgr, t]() {
+			Page* readerPage;
+			for (int r = 0; r < 50; r++) {
+				const PageId readNo = (t + r) % 10 + 1;
+				threadMgr.readPage(file1ptr, readNo, readerPage);
+				threadMgr.unPinPage(file1ptr, readNo, false);
+			}
+		}));
+	}
+	for (std::size_t t = 0; t < readers.size(); t++)
+		readers[t].join();
+	events.clear();
+	threadMgr.trace()->snapshot(events, names);
+	if (events.size() != 400)
+		PRINT_ERROR("ERROR :: Events of threads were lost.");
+	for (std::size_t e = 1; e < events.size(); e++) {
+		if (events[e].nanos < events[e - 1].nanos)
+			PRINT_ERROR("ERROR :: Trace is out of order.");
+	}
+	threadMgr.flushFile(file1ptr);
+
+	//Without the option there is no trace
+	BufMgr plainMgr(3);
+	if (plainMgr.trace() != NULL)
+		PRINT_ERROR("ERROR :: Trace made without the option.");
+
+	std::cout << "Test 30 passed" << "\n";
+}
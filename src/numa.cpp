@@ -0,0 +1,121 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "numa.h"
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+namespace {
+
+// Memory policy and flag of mbind(2), from <linux/mempolicy.h>
+const int MPOL_BIND_MODE = 2;
+const unsigned MPOL_MF_MOVE_FLAG = 1 << 1;
+
+// Largest node number the mbind node mask holds
+const int MAX_NODES = 1024;
+
+// Parses a sysfs list such as "0-3,8,10-11".
+std::vector<int> parseList(const std::string& text) {
+  std::vector<int> values;
+  std::istringstream in(text);
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    int first;
+    int last;
+    char dash;
+    std::istringstream parts(range);
+    if (!(parts >> first)) {
+      continue;
+    }
+    last = first;
+    if (parts >> dash >> last && dash != '-') {
+      last = first;
+    }
+    for (int value = first; value <= last; ++value) {
+      values.push_back(value);
+    }
+  }
+  return values;
+}
+
+std::vector<int> readList(const std::string& path) {
+  std::ifstream in(path.c_str());
+  std::string text;
+  std::getline(in, text);
+  return parseList(text);
+}
+
+std::vector<int> onlineNodes() {
+  std::vector<int> nodes = readList("/sys/devices/system/node/online");
+  if (nodes.empty()) {
+    nodes.push_back(0);
+  }
+  return nodes;
+}
+
+}
+
+const std::vector<int>& numaNodes() {
+  static const std::vector<int> nodes = onlineNodes();
+  return nodes;
+}
+
+int numaCurrentNode() {
+  unsigned cpu;
+  unsigned node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+    return 0;
+  }
+  return node;
+}
+
+bool numaRunOnNode(const int node) {
+  std::ostringstream path;
+  path << "/sys/devices/system/node/node" << node << "/cpulist";
+  const std::vector<int> cpus = readList(path.str());
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (std::size_t i = 0; i < cpus.size(); ++i) {
+    if (cpus[i] < CPU_SETSIZE) {
+      CPU_SET(cpus[i], &set);
+    }
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+bool numaBindMemory(void* addr, const std::size_t length, const int node) {
+  if (node < 0 || node >= MAX_NODES) {
+    return false;
+  }
+  const std::uintptr_t page = sysconf(_SC_PAGESIZE);
+  const std::uintptr_t start =
+      (reinterpret_cast<std::uintptr_t>(addr) + page - 1) / page * page;
+  const std::uintptr_t end =
+      (reinterpret_cast<std::uintptr_t>(addr) + length) / page * page;
+  if (end <= start) {
+    return true;
+  }
+  const int bits = 8 * sizeof(unsigned long);
+  unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+  mask[node / bits] = 1UL << (node % bits);
+  return syscall(SYS_mbind, start, end - start, MPOL_BIND_MODE, mask,
+                 MAX_NODES, MPOL_MF_MOVE_FLAG) == 0;
+}
+
+}
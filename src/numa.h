@@ -0,0 +1,51 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * Returns the numbers of the NUMA nodes the system has online, in ascending
+ * order; just node 0 when the kernel does not say (no NUMA support).  Read
+ * from sysfs once and cached.
+ */
+const std::vector<int>& numaNodes();
+
+/**
+ * Returns the node of the CPU the calling thread runs on at the moment; 0
+ * when the kernel does not say.
+ */
+int numaCurrentNode();
+
+/**
+ * Restricts the calling thread to the CPUs of a node.
+ *
+ * @param node  Node to run on.
+ * @return  False if the node has no CPUs listed or the affinity could not be
+ *          set; the thread then runs where it did.
+ */
+bool numaRunOnNode(int node);
+
+/**
+ * Binds the memory pages that lie wholly within length bytes at addr to a
+ * node (mbind with MPOL_BIND), moving those already touched.  Done with the
+ * system call itself, so no libnuma is needed.
+ *
+ * @param addr    Start of the range, part of a private mapping.
+ * @param length  Bytes in the range.
+ * @param node    Node to bind to.
+ * @return  False if the kernel refused, e.g. without NUMA support or inside
+ *          a container that forbids it; the memory then stays where the
+ *          default policy (first touch) puts it.
+ */
+bool numaBindMemory(void* addr, std::size_t length, int node);
+
+}
@@ -57,6 +57,24 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * LSN of the last log record that changed the page (see LogManager); 0 if
+   * no record did.
+   */
+  Lsn lsn;
+
+  /**
+   * Unused; keeps checksum at the end of the header without padding.
+   */
+  std::uint32_t reserved;
+
+  /**
+   * CRC-32C of the page as last written, taken without this field; 0 if it
+   * was written without one.  File sets it in the page it writes, or in a copy
+   * of a page it is handed as const, and checks it when it reads the page.
+   */
+  std::uint32_t checksum;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -199,6 +217,13 @@ class Page {
    */
   PageId next_page_number() const { return header_.next_page_number; }
 
+  /**
+   * Returns the LSN of the last log record that changed this page, or 0.
+   *
+   * @return  Page LSN.
+   */
+  Lsn lsn() const { return header_.lsn; }
+
   /**
    * Returns an iterator at the first record in the page.
    *
@@ -238,6 +263,13 @@ class Page {
     header_.next_page_number = new_next_page_number;
   }
 
+  /**
+   * Sets the LSN of the last log record that changed this page.
+   *
+   * @param new_lsn   LSN of the record.
+   */
+  void set_lsn(const Lsn new_lsn) { header_.lsn = new_lsn; }
+
   /**
    * Deletes the record with the given ID.  Page is compacted upon delete to
    * ensure that data of all records is contiguous.  Slot array is compacted if
@@ -327,12 +359,14 @@ class Page {
 
   /**
    * Data stored on the page.  Includes bookkeeping information about slots as
-   * well as actual content.
+   * well as actual content.  Held inline, so a Page is exactly SIZE bytes with
+   * no storage of its own on the heap and can live directly in the buffer pool
+   * arena.
    */
-
-  std::string data_;
+  char data_[DATA_SIZE];
 
   friend class File;
+  friend class LogManager;
   friend class PageIterator;
   friend class PageTest;
   friend class BufferTest;
@@ -342,5 +376,7 @@ static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(sizeof(Page) == Page::SIZE,
+              "Page must hold exactly its header and data.");
 
 }
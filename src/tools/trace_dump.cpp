@@ -0,0 +1,48 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Report of a buffer pool trace written by BufTrace::save().
+//
+// usage: trace_dump <trace> [top]
+//
+// For every file: its accesses, how far apart reuses of a page are and what hit
+// rate an LRU pool of each size would get, why pages left the pool and how many
+// were read again after an eviction.  Then the top pages read again most.
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "bufTrace.h"
+#include "exceptions/badgerdb_exception.h"
+
+using namespace badgerdb;
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <trace> [top]\n";
+    return 2;
+  }
+  const std::size_t top = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 10;
+
+  std::vector<BufTraceEvent> events;
+  std::map<std::uint64_t, std::string> names;
+  try {
+    BufTrace::load(argv[1], events, names);
+  } catch (const BadgerDbException& e) {
+    std::cerr << e.message() << "\n";
+    return 1;
+  }
+
+  BufTraceReport report;
+  report.build(events, names, top);
+  std::cout << events.size() << " events\n";
+  report.print(std::cout);
+  return 0;
+}
@@ -0,0 +1,140 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "twoQPolicy.h"
+
+namespace badgerdb {
+
+TwoQPolicy::TwoQPolicy(const std::uint32_t bufs)
+	: accesses(bufs), numBufs(bufs), kin(bufs / 4 > 0 ? bufs / 4 : 1), prev(bufs), next(bufs), owner(bufs, NULL),
+	  a1in(prev, next, owner), am(prev, next, owner), a1out(bufs / 2), keys(bufs)
+{
+  for (std::uint32_t i = bufs; i > 0; i--)
+    freeFrames.push_back(i - 1);
+}
+
+void TwoQPolicy::loaded(const FrameId frame, const File* file, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  PageKey key = {file, pageNo};
+  keys[frame] = key;
+
+  if (a1out.remove(key))
+    am.pushFront(frame);
+  else
+    a1in.pushFront(frame);
+}
+
+void TwoQPolicy::accessed(const FrameId frame)
+{
+  accesses.record(frame);
+}
+
+// Hits in a1in do not move the page: correlated references right after the first one
+// say nothing about reuse
+void TwoQPolicy::applyAccesses()
+{
+  accesses.replay([this](const FrameId frame, const std::uint32_t hits) {
+    if (frame < numBufs && am.contains(frame))
+      am.moveToFront(frame);
+  });
+}
+
+void TwoQPolicy::freed(const FrameId frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  if (a1in.contains(frame))
+    a1in.erase(frame);
+  else if (am.contains(frame))
+    am.erase(frame);
+  else
+    return;
+  freeFrames.push_back(frame);
+}
+
+// A frame already in a1in keeps its place in the FIFO; one the previous page had
+// promoted to am goes back to a1in
+void TwoQPolicy::recycled(const FrameId frame, const File* file, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  PageKey key = {file, pageNo};
+  keys[frame] = key;
+  if (am.contains(frame)) {
+    am.erase(frame);
+    a1in.pushFront(frame);
+  }
+}
+
+bool TwoQPolicy::victim(FrameReclaimer& reclaimer, const File* file, const PageId pageNo, FrameId& frame)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+
+  if (!freeFrames.empty() && reclaimer.reclaim(freeFrames.back())) {
+    frame = freeFrames.back();
+    freeFrames.pop_back();
+    return true;
+  }
+
+  // Take from a1in while it is over its target, otherwise from am; fall back to the
+  // other queue if every page of the preferred one is pinned
+  if (a1in.size() > kin && a1in.reclaimOldest(reclaimer, frame)) {
+    a1out.add(keys[frame]);
+    return true;
+  }
+  if (am.reclaimOldest(reclaimer, frame))
+    return true;
+  if (a1in.reclaimOldest(reclaimer, frame)) {
+    a1out.add(keys[frame]);
+    return true;
+  }
+  return false;
+}
+
+void TwoQPolicy::upcoming(const std::size_t count, std::vector<FrameId>& frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  const std::size_t first = frames.size();
+  if (a1in.size() > kin)
+    a1in.oldest(std::min(count, a1in.size() - kin), frames);
+  am.oldest(count - (frames.size() - first), frames);
+  // With am empty the victims come from a1in whatever its size
+  if (frames.size() == first)
+    a1in.oldest(count, frames);
+}
+
+// Pages of dropped frames that had been promoted to am go to a1out, so that the page
+// the buffer manager moves to another frame goes back to am when it is loaded there
+void TwoQPolicy::resize(const std::uint32_t frames)
+{
+  std::lock_guard<std::mutex> guard(latch);
+  applyAccesses();
+  for (FrameId f = frames; f < numBufs; f++) {
+    if (a1in.contains(f)) {
+      a1in.erase(f);
+    }
+    else if (am.contains(f)) {
+      am.erase(f);
+      a1out.add(keys[f]);
+    }
+  }
+  freeFrames.erase(std::remove_if(freeFrames.begin(), freeFrames.end(),
+      [frames](const FrameId f) { return f >= frames; }), freeFrames.end());
+  for (FrameId f = frames; f > numBufs; f--)
+    freeFrames.push_back(f - 1);
+  numBufs = frames;
+
+  kin = frames / 4 > 0 ? frames / 4 : 1;
+  a1out.resize(frames / 2);
+}
+
+}
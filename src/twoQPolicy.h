@@ -0,0 +1,99 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "bufPolicy.h"
+
+namespace badgerdb {
+
+/**
+* @brief 2Q replacement (Johnson and Shasha, full version)
+*
+* A page seen for the first time enters the FIFO queue A1in.  When it is evicted from
+* A1in only its identity is remembered, in the ghost queue A1out.  A page that comes back
+* while it is still in A1out has proven to be reused and enters the LRU queue Am.  Scans
+* therefore only churn A1in and never push hot pages out of Am.
+*/
+class TwoQPolicy : public BufPolicy
+{
+ private:
+	/**
+	 * Hits not yet applied; record() needs no latch
+	 */
+  AccessLog accesses;
+
+	/**
+	 * Protects all the members below
+	 */
+  std::mutex latch;
+
+	/**
+	 * Number of frames in the buffer pool; the arrays below may hold more
+	 */
+  std::uint32_t numBufs;
+
+	/**
+	 * Target size of A1in (a quarter of the frames)
+	 */
+  std::size_t kin;
+
+	/**
+	 * Link arrays shared by a1in and am
+	 */
+  std::vector<FrameId> prev;
+  std::vector<FrameId> next;
+  std::vector<const FrameList*> owner;
+
+	/**
+	 * FIFO of pages referenced once, LRU of pages referenced again after leaving a1in
+	 */
+  FrameList a1in;
+  FrameList am;
+
+	/**
+	 * Pages recently evicted from a1in (half as many as there are frames)
+	 */
+  GhostList a1out;
+
+	/**
+	 * Page held by each resident frame
+	 */
+  std::vector<PageKey> keys;
+
+	/**
+	 * Frames holding no page
+	 */
+  std::vector<FrameId> freeFrames;
+
+	/**
+	 * Applies the hits noted in accesses since the last call; called under the latch
+	 */
+  void applyAccesses();
+
+ public:
+	/**
+   * Constructor of TwoQPolicy class
+	 *
+	 * @param bufs   	Number of frames in the buffer pool
+	 */
+  explicit TwoQPolicy(const std::uint32_t bufs);
+
+  virtual void loaded(const FrameId frame, const File* file, const PageId pageNo);
+  virtual void accessed(const FrameId frame);
+  virtual void freed(const FrameId frame);
+  virtual void recycled(const FrameId frame, const File* file, const PageId pageNo);
+  virtual bool victim(FrameReclaimer& reclaimer, const File* file, const PageId pageNo, FrameId& frame);
+  virtual void upcoming(const std::size_t count, std::vector<FrameId>& frames);
+  virtual void resize(const std::uint32_t frames);
+  virtual const char* name() const { return "2q"; }
+};
+
+}
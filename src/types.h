@@ -24,6 +24,12 @@ typedef std::uint16_t SlotId;
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Log sequence number: the offset in the log just past a log record.
+ *        0 means no record.
+ */
+typedef std::uint64_t Lsn;
+
 /**
  * @brief Identifier for a record in a page.
  */